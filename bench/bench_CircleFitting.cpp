@@ -0,0 +1,56 @@
+#include "bench_common.hpp"
+
+#include "CircleFitting/CircleFitting.hpp"
+
+namespace {
+
+const double cx = 3.0;
+const double cy = -2.0;
+const double r  = 10.0;
+
+std::shared_ptr<CircleFittingProblem> makeCircleProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    std::vector<double> x(nbPts), y(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        if (i < (int)(nbPts * outliersRatio))
+        {
+            x[i] = uniform(cx - 2.0 * r, cx + 2.0 * r);
+            y[i] = uniform(cy - 2.0 * r, cy + 2.0 * r);
+        }
+        else
+        {
+            double angle = uniform(0.0, 2.0 * M_PI);
+            x[i] = cx + r * std::cos(angle) + noise();
+            y[i] = cy + r * std::sin(angle) + noise();
+        }
+    }
+
+    auto problem = std::make_shared<CircleFittingProblem>();
+    problem->setData(x, y);
+    return problem;
+}
+
+robest::bench::ProblemCache<CircleFittingProblem> cache(makeCircleProblem);
+
+template<typename Estimator>
+void BM_CircleFitting(benchmark::State & state)
+{
+    auto problem = cache.get((int) state.range(0), (int) state.range(1));
+
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        double res_cx, res_cy, res_r;
+        problem->getResult(res_cx, res_cy, res_r);
+        return std::fabs(res_cx - cx) + std::fabs(res_cy - cy) + std::fabs(res_r - r);
+    });
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_CircleFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_CircleFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_CircleFitting, robest::LMedS)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_CircleFitting, robest::MAGSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_CircleFitting, robest::ThresholdSweep)->Apply(robest::bench::sweep);
@@ -0,0 +1,60 @@
+#include "bench_common.hpp"
+
+#include "HomographyFitting/HomographyFitting.hpp"
+
+namespace {
+
+// perspective view of a 100x100 image, row-major with H[8] = 1
+const double H[9] = {0.9,    0.05,   3.0,
+                     -0.1,   1.1,    1.0,
+                     1.0e-3, -2.0e-3, 1.0};
+
+std::shared_ptr<HomographyFittingProblem> makeHomographyProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    std::vector<double> px(nbPts), py(nbPts), qx(nbPts), qy(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        px[i] = uniform(0.0, 100.0);
+        py[i] = uniform(0.0, 100.0);
+        if (i < (int)(nbPts * outliersRatio))
+        {
+            qx[i] = uniform(0.0, 100.0);
+            qy[i] = uniform(0.0, 100.0);
+        }
+        else
+        {
+            const double w = H[6] * px[i] + H[7] * py[i] + H[8];
+            qx[i] = (H[0] * px[i] + H[1] * py[i] + H[2]) / w + noise();
+            qy[i] = (H[3] * px[i] + H[4] * py[i] + H[5]) / w + noise();
+        }
+    }
+
+    auto problem = std::make_shared<HomographyFittingProblem>();
+    problem->setData(px, py, qx, qy);
+    return problem;
+}
+
+robest::bench::ProblemCache<HomographyFittingProblem> cache(makeHomographyProblem);
+
+template<typename Estimator>
+void BM_HomographyFitting(benchmark::State & state)
+{
+    auto problem = cache.get((int) state.range(0), (int) state.range(1));
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        std::vector<double> resH;
+        problem->getResult(resH);
+        double err = 0.0;
+        for (int k = 0; k < 9; k++)
+            err += std::fabs(resH[k] - H[k]);
+        return err;
+    });
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_HomographyFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_HomographyFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_HomographyFitting, robest::LMedS)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_HomographyFitting, robest::bench::Batched<robest::MSAC, 32>)->Apply(robest::bench::batchSweep);
@@ -0,0 +1,50 @@
+#include "bench_common.hpp"
+
+#include "LineFitting/LineFitting.hpp"
+
+namespace {
+
+// y = k*x + b
+const double k = 0.5;
+const double b = 2.0;
+
+std::shared_ptr<LineFittingProblem> makeLineProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    std::vector<double> x(nbPts), y(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        x[i] = uniform(0.0, 100.0);
+        if (i < (int)(nbPts * outliersRatio))
+            y[i] = uniform(-50.0, 100.0);
+        else
+            y[i] = k * x[i] + b + noise();
+    }
+
+    auto problem = std::make_shared<LineFittingProblem>();
+    problem->setData(x, y);
+    return problem;
+}
+
+robest::bench::ProblemCache<LineFittingProblem> cache(makeLineProblem);
+
+template<typename Estimator>
+void BM_LineFitting(benchmark::State & state)
+{
+    auto problem = cache.get((int) state.range(0), (int) state.range(1));
+
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        double res_k, res_b;
+        problem->getResult(res_k, res_b);
+        return std::fabs(res_k - k) + std::fabs(res_b - b);
+    });
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_LineFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_LineFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_LineFitting, robest::LMedS)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_LineFitting, robest::MAGSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_LineFitting, robest::ThresholdSweep)->Apply(robest::bench::sweep);
@@ -0,0 +1,165 @@
+#include "bench_common.hpp"
+
+#include "OrientedPlaneFitting/OrientedPlaneFitting.hpp"
+#include "OrientedSphereFitting/OrientedSphereFitting.hpp"
+#include "CylinderFitting/CylinderFitting.hpp"
+
+// Same scenes as bench_PlaneFitting and bench_SphereFitting, with normals: the
+// minimal samples have 1 (plane) and 2 (sphere, cylinder) points instead of 3 and 4
+
+namespace {
+
+// plane a*x + b*y + c*z + d = 0, (a, b, c) of unit norm
+const double a =  0.372997 / 0.477684;
+const double b = -0.136612 / 0.477684;
+const double c =  0.265316 / 0.477684;
+const double d = -0.878531 / 0.477684;
+
+// sphere and cylinder of radius r, the cylinder axis is z
+const double cx = 1.0;
+const double cy = 2.0;
+const double cz = 3.0;
+const double r  = 5.0;
+
+struct OrientedPoints
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+
+    explicit OrientedPoints(int nbPts) : x(nbPts), y(nbPts), z(nbPts), nx(nbPts), ny(nbPts), nz(nbPts) {}
+
+    void set(int i, double px, double py, double pz, double qx, double qy, double qz)
+    {
+        using namespace robest::bench;
+        x[i] = px + noise(); y[i] = py + noise(); z[i] = pz + noise();
+        nx[i] = qx + noise(); ny[i] = qy + noise(); nz[i] = qz + noise();
+    }
+
+    void setOutlier(int i, double lo, double hi)
+    {
+        using namespace robest::bench;
+        x[i] = uniform(lo, hi); y[i] = uniform(lo, hi); z[i] = uniform(lo, hi);
+        nx[i] = uniform(-1.0, 1.0); ny[i] = uniform(-1.0, 1.0); nz[i] = uniform(-1.0, 1.0);
+    }
+};
+
+std::shared_ptr<OrientedPlaneFittingProblem> makeOrientedPlaneProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    OrientedPoints points(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        if (i < (int)(nbPts * outliersRatio))
+            points.setOutlier(i, -10.0, 10.0);
+        else
+        {
+            double x = uniform(-10.0, 10.0), y = uniform(-10.0, 10.0);
+            points.set(i, x, y, (- a * x - b * y - d) / c, a, b, c);
+        }
+    }
+
+    auto problem = std::make_shared<OrientedPlaneFittingProblem>();
+    problem->setData(points.x, points.y, points.z, points.nx, points.ny, points.nz);
+    return problem;
+}
+
+std::shared_ptr<OrientedSphereFittingProblem> makeOrientedSphereProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    OrientedPoints points(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        if (i < (int)(nbPts * outliersRatio))
+            points.setOutlier(i, -2.0 * r, 2.0 * r);
+        else
+        {
+            double theta = std::acos(uniform(-1.0, 1.0));
+            double phi   = uniform(0.0, 2.0 * M_PI);
+            double ux = std::sin(theta) * std::cos(phi), uy = std::sin(theta) * std::sin(phi), uz = std::cos(theta);
+            points.set(i, cx + r * ux, cy + r * uy, cz + r * uz, ux, uy, uz);
+        }
+    }
+
+    auto problem = std::make_shared<OrientedSphereFittingProblem>();
+    problem->setData(points.x, points.y, points.z, points.nx, points.ny, points.nz);
+    return problem;
+}
+
+std::shared_ptr<CylinderFittingProblem> makeCylinderProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    OrientedPoints points(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        if (i < (int)(nbPts * outliersRatio))
+            points.setOutlier(i, -2.0 * r, 2.0 * r);
+        else
+        {
+            double phi = uniform(0.0, 2.0 * M_PI);
+            double ux = std::cos(phi), uy = std::sin(phi);
+            points.set(i, cx + r * ux, cy + r * uy, uniform(-2.0 * r, 2.0 * r), ux, uy, 0.0);
+        }
+    }
+
+    auto problem = std::make_shared<CylinderFittingProblem>();
+    problem->setData(points.x, points.y, points.z, points.nx, points.ny, points.nz);
+    return problem;
+}
+
+robest::bench::ProblemCache<OrientedPlaneFittingProblem> planeCache(makeOrientedPlaneProblem);
+robest::bench::ProblemCache<OrientedSphereFittingProblem> sphereCache(makeOrientedSphereProblem);
+robest::bench::ProblemCache<CylinderFittingProblem> cylinderCache(makeCylinderProblem);
+
+template<typename Estimator>
+void BM_OrientedPlaneFitting(benchmark::State & state)
+{
+    auto problem = planeCache.get((int) state.range(0), (int) state.range(1));
+
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        double res_a, res_b, res_c, res_d;
+        problem->getResult(res_a, res_b, res_c, res_d);
+        // the plane is defined up to the sign of its coefficients
+        double errPlus  = std::fabs(res_a - a) + std::fabs(res_b - b) + std::fabs(res_c - c) + std::fabs(res_d - d);
+        double errMinus = std::fabs(res_a + a) + std::fabs(res_b + b) + std::fabs(res_c + c) + std::fabs(res_d + d);
+        return std::min(errPlus, errMinus);
+    });
+}
+
+template<typename Estimator>
+void BM_OrientedSphereFitting(benchmark::State & state)
+{
+    auto problem = sphereCache.get((int) state.range(0), (int) state.range(1));
+
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        double res_cx, res_cy, res_cz, res_r;
+        problem->getResult(res_cx, res_cy, res_cz, res_r);
+        return std::fabs(res_cx - cx) + std::fabs(res_cy - cy) + std::fabs(res_cz - cz) + std::fabs(res_r - r);
+    });
+}
+
+template<typename Estimator>
+void BM_CylinderFitting(benchmark::State & state)
+{
+    auto problem = cylinderCache.get((int) state.range(0), (int) state.range(1));
+
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        std::vector<double> res_c, res_a;
+        double res_r;
+        problem->getResult(res_c, res_a, res_r);
+        // distance from (cx, cy) to the axis in the plane z = res_c[2], axis angle, radius
+        double t = res_a[2] != 0.0 ? (0.0 - res_c[2]) / res_a[2] : 0.0;
+        return std::hypot(res_c[0] + t * res_a[0] - cx, res_c[1] + t * res_a[1] - cy) +
+               (1.0 - std::fabs(res_a[2])) + std::fabs(res_r - r);
+    });
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_OrientedPlaneFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_OrientedPlaneFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_OrientedSphereFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_OrientedSphereFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_CylinderFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_CylinderFitting, robest::MSAC)->Apply(robest::bench::sweep);
@@ -0,0 +1,226 @@
+#include "bench_common.hpp"
+
+#include "PlaneFitting/PlaneFitting.hpp"
+
+namespace {
+
+// a*x + b*y + c*z + d = 0, normalized as in PlaneFittingProblem::getResult
+const double a =  0.372997;
+const double b = -0.136612;
+const double c =  0.265316;
+const double d = -0.878531;
+
+void makePlanePoints(int nbPts, double outliersRatio, std::vector<double> & x, std::vector<double> & y, std::vector<double> & z)
+{
+    using namespace robest::bench;
+
+    x.resize(nbPts);
+    y.resize(nbPts);
+    z.resize(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        x[i] = uniform(-10.0, 10.0);
+        y[i] = uniform(-10.0, 10.0);
+        if (i < (int)(nbPts * outliersRatio))
+            z[i] = uniform(-20.0, 20.0);
+        else
+            z[i] = (- a * x[i] - b * y[i] - d) / c + noise();
+    }
+}
+
+std::shared_ptr<PlaneFittingProblem> makePlaneProblem(int nbPts, double outliersRatio)
+{
+    std::vector<double> x, y, z;
+    makePlanePoints(nbPts, outliersRatio, x, y, z);
+
+    auto problem = std::make_shared<PlaneFittingProblem>();
+    problem->setData(x, y, z);
+    return problem;
+}
+
+// same data, scored on a 16 bits copy of the points. The full precision points are
+// released: the exact ones are read back from arrays standing for the caller's copy.
+std::shared_ptr<PlaneFittingProblem> makeQuantizedPlaneProblem(int nbPts, double outliersRatio)
+{
+    auto points = std::make_shared<std::vector<double>>();
+    std::vector<double> x, y, z;
+    makePlanePoints(nbPts, outliersRatio, x, y, z);
+
+    auto problem = std::make_shared<PlaneFittingProblem>();
+    problem->setData(x, y, z);
+    points->swap(x);
+    points->insert(points->end(), y.begin(), y.end());
+    points->insert(points->end(), z.begin(), z.end());
+    problem->setQuantizedStorage(16, 1024, [points, nbPts](int i, double & px, double & py, double & pz) {
+        px = (*points)[i];
+        py = (*points)[nbPts + i];
+        pz = (*points)[2 * nbPts + i];
+    });
+    return problem;
+}
+
+// outliers on five other planes, each holding less points than the true one
+std::shared_ptr<PlaneFittingProblem> makeStructuredPlaneProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    std::vector<double> x(nbPts), y(nbPts), z(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        x[i] = uniform(-10.0, 10.0);
+        y[i] = uniform(-10.0, 10.0);
+        if (i < (int)(nbPts * outliersRatio))
+            z[i] = 0.3 * (i % 5 - 2) * x[i] + 0.5 * y[i] + 4.0 * (i % 5) - 8.0 + noise();
+        else
+            z[i] = (- a * x[i] - b * y[i] - d) / c + noise();
+    }
+
+    auto problem = std::make_shared<PlaneFittingProblem>();
+    problem->setData(x, y, z);
+    return problem;
+}
+
+robest::bench::ProblemCache<PlaneFittingProblem> cache(makePlaneProblem);
+robest::bench::ProblemCache<PlaneFittingProblem> structuredCache(makeStructuredPlaneProblem);
+robest::bench::ProblemCache<PlaneFittingProblem> quantizedCache(makeQuantizedPlaneProblem);
+
+template<typename Estimator>
+void runPlaneSolve(benchmark::State & state, std::shared_ptr<PlaneFittingProblem> problem,
+                   std::function<void(Estimator &, int)> solveFn = nullptr)
+{
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        double res_a, res_b, res_c, res_d;
+        problem->getResult(res_a, res_b, res_c, res_d);
+        double norm = std::sqrt(a*a + b*b + c*c + d*d);
+        // the plane is defined up to the sign of its coefficients
+        double errPlus  = std::fabs(res_a - a/norm) + std::fabs(res_b - b/norm) + std::fabs(res_c - c/norm) + std::fabs(res_d - d/norm);
+        double errMinus = std::fabs(res_a + a/norm) + std::fabs(res_b + b/norm) + std::fabs(res_c + c/norm) + std::fabs(res_d + d/norm);
+        return std::min(errPlus, errMinus);
+    }, solveFn);
+}
+
+template<typename Estimator>
+void BM_PlaneFitting(benchmark::State & state)
+{
+    runPlaneSolve<Estimator>(state, cache.get((int) state.range(0), (int) state.range(1)));
+}
+
+// built once per dataset, as an application solving repeatedly on the same data
+template<typename Estimator>
+void BM_HierarchicalPlaneFitting(benchmark::State & state)
+{
+    static robest::SamplePyramid pyramid;
+    auto problem = cache.get((int) state.range(0), (int) state.range(1));
+    if (pyramid.getTotalNbSamples() != problem->getTotalNbSamples())
+        pyramid.buildRandom(problem->getTotalNbSamples(), 20000);
+
+    runPlaneSolve<Estimator>(state, problem, [&](Estimator & solver, int nbIter) {
+        solver.solveHierarchical(problem, pyramid, robest::bench::thres, nbIter);
+    });
+}
+
+template<typename Estimator>
+void BM_QuantizedPlaneFitting(benchmark::State & state)
+{
+    auto problem = quantizedCache.get((int) state.range(0), (int) state.range(1));
+    runPlaneSolve<Estimator>(state, problem);
+    state.counters["bytes_per_point"] = (double) problem->getMemorySize() / problem->getTotalNbSamples();
+}
+
+// adaptive termination: the iterations run are counted, not fixed
+template<typename Estimator>
+void BM_StructuredPlaneFitting(benchmark::State & state)
+{
+    auto problem = structuredCache.get((int) state.range(0), (int) state.range(1));
+    long long nbIterations = 0;
+    runPlaneSolve<Estimator>(state, problem, [&](Estimator & solver, int) {
+        nbIterations += solver.solve(problem, robest::bench::thres, 50000, robest::SolveControl()).nbIterations;
+    });
+    state.counters["iterations"] = benchmark::Counter((double) nbIterations, benchmark::Counter::kAvgIterations);
+}
+
+// Point file of the same plane, written once per dataset in the working directory
+const robest::MappedPointFile & planeFile(int nbPts, int outliersPercent)
+{
+    using namespace robest::bench;
+    static robest::MappedPointFile file;
+    static int lastNbPts = -1, lastOutliers = -1;
+    if (nbPts == lastNbPts && outliersPercent == lastOutliers)
+        return file;
+
+    const char * path = "robest_bench_plane.pts";
+    robest::PointFileWriter writer;
+    writer.open(path, 3);
+    for (int i = 0; i < nbPts; i++)
+    {
+        double p[3] = { uniform(-10.0, 10.0), uniform(-10.0, 10.0), 0.0 };
+        p[2] = i < (int)(nbPts * outliersPercent / 100.0) ? uniform(-20.0, 20.0) : (- a * p[0] - b * p[1] - d) / c + noise();
+        writer.write(p, 1);
+    }
+    writer.close();
+    file.open(path);
+    std::remove(path); // the mapping keeps the data
+    lastNbPts = nbPts;
+    lastOutliers = outliersPercent;
+    return file;
+}
+
+// hypotheses on a 100000 points reservoir, the best ones scored on the mapped file
+template<typename Estimator>
+void BM_OutOfCorePlaneFitting(benchmark::State & state)
+{
+    const robest::MappedPointFile & file = planeFile((int) state.range(0), (int) state.range(1));
+    auto problem = std::make_shared<PlaneFittingProblem>();
+    auto load = [problem](const double * points, int n) {
+        std::vector<double> x(n), y(n), z(n);
+        for (int i = 0; i < n; ++i)
+        {
+            x[i] = points[3 * i];
+            y[i] = points[3 * i + 1];
+            z[i] = points[3 * i + 2];
+        }
+        problem->setData(x, y, z);
+    };
+
+    runPlaneSolve<Estimator>(state, problem, [&](Estimator & solver, int nbIter) {
+        solver.solveOutOfCore(problem, file, load, robest::bench::thres, nbIter);
+    });
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::LMedS)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::MAGSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::ThresholdSweep)->Apply(robest::bench::sweep);
+
+// strategy, chunks, batches and threads picked from the measured costs
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::bench::AutoTuned<robest::MSAC>)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::bench::AutoTuned<robest::RANSAC>)->Apply(robest::bench::sweep);
+
+// one hypothesis per pass over the data versus tiled batches
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::bench::Batched<robest::MSAC, 1>)->Apply(robest::bench::batchSweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::bench::Batched<robest::MSAC, 8>)->Apply(robest::bench::batchSweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::bench::Batched<robest::MSAC, 32>)->Apply(robest::bench::batchSweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::bench::Batched<robest::RANSAC, 32>)->Apply(robest::bench::batchSweep);
+
+// the same batches with the samples and threads spread over the NUMA nodes
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::bench::NumaAware<robest::MSAC, 32>)->Apply(robest::bench::batchSweep);
+BENCHMARK_TEMPLATE(BM_PlaneFitting, robest::bench::NumaAware<robest::RANSAC, 32>)->Apply(robest::bench::batchSweep);
+
+// batches scored on int16 coordinates, uncertain inliers re-verified in double
+BENCHMARK_TEMPLATE(BM_QuantizedPlaneFitting, robest::bench::Batched<robest::MSAC, 32>)->Apply(robest::bench::batchSweep);
+BENCHMARK_TEMPLATE(BM_QuantizedPlaneFitting, robest::bench::Batched<robest::RANSAC, 32>)->Apply(robest::bench::batchSweep);
+
+// hypotheses on 20000 points, the best ones scored again on 200000 (and 2000000)
+BENCHMARK_TEMPLATE(BM_HierarchicalPlaneFitting, robest::MSAC)->Apply(robest::bench::batchSweep);
+BENCHMARK_TEMPLATE(BM_HierarchicalPlaneFitting, robest::RANSAC)->Apply(robest::bench::batchSweep);
+
+// samples guided by the inlier probabilities learned from the previous hypotheses
+BENCHMARK_TEMPLATE(BM_StructuredPlaneFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_StructuredPlaneFitting, robest::bench::Guided<robest::MSAC>)->Apply(robest::bench::sweep);
+
+// verification streamed from a point file, 2^20 points at a time
+BENCHMARK_TEMPLATE(BM_OutOfCorePlaneFitting, robest::MSAC)->Apply(robest::bench::batchSweep);
+BENCHMARK_TEMPLATE(BM_OutOfCorePlaneFitting, robest::RANSAC)->Apply(robest::bench::batchSweep);
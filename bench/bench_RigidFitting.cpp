@@ -0,0 +1,69 @@
+#include "bench_common.hpp"
+
+#include "RigidFitting/RigidFitting.hpp"
+
+namespace {
+
+// rotation of 0.8 rad around (1, 2, 2) / 3, row-major
+const double c = std::cos(0.8), s = std::sin(0.8), C = 1.0 - c;
+const double ux = 1.0 / 3.0, uy = 2.0 / 3.0, uz = 2.0 / 3.0;
+const double R[9] = {c + ux*ux*C,    ux*uy*C - uz*s, ux*uz*C + uy*s,
+                     uy*ux*C + uz*s, c + uy*uy*C,    uy*uz*C - ux*s,
+                     uz*ux*C - uy*s, uz*uy*C + ux*s, c + uz*uz*C};
+const double t[3] = {1.5, -3.0, 0.25};
+
+std::shared_ptr<RigidFittingProblem> makeRigidProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    std::vector<double> px(nbPts), py(nbPts), pz(nbPts);
+    std::vector<double> qx(nbPts), qy(nbPts), qz(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        px[i] = uniform(-10.0, 10.0);
+        py[i] = uniform(-10.0, 10.0);
+        pz[i] = uniform(-10.0, 10.0);
+        if (i < (int)(nbPts * outliersRatio))
+        {
+            qx[i] = uniform(-20.0, 20.0);
+            qy[i] = uniform(-20.0, 20.0);
+            qz[i] = uniform(-20.0, 20.0);
+        }
+        else
+        {
+            qx[i] = R[0] * px[i] + R[1] * py[i] + R[2] * pz[i] + t[0] + noise();
+            qy[i] = R[3] * px[i] + R[4] * py[i] + R[5] * pz[i] + t[1] + noise();
+            qz[i] = R[6] * px[i] + R[7] * py[i] + R[8] * pz[i] + t[2] + noise();
+        }
+    }
+
+    auto problem = std::make_shared<RigidFittingProblem>();
+    problem->setData(px, py, pz, qx, qy, qz);
+    return problem;
+}
+
+robest::bench::ProblemCache<RigidFittingProblem> cache(makeRigidProblem);
+
+template<typename Estimator>
+void BM_RigidFitting(benchmark::State & state)
+{
+    auto problem = cache.get((int) state.range(0), (int) state.range(1));
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        std::vector<double> resR, rest;
+        double ress;
+        problem->getResult(resR, rest, ress);
+        double err = 0.0;
+        for (int k = 0; k < 9; k++)
+            err += std::fabs(resR[k] - R[k]);
+        for (int k = 0; k < 3; k++)
+            err += std::fabs(rest[k] - t[k]);
+        return err;
+    });
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_RigidFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_RigidFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_RigidFitting, robest::LMedS)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_RigidFitting, robest::bench::Batched<robest::MSAC, 32>)->Apply(robest::bench::batchSweep);
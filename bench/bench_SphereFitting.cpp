@@ -0,0 +1,60 @@
+#include "bench_common.hpp"
+
+#include "SphereFitting/SphereFitting.hpp"
+
+namespace {
+
+const double cx = 1.0;
+const double cy = 2.0;
+const double cz = 3.0;
+const double r  = 5.0;
+
+std::shared_ptr<SphereFittingProblem> makeSphereProblem(int nbPts, double outliersRatio)
+{
+    using namespace robest::bench;
+
+    std::vector<double> x(nbPts), y(nbPts), z(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        if (i < (int)(nbPts * outliersRatio))
+        {
+            x[i] = uniform(cx - 2.0 * r, cx + 2.0 * r);
+            y[i] = uniform(cy - 2.0 * r, cy + 2.0 * r);
+            z[i] = uniform(cz - 2.0 * r, cz + 2.0 * r);
+        }
+        else
+        {
+            double theta = std::acos(uniform(-1.0, 1.0));
+            double phi   = uniform(0.0, 2.0 * M_PI);
+            x[i] = cx + r * std::sin(theta) * std::cos(phi) + noise();
+            y[i] = cy + r * std::sin(theta) * std::sin(phi) + noise();
+            z[i] = cz + r * std::cos(theta) + noise();
+        }
+    }
+
+    auto problem = std::make_shared<SphereFittingProblem>();
+    problem->setData(x, y, z);
+    return problem;
+}
+
+robest::bench::ProblemCache<SphereFittingProblem> cache(makeSphereProblem);
+
+template<typename Estimator>
+void BM_SphereFitting(benchmark::State & state)
+{
+    auto problem = cache.get((int) state.range(0), (int) state.range(1));
+
+    robest::bench::runSolve<Estimator>(state, problem, [&]() {
+        double res_cx, res_cy, res_cz, res_r;
+        problem->getResult(res_cx, res_cy, res_cz, res_r);
+        return std::fabs(res_cx - cx) + std::fabs(res_cy - cy) + std::fabs(res_cz - cz) + std::fabs(res_r - r);
+    });
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_SphereFitting, robest::RANSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_SphereFitting, robest::MSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_SphereFitting, robest::LMedS)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_SphereFitting, robest::MAGSAC)->Apply(robest::bench::sweep);
+BENCHMARK_TEMPLATE(BM_SphereFitting, robest::ThresholdSweep)->Apply(robest::bench::sweep);
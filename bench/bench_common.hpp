@@ -0,0 +1,209 @@
+/**
+ *  @brief Shared helpers of the robest micro-benchmarks
+ *
+ *  For MAGSAC the threshold is used as the maximum noise scale sigmaMax.
+ *  ThresholdSweep scores its default 20 thresholds in each solve.
+ *  Batched<Estimator, H> scores H hypotheses per pass over the data (batchSweep).
+ *  NumaAware<Estimator, H> does the same with the samples placed on the NUMA nodes.
+ *  Guided<Estimator> draws half of its minimal samples from learned inlier probabilities.
+ *  AutoTuned<Estimator> lets the tuner pick its parallel strategy, threads included.
+ *  Hierarchical benchmarks hypothesize on a random 20000 points level (batchSweep).
+ *
+ *  Every benchmark is registered over the same sweep:
+ *      arg 0 - number of points      (1e2 .. 1e7)
+ *      arg 1 - outliers ratio, in %  (10 .. 90)
+ *      arg 2 - number of OpenMP threads
+ *
+ *  Reported counters:
+ *      residuals_per_s - residual evaluations per second (from SolverStats)
+ *      iterations      - iterations per solve
+ *      param_err       - mean distance between the estimated and the true model
+ *      strategy        - parallel strategy of the last solve (0 serial, 1 hypotheses, 2 data)
+ *  Time to solution is the benchmark real time.
+ */
+
+#ifndef ROBEST_BENCH_COMMON_H
+#define ROBEST_BENCH_COMMON_H
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <omp.h>
+
+#include "robust_estim.hpp"
+
+namespace robest {
+namespace bench {
+
+const double noiseSigma = 0.01;
+const double thres      = 0.1;
+
+// Fixed seed: every run of the benchmark sees the same data
+inline std::mt19937 & generator()
+{
+    static std::mt19937 gen(42);
+    return gen;
+}
+
+inline void sweep(benchmark::internal::Benchmark * b)
+{
+    std::vector<int64_t> threads;
+    for (int t = 1; t <= omp_get_max_threads(); t *= 2)
+        threads.push_back(t);
+
+    b->ArgNames({"N", "outliers%", "threads"});
+    b->ArgsProduct({
+        {100, 1000, 10000, 100000, 1000000, 10000000},
+        {10, 30, 50, 70, 90},
+        threads
+    });
+    b->UseRealTime();
+    b->Unit(benchmark::kMillisecond);
+}
+
+// Large datasets only, where scoring is memory bound
+inline void batchSweep(benchmark::internal::Benchmark * b)
+{
+    std::vector<int64_t> threads;
+    for (int t = 1; t <= omp_get_max_threads(); t *= 2)
+        threads.push_back(t);
+
+    b->ArgNames({"N", "outliers%", "threads"});
+    b->ArgsProduct({{1000000, 10000000}, {50}, threads});
+    b->UseRealTime();
+    b->Unit(benchmark::kMillisecond);
+}
+
+// Estimator with batched (tiled) scoring of BatchSize hypotheses
+template<typename Estimator, int BatchSize>
+class Batched : public Estimator
+{
+  public:
+    Batched() { this->setBatchSize(BatchSize); }
+};
+
+// Batched estimator scoring each NUMA node's share of the samples on the node
+template<typename Estimator, int BatchSize>
+class NumaAware : public Estimator
+{
+  public:
+    NumaAware()
+    {
+        this->setBatchSize(BatchSize);
+        this->setNumaAware(true);
+    }
+};
+
+// Estimator drawing half of its samples from the learned inlier probabilities
+template<typename Estimator>
+class Guided : public Estimator
+{
+  public:
+    Guided() { this->setGuidedSampling(0.5); }
+};
+
+// Estimator whose parallel strategy is chosen by the tuner, within the thread count
+// of the benchmark
+template<typename Estimator>
+class AutoTuned : public Estimator
+{
+  public:
+    AutoTuned() { this->setAutoTuning(true); }
+};
+
+// Datasets are expensive to build for large N: keep the last one around, the
+// sweep visits all thread counts of a given (N, outliers) pair in a row.
+template<typename Problem>
+class ProblemCache
+{
+  public:
+    typedef std::function<std::shared_ptr<Problem>(int, double)> Factory;
+
+    explicit ProblemCache(Factory factory) : factory(factory) {}
+
+    std::shared_ptr<Problem> get(int nbPts, int outliersPercent)
+    {
+        if (!problem || nbPts != lastNbPts || outliersPercent != lastOutliers)
+        {
+            problem.reset();
+            problem = factory(nbPts, outliersPercent / 100.0);
+            lastNbPts = nbPts;
+            lastOutliers = outliersPercent;
+        }
+        return problem;
+    }
+
+  private:
+    Factory factory;
+    std::shared_ptr<Problem> problem;
+    int lastNbPts = -1;
+    int lastOutliers = -1;
+};
+
+// Runs one solve per benchmark iteration and fills the counters.
+// The number of iterations is the one required to reach 99% confidence for the
+// true outliers ratio, as calculateIterationsNb would compute it.
+// solveFn replaces the plain solve(problem, thres, nbIter) call when given.
+template<typename Estimator>
+void runSolve(benchmark::State & state,
+              std::shared_ptr<EstimationProblem> problem,
+              std::function<double()> paramError,
+              std::function<void(Estimator &, int)> solveFn = nullptr)
+{
+    const double outliersRatio = state.range(1) / 100.0;
+    const int nbThreads = (int) state.range(2);
+
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(nbThreads);
+
+    int nbIter = Estimator().calculateIterationsNb(problem->getNbMinSamples(), 0.99f, (float)(1.0 - outliersRatio));
+
+    long long nbResiduals = 0;
+    double sumErr = 0.0;
+    ParallelStrategy strategy = ParallelStrategy::Serial;
+    for (auto _ : state)
+    {
+        Estimator solver;
+        if (solveFn)
+            solveFn(solver, nbIter);
+        else
+            solver.solve(problem, thres, nbIter);
+        nbResiduals += solver.getStats().nbResiduals;
+        strategy = solver.getStats().parallel.strategy;
+
+        state.PauseTiming();
+        sumErr += paramError();
+        state.ResumeTiming();
+    }
+
+    state.counters["residuals_per_s"] = benchmark::Counter((double) nbResiduals, benchmark::Counter::kIsRate);
+    state.counters["iterations"] = nbIter;
+    state.counters["param_err"] = benchmark::Counter(sumErr, benchmark::Counter::kAvgIterations);
+    state.counters["strategy"] = (int) strategy;
+
+    omp_set_num_threads(previousNbThreads);
+}
+
+// Uniform outliers in [lo, hi]
+inline double uniform(double lo, double hi)
+{
+    std::uniform_real_distribution<double> dist(lo, hi);
+    return dist(generator());
+}
+
+inline double noise()
+{
+    std::normal_distribution<double> dist(0.0, noiseSigma);
+    return dist(generator());
+}
+
+} // namespace bench
+} // namespace robest
+
+#endif // ROBEST_BENCH_COMMON_H
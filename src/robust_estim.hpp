@@ -20,10 +20,26 @@
 #include <limits>
 #include <memory>
 #include <queue>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
 #include <assert.h>
 
 #include <omp.h>
 
+#include "robust_mask.hpp"
+#include "robust_pyramid.hpp"
+#include "robust_shard.hpp"
+#include "robust_mapped.hpp"
+#include "robust_numa.hpp"
+#include "robust_executor.hpp"
+#include "robust_sampler.hpp"
+#include "robust_tuner.hpp"
+#include "robust_trace.hpp"
+
 namespace robest
 {
 
@@ -55,11 +71,77 @@ public:
 class EstimationProblem
 {
   public:
+    virtual ~EstimationProblem() {}
+
     // Functions to overload in your class:
     virtual double estimErrorForSample(int i) = 0;
     virtual void   estimModelFromSamples(const std::vector<int> & samplesIdx) = 0;
     virtual int    getTotalNbSamples() const = 0;
 
+    // Optional: reject a minimal sample before the model is estimated from it.
+    // Degenerate samples are counted in SolverStats and are not scored.
+    virtual bool   isDegenerate(const std::vector<int> & samplesIdx) { return false; }
+
+    // Optional: the current model as getNbParams() values. Needed to warm start a
+    // solve from prior models. Return false if not supported.
+    virtual bool   getModelParams(std::vector<double> & params) const { return false; }
+    virtual bool   setModelParams(const std::vector<double> & params) { return false; }
+
+    // Optional: errors of the samples [begin, end) for the model params, written to
+    // errors[0 .. end-begin), without changing the current model. It must be safe to
+    // call from several threads; it enables the batched (tiled) scoring of
+    // AbstractEstimator::setBatchSize. Return false if not supported.
+    virtual bool   estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const { return false; }
+
+    // Optional: same as estimErrorsForModel, from a compact (e.g. quantized) copy of the
+    // data. Every error is within errorBound of the exact one. The batched scoring
+    // uses it and recomputes the exact error of the samples whose inlier / outlier
+    // status is within the bound. Return false if not supported.
+    virtual bool   estimApproxErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors, double & errorBound) const { return false; }
+
+    // Optional: model of the samples written to params, leaving the current model as is
+    // (params unchanged if the samples are degenerate). It must be safe to call from
+    // several threads; estimators running at the same time on the problem use it (see
+    // ModelView). Return false if not supported.
+    virtual bool   estimModelParams(const std::vector<int> & samplesIdx, std::vector<double> & params) const { return false; }
+
+    // Optional: same as estimModelParams for estimModelFromWeightedSamples
+    virtual bool   estimWeightedModelParams(const std::vector<int> & samplesIdx, const std::vector<double> & weights,
+                                            std::vector<double> & params) const { return false; }
+
+    // Optional: copy of the problem, data included (see copyOf). Estimators running
+    // at the same time on a problem without estimModelParams each solve a copy (see
+    // Portfolio). Return nullptr if not supported.
+    virtual std::shared_ptr<EstimationProblem> clone() const { return nullptr; }
+
+    // Optional: moves the arrays of samples to the NUMA nodes that score them, by
+    // calling layout.place on each of them. Used by the NUMA aware batched scoring
+    // (see AbstractEstimator::setNumaAware), once per data version: call dataChanged()
+    // when the arrays are replaced.
+    virtual void   placeSamples(const NumaLayout & layout) {}
+
+    // Unique among the problems, changed by dataChanged()
+    virtual unsigned long long getDataVersion() const { return dataVersion; }
+
+    // Key of the costs measured by the auto-tuning (see ParallelTuner): the type of the
+    // problem by default. Views of a problem forward the key of the problem.
+    virtual std::string costKey() const { return typeid(*this).name(); }
+
+    // Optional: weighted least squares model from samplesIdx, used by the polishing
+    // step of MAGSAC. By default, the model is estimated from the samples of positive
+    // weight, without weighting.
+    virtual void   estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+    {
+        std::vector<int> idx;
+        for (int i = 0; i < (int)samplesIdx.size(); ++i)
+        {
+            if (weights[i] > 0.0)
+                idx.push_back(samplesIdx[i]);
+        }
+        if ((int)idx.size() >= getNbMinSamples())
+            estimModelFromSamples(idx);
+    }
+
     int getNbParams() const { return nbParams; }
     int getNbMinSamples() const { return nbMinSamples; }
 
@@ -67,259 +149,2886 @@ class EstimationProblem
     void setNbParams(int i) { nbParams = i; }
     void setNbMinSamples(int i) { nbMinSamples = i; }
 
+    // To call when the samples change, e.g. from setData
+    void dataChanged() { dataVersion = nextDataVersion(); }
+
+    // clone() of a copyable problem: its data get a version of their own
+    template<typename Problem>
+    static std::shared_ptr<EstimationProblem> copyOf(const Problem & problem)
+    {
+        std::shared_ptr<Problem> copy = std::make_shared<Problem>(problem);
+        copy->dataChanged();
+        return copy;
+    }
+
   private:
+    static unsigned long long nextDataVersion()
+    {
+        static std::atomic<unsigned long long> last(0);
+        return ++last;
+    }
+
     int nbParams = -1;
     int nbMinSamples = -1;
+    unsigned long long dataVersion = nextDataVersion();
 };
 
-static std::random_device rd;  // random device engine, usually based on /dev/random on UNIX-like systems
-static std::mt19937 rng(rd()); // initialize Mersennes' twister using rd to generate the seed
-
-// Base class for Robust Estimators
-class AbstractEstimator
+// View of a problem restricted to a subset of its samples: sample i of the view is
+// sample indices[i] of the problem. Both share the model held by the problem. The
+// indices are not copied and must outlive the view.
+class SubsetProblem : public EstimationProblem
 {
   public:
-    // Generate X !different! random numbers from 0 to N-1
-    // X - minimal number of samples
-    // N - total number of samples
-    // generated numbers are indices of data points
+    SubsetProblem(std::shared_ptr<EstimationProblem> problem, const std::vector<int> & indices)
+        : problem(problem), indices(indices)
+    {
+        setNbParams(problem->getNbParams());
+        setNbMinSamples(problem->getNbMinSamples());
+    }
 
-    std::vector<int> randomSampleIdx()
+    double estimErrorForSample(int i) { return problem->estimErrorForSample(indices[i]); }
+
+    void estimModelFromSamples(const std::vector<int> & samplesIdx)
     {
-        int minNbSamples = problem->getNbMinSamples();
-        int totalNbSamples = problem->getTotalNbSamples();
+        problem->estimModelFromSamples(toProblemIdx(samplesIdx));
+    }
 
-        std::vector<int> allIdx(totalNbSamples);
-        std::iota(std::begin(allIdx), std::end(allIdx), 0); // Fill with 0, 1, ..., totalNbSamples-1.
+    int getTotalNbSamples() const { return (int) indices.size(); }
 
-        // shuffle the elements of allIdx : Fisher–Yates shuffle
-        for (int i = 0; i < minNbSamples; i++)
+    bool isDegenerate(const std::vector<int> & samplesIdx)
+    {
+        return problem->isDegenerate(toProblemIdx(samplesIdx));
+    }
+
+    bool getModelParams(std::vector<double> & params) const { return problem->getModelParams(params); }
+    bool setModelParams(const std::vector<double> & params) { return problem->setModelParams(params); }
+
+    std::string costKey() const { return problem->costKey(); }
+
+    // one sample at a time: the subset is not contiguous in the problem
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+    {
+        if (begin == end)
+            return problem->estimErrorsForModel(params, 0, 0, errors);
+        for (int i = begin; i < end; ++i)
         {
-            std::uniform_int_distribution<int> dist(0, totalNbSamples - i - 1);
-            int randInt = dist(rng);
-            std::swap(allIdx[totalNbSamples - i - 1], allIdx[randInt]);
+            if (!problem->estimErrorsForModel(params, indices[i], indices[i] + 1, errors + i - begin))
+                return false;
         }
+        return true;
+    }
 
-        //take last <minNbSamples> elements
-        std::vector<int> idx(allIdx.end() - minNbSamples, allIdx.end());
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+    {
+        problem->estimModelFromWeightedSamples(toProblemIdx(samplesIdx), weights);
+    }
 
+    // Indices of the problem for sample indices of the view
+    std::vector<int> toProblemIdx(const std::vector<int> & samplesIdx) const
+    {
+        std::vector<int> idx(samplesIdx.size());
+        for (size_t k = 0; k < samplesIdx.size(); ++k)
+            idx[k] = indices[samplesIdx[k]];
         return idx;
     }
 
-    int calculateIterationsNb(const int batchSize, const float alpha = 0.99f, const float gamma = 0.80f)
+  private:
+    std::shared_ptr<EstimationProblem> problem;
+    const std::vector<int> & indices;
+};
+
+// Statistics of the last call to solve().
+// Phase times are in seconds and summed over all threads, totalTime is the wall time
+// of the call. Define ROBEST_DISABLE_STATS to compile the collection out entirely:
+// the structure is still available but stays zeroed.
+struct SolverStats
+{
+    long long nbIterations = 0;         // minimal samples drawn
+    long long nbHypotheses = 0;         // models scored against the data, priors included
+    long long nbDegenerate = 0;         // samples rejected by EstimationProblem::isDegenerate
+    long long nbResiduals  = 0;         // calls to estimErrorForSample
+    long long nbReverified = 0;         // approximate errors recomputed exactly (batched scoring)
+    long long nbAborted    = 0;         // hypotheses whose scoring stopped early (see setEarlyAbort)
+    long long lastImprovementIter = -1; // iteration that produced the retained model (-1: a prior)
+
+    double samplingTime = 0.0;
+    double modelTime    = 0.0;
+    double scoringTime  = 0.0;
+    double finalTime    = 0.0;          // inliers extraction and refit
+    double totalTime    = 0.0;
+
+    ParallelDecision parallel;          // how the iterations ran, see setAutoTuning
+
+    std::vector<long long> hypothesesPerThread;
+
+    // keeps the capacity of hypothesesPerThread: resetting does not allocate
+    void reset()
     {
-        assert(batchSize > 0 && "The size of input data must be > 0");
-        assert((alpha > 0.0f && alpha <  1.0f) && "Accepted value of success probability (aplha) is in range (0,1)");
-        assert((gamma > 0.0f && gamma <= 1.0f) && "Accepted value of inlier's ratio (gamma) is in range (0,1]");
+        std::vector<long long> perThread;
+        perThread.swap(hypothesesPerThread);
+        *this = SolverStats();
+        perThread.clear();
+        perThread.swap(hypothesesPerThread);
+    }
 
-        if (gamma == 1.0f)
-            return 1;
+    void improvedAt(long long iter)
+    {
+#ifndef ROBEST_DISABLE_STATS
+        lastImprovementIter = iter;
+#endif
+    }
+};
 
-        // Counting the number of iteration
-        int nbIter = 1 + int(std::log(1.0 - alpha) / std::log(1.0 - std::pow(gamma, batchSize)));
-        if ( nbIter < 0 || nbIter > 50000) nbIter = 50000;
+// Per-thread accumulator for SolverStats: filled without synchronisation inside
+// the iterations loop and merged once per thread at the end of the loop.
+class StatsAccumulator
+{
+  public:
+#ifndef ROBEST_DISABLE_STATS
+    typedef std::chrono::steady_clock Clock;
 
-        assert(nbIter > 0 && "Number of interations must be > 0: check solver params or define nbIter manually");
-        
-        return nbIter;
+    StatsAccumulator() : last(Clock::now()) {}
+
+    void startIteration()           { nbIterations++; lap(); }
+    void endSampling()              { samplingTime += lap(); }
+    void endModelEstimation()       { modelTime += lap(); }
+    void degenerateSample()         { nbDegenerate++; }
+    void endScoring(int nbResidual, bool aborted = false)
+    {
+        scoringTime += lap();
+        nbHypotheses++;
+        nbResiduals += nbResidual;
+        nbAborted += aborted;
     }
 
-    double getInliersFraction() const { return inliersFraction; }
-    std::vector<int> getInliersIndices() const { return inliersIdx; }
+    // must be called from a critical section
+    void mergeInto(SolverStats & stats, int threadId) const
+    {
+        stats.nbIterations += nbIterations;
+        stats.nbHypotheses += nbHypotheses;
+        stats.nbDegenerate += nbDegenerate;
+        stats.nbResiduals  += nbResiduals;
+        stats.nbAborted    += nbAborted;
+        stats.samplingTime += samplingTime;
+        stats.modelTime    += modelTime;
+        stats.scoringTime  += scoringTime;
 
-  protected:
-    void getInliers(double thres)
+        if ((int)stats.hypothesesPerThread.size() <= threadId)
+            stats.hypothesesPerThread.resize(threadId + 1, 0);
+        stats.hypothesesPerThread[threadId] += nbHypotheses;
+    }
+
+  private:
+    double lap()
     {
-        int totalNbSamples = problem->getTotalNbSamples();
-        inliersIdx.clear();
-        #pragma omp parallel for
-        for (int j = 0; j < totalNbSamples; ++j)
-        {
-            double error = problem->estimErrorForSample(j);
-            
-            #pragma omp critical
-            {
-                if ((error * error) < (thres * thres))
-                {
-                    inliersIdx.push_back(j);
-                }
-            }
-        }
-        this->inliersFraction = (double)(inliersIdx.size()) / (double)(totalNbSamples);
+        Clock::time_point now = Clock::now();
+        double dt = std::chrono::duration<double>(now - last).count();
+        last = now;
+        return dt;
     }
 
-    std::shared_ptr<EstimationProblem> problem;
-    std::vector<int> bestIdxSet;
-    std::vector<int> inliersIdx;
-    double inliersFraction = -1.0;
+    Clock::time_point last;
+    long long nbIterations = 0;
+    long long nbHypotheses = 0;
+    long long nbDegenerate = 0;
+    long long nbResiduals  = 0;
+    long long nbAborted    = 0;
+    double samplingTime = 0.0;
+    double modelTime    = 0.0;
+    double scoringTime  = 0.0;
+#else
+    void startIteration() {}
+    void endSampling() {}
+    void endModelEstimation() {}
+    void degenerateSample() {}
+    void endScoring(int, bool = false) {}
+    void mergeInto(SolverStats &, int) const {}
+#endif
+};
 
+// Wall clock of a whole phase (e.g. solve() or final refit), no-op without stats
+class StatsTimer
+{
+  public:
+#ifndef ROBEST_DISABLE_STATS
+    StatsTimer() : start(std::chrono::steady_clock::now()) {}
+    double elapsed() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  private:
+    std::chrono::steady_clock::time_point start;
+#else
+    double elapsed() const { return 0.0; }
+#endif
 };
 
-class RANSAC : public AbstractEstimator
+// Cooperative cancellation of a running solve(): copies share the same flag, so a
+// token can be handed to the solver and cancelled from any other thread.
+class CancellationToken
 {
   public:
-    RANSAC()
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const { flag->store(true); }
+    bool isCancelled() const
     {
+        return flag->load(std::memory_order_relaxed) || (parent && parent->isCancelled());
     }
 
-    void solve(std::shared_ptr<EstimationProblem> pb, double thres = 0.1, int nbIter = -1)
+    // New token, cancelled either on its own or with this one
+    CancellationToken child() const
     {
-        problem = pb;
+        CancellationToken token;
+        token.parent = std::make_shared<CancellationToken>(*this);
+        return token;
+    }
 
-        int totalNbSamples = problem->getTotalNbSamples();
+  private:
+    std::shared_ptr<std::atomic<bool>> flag;
+    std::shared_ptr<const CancellationToken> parent;
+};
 
-        if (nbIter <= 0)
-            nbIter = this->calculateIterationsNb(problem->getTotalNbSamples());
+// State of a running solve, see SolveControl::progress
+struct SolveProgress
+{
+    int    nbIterations = 0;       // iterations done so far
+    double bestCost = std::numeric_limits<double>::max(); // of the best model, as the estimator scores it
+    double inliersFraction = 0.0;  // of the best model
+    double confidence = 0.0;       // probability that an all-inliers sample was drawn,
+                                   // counting the uniform samples only
+};
 
-        #pragma omp parallel for
-        for (int i = 0; i < nbIter; ++i)
-        {
-            std::vector<int> indices = randomSampleIdx();
+// Bounds of a solve() call besides the number of iterations. Workers check them
+// between chunks of iterations, so a solve stops at most one chunk late.
+struct SolveControl
+{
+    typedef std::chrono::steady_clock Clock;
 
-            problem->estimModelFromSamples(indices);
+    Clock::time_point deadline = Clock::time_point::max();
+    CancellationToken cancelToken;
 
-            //getInliersNb
-            int nbInliers = 0;
-            for (int j = 0; j < totalNbSamples; ++j)
-            {
-                double error = problem->estimErrorForSample(j);
-                error = error * error;
+    // Time (in seconds) kept for the inliers extraction and refit. If negative,
+    // it is estimated as two scoring passes measured during the iterations.
+    double finalPhaseReserve = -1.0;
 
-                if (std::fabs(error) < thres)
-                {
-                    nbInliers++;
-                }
-            }
+    float confidence = 0.99f;         // success probability targeted (alpha)
+    bool  adaptiveTermination = true; // stop once the confidence is reached
+    int   chunkSize = 16;             // max iterations between two checks
 
-            #pragma omp critical
-            {
-                double inliersFraction = (double)(nbInliers) / (double)(totalNbSamples);
-                
-                if (inliersFraction > this->inliersFraction)
-                {
-                    this->inliersFraction = inliersFraction;
-                    this->bestIdxSet = indices;
-                }
-            }
-            
-        }
-        problem->estimModelFromSamples(bestIdxSet);
-        getInliers(thres);
-        problem->estimModelFromSamples(inliersIdx);
+    // Called between chunks of iterations, at most every progressInterval seconds,
+    // and once when the iterations end. It runs on a thread of the solve, which it
+    // delays: it should be short.
+    std::function<void(const SolveProgress &)> progress;
+    double progressInterval = 0.1;
+
+    static SolveControl timeout(double seconds)
+    {
+        SolveControl control;
+        control.deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+        return control;
+    }
+
+    // What the plain solve(pb, thres, nbIter) does: exactly nbIter iterations
+    static const SolveControl & unbounded()
+    {
+        static const SolveControl control = makeUnbounded();
+        return control;
+    }
+
+  private:
+    static SolveControl makeUnbounded()
+    {
+        SolveControl control;
+        control.adaptiveTermination = false;
+        control.chunkSize = 64;
+        return control;
     }
 };
 
-class MSAC : public AbstractEstimator
+// How a bounded solve() ended. The best model found so far is always kept in the
+// problem, even if the iterations were interrupted.
+struct SolveStatus
+{
+    bool confidenceReached = false; // enough iterations for the best inliers ratio
+    bool deadlineReached   = false;
+    bool cancelled         = false;
+    bool shardsLost        = false; // a shard failed: the batches were scored by this process,
+                                    // or the solve stopped if the estimator cannot score them
+    bool ioError           = false; // the inliers file of solveOutOfCore could not be written
+    int  nbIterations      = 0;     // iterations actually run
+};
+
+// Solve running on an Executor, returned by AbstractEstimator::solveAsync
+class SolveHandle
 {
   public:
-    MSAC()
+    bool valid() const { return future.valid(); }
+
+    // Waits for the end of the solve
+    SolveStatus get() const { return future.get(); }
+    void wait() const { future.wait(); }
+
+    // False if the solve is still running after the given time
+    bool waitFor(double seconds) const
     {
-        sumSqErr = std::numeric_limits<double>::max();
+        return future.wait_for(std::chrono::duration<double>(seconds)) == std::future_status::ready;
     }
+    bool isReady() const { return waitFor(0.0); }
 
-    void solve(std::shared_ptr<EstimationProblem> pb, double thres = 0.1, int nbIter = -1)
+    // Stops the solve at the next check, see SolveControl. A solve still queued
+    // ends without any iteration.
+    void cancel() const { cancelToken.cancel(); }
+
+  private:
+    friend class AbstractEstimator;
+
+    std::shared_future<SolveStatus> future;
+    CancellationToken cancelToken;
+};
+
+// Parameters of AbstractEstimator::solveOutOfCore
+struct OutOfCoreOptions
+{
+    int reservoirSize = 100000;  // points held in memory, from which the hypotheses are drawn
+    int chunkSize = 1 << 20;     // points loaded at a time, rounded down to a multiple of 64
+    std::string inliersPath;     // file receiving the final inliers, none if empty
+    InliersFileFormat::Type inliersFormat = InliersFileFormat::Bitmask;
+};
+
+static std::random_device rd;  // random device engine, usually based on /dev/random on UNIX-like systems
+static std::mt19937 rng(rd()); // initialize Mersennes' twister using rd to generate the seed
+
+// Scratch memory of the estimators. Buffers only grow: once a workspace has seen
+// the largest number of samples and of threads, solve() does not allocate anymore
+// (model estimation and scoring are up to the problem). A workspace can be shared
+// by several estimators used one after the other, e.g. one per server thread.
+class SolverWorkspace
+{
+  public:
+    struct ThreadBuffers
     {
-        problem = pb;
+        std::vector<int>    permutation;  // state of the partial Fisher-Yates shuffle
+        std::vector<int>    sample;       // current minimal sample
+        std::vector<double> residuals;    // one residual per sample
+        std::vector<double> model;        // parameters of the current hypothesis
+        std::vector<int>    sortedSample; // key of the sample in the hash set
+        std::vector<double> batchCosts;   // per hypothesis of a batch, over the tiles of this thread
+        std::vector<int>    batchInliers;
+        int abortedAt = -1;               // residuals of the last scoring if it stopped early
 
-        int totalNbSamples = problem->getTotalNbSamples();
+        void reservePermutation(int nbSamples)
+        {
+            if ((int)permutation.size() != nbSamples)
+            {
+                // any permutation of 0..N-1 is a valid shuffle state
+                permutation.resize(nbSamples);
+                std::iota(permutation.begin(), permutation.end(), 0);
+            }
+        }
+    };
 
-        if (nbIter <= 0)
-            nbIter = this->calculateIterationsNb(problem->getTotalNbSamples());
+    // Hypothesis of a batch, see AbstractEstimator::setBatchSize
+    struct Hypothesis
+    {
+        std::vector<int>    sample;
+        std::vector<double> model;
+        double cost = 0.0;
+        int nbInliers = 0;
+        int iter = 0;
+    };
+
+    // Scores of a batch per NUMA partition, see AbstractEstimator::setNumaAware
+    std::vector<double> partialCosts;
+    std::vector<int>    partialInliers;
+
+    // Makes room for nbThreads threads, nbSamples samples and minimal samples of
+    // sampleSize, even for the threads that will not draw any in the next solve
+    void reserve(int nbSamples, int nbThreads, int sampleSize = 0)
+    {
+        if ((int)threads.size() < nbThreads)
+            threads.resize(nbThreads);
 
-        //#pragma omp parallel for
-        for (int i = 0; i < nbIter; ++i)
+        for (auto & buffers : threads)
         {
-            std::vector<int> indices = randomSampleIdx();
-            problem->estimModelFromSamples(indices);
+            buffers.reservePermutation(nbSamples);
+            if ((int)buffers.residuals.size() < nbSamples)
+                buffers.residuals.resize(nbSamples);
+            buffers.sample.reserve(sampleSize);
+            buffers.sortedSample.reserve(sampleSize);
+        }
+    }
 
-            double sumSqErr = 0;
-            int nbInliers = 0;
-            for (int j = 0; j < totalNbSamples; ++j)
-            {
-                double error = problem->estimErrorForSample(j);
+    // Makes room for batches of nbHypotheses hypotheses
+    void reserveBatch(int nbHypotheses)
+    {
+        if ((int)hypotheses.size() < nbHypotheses)
+            hypotheses.resize(nbHypotheses);
+        for (auto & buffers : threads)
+        {
+            buffers.batchCosts.reserve(nbHypotheses);
+            buffers.batchInliers.reserve(nbHypotheses);
+        }
+    }
 
-                if (error * error < thres * thres)
-                {
-                    sumSqErr += error * error;
-                    nbInliers++;
-                }
-                else
-                {
-                    sumSqErr += thres * thres;
-                }
-            }
+    // Empties the set of scored samples, sized for nbSamples insertions
+    void resetSampleHashes(int nbSamples)
+    {
+        size_t size = 16;
+        while (size < 2 * (size_t) nbSamples && size < maxSampleHashes)
+            size *= 2;
+        if (sampleHashes.size() < size)
+            sampleHashes.resize(size);
+        std::fill(sampleHashes.begin(), sampleHashes.end(), 0);
+        nbSampleHashes = 0;
+    }
+
+    // Records the hash of a sorted minimal sample (open addressing). Returns false if
+    // it was already recorded. Once the table is half full, every sample is new.
+    bool insertSample(const std::vector<int> & sortedSample)
+    {
+        uint64_t hash = 14695981039346656037ULL; // FNV-1a
+        for (int i : sortedSample)
+        {
+            hash ^= (uint64_t)(uint32_t) i;
+            hash *= 1099511628211ULL;
+        }
+        hash |= 1; // 0 marks an empty slot
 
-            #pragma omp critical
+        bool inserted = true;
+        #pragma omp critical(robest_sample_hashes)
+        {
+            if (2 * nbSampleHashes < sampleHashes.size())
             {
-                double inliersFraction = (double)(nbInliers) / (double)(problem->getTotalNbSamples());
+                size_t mask = sampleHashes.size() - 1;
+                size_t slot = (size_t)(hash ^ (hash >> 29)) & mask;
+                while (sampleHashes[slot] != 0 && sampleHashes[slot] != hash)
+                    slot = (slot + 1) & mask;
 
-                if (sumSqErr < this->sumSqErr )
+                inserted = sampleHashes[slot] == 0;
+                if (inserted)
                 {
-                    this->inliersFraction = inliersFraction;
-                    this->sumSqErr = sumSqErr;
-                    this->bestIdxSet = indices;
+                    sampleHashes[slot] = hash;
+                    nbSampleHashes++;
                 }
             }
         }
-     
-        problem->estimModelFromSamples(bestIdxSet);
-        getInliers(thres);
-        //problem->estimModelFromSamples(inliersIdx);
+        return inserted;
     }
+
+    ThreadBuffers & thread(int threadId)
+    {
+        assert(threadId < (int)threads.size() && "Workspace not reserved for this thread");
+        return threads[threadId];
+    }
+
+    std::vector<Hypothesis> hypotheses;   // current batch
+    InlierMask mask;                      // inliers of a prior
+    std::vector<int> indices;             // weighted fits
+    std::vector<double> weights;
+
   private:
-    double sumSqErr;
+    static const size_t maxSampleHashes = size_t(1) << 22;
+
+    std::vector<ThreadBuffers> threads;
+    std::vector<uint64_t> sampleHashes;   // scored samples, see AbstractEstimator::setUniqueSamples
+    size_t nbSampleHashes = 0;
 };
 
-class LMedS : public AbstractEstimator
+// Base class for Robust Estimators
+class AbstractEstimator
 {
   public:
-    LMedS()
+    AbstractEstimator() {}
+    virtual ~AbstractEstimator() {}
+
+    // Estimators are not copyable: the state shared by the threads of a solve
+    // (required iterations, cost bound) is atomic, and a copy would share the
+    // workspace. Create one estimator per concurrent solve.
+    AbstractEstimator(const AbstractEstimator &) = delete;
+    AbstractEstimator & operator=(const AbstractEstimator &) = delete;
+
+    // Generate X !different! random numbers from 0 to N-1
+    // X - minimal number of samples
+    // N - total number of samples
+    // generated numbers are indices of data points
+    // Each calling thread draws from a shuffle state of its own, out of the workspace.
+
+    std::vector<int> randomSampleIdx()
+    {
+        static thread_local SolverWorkspace::ThreadBuffers buffers;
+        buffers.reservePermutation(problem->getTotalNbSamples());
+        std::vector<int> idx;
+        randomSampleIdx(buffers, idx);
+        return idx;
+    }
+
+    int calculateIterationsNb(const int batchSize, const float alpha = 0.99f, const float gamma = 0.80f) const
     {
-        med = std::numeric_limits<double>::max();
+        assert(batchSize > 0 && "The size of input data must be > 0");
+        assert((alpha > 0.0f && alpha <  1.0f) && "Accepted value of success probability (aplha) is in range (0,1)");
+        assert((gamma > 0.0f && gamma <= 1.0f) && "Accepted value of inlier's ratio (gamma) is in range (0,1]");
+
+        if (gamma == 1.0f)
+            return 1;
+
+        // Counting the number of iteration
+        int nbIter = 1 + int(std::log(1.0 - alpha) / std::log(1.0 - std::pow(gamma, batchSize)));
+        if ( nbIter < 0 || nbIter > 50000) nbIter = 50000;
+
+        assert(nbIter > 0 && "Number of interations must be > 0: check solver params or define nbIter manually");
+        
+        return nbIter;
     }
 
     void solve(std::shared_ptr<EstimationProblem> pb, double thres = 0.1, int nbIter = -1)
     {
+        solve(pb, thres, nbIter, SolveControl::unbounded());
+    }
+
+    // Solve bounded by nbIter and by the deadline / cancellation token of control.
+    // The inliers extraction and refit always run on the best model found so far,
+    // within the time reserved for them.
+    SolveStatus solve(std::shared_ptr<EstimationProblem> pb, double thres, int nbIter, const SolveControl & control)
+    {
+        StatsTimer totalTimer;
+        stats.reset();
+        traceId = Tracer::global().beginSolve();
+        ROBEST_TRACE_SPAN("solve", traceId);
         problem = pb;
-        int totalNbSamples = problem->getTotalNbSamples();
+        workspace->reserve(problem->getTotalNbSamples(), omp_get_max_threads(), problem->getNbMinSamples());
+        resetBest();
+        prepareSolve();
 
         if (nbIter <= 0)
             nbIter = this->calculateIterationsNb(problem->getTotalNbSamples());
 
-        #pragma omp parallel for
-        for (int i = 0; i < nbIter; ++i)
+        // exhaustive search if all the minimal samples fit in the budget
+        enumerateSamples = false;
+        long long nbSubsets = 0;
+        if (uniqueSamples)
         {
-            MedianFinder<double> errorsVec;
-            std::vector<int> indices = randomSampleIdx();
+            nbSubsets = nbCombinations(problem->getTotalNbSamples(), problem->getNbMinSamples(), nbIter);
+            enumerateSamples = nbSubsets <= nbIter;
+            if (enumerateSamples)
+                nbIter = (int) nbSubsets;
+            else
+                workspace->resetSampleHashes(nbIter);
+        }
+        SolveControl iterControl = control;
+        if (enumerateSamples)
+            iterControl.adaptiveTermination = false;
 
-            problem->estimModelFromSamples(indices);
+        const int previousNbThreads = omp_get_max_threads();
+        const bool batched = chooseParallelism(thres, nbIter, iterControl);
+        if (parallel.tuned)
+            omp_set_num_threads(parallel.nbThreads);
 
-            for (int j = 0; j < problem->getTotalNbSamples(); ++j)
-            {
-                double error = problem->estimErrorForSample(j);
-                //errorsVec[j] = error; // error must be squared!
-                errorsVec.add(error * error);
-            }
-            double med = errorsVec.median();
+        scorePriors(thres, control.confidence);
+        SolveStatus status = batched ? runBatchedIterations(thres, nbIter, iterControl)
+                                     : runIterations(thres, nbIter, iterControl);
+        if (enumerateSamples && status.nbIterations == nbSubsets)
+            status.confidenceReached = true;
+        costBound.store(std::numeric_limits<double>::max());
 
-            #pragma omp critical
-            {
-                if (med < this->med)
-                {
-                    this->med = med;
-                    this->bestIdxSet = indices;
+        StatsTimer finalTimer;
+        {
+            ROBEST_TRACE_SPAN("final", traceId);
+            finalizeModel(thres);
+        }
+        if (parallel.tuned)
+            omp_set_num_threads(previousNbThreads);
+        stats.finalTime = finalTimer.elapsed();
+        stats.totalTime = totalTimer.elapsed();
+
+        return status;
+    }
+
+    // solve() on a worker of the executor. The estimator and pb must not be used
+    // until the handle is ready, then the results are read as after solve(). The
+    // token of control and the handle both cancel the solve.
+    SolveHandle solveAsync(std::shared_ptr<EstimationProblem> pb, double thres, int nbIter,
+                           const SolveControl & control = SolveControl::unbounded(),
+                           Executor & executor = Executor::global())
+    {
+        SolveHandle handle;
+        handle.cancelToken = control.cancelToken.child();
+        SolveControl asyncControl = control;
+        asyncControl.cancelToken = handle.cancelToken;
+
+        auto task = std::make_shared<std::packaged_task<SolveStatus()>>([this, pb, thres, nbIter, asyncControl]()
+        {
+            return solve(pb, thres, nbIter, asyncControl);
+        });
+        handle.future = task->get_future().share();
+        executor.submit([task]() { (*task)(); });
+        return handle;
+    }
+
+    // Coarse-to-fine solve on a pyramid built for the samples of pb. The iterations
+    // run on the coarsest level; its best hypotheses (see setNbCarriedHypotheses) and
+    // its refined model are scored again on each finer level, the better half being
+    // kept each time, and the inliers extraction and refit run on the full dataset.
+    // Prior models are scored on the coarsest level with the other hypotheses.
+    SolveStatus solveHierarchical(std::shared_ptr<EstimationProblem> pb, const SamplePyramid & pyramid,
+                                  double thres, int nbIter, const SolveControl & control = SolveControl::unbounded())
+    {
+        assert(pyramid.getTotalNbSamples() == pb->getTotalNbSamples() && "Pyramid of other data");
+        if (pyramid.nbLevels() <= 1)
+            return solve(pb, thres, nbIter, control);
+
+        StatsTimer totalTimer;
+        const int coarsest = pyramid.nbLevels() - 1;
+        auto coarse = std::make_shared<SubsetProblem>(pb, pyramid.indices(coarsest));
+
+        candidates.clear();
+        nbCandidates = nbCarried;
+        SolveStatus status = solve(coarse, thres, nbIter, control);
+        nbCandidates = 0;
+        double finalTime = stats.finalTime;
+
+        // hypotheses in indices of the full dataset, the refined model first
+        std::vector<Carried> carried;
+        if (inliersMask.count() >= pb->getNbMinSamples())
+        {
+            Carried refined;
+            if (!pb->getModelParams(refined.prior.model))
+                refined.prior.inliers = coarse->toProblemIdx(getInliersIndices());
+            carried.push_back(refined);
+        }
+        for (const Candidate & candidate : candidates)
+        {
+            Carried hypothesis;
+            if (candidate.prior < 0)
+                hypothesis.prior.inliers = coarse->toProblemIdx(candidate.sample);
+            else if (priors[candidate.prior].model.empty())
+                hypothesis.prior.inliers = coarse->toProblemIdx(priors[candidate.prior].inliers);
+            else
+                hypothesis.prior.model = priors[candidate.prior].model;
+            carried.push_back(hypothesis);
+        }
+        candidates.clear();
+
+        StatsAccumulator threadStats;
+        for (int level = coarsest - 1; level >= 0 && !carried.empty(); --level)
+        {
+            if (control.cancelToken.isCancelled())
+            {
+                status.cancelled = true;
+                break;
+            }
+
+            std::shared_ptr<EstimationProblem> levelProblem = pb;
+            if (level > 0)
+                levelProblem = std::make_shared<SubsetProblem>(pb, pyramid.indices(level));
+            workspace->reserve(levelProblem->getTotalNbSamples(), omp_get_max_threads());
+
+            for (Carried & hypothesis : carried)
+            {
+                problem = pb;
+                hypothesis.valid = restorePrior(hypothesis.prior);
+                if (!hypothesis.valid)
+                    continue;
+                problem = levelProblem;
+                hypothesis.cost = scoreCurrentModel(thres, hypothesis.nbInliers);
+                threadStats.endScoring(levelProblem->getTotalNbSamples());
+            }
+
+            carried.erase(std::remove_if(carried.begin(), carried.end(),
+                          [](const Carried & hypothesis) { return !hypothesis.valid; }), carried.end());
+            std::stable_sort(carried.begin(), carried.end(),
+                             [](const Carried & a, const Carried & b) { return a.cost < b.cost; });
+            carried.resize(std::min(carried.size(), level > 0 ? (carried.size() + 1) / 2 : size_t(1)));
+        }
+        threadStats.mergeInto(stats, 0);
+
+        // final phase on the full dataset, the retained hypothesis acting as a prior
+        StatsTimer finalTimer;
+        problem = pb;
+        workspace->reserve(pb->getTotalNbSamples(), omp_get_max_threads());
+        resetBest();
+        if (!carried.empty())
+        {
+            priors.push_back(carried[0].prior);
+            bestPrior = (int) priors.size() - 1;
+            bestCost = carried[0].cost;
+            bestNbInliers = carried[0].nbInliers;
+        }
+        finalizeModel(thres);
+        if (bestPrior >= 0)
+        {
+            priors.pop_back();
+            bestPrior = -1;
+        }
+        stats.finalTime = finalTime + finalTimer.elapsed();
+        stats.totalTime = totalTimer.elapsed();
+
+        return status;
+    }
+
+    // Loads n points of a point file (dims() coordinates each, row by row) into the
+    // problem solved out of core, replacing its data. The points are only valid
+    // during the call.
+    typedef std::function<void(const double * points, int n)> PointsLoader;
+
+    // Solve on a point file larger than the memory. pb is loaded (see PointsLoader)
+    // with a uniform sample of options.reservoirSize points and solved as by solve().
+    // Its refined model and its best hypotheses (see setNbCarriedHypotheses) are then
+    // scored on the whole file, loaded chunk by chunk with a read-ahead of one chunk,
+    // all the hypotheses being scored on a chunk before the next one is read. The
+    // winner is refit on its inliers of the reservoir (if the estimator refits) and
+    // a last pass over the file streams its inliers to options.inliersPath. If the
+    // file cannot be created or written, SolveStatus::ioError is set and the file is
+    // left incomplete.
+    //
+    // It needs an estimator that scores by tile (RANSAC, MSAC, MAGSAC) and a problem
+    // implementing getModelParams, setModelParams and estimErrorsForModel. Once done,
+    // pb holds the reservoir and the final model, getInliersMask() is the one of the
+    // reservoir and getInliersFraction() the one of the whole file. The control bounds
+    // the iterations on the reservoir; a cancellation during a pass over the file
+    // keeps the best hypothesis on the chunks already scored.
+    SolveStatus solveOutOfCore(std::shared_ptr<EstimationProblem> pb, const MappedPointFile & file, PointsLoader load,
+                               double thres, int nbIter, const OutOfCoreOptions & options = OutOfCoreOptions(),
+                               const SolveControl & control = SolveControl::unbounded())
+    {
+        assert(file.isOpen() && file.size() > 0 && "Empty point file");
+        assert(options.reservoirSize > 0 && options.chunkSize > 0 && "Wrong out-of-core parameters");
+        StatsTimer totalTimer;
+        const int dims = file.dims();
+
+        // the reservoir, in file order
+        std::vector<long long> reservoirIdx;
+        sampleReservoir(file.size(), options.reservoirSize, reservoirIdx);
+        std::vector<double> reservoir(reservoirIdx.size() * dims);
+        for (size_t i = 0; i < reservoirIdx.size(); ++i)
+            std::copy(file.point(reservoirIdx[i]), file.point(reservoirIdx[i]) + dims, reservoir.begin() + i * dims);
+        load(reservoir.data(), (int) reservoirIdx.size());
+
+        candidates.clear();
+        nbCandidates = nbCarried;
+        SolveStatus status = solve(pb, thres, nbIter, control);
+        nbCandidates = 0;
+
+        // hypotheses as model parameters, the refined model first
+        double cost = 0.0;
+        int nbInliers = 0;
+        bool byTile = scoreTile(nullptr, 0, 0.0, cost, nbInliers);
+        assert(byTile && "The estimator does not score by tile");
+        (void) byTile;
+        workspace->reserveBatch(1 + (int) candidates.size());
+        std::vector<SolverWorkspace::Hypothesis> & batch = workspace->hypotheses;
+        int nbModels = 0;
+        if (inliersMask.count() >= pb->getNbMinSamples() && pb->getModelParams(batch[nbModels].model))
+            nbModels++;
+        for (const Candidate & candidate : candidates)
+        {
+            bool valid = true;
+            if (candidate.prior < 0)
+                pb->estimModelFromSamples(candidate.sample);
+            else
+                valid = restorePrior(priors[candidate.prior]);
+            if (valid && pb->getModelParams(batch[nbModels].model))
+                nbModels++;
+        }
+        candidates.clear();
+        if (nbModels == 0)
+        {
+            stats.totalTime = totalTimer.elapsed();
+            return status;
+        }
+
+        // scores on the whole file
+        StatsTimer scoringTimer;
+        std::vector<double> costs(nbModels, 0.0);
+        approxErrors = false;
+        bool complete = streamChunks(file, load, options.chunkSize, control.cancelToken, [&](long long, int n)
+        {
+            workspace->reserve(n, omp_get_max_threads());
+            scoreBatch(batch, nbModels, thres, tileSize);
+            for (int h = 0; h < nbModels; ++h)
+                costs[h] += batch[h].cost;
+            countResiduals((long long) n * nbModels);
+        });
+        status.cancelled = status.cancelled || !complete;
+        int best = (int)(std::min_element(costs.begin(), costs.end()) - costs.begin());
+        stats.scoringTime += scoringTimer.elapsed();
+
+        // refit on the reservoir
+        StatsTimer finalTimer;
+        std::vector<double> model = batch[best].model;
+        load(reservoir.data(), (int) reservoirIdx.size());
+        workspace->reserve(pb->getTotalNbSamples(), omp_get_max_threads());
+        pb->setModelParams(model);
+        if (refitOnInliers())
+        {
+            getInliers(thres);
+            if (inliersMask.count() >= pb->getNbMinSamples())
+            {
+                pb->estimModelFromSamples(getInliersIndices());
+                pb->getModelParams(model);
+            }
+        }
+
+        // inliers of the whole file
+        FILE * output = nullptr;
+        if (!options.inliersPath.empty())
+        {
+            output = std::fopen(options.inliersPath.c_str(), "wb");
+            status.ioError = !output;
+        }
+        long long nbFileInliers = 0;
+        std::vector<int64_t> fileIndices;
+        streamChunks(file, load, options.chunkSize, CancellationToken(), [&](long long begin, int n)
+        {
+            workspace->reserve(n, omp_get_max_threads());
+            pb->setModelParams(model);
+            computeInliersMask(thres, workspace->mask);
+            nbFileInliers += workspace->mask.count();
+            if (!output)
+                return;
+            bool written = true;
+            if (options.inliersFormat == InliersFileFormat::Bitmask)
+            {
+                for (int w = 0; w < workspace->mask.nbWords() && written; ++w)
+                {
+                    InlierMask::Word word = workspace->mask.word(w);
+                    written = std::fwrite(&word, sizeof(word), 1, output) == 1;
+                }
+            }
+            else
+            {
+                workspace->mask.toIndices(workspace->thread(0).sample);
+                fileIndices.assign(workspace->thread(0).sample.begin(), workspace->thread(0).sample.end());
+                for (int64_t & idx : fileIndices)
+                    idx += begin;
+                written = std::fwrite(fileIndices.data(), sizeof(int64_t), fileIndices.size(), output) == fileIndices.size();
+            }
+            // the inliers are still counted on the next chunks
+            if (!written)
+            {
+                std::fclose(output);
+                output = nullptr;
+                status.ioError = true;
+            }
+        });
+        if (output && std::fclose(output) != 0)
+            status.ioError = true;
+
+        // the problem keeps the reservoir and the final model
+        load(reservoir.data(), (int) reservoirIdx.size());
+        workspace->reserve(pb->getTotalNbSamples(), omp_get_max_threads());
+        pb->setModelParams(model);
+        getInliers(thres);
+        inliersFraction = (double) nbFileInliers / (double) file.size();
+
+        stats.finalTime += finalTimer.elapsed();
+        stats.totalTime = totalTimer.elapsed();
+        return status;
+    }
+
+    // Hypotheses of the coarsest level carried to the finer ones by solveHierarchical
+    // and to the whole file by solveOutOfCore
+    void setNbCarriedHypotheses(int n)
+    {
+        assert(n >= 0 && "Negative number of hypotheses");
+        nbCarried = n;
+    }
+
+    // Warm start: the next solve() calls score these models (getNbParams() values
+    // each, see EstimationProblem::getModelParams) before the first iteration, so the
+    // best-so-far starts high and the adaptive termination can fire immediately.
+    void setPriorModels(const std::vector<std::vector<double>> & models)
+    {
+        priors.erase(std::remove_if(priors.begin(), priors.end(),
+                     [](const Prior & prior) { return !prior.model.empty(); }), priors.end());
+        for (const auto & model : models)
+        {
+            Prior prior;
+            prior.model = model;
+            priors.push_back(prior);
+        }
+    }
+
+    // Warm start from inliers index sets of previous solves: a model is estimated
+    // from each set and scored before the first iteration.
+    void setPriorInliers(const std::vector<std::vector<int>> & inliersSets)
+    {
+        priors.erase(std::remove_if(priors.begin(), priors.end(),
+                     [](const Prior & prior) { return prior.model.empty(); }), priors.end());
+        for (const auto & inliers : inliersSets)
+        {
+            Prior prior;
+            prior.inliers = inliers;
+            priors.push_back(prior);
+        }
+    }
+
+    void clearPriors() { priors.clear(); }
+
+    // Probability for a minimal sample to be drawn among the inliers of the best
+    // prior rather than uniformly (0 by default). The adaptive termination only counts
+    // the uniform samples: it needs 1 / (1 - bias) times more iterations, while biased
+    // samples find the tracked model sooner within a fixed budget or deadline.
+    void setPriorSamplingBias(double bias)
+    {
+        assert(bias >= 0.0 && bias <= 1.0 && "Prior sampling bias is a probability");
+        priorSamplingBias = bias;
+    }
+
+    // Probability for a minimal sample to be drawn from the inlier probabilities
+    // learned during the solve (see robust_sampler.hpp) rather than uniformly (0 by
+    // default). Learning from the best models needs a problem implementing
+    // getModelParams and estimErrorsForModel. The adaptive termination only counts
+    // the uniform samples, whatever was learned: it needs 1 / (1 - guidance) times
+    // more iterations, while guided samples find a good model sooner within a fixed
+    // budget or deadline.
+    void setGuidedSampling(double guidance)
+    {
+        assert(guidance >= 0.0 && guidance < 1.0 && "Guidance is a probability, below 1 to keep uniform samples");
+        this->guidance = guidance;
+    }
+
+    // Batched verification: nbHypotheses models are generated, then scored together
+    // while the data is walked in tiles of tileSize samples, so that a tile is read
+    // from memory once per batch instead of once per hypothesis. Tiles are scored in
+    // parallel. It needs an estimator that scores by tile (RANSAC, MSAC, MAGSAC) and a
+    // problem implementing getModelParams and estimErrorsForModel: otherwise, or with
+    // nbHypotheses = 1 (default), the hypotheses are scored one at a time.
+    void setBatchSize(int nbHypotheses, int tileSize = 4096)
+    {
+        assert(nbHypotheses >= 1 && tileSize >= 1 && "Wrong batch size");
+        batchSize = nbHypotheses;
+        this->tileSize = tileSize;
+    }
+
+    // Parallel strategy of each solve chosen by the tuner (see robust_tuner.hpp)
+    // instead of the one set by setBatchSize and the estimator: serial, iterations
+    // shared by the threads or batches scored by tile. The costs of the problem type
+    // are measured on its first solve, unless the tuner already knows them. The tuner
+    // also picks the chunk, batch and tile sizes, and the number of OpenMP threads
+    // used by the calling thread until the end of the solve. Iterations are only
+    // shared by the threads if the estimator allows it (not MSAC), batches need the
+    // same support as setBatchSize. Disabled by default; sharded solves are not
+    // tuned. The strategy of every solve, tuned or not, is in SolverStats::parallel.
+    void setAutoTuning(bool enable, ParallelTuner & tuner = ParallelTuner::global())
+    {
+        autoTuning = enable;
+        this->tuner = &tuner;
+    }
+
+    // NUMA aware batched scoring (see robust_numa.hpp): the samples are split in one
+    // partition per node of the topology, moved to their node (EstimationProblem::
+    // placeSamples, on the first batched solve of a problem) and scored by threads
+    // pinned to the node; the threads get their previous affinity back at the end of
+    // the solve. It only applies to the batched scoring (setBatchSize) and does
+    // nothing on a single node. Disabled by default.
+    void setNumaAware(bool enable, const NumaTopology & topology = NumaTopology::system())
+    {
+        numaAware = enable;
+        numaTopology = topology;
+        placedVersion = 0;
+    }
+
+    // Minimal samples are never scored twice. When there are no more minimal samples
+    // (C(N, k)) than iterations, they are all enumerated: the best one is found for
+    // sure, in at most C(N, k) iterations, and the adaptive termination is not used.
+    // Otherwise, a random sample that was already drawn is drawn again (up to a few
+    // times). Disabled by default.
+    void setUniqueSamples(bool enable) { uniqueSamples = enable; }
+
+    // Early abort: the scoring of a hypothesis stops as soon as it cannot beat the best
+    // one (RANSAC, MSAC: not even with all the remaining samples as inliers; LMedS: more
+    // than half of the squared errors are above the best median). The best cost is
+    // shared by the threads. The results do not change, only residual evaluations are
+    // saved (see SolverStats::nbAborted). The batched and sharded scorings always go
+    // through the data. Enabled by default.
+    void setEarlyAbort(bool enable) { earlyAbort = enable; }
+
+    // Sharded scoring: the batches of hypotheses are scored by the workers of the
+    // transport (see serveShard), each holding a part of the data, instead of by this
+    // process. It needs an estimator that scores by tile (RANSAC, MSAC, MAGSAC) or
+    // from an error sketch (LMedS) and a problem implementing getModelParams; the
+    // batch size applies. The problem given to solve() draws the hypotheses and runs
+    // the final phase (inliers extraction and refit). Null to score locally. If a shard
+    // fails, see SolveStatus::shardsLost.
+    void setShards(std::shared_ptr<ShardTransport> transport) { shards = transport; }
+
+    // Adds the score of n errors to cost and nbInliers, as the batched scoring does
+    // for one tile. False if the estimator does not score by tile.
+    bool scoreErrors(const double * errors, int n, double thres, double & cost, int & nbInliers) const
+    {
+        return scoreTile(errors, n, thres, cost, nbInliers);
+    }
+
+    // Error that separates inliers from outliers for the threshold thres
+    double getInlierBoundary(double thres) const { return inlierBoundary(thres); }
+
+    // Scratch memory used by solve(); every estimator starts with its own
+    void setWorkspace(std::shared_ptr<SolverWorkspace> ws)
+    {
+        assert(ws && "Null workspace");
+        workspace = ws;
+    }
+    std::shared_ptr<SolverWorkspace> getWorkspace() const { return workspace; }
+
+    double getInliersFraction() const { return inliersFraction; }
+    const InlierMask & getInliersMask() const { return inliersMask; }
+
+    // Indices of the inliers in ascending order, converted from the mask by solve()
+    const std::vector<int> & getInliersIndices() const { return inliersIdx; }
+    const SolverStats & getStats() const { return stats; }
+
+    // Inlier probability of sample i learned by the last solve, 0 if it was not guided
+    // (see setGuidedSampling)
+    double getInlierProbability(int i) const { return i < guidedSampler.size() ? guidedSampler.probability(i) : 0.0; }
+
+    // Id of the spans of the last solve in Tracer::global(), 0 if it was not traced
+    // (see robust_trace.hpp). Tracer::global().writeChromeTrace(path, id, id)
+    // exports them.
+    uint32_t getTraceId() const { return traceId; }
+
+  protected:
+    // Cost of the model currently held by the problem: the lower, the better.
+    // nbInliers is set to the number of points the estimator considers as inliers.
+    virtual double scoreCurrentModel(double thres, int & nbInliers) = 0;
+
+    // Whether the final model is re-estimated from all the inliers
+    virtual bool refitOnInliers() const { return true; }
+
+    // Called once the problem is set, before any hypothesis is scored
+    virtual void prepareSolve() {}
+
+    // Optional: adds the score of n errors (one tile of the data) to cost and
+    // nbInliers. Estimators whose cost is a sum over the samples implement it to
+    // enable the batched scoring. Return false if not supported.
+    virtual bool scoreTile(const double * errors, int n, double thres, double & cost, int & nbInliers) const { return false; }
+
+    // Optional: cost from the histogram of the squared errors of all the samples, for
+    // the sharded scoring of estimators whose cost is not a sum over the samples.
+    // Return false if not supported.
+    virtual bool scoreSketch(const ErrorSketch & sketch, double & cost) const { return false; }
+
+    // Error that separates inliers from outliers for the threshold thres. Approximate
+    // errors closer than their bound to it are recomputed exactly.
+    virtual double inlierBoundary(double thres) const { return thres; }
+
+    // Final phase: puts the best model in the problem and extracts its inliers
+    virtual void finalizeModel(double thres) { refitFromBest(thres, refitOnInliers()); }
+
+    // Cost a hypothesis has to beat to become the best one, read by scoreCurrentModel
+    // every abortCheckInterval residuals: the scoring may stop once the cost is sure
+    // not to be lower, returning any cost that is not lower either. Infinite when the
+    // costs must be exact: early abort disabled, outside of the iterations, or when
+    // solveHierarchical keeps several hypotheses.
+    double costToBeat() const { return costBound.load(std::memory_order_relaxed); }
+
+    // Called by scoreCurrentModel when it stops after nbResiduals residuals
+    void scoringAborted(int nbResiduals) { workspace->thread(omp_get_thread_num()).abortedAt = nbResiduals; }
+
+    enum { abortCheckInterval = 256 };
+
+    // Residual evaluations done outside of the iterations loop
+    void countResiduals(long long nbResiduals)
+    {
+#ifndef ROBEST_DISABLE_STATS
+        stats.nbResiduals += nbResiduals;
+#endif
+    }
+
+    // Inliers of the model held by the problem (err^2 < thres^2). Threads fill
+    // disjoint words of the mask, 64 residuals at a time.
+    void computeInliersMask(double thres, InlierMask & mask)
+    {
+        const int totalNbSamples = problem->getTotalNbSamples();
+        const double thres2 = thres * thres;
+        mask.resize(totalNbSamples);
+        countResiduals(totalNbSamples);
+
+        #pragma omp parallel
+        {
+        ROBEST_TRACE_SPAN("inliers mask", traceId);
+
+        #pragma omp for
+        for (int w = 0; w < mask.nbWords(); ++w)
+        {
+            double errors2[InlierMask::wordBits];
+            int begin = w * InlierMask::wordBits;
+            int n = std::min((int) InlierMask::wordBits, totalNbSamples - begin);
+            for (int j = 0; j < n; ++j)
+            {
+                double error = problem->estimErrorForSample(begin + j);
+                errors2[j] = error * error;
+            }
+            mask.setWord(w, InlierMask::thresholdWord(errors2, n, thres2));
+        }
+        }
+    }
+
+    // Inliers extraction and refit are accounted as the final phase
+    void getInliers(double thres)
+    {
+        computeInliersMask(thres, inliersMask);
+        inliersMask.toIndices(inliersIdx);
+        this->inliersFraction = (double)(inliersMask.count()) / (double)(problem->getTotalNbSamples());
+    }
+
+    // Final step of every estimator: best model (minimal sample or prior), its inliers
+    // and optionally a refit on them. Nothing to do if all samples were degenerate.
+    void refitFromBest(double thres, bool refitOnInliers)
+    {
+        if (bestPrior >= 0)
+        {
+            restorePrior(priors[bestPrior]);
+        }
+        else if (bestIdxSet.empty())
+        {
+            inliersMask.resize(problem->getTotalNbSamples());
+            inliersIdx.clear();
+            inliersFraction = 0.0;
+            return;
+        }
+        else
+        {
+            problem->estimModelFromSamples(bestIdxSet);
+        }
+
+        getInliers(thres);
+        if (refitOnInliers && inliersMask.count() >= problem->getNbMinSamples())
+        {
+            ROBEST_TRACE_SPAN("refit", traceId);
+            problem->estimModelFromSamples(getInliersIndices());
+        }
+    }
+
+    std::shared_ptr<EstimationProblem> problem;
+    std::vector<int> bestIdxSet;
+    InlierMask inliersMask;
+    std::shared_ptr<SolverWorkspace> workspace = std::make_shared<SolverWorkspace>();
+    double inliersFraction = -1.0;
+    double bestCost = std::numeric_limits<double>::max();
+    SolverStats stats;
+
+    // Iterations of RANSAC-like estimators run in parallel unless disabled here
+    bool parallelIterations = true;
+
+    uint32_t traceId = 0; // of the spans of the solve, 0 if not traced
+
+  private:
+    typedef SolveControl::Clock Clock;
+
+    // Warm start hypothesis: either model parameters or an inliers index set
+    struct Prior
+    {
+        std::vector<double> model;
+        std::vector<int> inliers;
+    };
+
+    // Puts the prior model into the problem, false if it cannot be used
+    bool restorePrior(const Prior & prior)
+    {
+        if (!prior.model.empty())
+            return problem->setModelParams(prior.model);
+
+        int totalNbSamples = problem->getTotalNbSamples();
+        if ((int)prior.inliers.size() < problem->getNbMinSamples())
+            return false;
+        for (int idx : prior.inliers)
+        {
+            if (idx < 0 || idx >= totalNbSamples)
+                return false;
+        }
+        problem->estimModelFromSamples(prior.inliers);
+        return true;
+    }
+
+    // Priors are scored before any iteration. The inliers of the best one are kept
+    // as the pool of the biased sampler.
+    void scorePriors(double thres, float confidence)
+    {
+        priorPool.clear();
+        StatsAccumulator threadStats;
+
+        for (int p = 0; p < (int)priors.size(); ++p)
+        {
+            if (!restorePrior(priors[p]))
+                continue;
+
+            int nbInliers = 0;
+            double cost = scoreHypothesis(thres, nbInliers, threadStats);
+            if (nbCandidates > 0)
+                keepCandidate(cost, std::vector<int>(), p);
+
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                tightenCostBound();
+                bestNbInliers = nbInliers;
+                inliersFraction = (double)(nbInliers) / (double)(problem->getTotalNbSamples());
+                bestPrior = p;
+                requiredIterations.store(iterationsForConfidence(confidence));
+                stats.improvedAt(-1);
+            }
+        }
+        threadStats.mergeInto(stats, 0);
+
+        if (bestPrior >= 0 && priorSamplingBias > 0.0)
+        {
+            restorePrior(priors[bestPrior]);
+            computeInliersMask(thres, workspace->mask);
+            workspace->mask.toIndices(priorPool);
+            requiredIterations.store(iterationsForConfidence(confidence));
+        }
+    }
+
+    // k indices drawn uniformly from 0..n-1 without replacement, in ascending order.
+    // Reservoir sampling (algorithm L): about k * (1 + log(n / k)) random draws.
+    static void sampleReservoir(long long n, int k, std::vector<long long> & idx)
+    {
+        idx.clear();
+        for (long long i = 0; i < std::min<long long>(n, k); ++i)
+            idx.push_back(i);
+        if (n <= k)
+            return;
+
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::uniform_int_distribution<int> slot(0, k - 1);
+        double w = std::exp(std::log(1.0 - uniform(rng)) / k);
+        long long i = k - 1;
+        while (true)
+        {
+            // number of points skipped before the next one enters the reservoir
+            i += (long long) std::floor(std::log(1.0 - uniform(rng)) / std::log(1.0 - w)) + 1;
+            if (i >= n || i < 0)
+                break;
+            idx[slot(rng)] = i;
+            w *= std::exp(std::log(1.0 - uniform(rng)) / k);
+        }
+        std::sort(idx.begin(), idx.end());
+    }
+
+    // Loads the file chunk by chunk (chunkSize points, a multiple of 64) and calls
+    // fn(first point, nbPoints) on each one. The next chunk is read ahead and the
+    // pages of the chunk processed are released. False if cancelled.
+    template<typename Fn>
+    static bool streamChunks(const MappedPointFile & file, const PointsLoader & load, int chunkSize,
+                             const CancellationToken & cancelToken, Fn fn)
+    {
+        const long long chunk = std::max<int>(InlierMask::wordBits, chunkSize / InlierMask::wordBits * InlierMask::wordBits);
+        file.willNeed(0, chunk);
+        for (long long begin = 0; begin < file.size(); begin += chunk)
+        {
+            if (cancelToken.isCancelled())
+                return false;
+            long long end = std::min(begin + chunk, file.size());
+            file.willNeed(end, end + chunk);
+            load(file.point(begin), (int)(end - begin));
+            fn(begin, (int)(end - begin));
+            file.release(begin, end);
+        }
+        return true;
+    }
+
+    // Generate X !different! random numbers from 0 to N-1
+    // X - minimal number of samples
+    // N - total number of samples
+    // generated numbers are indices of data points
+    void randomSampleIdx(SolverWorkspace::ThreadBuffers & buffers, std::vector<int> & idx)
+    {
+        int minNbSamples = problem->getNbMinSamples();
+        int totalNbSamples = problem->getTotalNbSamples();
+
+        if (priorSamplingBias > 0.0 && (int)priorPool.size() >= minNbSamples)
+        {
+            std::uniform_real_distribution<double> coin(0.0, 1.0);
+            if (coin(rng) < priorSamplingBias)
+            {
+                randomPriorSampleIdx(idx);
+                return;
+            }
+        }
+
+        if (guidance > 0.0 && guidedSampler.size() == totalNbSamples)
+        {
+            std::uniform_real_distribution<double> coin(0.0, 1.0);
+            if (coin(rng) < guidance)
+            {
+                #pragma omp critical(robest_guided)
+                guidedSampler.draw(minNbSamples, rng, idx);
+                return;
+            }
+        }
+
+        uniformSampleIdx(buffers, idx);
+    }
+
+    // Minimal sample drawn uniformly, whatever the sampling settings
+    void uniformSampleIdx(SolverWorkspace::ThreadBuffers & buffers, std::vector<int> & idx,
+                          std::mt19937 & generator = rng)
+    {
+        int minNbSamples = problem->getNbMinSamples();
+        int totalNbSamples = problem->getTotalNbSamples();
+
+        // shuffle the elements of the permutation : partial Fisher–Yates shuffle.
+        // The permutation is not reset between two draws, it stays a permutation.
+        std::vector<int> & allIdx = buffers.permutation;
+        for (int i = 0; i < minNbSamples; i++)
+        {
+            std::uniform_int_distribution<int> dist(0, totalNbSamples - i - 1);
+            int randInt = dist(generator);
+            std::swap(allIdx[totalNbSamples - i - 1], allIdx[randInt]);
+        }
+
+        //take last <minNbSamples> elements
+        idx.assign(allIdx.end() - minNbSamples, allIdx.end());
+    }
+
+    // Minimal sample of iteration iter: random, enumerated or redrawn if already scored
+    void drawSample(SolverWorkspace::ThreadBuffers & buffers, std::vector<int> & idx, int iter)
+    {
+        if (enumerateSamples)
+        {
+            combinationFromRank(problem->getTotalNbSamples(), problem->getNbMinSamples(), iter, idx);
+            return;
+        }
+
+        randomSampleIdx(buffers, idx);
+        if (!uniqueSamples)
+            return;
+
+        for (int attempt = 0; attempt < 16; ++attempt)
+        {
+            buffers.sortedSample.assign(idx.begin(), idx.end());
+            std::sort(buffers.sortedSample.begin(), buffers.sortedSample.end());
+            if (workspace->insertSample(buffers.sortedSample))
+                return;
+            randomSampleIdx(buffers, idx);
+        }
+    }
+
+    // C(n, k), or cap + 1 if it is larger than cap
+    static long long nbCombinations(int n, int k, long long cap)
+    {
+        if (k > n)
+            return 0;
+        long long c = 1;
+        for (int i = 1; i <= k; ++i)
+        {
+            // C(n-k+i, i) = C(n-k+i-1, i-1) * (n-k+i) / i, exact at every step
+            c = c * (n - k + i) / i;
+            if (c > cap)
+                return cap + 1;
+        }
+        return c;
+    }
+
+    // k-subset of {0 .. n-1} of the given rank, in lexicographic order
+    static void combinationFromRank(int n, int k, long long rank, std::vector<int> & idx)
+    {
+        idx.resize(k);
+        int x = 0;
+        for (int i = 0; i < k; ++i)
+        {
+            while (true)
+            {
+                long long c = nbCombinations(n - x - 1, k - i - 1, std::numeric_limits<long long>::max() / n);
+                if (rank < c)
+                    break;
+                rank -= c;
+                x++;
+            }
+            idx[i] = x++;
+        }
+    }
+
+    // minNbSamples different indices drawn from the prior inliers
+    void randomPriorSampleIdx(std::vector<int> & idx)
+    {
+        int minNbSamples = problem->getNbMinSamples();
+        std::uniform_int_distribution<int> dist(0, (int)priorPool.size() - 1);
+
+        idx.clear();
+        while ((int)idx.size() < minNbSamples)
+        {
+            int candidate = priorPool[dist(rng)];
+            if (std::find(idx.begin(), idx.end(), candidate) == idx.end())
+                idx.push_back(candidate);
+        }
+    }
+
+    void resetBest()
+    {
+        bestPrior = -1;
+        bestIdxSet.clear();
+        inliersFraction = -1.0;
+        bestCost = std::numeric_limits<double>::max();
+        costBound.store(std::numeric_limits<double>::max());
+        bestNbInliers = 0;
+        requiredIterations.store(std::numeric_limits<int>::max());
+    }
+
+    // Guided samples of the iterations on the current problem start from the prior
+    void prepareGuidedSampling(double thres)
+    {
+        if (guidance == 0.0 || enumerateSamples)
+        {
+            guidedSampler.reset(0);
+            return;
+        }
+        guidedSampler.reset(problem->getTotalNbSamples());
+        guidedBoundary = inlierBoundary(thres);
+        bestSequence = learnedSequence = 0;
+    }
+
+    // The guided sampler learns from the errors of the best model number sequence (see
+    // updateBest), if they can be computed. Called out of the critical section of
+    // updateBest: the errors of the model are computed by the calling thread, and a
+    // model older than the one learned meanwhile is dropped.
+    void learnFromBest(const std::vector<double> & model, int nbInliers, int sequence)
+    {
+        const int totalNbSamples = problem->getTotalNbSamples();
+        double * errors = workspace->thread(omp_get_thread_num()).residuals.data();
+        if (!problem->estimErrorsForModel(model, 0, totalNbSamples, errors))
+            return;
+
+        #pragma omp critical(robest_guided)
+        {
+            if (sequence > learnedSequence)
+            {
+                guidedSampler.learnFromModel(errors, nbInliers, guidedBoundary);
+                learnedSequence = sequence;
+            }
+        }
+    }
+
+    // Iterations needed to reach the confidence target with the current best model.
+    // With biased or guided sampling, only the uniform samples are counted (see
+    // sampleSuccessProbability).
+    int iterationsForConfidence(float confidence) const
+    {
+        if (bestNbInliers <= 0)
+            return std::numeric_limits<int>::max();
+
+        int totalNbSamples = problem->getTotalNbSamples();
+        float gamma = std::min(1.0f, (float) bestNbInliers / (float) totalNbSamples);
+        if ((priorPool.empty() || priorSamplingBias == 0.0) && guidedSampler.size() == 0)
+            return calculateIterationsNb(problem->getNbMinSamples(), confidence, gamma);
+
+        double pSuccess = sampleSuccessProbability();
+        if (pSuccess >= 1.0)
+            return 1;
+        if (pSuccess <= 0.0)   // no uniform samples
+            return 50000;
+
+        double nbIter = 1.0 + std::log(1.0 - confidence) / std::log(1.0 - pSuccess);
+        return nbIter > 50000.0 ? 50000 : int(nbIter);
+    }
+
+    // Probability for a minimal sample to be drawn uniformly and all inliers of the
+    // best model. Samples drawn among the prior inliers or from the guided sampler are
+    // not counted: a stale or wrong prior would otherwise stop the solve on its own
+    // model after a handful of iterations.
+    double sampleSuccessProbability() const
+    {
+        const int k = problem->getNbMinSamples();
+        double gamma = std::min(1.0, (double) bestNbInliers / (double) problem->getTotalNbSamples());
+        double pSuccess = std::pow(gamma, k);
+        if (guidedSampler.size() > 0)
+            pSuccess *= 1.0 - guidance;
+        if ((int) priorPool.size() >= k && priorSamplingBias > 0.0)
+            pSuccess *= 1.0 - priorSamplingBias;
+        return pSuccess;
+    }
+
+    // Probability that one of nbIterations samples was all inliers of the best model,
+    // with the success probability of iterationsForConfidence
+    double confidenceAfter(int nbIterations) const
+    {
+        if (bestNbInliers <= 0)
+            return 0.0;
+
+        double pSuccess = sampleSuccessProbability();
+        if (pSuccess >= 1.0)
+            return 1.0;
+        return 1.0 - std::pow(1.0 - pSuccess, nbIterations);
+    }
+
+    // Calls control.progress once progressInterval went by since lastReport, or at
+    // the end of the iterations. Called by one thread at a time.
+    void reportProgress(const SolveControl & control, int nbDone, Clock::time_point & lastReport, bool end)
+    {
+        if (!control.progress)
+            return;
+        Clock::time_point now = Clock::now();
+        if (!end && std::chrono::duration<double>(now - lastReport).count() < control.progressInterval)
+            return;
+        lastReport = now;
+
+        SolveProgress progress;
+        progress.nbIterations = nbDone;
+        #pragma omp critical
+        {
+            progress.bestCost = bestCost;
+            progress.inliersFraction = std::max(0.0, inliersFraction);
+            progress.confidence = confidenceAfter(nbDone);
+        }
+        control.progress(progress);
+    }
+
+    // One hypothesis: sample, model, score and keep it if it is the best so far
+    void runIteration(int iter, double thres, StatsAccumulator & threadStats, float confidence)
+    {
+        threadStats.startIteration();
+        SolverWorkspace::ThreadBuffers & buffers = workspace->thread(omp_get_thread_num());
+        std::vector<int> & indices = buffers.sample;
+        {
+            ROBEST_TRACE_SPAN("sample", traceId);
+            drawSample(buffers, indices, iter);
+        }
+        threadStats.endSampling();
+
+        if (problem->isDegenerate(indices))
+        {
+            threadStats.degenerateSample();
+            return;
+        }
+
+        {
+            ROBEST_TRACE_SPAN("model", traceId);
+            problem->estimModelFromSamples(indices);
+        }
+        threadStats.endModelEstimation();
+
+        int nbInliers = 0;
+        double cost = scoreHypothesis(thres, nbInliers, threadStats);
+
+        // an aborted scoring counted the inliers of the first residuals only: all the
+        // others may be inliers too
+        const int inliersBound = buffers.abortedAt < 0 ? nbInliers
+                                                       : nbInliers + problem->getTotalNbSamples() - buffers.abortedAt;
+
+        ROBEST_TRACE_MARK(waitStart, traceId);
+        int sequence = 0;
+        #pragma omp critical
+        {
+            ROBEST_TRACE_SINCE("wait best", waitStart, traceId);
+            ROBEST_TRACE_SPAN("update best", traceId);
+            sequence = updateBest(cost, nbInliers, indices, iter, confidence, nullptr, inliersBound);
+        }
+        if (sequence > 0)
+            learnFromBest(workspace->thread(omp_get_thread_num()).model, nbInliers, sequence);
+    }
+
+    // scoreCurrentModel, counting the residuals it evaluated
+    double scoreHypothesis(double thres, int & nbInliers, StatsAccumulator & threadStats)
+    {
+        int & abortedAt = workspace->thread(omp_get_thread_num()).abortedAt;
+        abortedAt = -1;
+        double cost;
+        {
+            ROBEST_TRACE_SPAN("score", traceId);
+            cost = scoreCurrentModel(thres, nbInliers);
+        }
+        threadStats.endScoring(abortedAt < 0 ? problem->getTotalNbSamples() : abortedAt, abortedAt >= 0);
+        return cost;
+    }
+
+    // The best cost becomes the bound of the early abort. Not thread safe.
+    void tightenCostBound()
+    {
+        if (earlyAbort && nbCandidates == 0)
+            costBound.store(bestCost, std::memory_order_relaxed);
+    }
+
+    // Keeps the hypothesis if it is the best so far; its model is the one of the problem
+    // if null. Not thread safe. With guided sampling, returns the sequence number of the
+    // new best model (0 if none) for learnFromBest: its parameters are model, or the
+    // model buffer of the calling thread once copied from the problem. The sample is
+    // taken as a failure if inliersBound (nbInliers if negative), an upper bound of the
+    // inliers when the scoring stopped early, is too low.
+    int updateBest(double cost, int nbInliers, const std::vector<int> & indices, int iter, float confidence,
+                   const std::vector<double> * model = nullptr, int inliersBound = -1)
+    {
+        int sequence = 0;
+        if (nbCandidates > 0)
+            keepCandidate(cost, indices, -1);
+
+        if (guidedSampler.size() > 0)
+        {
+            #pragma omp critical(robest_guided)
+            guidedSampler.update(indices, inliersBound < 0 ? nbInliers : inliersBound, bestNbInliers);
+        }
+
+        if (cost < this->bestCost)
+        {
+            this->bestCost = cost;
+            tightenCostBound();
+            this->bestNbInliers = nbInliers;
+            this->inliersFraction = (double)(nbInliers) / (double)(problem->getTotalNbSamples());
+            this->bestIdxSet = indices;
+            this->bestPrior = -1;
+            if (guidedSampler.size() > 0 && (model || problem->getModelParams(workspace->thread(omp_get_thread_num()).model)))
+                sequence = ++bestSequence;
+            this->requiredIterations.store(iterationsForConfidence(confidence));
+            stats.improvedAt(iter);
+        }
+        return sequence;
+    }
+
+    // Keeps the nbCandidates lowest cost hypotheses, sorted by cost. Not thread safe.
+    void keepCandidate(double cost, const std::vector<int> & sample, int prior)
+    {
+        if ((int) candidates.size() == nbCandidates && !(cost < candidates.back().cost))
+            return;
+
+        Candidate candidate;
+        candidate.cost = cost;
+        candidate.sample = sample;
+        candidate.prior = prior;
+        auto pos = std::upper_bound(candidates.begin(), candidates.end(), candidate,
+                                    [](const Candidate & a, const Candidate & b) { return a.cost < b.cost; });
+        candidates.insert(pos, candidate);
+        if ((int) candidates.size() > nbCandidates)
+            candidates.pop_back();
+    }
+
+    // Iterations are handed out in chunks; between two chunks each worker checks the
+    // cancellation token, the deadline (keeping the final phase reserve) and the
+    // adaptive termination criterion.
+    SolveStatus runIterations(double thres, int nbIter, const SolveControl & control)
+    {
+        const bool hasDeadline = control.deadline != Clock::time_point::max();
+        const int chunkSize = std::max(1, parallel.chunkSize);
+
+        std::atomic<int>  nextIter(0);
+        std::atomic<int>  nbDone(0);
+        std::atomic<bool> stop(false);
+        std::atomic<bool> deadlineReached(false);
+        std::atomic<long long> iterCostNs(0); // measured duration of one iteration
+        Clock::time_point lastReport = Clock::now();
+        std::atomic<bool> reporting(false); // a worker is reporting the progress
+        prepareGuidedSampling(thres);
+
+        #pragma omp parallel if(parallel.strategy == ParallelStrategy::Hypotheses)
+        {
+        StatsAccumulator threadStats;
+        ROBEST_TRACE_SPAN("iterations", traceId);
+
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (control.cancelToken.isCancelled() ||
+                (control.adaptiveTermination && nbDone.load() >= requiredIterations.load()))
+            {
+                stop.store(true);
+                break;
+            }
+
+            int chunk = chunkSize;
+            Clock::time_point chunkStart = Clock::now();
+            if (hasDeadline)
+            {
+                // iterations that still fit before the deadline minus the final phase
+                double iterCost = iterCostNs.load() * 1e-9;
+                double reserve  = control.finalPhaseReserve >= 0.0 ? control.finalPhaseReserve : 2.0 * iterCost;
+                double timeLeft = std::chrono::duration<double>(control.deadline - chunkStart).count() - reserve;
+                if (timeLeft <= 0.0)
+                {
+                    deadlineReached.store(true);
+                    stop.store(true);
+                    break;
+                }
+                // single iteration until its cost is known
+                chunk = iterCost > 0.0 ? (int) std::min<double>(chunk, timeLeft / iterCost) : 1;
+                if (chunk <= 0)
+                {
+                    deadlineReached.store(true);
+                    stop.store(true);
+                    break;
+                }
+            }
+
+            int begin = nextIter.fetch_add(chunk);
+            if (begin >= nbIter)
+                break;
+            int end = std::min(begin + chunk, nbIter);
+
+            for (int i = begin; i < end; ++i)
+            {
+                // adaptive termination is cheap enough to be checked at every iteration
+                if (control.adaptiveTermination && nbDone.load() + (i - begin) >= requiredIterations.load())
+                {
+                    end = i;
+                    stop.store(true);
+                    break;
+                }
+                runIteration(i, thres, threadStats, control.confidence);
+            }
+            if (end == begin)
+                break;
+
+            nbDone.fetch_add(end - begin);
+            if (hasDeadline)
+            {
+                long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - chunkStart).count() / (end - begin);
+                long long prev = iterCostNs.load();
+                while (ns > prev && !iterCostNs.compare_exchange_weak(prev, ns)) {}
+            }
+            if (control.progress && !reporting.exchange(true))
+            {
+                reportProgress(control, nbDone.load(), lastReport, false);
+                reporting.store(false);
+            }
+        }
+
+        #pragma omp critical
+        threadStats.mergeInto(stats, omp_get_thread_num());
+        }
+
+        reportProgress(control, nbDone.load(), lastReport, true);
+
+        SolveStatus status;
+        status.nbIterations = nbDone.load();
+        status.cancelled = control.cancelToken.isCancelled();
+        status.deadlineReached = deadlineReached.load();
+        status.confidenceReached = status.nbIterations >= iterationsForConfidence(control.confidence);
+        return status;
+    }
+
+    std::vector<int> inliersIdx;   // converted from inliersMask by getInliers
+
+    // Strategy of the iterations: the one of the tuner if auto-tuning, otherwise the
+    // one set by setBatchSize and parallelIterations. Returns whether the hypotheses
+    // are scored in batches.
+    bool chooseParallelism(double thres, int nbIter, const SolveControl & control)
+    {
+        const bool batchable = batchesSupported();
+        const int maxChunk = std::max(1, control.chunkSize);
+        if (autoTuning && !shards)
+        {
+            parallel = tuner->decide(problemCosts(batchable, thres), problem->getTotalNbSamples(), nbIter,
+                                     omp_get_max_threads(), parallelIterations, batchable, maxChunk);
+        }
+        else
+        {
+            parallel = ParallelDecision();
+            if (batchable && (batchSize > 1 || shards))
+                parallel.strategy = ParallelStrategy::Data;
+            else if (parallelIterations)
+                parallel.strategy = ParallelStrategy::Hypotheses;
+            parallel.nbThreads = parallel.strategy == ParallelStrategy::Serial ? 1 : omp_get_max_threads();
+            parallel.chunkSize = maxChunk;
+            parallel.batchSize = batchSize;
+            parallel.tileSize = tileSize;
+        }
+#ifndef ROBEST_DISABLE_STATS
+        stats.parallel = parallel;
+#endif
+        return parallel.strategy == ParallelStrategy::Data;
+    }
+
+    // Costs of the type of the problem (its costKey), measured unless the tuner knows them
+    ProblemCosts problemCosts(bool batchable, double thres)
+    {
+        const std::string type = problem->costKey();
+        ProblemCosts costs;
+        if (tuner->getCosts(type, costs) && (costs.batchResidual > 0.0 || !batchable))
+            return costs;
+        costs = measureCosts(batchable, thres);
+        tuner->setCosts(type, costs);
+        return costs;
+    }
+
+    // Fastest of a few runs of the steps of an iteration, the residuals being
+    // measured on the first samples. The samples are drawn from a generator of their
+    // own, the model of the problem (if it has params) is restored afterwards.
+    ProblemCosts measureCosts(bool batchable, double thres)
+    {
+        std::vector<double> model;
+        const bool restoreModel = problem->getModelParams(model);
+        std::mt19937 generator;
+
+        const int nbRuns = 3, nbModels = 8;
+        const int n = std::min(problem->getTotalNbSamples(), 4096);
+        SolverWorkspace::ThreadBuffers & buffers = workspace->thread(0);
+        ProblemCosts costs;
+        costs.residual = costs.batchResidual = costs.batchOverhead = costs.model = std::numeric_limits<double>::max();
+        auto seconds = [](Clock::time_point begin, Clock::time_point end) { return std::chrono::duration<double>(end - begin).count(); };
+
+        for (int run = 0; run < nbRuns; ++run)
+        {
+            Clock::time_point start = Clock::now();
+            for (int m = 0; m < nbModels; ++m)
+            {
+                uniformSampleIdx(buffers, buffers.sample, generator);
+                if (!problem->isDegenerate(buffers.sample))
+                    problem->estimModelFromSamples(buffers.sample);
+            }
+            Clock::time_point modelled = Clock::now();
+            for (int i = 0; i < n; ++i)
+                buffers.residuals[i] = problem->estimErrorForSample(i);
+            Clock::time_point scored = Clock::now();
+            costs.model = std::min(costs.model, seconds(start, modelled) / nbModels);
+            costs.residual = std::min(costs.residual, seconds(modelled, scored) / n);
+
+            if (batchable && problem->getModelParams(buffers.model))
+            {
+                // a tile and its score, then a batch with nothing to score
+                double cost = 0.0;
+                int nbInliers = 0;
+                problem->estimErrorsForModel(buffers.model, 0, n, buffers.residuals.data());
+                scoreTile(buffers.residuals.data(), n, thres, cost, nbInliers);
+                Clock::time_point tiled = Clock::now();
+                scoreBatch(workspace->hypotheses, 0, thres, tileSize);
+                costs.batchResidual = std::min(costs.batchResidual, seconds(scored, tiled) / n);
+                costs.batchOverhead = std::min(costs.batchOverhead, seconds(tiled, Clock::now()));
+            }
+        }
+        if (!batchable || costs.batchResidual == std::numeric_limits<double>::max())
+            costs.batchResidual = costs.batchOverhead = 0.0;
+
+        if (restoreModel)
+            problem->setModelParams(model);
+        return costs;
+    }
+
+    // Whether the estimator and the problem support the batched (or sharded) scoring,
+    // whatever the batch size
+    bool batchesSupported()
+    {
+        double cost = 0.0, errorBound = 0.0;
+        int nbInliers = 0;
+        std::vector<double> & params = workspace->thread(0).model;
+        if (shards)
+        {
+            shardSketch = !scoreTile(nullptr, 0, 0.0, cost, nbInliers);
+            if (shardSketch && !scoreSketch(ErrorSketch(), cost))
+                return false;
+            return problem->getModelParams(params);
+        }
+
+        bool supported = scoreTile(nullptr, 0, 0.0, cost, nbInliers) &&
+                         problem->getModelParams(params) &&
+                         problem->estimErrorsForModel(params, 0, 0, nullptr);
+        approxErrors = supported && problem->estimApproxErrorsForModel(params, 0, 0, nullptr, errorBound);
+        return supported;
+    }
+
+    // Scores the models of batch[0 .. nbModels) tile by tile: each thread walks its
+    // tiles and scores all the models on a tile while it is in cache. NUMA aware, the
+    // threads walk the tiles of the partition of their node and their scores are
+    // summed per partition first.
+    void scoreBatch(std::vector<SolverWorkspace::Hypothesis> & batch, int nbModels, double thres, int tileSize)
+    {
+        const int totalNbSamples = problem->getTotalNbSamples();
+        const int tile = std::min(tileSize, totalNbSamples);
+        const int nbTiles = (totalNbSamples + tile - 1) / tile;
+
+        for (int h = 0; h < nbModels; ++h)
+        {
+            batch[h].cost = 0.0;
+            batch[h].nbInliers = 0;
+        }
+
+        const double boundary = inlierBoundary(thres);
+        const bool numa = numaAware && NumaLayout(numaTopology, totalNbSamples, omp_get_max_threads()).isMultiNode();
+        long long nbReverified = 0;
+        std::vector<double> & partialCosts = workspace->partialCosts;
+        std::vector<int> & partialInliers = workspace->partialInliers;
+
+        #pragma omp parallel reduction(+:nbReverified)
+        {
+            ROBEST_TRACE_SPAN("tiles", traceId);
+            SolverWorkspace::ThreadBuffers & buffers = workspace->thread(omp_get_thread_num());
+            buffers.batchCosts.assign(nbModels, 0.0);
+            buffers.batchInliers.assign(nbModels, 0);
+            double * errors = buffers.residuals.data();
+
+            auto scoreTiles = [&](int begin, int end)
+            {
+                for (int h = 0; h < nbModels; ++h)
+                {
+                    const std::vector<double> & model = batch[h].model;
+                    double errorBound = 0.0;
+                    if (approxErrors && problem->estimApproxErrorsForModel(model, begin, end, errors, errorBound))
+                    {
+                        // exact errors where the inlier status is not certain
+                        for (int j = 0; j < end - begin; ++j)
+                        {
+                            if (std::fabs(errors[j] - boundary) <= errorBound)
+                            {
+                                problem->estimErrorsForModel(model, begin + j, begin + j + 1, errors + j);
+                                nbReverified++;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        problem->estimErrorsForModel(model, begin, end, errors);
+                    }
+                    scoreTile(errors, end - begin, thres, buffers.batchCosts[h], buffers.batchInliers[h]);
+                }
+            };
+
+            if (numa)
+            {
+                // the team may be smaller than expected: the layout is the one of the team
+                NumaLayout layout(numaTopology, totalNbSamples, omp_get_num_threads());
+                const int t = omp_get_thread_num();
+                const int partition = layout.partitionOfThread(t);
+                const int first = layout.firstThread(partition);
+                const int nbThreads = layout.firstThread(partition + 1) - first;
+                const int partBegin = layout.partitionBegin(partition);
+                const int partEnd = layout.partitionBegin(partition + 1);
+                const int partTiles = (partEnd - partBegin + tile - 1) / tile;
+
+                #pragma omp single
+                {
+                    partialCosts.assign((size_t) layout.nbPartitions() * nbModels, 0.0);
+                    partialInliers.assign((size_t) layout.nbPartitions() * nbModels, 0);
+                }
+
+                // contiguous tiles, as the pages of the partition are
+                const int firstTile = (int)((long long) partTiles * (t - first) / nbThreads);
+                const int lastTile = (int)((long long) partTiles * (t - first + 1) / nbThreads);
+                for (int k = firstTile; k < lastTile; ++k)
+                    scoreTiles(partBegin + k * tile, std::min(partBegin + (k + 1) * tile, partEnd));
+
+                #pragma omp critical(robest_numa_partials)
+                for (int h = 0; h < nbModels; ++h)
+                {
+                    partialCosts[partition * nbModels + h] += buffers.batchCosts[h];
+                    partialInliers[partition * nbModels + h] += buffers.batchInliers[h];
+                }
+            }
+            else
+            {
+                #pragma omp for schedule(static)
+                for (int t = 0; t < nbTiles; ++t)
+                    scoreTiles(t * tile, std::min((t + 1) * tile, totalNbSamples));
+
+                #pragma omp critical
+                for (int h = 0; h < nbModels; ++h)
+                {
+                    batch[h].cost += buffers.batchCosts[h];
+                    batch[h].nbInliers += buffers.batchInliers[h];
+                }
+            }
+        }
+
+        if (numa)
+        {
+            const int nbPartitions = (int) partialCosts.size() / std::max(1, nbModels);
+            for (int partition = 0; partition < nbPartitions; ++partition)
+            {
+                for (int h = 0; h < nbModels; ++h)
+                {
+                    batch[h].cost += partialCosts[partition * nbModels + h];
+                    batch[h].nbInliers += partialInliers[partition * nbModels + h];
+                }
+            }
+        }
+
+#ifndef ROBEST_DISABLE_STATS
+        stats.nbReverified += nbReverified;
+#endif
+    }
+
+    // After the loss of a shard: whether this process can score the batches instead
+    bool localBatchesSupported()
+    {
+        double cost = 0.0;
+        int nbInliers = 0;
+        std::vector<double> & params = workspace->thread(0).model;
+        approxErrors = false;
+        return scoreTile(nullptr, 0, 0.0, cost, nbInliers) &&
+               problem->getModelParams(params) &&
+               problem->estimErrorsForModel(params, 0, 0, nullptr);
+    }
+
+    // Scores the models of batch[0 .. nbModels) on the shards and sums their replies.
+    // False if a shard cannot be reached or does not reply as expected, the replies of
+    // the other shards being read anyway.
+    bool scoreBatchOnShards(std::vector<SolverWorkspace::Hypothesis> & batch, int nbModels, double thres)
+    {
+        const int nbParams = nbModels > 0 ? (int) batch[0].model.size() : 0;
+        shardMessage.assign(ShardOp::headerSize, 0.0);
+        shardMessage[0] = shardSketch ? ShardOp::Sketch : ShardOp::Sums;
+        shardMessage[1] = thres;
+        shardMessage[2] = inlierBoundary(thres);
+        shardMessage[3] = nbModels;
+        shardMessage[4] = nbParams;
+        for (int h = 0; h < nbModels; ++h)
+        {
+            assert((int) batch[h].model.size() == nbParams && "Models of different sizes");
+            shardMessage.insert(shardMessage.end(), batch[h].model.begin(), batch[h].model.end());
+        }
+        bool replied = shards->broadcast(shardMessage);
+
+        const int replySize = shardSketch ? 1 + ErrorSketch::nbBins : 2;
+        shardSketches.resize(shardSketch ? nbModels : 0);
+        for (ErrorSketch & sketch : shardSketches)
+            sketch.clear();
+        for (int h = 0; h < nbModels; ++h)
+        {
+            batch[h].cost = 0.0;
+            batch[h].nbInliers = 0;
+        }
+
+        for (int shard = 0; shard < shards->nbShards(); ++shard)
+        {
+            if (!shards->receive(shard, shardMessage) || (int) shardMessage.size() != nbModels * replySize)
+            {
+                replied = false;
+                continue;
+            }
+            for (int h = 0; h < nbModels; ++h)
+            {
+                const double * reply = shardMessage.data() + h * replySize;
+                if (shardSketch)
+                {
+                    batch[h].nbInliers += (int) reply[0];
+                    shardSketches[h].merge(reply + 1);
+                }
+                else
+                {
+                    batch[h].cost += reply[0];
+                    batch[h].nbInliers += (int) reply[1];
+                }
+            }
+        }
+
+        if (!replied)
+            return false;
+        for (int h = 0; h < (int) shardSketches.size(); ++h)
+            scoreSketch(shardSketches[h], batch[h].cost);
+        return true;
+    }
+
+    // Batched counterpart of runIterations: the cancellation token, the deadline and
+    // the adaptive termination are checked between two batches, a batch being cut
+    // to the hypotheses that still fit.
+    SolveStatus runBatchedIterations(double thres, int nbIter, const SolveControl & control)
+    {
+        const bool hasDeadline = control.deadline != Clock::time_point::max();
+        const int totalNbSamples = problem->getTotalNbSamples();
+        const int batchSize = parallel.batchSize;
+        workspace->reserveBatch(batchSize);
+        std::vector<SolverWorkspace::Hypothesis> & batch = workspace->hypotheses;
+
+        StatsAccumulator threadStats;
+        SolveStatus status;
+        int nbDone = 0;
+        double hypothesisCost = 0.0; // measured duration of one hypothesis, in seconds
+        Clock::time_point lastReport = Clock::now();
+        prepareGuidedSampling(thres);
+
+        const bool numa = numaAware && !shards && NumaLayout(numaTopology, totalNbSamples, omp_get_max_threads()).isMultiNode();
+        if (numa)
+            pinToNodes(totalNbSamples);
+
+        bool onShards = shards != nullptr;
+        if (onShards && shards->nbShards() == 0)
+        {
+            status.shardsLost = true;
+            onShards = false;
+            if (!localBatchesSupported())
+                nbIter = 0;
+        }
+
+        ROBEST_TRACE_SPAN("iterations", traceId);
+        while (nbDone < nbIter && !control.cancelToken.isCancelled())
+        {
+
+            int nbHypotheses = std::min(batchSize, nbIter - nbDone);
+            if (control.adaptiveTermination)
+            {
+                if (nbDone >= requiredIterations.load())
+                    break;
+                nbHypotheses = std::min(nbHypotheses, requiredIterations.load() - nbDone);
+            }
+
+            Clock::time_point batchStart = Clock::now();
+            if (hasDeadline)
+            {
+                double reserve  = control.finalPhaseReserve >= 0.0 ? control.finalPhaseReserve : 2.0 * hypothesisCost;
+                double timeLeft = std::chrono::duration<double>(control.deadline - batchStart).count() - reserve;
+                // single hypothesis until its cost is known
+                nbHypotheses = hypothesisCost > 0.0 ? (int) std::min<double>(nbHypotheses, timeLeft / hypothesisCost)
+                                                    : (timeLeft > 0.0 ? 1 : 0);
+                if (nbHypotheses <= 0)
+                {
+                    status.deadlineReached = true;
+                    break;
+                }
+            }
+
+            // models are estimated one after the other: the problem holds the model
+            int nbModels = 0;
+            ROBEST_TRACE_MARK(hypothesesStart, traceId);
+            for (int h = 0; h < nbHypotheses; ++h)
+            {
+                threadStats.startIteration();
+                SolverWorkspace::Hypothesis & hypothesis = batch[nbModels];
+                drawSample(workspace->thread(0), hypothesis.sample, nbDone + h);
+                threadStats.endSampling();
+
+                if (problem->isDegenerate(hypothesis.sample))
+                {
+                    threadStats.degenerateSample();
+                    continue;
+                }
+
+                problem->estimModelFromSamples(hypothesis.sample);
+                problem->getModelParams(hypothesis.model);
+                hypothesis.iter = nbDone + h;
+                threadStats.endModelEstimation();
+                nbModels++;
+            }
+
+            ROBEST_TRACE_SINCE("hypotheses", hypothesesStart, traceId);
+
+            {
+                ROBEST_TRACE_SPAN("score batch", traceId);
+                if (onShards && !scoreBatchOnShards(batch, nbModels, thres))
+                {
+                    status.shardsLost = true;
+                    onShards = false;
+                    if (!localBatchesSupported())
+                        break;
+                }
+                if (!onShards)
+                    scoreBatch(batch, nbModels, thres, parallel.tileSize);
+            }
+
+            ROBEST_TRACE_MARK(updateStart, traceId);
+            for (int h = 0; h < nbModels; ++h)
+            {
+                threadStats.endScoring(totalNbSamples);
+                int sequence = updateBest(batch[h].cost, batch[h].nbInliers, batch[h].sample, batch[h].iter,
+                                          control.confidence, &batch[h].model);
+                if (sequence > 0)
+                    learnFromBest(batch[h].model, batch[h].nbInliers, sequence);
+            }
+            ROBEST_TRACE_SINCE("update best", updateStart, traceId);
+
+            nbDone += nbHypotheses;
+            double duration = std::chrono::duration<double>(Clock::now() - batchStart).count() / nbHypotheses;
+            hypothesisCost = std::max(hypothesisCost, duration);
+            reportProgress(control, nbDone, lastReport, false);
+        }
+
+        threadStats.mergeInto(stats, 0);
+        if (numa)
+        {
+            #pragma omp parallel
+            NumaLayout::restoreThread(threadAffinities[omp_get_thread_num()]);
+        }
+        reportProgress(control, nbDone, lastReport, true);
+
+        status.nbIterations = nbDone;
+        status.cancelled = control.cancelToken.isCancelled();
+        status.confidenceReached = status.nbIterations >= iterationsForConfidence(control.confidence);
+        return status;
+    }
+
+    // Places the samples of a new problem or new data on the nodes and pins the
+    // threads of the team
+    void pinToNodes(int totalNbSamples)
+    {
+        NumaLayout layout(numaTopology, totalNbSamples, omp_get_max_threads());
+        if (placedVersion != problem->getDataVersion() || placedNbSamples != totalNbSamples)
+        {
+            problem->placeSamples(layout);
+            placedVersion = problem->getDataVersion();
+            placedNbSamples = totalNbSamples;
+        }
+
+        threadAffinities.resize(std::max<size_t>(threadAffinities.size(), omp_get_max_threads()));
+        #pragma omp parallel
+        {
+            NumaLayout team(numaTopology, totalNbSamples, omp_get_num_threads());
+            team.pinThread(omp_get_thread_num(), threadAffinities[omp_get_thread_num()]);
+        }
+    }
+
+    // Hypothesis of the coarsest level of solveHierarchical: a minimal sample of the
+    // coarse level or a prior
+    struct Candidate
+    {
+        double cost;
+        std::vector<int> sample;
+        int prior;
+    };
+
+    // Hypothesis scored on the finer levels of solveHierarchical
+    struct Carried
+    {
+        Prior prior;
+        double cost = 0.0;
+        int nbInliers = 0;
+        bool valid = false;
+    };
+
+    std::vector<Prior> priors;
+    std::vector<int> priorPool;
+    double priorSamplingBias = 0.0;
+    int bestPrior = -1;
+
+    double guidance = 0.0;
+    GuidedSampler guidedSampler;        // empty unless the current iterations are guided
+    double guidedBoundary = 0.0;        // inlier boundary of the threshold of the iterations
+    int bestSequence = 0;     // best models kept since the start of the iterations
+    int learnedSequence = 0;  // the last one the guided sampler learned from
+
+    int batchSize = 1;
+    int tileSize = 4096;
+    bool autoTuning = false;
+    ParallelTuner * tuner = &ParallelTuner::global();
+    ParallelDecision parallel;     // of the current solve
+    bool uniqueSamples = false;
+    bool enumerateSamples = false;
+    bool approxErrors = false;     // the problem provides approximate errors with a bound
+
+    std::shared_ptr<ShardTransport> shards;
+    bool shardSketch = false;      // the shards reply with error sketches rather than sums
+    std::vector<double> shardMessage;
+    std::vector<ErrorSketch> shardSketches;
+
+    int nbCarried = 8;
+    int nbCandidates = 0;          // hypotheses kept by updateBest, for solveHierarchical
+    std::vector<Candidate> candidates;
+
+    bool earlyAbort = true;
+
+    bool numaAware = false;
+    NumaTopology numaTopology;
+    unsigned long long placedVersion = 0;  // data version of the problem whose samples were placed
+    int placedNbSamples = 0;
+    std::vector<NumaLayout::Affinity> threadAffinities;
+    std::atomic<double> costBound{std::numeric_limits<double>::max()}; // see costToBeat
+
+    int bestNbInliers = 0;
+    std::atomic<int> requiredIterations{std::numeric_limits<int>::max()};
+};
+
+class RANSAC : public AbstractEstimator
+{
+  public:
+    RANSAC()
+    {
+    }
+
+  protected:
+    double scoreCurrentModel(double thres, int & nbInliers)
+    {
+        int totalNbSamples = problem->getTotalNbSamples();
+
+        //getInliersNb
+        nbInliers = 0;
+        for (int begin = 0; begin < totalNbSamples; begin += abortCheckInterval)
+        {
+            int end = std::min(begin + abortCheckInterval, totalNbSamples);
+            for (int j = begin; j < end; ++j)
+            {
+                double error = problem->estimErrorForSample(j);
+                error = error * error;
+
+                if (std::fabs(error) < thres)
+                {
+                    nbInliers++;
                 }
             }
+
+            // cost if all the remaining samples were inliers
+            double lowestCost = -(double)(nbInliers + totalNbSamples - end);
+            if (end < totalNbSamples && lowestCost >= costToBeat())
+            {
+                scoringAborted(end);
+                return lowestCost;
+            }
         }
+        return -(double)nbInliers;
+    }
 
-        problem->estimModelFromSamples(bestIdxSet);
-        getInliers(thres);
-        problem->estimModelFromSamples(inliersIdx);
+    bool scoreTile(const double * errors, int n, double thres, double & cost, int & nbInliers) const
+    {
+        int count = 0;
+        for (int j = 0; j < n; ++j)
+            count += errors[j] * errors[j] < thres;
+        nbInliers += count;
+        cost -= count;
+        return true;
+    }
+
+    // the threshold of RANSAC applies to the squared error
+    double inlierBoundary(double thres) const { return std::sqrt(thres); }
+};
+
+class MSAC : public AbstractEstimator
+{
+  public:
+    MSAC()
+    {
+        parallelIterations = false;
+    }
+
+  protected:
+    double scoreCurrentModel(double thres, int & nbInliers)
+    {
+        int totalNbSamples = problem->getTotalNbSamples();
+
+        double sumSqErr = 0;
+        nbInliers = 0;
+        for (int begin = 0; begin < totalNbSamples; begin += abortCheckInterval)
+        {
+            int end = std::min(begin + abortCheckInterval, totalNbSamples);
+            for (int j = begin; j < end; ++j)
+            {
+                double error = problem->estimErrorForSample(j);
+
+                if (error * error < thres * thres)
+                {
+                    sumSqErr += error * error;
+                    nbInliers++;
+                }
+                else
+                {
+                    sumSqErr += thres * thres;
+                }
+            }
+
+            // the remaining samples can only add to the sum
+            if (end < totalNbSamples && sumSqErr >= costToBeat())
+            {
+                scoringAborted(end);
+                return sumSqErr;
+            }
+        }
+        return sumSqErr;
+    }
+
+    bool scoreTile(const double * errors, int n, double thres, double & cost, int & nbInliers) const
+    {
+        const double thres2 = thres * thres;
+        double sumSqErr = 0.0;
+        int count = 0;
+        for (int j = 0; j < n; ++j)
+        {
+            double error2 = errors[j] * errors[j];
+            bool inlier = error2 < thres2;
+            sumSqErr += inlier ? error2 : thres2;
+            count += inlier;
+        }
+        cost += sumSqErr;
+        nbInliers += count;
+        return true;
+    }
+
+    bool refitOnInliers() const { return false; }
+};
+
+class LMedS : public AbstractEstimator
+{
+  public:
+    LMedS()
+    {
+    }
+
+  protected:
+    double scoreCurrentModel(double thres, int & nbInliers)
+    {
+        const int totalNbSamples = problem->getTotalNbSamples();
+        std::vector<double> & errorsVec = workspace->thread(omp_get_thread_num()).residuals;
+
+        // once more than half of the squared errors are above the best median, so is
+        // the median of this model (the mean of the two middle ones for even N too)
+        int nbAbove = 0;
+        nbInliers = 0;
+        for (int begin = 0; begin < totalNbSamples; begin += abortCheckInterval)
+        {
+            int end = std::min(begin + abortCheckInterval, totalNbSamples);
+            const double bound = costToBeat();
+            for (int j = begin; j < end; ++j)
+            {
+                double error = problem->estimErrorForSample(j);
+                errorsVec[j] = error * error; // error must be squared!
+                if (error * error < thres * thres)
+                    nbInliers++;
+                nbAbove += errorsVec[j] > bound;
+            }
+
+            if (end < totalNbSamples && nbAbove > totalNbSamples / 2)
+            {
+                scoringAborted(end);
+                return bound;
+            }
+        }
+
+        // median by selection in the workspace buffer, as MedianFinder would give it
+        std::vector<double>::iterator first = errorsVec.begin();
+        std::vector<double>::iterator middle = first + totalNbSamples / 2;
+        std::nth_element(first, middle, first + totalNbSamples);
+        if (totalNbSamples % 2 == 1)
+            return *middle;
+        return (*std::max_element(first, middle) + *middle) * 0.5;
+    }
+
+    // median of the squared errors, up to the resolution of the sketch
+    bool scoreSketch(const ErrorSketch & sketch, double & cost) const
+    {
+        cost = sketch.quantile(0.5);
+        return true;
+    }
+};
+
+namespace detail
+{
+
+// Regularized incomplete gamma functions P(a,x) and Q(a,x) = 1 - P(a,x):
+// series expansion for x < a+1, continued fraction (modified Lentz) otherwise.
+inline double incompleteGammaSeries(double a, double x)
+{
+    double ap = a;
+    double del = 1.0 / a;
+    double sum = del;
+    for (int n = 0; n < 1000; ++n)
+    {
+        ap += 1.0;
+        del *= x / ap;
+        sum += del;
+        if (std::fabs(del) < std::fabs(sum) * 1e-15)
+            break;
+    }
+    return sum * std::exp(-x + a * std::log(x) - std::lgamma(a));
+}
+
+inline double incompleteGammaContinuedFraction(double a, double x)
+{
+    const double tiny = 1e-300;
+    double b = x + 1.0 - a;
+    double c = 1.0 / tiny;
+    double d = 1.0 / b;
+    double h = d;
+    for (int i = 1; i < 1000; ++i)
+    {
+        double an = -i * (i - a);
+        b += 2.0;
+        d = an * d + b;
+        if (std::fabs(d) < tiny) d = tiny;
+        c = b + an / c;
+        if (std::fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double del = d * c;
+        h *= del;
+        if (std::fabs(del - 1.0) < 1e-15)
+            break;
+    }
+    return std::exp(-x + a * std::log(x) - std::lgamma(a)) * h;
+}
+
+inline double regularizedLowerGamma(double a, double x)
+{
+    if (x <= 0.0) return 0.0;
+    return x < a + 1.0 ? incompleteGammaSeries(a, x) : 1.0 - incompleteGammaContinuedFraction(a, x);
+}
+
+inline double regularizedUpperGamma(double a, double x)
+{
+    if (x <= 0.0) return 1.0;
+    return x < a + 1.0 ? 1.0 - incompleteGammaSeries(a, x) : incompleteGammaContinuedFraction(a, x);
+}
+
+} // namespace detail
+
+// MAGSAC++ loss and weight marginalized over the noise scale sigma in [0, sigmaMax],
+// tabulated as functions of t = r^2 / sigmaMax^2 and linearly interpolated, so that
+// scoring costs about as much as MSAC.
+//   loss(t)   - in [0,1], 1 for outliers (r > k*sigmaMax)
+//   weight(t) - IRLS weight in [0,1], 1 for r = 0 and 0 for outliers
+// dof is the number of degrees of freedom of the residual (>= 2), k^2 is the
+// chi-squared quantile for the given confidence.
+class SigmaConsensusTable
+{
+  public:
+    SigmaConsensusTable(int dof = 2, double confidence = 0.99, int size = 4096) : nbBins(size)
+    {
+        assert(dof >= 2 && "sigma-consensus needs a residual with at least 2 degrees of freedom");
+        assert(size > 1);
+
+        // chi-squared quantile by bisection
+        double lo = 0.0, hi = 1000.0;
+        for (int i = 0; i < 200; ++i)
+        {
+            double mid = 0.5 * (lo + hi);
+            if (detail::regularizedLowerGamma(0.5 * dof, 0.5 * mid) < confidence) lo = mid;
+            else hi = mid;
+        }
+        k2 = 0.5 * (lo + hi);
+
+        // MAGSAC++ (Barath et al., 2020) up to a constant factor, with x = t/2:
+        //   weight ~ G((n-1)/2, x) - G((n-1)/2, k^2/2)
+        //   loss   ~ g((n+1)/2, x) + x * (G((n-1)/2, x) - G((n-1)/2, k^2/2))
+        // where g and G are the lower and upper incomplete gamma functions
+        const double aLow = 0.5 * (dof + 1), aUp = 0.5 * (dof - 1);
+        const double gammaLow = std::tgamma(aLow), gammaUp = std::tgamma(aUp);
+        const double upperAtK = detail::regularizedUpperGamma(aUp, 0.5 * k2) * gammaUp;
+        const double outlierLoss = detail::regularizedLowerGamma(aLow, 0.5 * k2) * gammaLow;
+        const double weightAtZero = gammaUp - upperAtK;
+
+        step = k2 / (nbBins - 1);
+        invStep = 1.0 / step;
+        lossTable.resize(nbBins + 1);
+        weightTable.resize(nbBins + 1);
+        for (int i = 0; i < nbBins; ++i)
+        {
+            double x = 0.5 * i * step;
+            double upper = detail::regularizedUpperGamma(aUp, x) * gammaUp - upperAtK;
+            lossTable[i]   = (detail::regularizedLowerGamma(aLow, x) * gammaLow + x * upper) / outlierLoss;
+            weightTable[i] = upper / weightAtZero;
+        }
+        lossTable[nbBins - 1] = 1.0;
+        weightTable[nbBins - 1] = 0.0;
+        lossTable[nbBins] = 1.0;   // guard for the interpolation
+        weightTable[nbBins] = 0.0;
+    }
+
+    // squared cutoff k^2: residuals above k*sigmaMax are outliers
+    double cutoff2() const { return k2; }
+
+    // Branchless lookups: past the cutoff the tables hold their outlier value, so t
+    // is only clamped (this avoids mispredictions on mixed inliers and outliers)
+    double loss(double t) const   { return interpolate(lossTable.data(), t); }
+    double weight(double t) const { return interpolate(weightTable.data(), t); }
+
+  private:
+    double interpolate(const double * table, double t) const
+    {
+        double pos = std::min(t, k2) * invStep;
+        int i = (int) pos;
+        double f = pos - i;
+        return table[i] + f * (table[i + 1] - table[i]);
+    }
+
+    int nbBins;
+    double k2;
+    double step;
+    double invStep;
+    std::vector<double> lossTable;
+    std::vector<double> weightTable;
+};
+
+// MAGSAC++: threshold-free scoring by marginalizing the noise scale. The threshold
+// argument of solve() is the maximum noise scale sigmaMax; inliers are the points
+// with a non-zero weight, i.e. closer than k*sigmaMax to the model. The best model
+// is polished by sigma-weighted iteratively reweighted least squares, which uses
+// EstimationProblem::estimModelFromWeightedSamples.
+class MAGSAC : public AbstractEstimator
+{
+  public:
+    MAGSAC(int dof = 2, int nbPolishingIter = 10) : table(dof), nbPolishingIter(nbPolishingIter)
+    {
+    }
+
+    // MAGSAC++ score of the last solution: sum of the marginalized losses
+    double getScore() const { return bestScore; }
+
+  protected:
+    double scoreCurrentModel(double sigmaMax, int & nbInliers)
+    {
+        return scoreFromResiduals(sigmaMax, workspace->thread(omp_get_thread_num()).residuals, nbInliers);
+    }
+
+    bool scoreTile(const double * errors, int n, double sigmaMax, double & cost, int & nbInliers) const
+    {
+        const double invSigma2 = 1.0 / (sigmaMax * sigmaMax);
+        const double k2 = table.cutoff2();
+        double loss = 0.0;
+        int count = 0;
+        for (int j = 0; j < n; ++j)
+        {
+            double t = errors[j] * errors[j] * invSigma2;
+            loss += table.loss(t);
+            count += t < k2;
+        }
+        cost += loss;
+        nbInliers += count;
+        return true;
+    }
+
+    double inlierBoundary(double sigmaMax) const { return std::sqrt(table.cutoff2()) * sigmaMax; }
+
+    void finalizeModel(double sigmaMax)
+    {
+        const double cutoff = std::sqrt(table.cutoff2()) * sigmaMax;
+        refitFromBest(cutoff, false);
+        if (inliersMask.count() == 0)
+        {
+            bestScore = problem->getTotalNbSamples();
+            return;
+        }
+
+        std::vector<double> & t = workspace->thread(0).residuals;
+        int nbInliers = 0;
+        bestScore = scoreFromResiduals(sigmaMax, t, nbInliers);
+        countResiduals(problem->getTotalNbSamples());
+
+        // sigma-consensus++ polishing
+        std::vector<int> & idx = workspace->indices;
+        std::vector<double> & weights = workspace->weights;
+        std::vector<double> & params = workspace->thread(0).model;
+        for (int it = 0; it < nbPolishingIter; ++it)
+        {
+            idx.clear();
+            weights.clear();
+            for (int j = 0; j < problem->getTotalNbSamples(); ++j)
+            {
+                double w = table.weight(t[j]);
+                if (w > 0.0)
+                {
+                    idx.push_back(j);
+                    weights.push_back(w);
+                }
+            }
+            if ((int)idx.size() < problem->getNbMinSamples())
+                break;
+
+            bool canRevert = problem->getModelParams(params);
+            problem->estimModelFromWeightedSamples(idx, weights);
+
+            double score = scoreFromResiduals(sigmaMax, t, nbInliers);
+            countResiduals(problem->getTotalNbSamples());
+            if (score > bestScore && canRevert)
+            {
+                // polishing must not degrade the model
+                problem->setModelParams(params);
+                break;
+            }
+            bool converged = bestScore - score <= 1e-9 * bestScore;
+            bestScore = std::min(score, bestScore);
+            if (converged)
+                break;
+        }
+
+        getInliers(cutoff);
+    }
+
+  private:
+    // Fills t with r^2 / sigmaMax^2 for the model held by the problem, then sums the
+    // tabulated losses over it
+    double scoreFromResiduals(double sigmaMax, std::vector<double> & t, int & nbInliers)
+    {
+        const int totalNbSamples = problem->getTotalNbSamples();
+        const double invSigma2 = 1.0 / (sigmaMax * sigmaMax);
+
+        for (int j = 0; j < totalNbSamples; ++j)
+        {
+            double error = problem->estimErrorForSample(j);
+            t[j] = error * error * invSigma2;
+        }
+
+        const double k2 = table.cutoff2();
+        double cost = 0.0;
+        int count = 0;
+        for (int j = 0; j < totalNbSamples; ++j)
+        {
+            cost += table.loss(t[j]);
+            count += t[j] < k2;
+        }
+        nbInliers = count;
+        return cost;
+    }
+
+    SigmaConsensusTable table;
+    int nbPolishingIter;
+    double bestScore = 0.0;
+};
+
+// Best hypothesis for one threshold of a ThresholdSweep
+struct ThresholdScore
+{
+    double thres = 0.0;
+    int nbInliers = 0;            // err^2 < thres^2
+    double cost = std::numeric_limits<double>::max(); // MSAC cost
+    std::vector<double> model;    // EstimationProblem::getModelParams of the best hypothesis
+    std::vector<long long> histogram; // residuals of the best hypothesis binned by threshold
+};
+
+// Scores every hypothesis for a log-spaced range of thresholds in a single pass over
+// the residuals: they are binned into a histogram whose edges are the thresholds,
+// whose prefix sums give the inlier count and the MSAC cost at every threshold.
+// Bin b of a histogram holds the residuals in [thresholds[b-1], thresholds[b]); the
+// last bin holds the residuals above the largest threshold.
+// The threshold argument of solve() selects the model kept by the estimator itself,
+// which is refitted as MSAC does. Recording the model of each threshold requires the
+// problem to implement getModelParams.
+class ThresholdSweep : public AbstractEstimator
+{
+  public:
+    enum Criterion
+    {
+        MinimizeCost,    // best model per threshold is the one of lowest MSAC cost
+        MaximizeInliers  // ... or the one with the most inliers (RANSAC)
+    };
+
+    ThresholdSweep(double thresMin = 0.01, double thresMax = 1.0, int nbThresholds = 20,
+                   Criterion criterion = MinimizeCost)
+        : criterion(criterion)
+    {
+        assert(thresMin > 0.0 && thresMax >= thresMin && nbThresholds >= 1 && "Wrong threshold range");
+
+        double ratio = nbThresholds > 1 ? std::pow(thresMax / thresMin, 1.0 / (nbThresholds - 1)) : 1.0;
+        sweep.resize(nbThresholds);
+        edges2.resize(nbThresholds);
+        for (int k = 0; k < nbThresholds; ++k)
+        {
+            sweep[k].thres = (k == nbThresholds - 1) ? thresMax : thresMin * std::pow(ratio, k);
+            edges2[k] = sweep[k].thres * sweep[k].thres;
+        }
+
+        // MSAC scores the threshold of the model it keeps in the same pass
+        parallelIterations = false;
+    }
+
+    // Best model, inlier count, MSAC cost and residual histogram for every threshold
+    const std::vector<ThresholdScore> & getSweep() const { return sweep; }
+
+  protected:
+    void prepareSolve()
+    {
+        for (auto & score : sweep)
+        {
+            score.nbInliers = 0;
+            score.cost = std::numeric_limits<double>::max();
+            score.model.clear();
+            score.histogram.assign(edges2.size() + 1, 0);
+        }
+        counts.assign(edges2.size() + 1, 0);
+        sums.assign(edges2.size() + 1, 0.0);
+    }
+
+    double scoreCurrentModel(double thres, int & nbInliers)
+    {
+        const int totalNbSamples = problem->getTotalNbSamples();
+        const double thres2 = thres * thres;
+
+        std::fill(counts.begin(), counts.end(), 0);
+        std::fill(sums.begin(), sums.end(), 0.0);
+
+        double sumSqErr = 0.0;
+        nbInliers = 0;
+        for (int j = 0; j < totalNbSamples; ++j)
+        {
+            double error = problem->estimErrorForSample(j);
+            error = error * error;
+
+            int bin = (int)(std::upper_bound(edges2.begin(), edges2.end(), error) - edges2.begin());
+            counts[bin]++;
+            sums[bin] += error;
+
+            bool inlier = error < thres2;
+            sumSqErr += inlier ? error : thres2;
+            nbInliers += inlier;
+        }
+
+        // prefix sums: the inliers of threshold k are the bins 0..k
+        long long inliers = 0;
+        double inliersSqErr = 0.0;
+        std::vector<double> & currentModel = workspace->thread(omp_get_thread_num()).model;
+        bool modelFetched = false;
+        for (size_t k = 0; k < sweep.size(); ++k)
+        {
+            inliers += counts[k];
+            inliersSqErr += sums[k];
+            double cost = inliersSqErr + (totalNbSamples - inliers) * edges2[k];
+
+            ThresholdScore & score = sweep[k];
+            bool better = (criterion == MinimizeCost) ? cost < score.cost
+                                                      : (inliers > score.nbInliers || score.cost == std::numeric_limits<double>::max());
+            if (better)
+            {
+                score.nbInliers = (int) inliers;
+                score.cost = cost;
+                score.histogram = counts;
+                if (!modelFetched && !problem->getModelParams(currentModel))
+                    currentModel.clear();
+                modelFetched = true;
+                score.model = currentModel;
+            }
+        }
+        return sumSqErr;
     }
 
+    bool refitOnInliers() const { return false; }
+
   private:
-    double med;
+    Criterion criterion;
+    std::vector<ThresholdScore> sweep;
+    std::vector<double> edges2;        // squared thresholds, ascending
+    std::vector<long long> counts;     // histogram of the current hypothesis
+    std::vector<double> sums;          // sum of squared residuals per bin
 };
 
+// Worker loop of the sharded scoring: answers the requests of the coordinator with
+// the partial scores of the samples [begin, end) of problem, until the coordinator
+// shuts down. The estimator must be of the same type and settings as the coordinator.
+// If the problem does not implement estimErrorsForModel, the worker replies with an
+// empty message, which the coordinator takes as the loss of the shard, and returns.
+inline void serveShard(ShardEndpoint & endpoint, EstimationProblem & problem, int begin, int end,
+                       const AbstractEstimator & estimator, int tileSize = 4096)
+{
+    std::vector<double> request, reply, errors(tileSize), params;
+    std::vector<ErrorSketch> sketches;
+
+    while (endpoint.receive(request))
+    {
+        const int op = (int) request[0];
+        const double thres = request[1];
+        const double boundary = request[2];
+        const int nbModels = (int) request[3];
+        const int nbParams = (int) request[4];
+        const int replySize = op == ShardOp::Sketch ? 1 + ErrorSketch::nbBins : 2;
+
+        reply.assign(nbModels * replySize, 0.0);
+        sketches.resize(op == ShardOp::Sketch ? nbModels : 0);
+        for (ErrorSketch & sketch : sketches)
+            sketch.clear();
+
+        // tile by tile, all the models on a tile while it is in cache
+        for (int first = begin; first < end; first += tileSize)
+        {
+            int last = std::min(first + tileSize, end);
+            for (int h = 0; h < nbModels; ++h)
+            {
+                const double * model = request.data() + ShardOp::headerSize + h * nbParams;
+                params.assign(model, model + nbParams);
+                if (!problem.estimErrorsForModel(params, first, last, errors.data()))
+                {
+                    endpoint.reply(std::vector<double>());
+                    return;
+                }
+
+                double * out = reply.data() + h * replySize;
+                if (op == ShardOp::Sketch)
+                {
+                    for (int j = 0; j < last - first; ++j)
+                    {
+                        sketches[h].add(errors[j] * errors[j]);
+                        out[0] += std::fabs(errors[j]) < boundary;
+                    }
+                }
+                else
+                {
+                    int nbInliers = 0;
+                    estimator.scoreErrors(errors.data(), last - first, thres, out[0], nbInliers);
+                    out[1] += nbInliers;
+                }
+            }
+        }
+
+        for (int h = 0; h < (int) sketches.size(); ++h)
+            std::copy(sketches[h].data(), sketches[h].data() + ErrorSketch::nbBins, reply.begin() + h * replySize + 1);
+        endpoint.reply(reply);
+    }
+}
+
 } // namespace robest
 #endif // ROBUST_ESTIMATOR_H
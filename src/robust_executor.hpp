@@ -0,0 +1,116 @@
+/**
+ *  @brief Pool of worker threads running the asynchronous solves
+ *
+ *  An Executor runs the tasks submitted to it on a fixed number of worker threads,
+ *  in submission order. Each worker runs the OpenMP regions of its tasks on
+ *  threadsPerWorker threads; by default the workers share the threads OpenMP would
+ *  use, so that tasks sharing an executor do not oversubscribe the machine: the
+ *  tasks that do not find a free worker wait in the queue.
+ *
+ *  Executor::global() is the executor of the library (used by solveAsync when none
+ *  is given): a single worker running its solves on all the OpenMP threads.
+ */
+
+#ifndef ROBUST_EXECUTOR_H
+#define ROBUST_EXECUTOR_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <assert.h>
+
+#include <omp.h>
+
+namespace robest
+{
+
+class Executor
+{
+  public:
+    // nbWorkers threads running OpenMP regions on threadsPerWorker threads each
+    // (0: an equal share of omp_get_max_threads())
+    explicit Executor(int nbWorkers = 1, int threadsPerWorker = 0)
+    {
+        assert(nbWorkers > 0 && threadsPerWorker >= 0 && "Wrong executor size");
+        this->threadsPerWorker = threadsPerWorker > 0 ? threadsPerWorker : std::max(1, omp_get_max_threads() / nbWorkers);
+        for (int w = 0; w < nbWorkers; ++w)
+            workers.emplace_back([this]() { work(); });
+    }
+
+    Executor(const Executor &) = delete;
+    Executor & operator=(const Executor &) = delete;
+
+    // The tasks already submitted are run before the workers stop
+    ~Executor()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (std::thread & worker : workers)
+            worker.join();
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            assert(!stopping && "Executor stopping");
+            tasks.push_back(std::move(task));
+        }
+        ready.notify_one();
+    }
+
+    int getNbWorkers() const { return (int) workers.size(); }
+    int getThreadsPerWorker() const { return threadsPerWorker; }
+
+    // Tasks submitted and not started yet
+    int getNbPending()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        return (int) tasks.size();
+    }
+
+    static Executor & global()
+    {
+        static Executor executor;
+        return executor;
+    }
+
+  private:
+    void work()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            // the number of threads is a setting of the calling thread, which a
+            // previous task may have changed
+            omp_set_num_threads(threadsPerWorker);
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    int threadsPerWorker = 1;
+    std::vector<std::thread> workers;
+};
+
+} // namespace robest
+
+#endif // ROBUST_EXECUTOR_H
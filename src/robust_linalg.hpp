@@ -0,0 +1,155 @@
+/**
+ *  @brief Small dense linear algebra helpers for estimation problems
+ *
+ *  Non-minimal (least squares) model estimation needs a few dense operations on
+ *  tiny matrices: these helpers avoid a dependency on a full linear algebra library.
+ *  Matrices are stored row-major in std::vector<double>.
+ */
+
+#ifndef ROBUST_LINALG_H
+#define ROBUST_LINALG_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <assert.h>
+
+namespace robest
+{
+namespace linalg
+{
+
+// Solves A x = b for a square n x n matrix (Gaussian elimination, partial pivoting).
+// Returns false if A is singular.
+inline bool solve(std::vector<double> A, std::vector<double> b, int n, std::vector<double> & x)
+{
+    assert((int)A.size() == n * n && (int)b.size() == n && "Wrong matrix size");
+
+    for (int col = 0; col < n; ++col)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < n; ++row)
+        {
+            if (std::fabs(A[row * n + col]) > std::fabs(A[pivot * n + col]))
+                pivot = row;
+        }
+        if (std::fabs(A[pivot * n + col]) < 1e-300)
+            return false;
+
+        if (pivot != col)
+        {
+            for (int k = 0; k < n; ++k)
+                std::swap(A[col * n + k], A[pivot * n + k]);
+            std::swap(b[col], b[pivot]);
+        }
+
+        for (int row = col + 1; row < n; ++row)
+        {
+            double f = A[row * n + col] / A[col * n + col];
+            for (int k = col; k < n; ++k)
+                A[row * n + k] -= f * A[col * n + k];
+            b[row] -= f * b[col];
+        }
+    }
+
+    x.assign(n, 0.0);
+    for (int row = n - 1; row >= 0; --row)
+    {
+        double sum = b[row];
+        for (int k = row + 1; k < n; ++k)
+            sum -= A[row * n + k] * x[k];
+        x[row] = sum / A[row * n + row];
+    }
+    return true;
+}
+
+// Eigen decomposition of a symmetric n x n matrix (cyclic Jacobi).
+// Eigenvalues are sorted in ascending order, eigenvectors are the columns of V.
+inline void symmetricEigen(std::vector<double> A, int n, std::vector<double> & eigenvalues, std::vector<double> & V)
+{
+    assert((int)A.size() == n * n && "Wrong matrix size");
+
+    V.assign(n * n, 0.0);
+    for (int i = 0; i < n; ++i)
+        V[i * n + i] = 1.0;
+
+    for (int sweep = 0; sweep < 100; ++sweep)
+    {
+        double offDiag = 0.0;
+        for (int p = 0; p < n; ++p)
+            for (int q = p + 1; q < n; ++q)
+                offDiag += A[p * n + q] * A[p * n + q];
+        if (offDiag < 1e-30)
+            break;
+
+        for (int p = 0; p < n; ++p)
+        {
+            for (int q = p + 1; q < n; ++q)
+            {
+                double apq = A[p * n + q];
+                if (std::fabs(apq) < 1e-300)
+                    continue;
+
+                double theta = (A[q * n + q] - A[p * n + p]) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < n; ++k)
+                {
+                    double akp = A[k * n + p];
+                    double akq = A[k * n + q];
+                    A[k * n + p] = c * akp - s * akq;
+                    A[k * n + q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < n; ++k)
+                {
+                    double apk = A[p * n + k];
+                    double aqk = A[q * n + k];
+                    A[p * n + k] = c * apk - s * aqk;
+                    A[q * n + k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < n; ++k)
+                {
+                    double vkp = V[k * n + p];
+                    double vkq = V[k * n + q];
+                    V[k * n + p] = c * vkp - s * vkq;
+                    V[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    // sort by ascending eigenvalue
+    std::vector<int> order(n);
+    for (int i = 0; i < n; ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int i, int j) { return A[i * n + i] < A[j * n + j]; });
+
+    std::vector<double> sortedV(n * n);
+    eigenvalues.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        eigenvalues[i] = A[order[i] * n + order[i]];
+        for (int k = 0; k < n; ++k)
+            sortedV[k * n + i] = V[k * n + order[i]];
+    }
+    V.swap(sortedV);
+}
+
+// Unit eigenvector of the smallest eigenvalue of a symmetric n x n matrix
+inline std::vector<double> smallestEigenvector(const std::vector<double> & A, int n)
+{
+    std::vector<double> eigenvalues, V;
+    symmetricEigen(A, n, eigenvalues, V);
+
+    std::vector<double> v(n);
+    for (int k = 0; k < n; ++k)
+        v[k] = V[k * n];
+    return v;
+}
+
+} // namespace linalg
+} // namespace robest
+
+#endif // ROBUST_LINALG_H
@@ -0,0 +1,247 @@
+/**
+ *  @brief Binary point files read through a memory mapping, for datasets larger than RAM
+ *
+ *  A point file holds nbPoints points of dims coordinates (doubles, row by row) after
+ *  a 24 bytes header:
+ *      char     magic[8]   "RBSTPTS" and a null byte
+ *      uint32_t version    1
+ *      uint32_t dims
+ *      uint64_t nbPoints
+ *  Integers and doubles are in the byte order of the machine that wrote the file.
+ *
+ *  MappedPointFile maps a file read only, the kernel paging the points in and out
+ *  as they are accessed: willNeed() starts reading a range ahead, release() drops the
+ *  pages of a range already processed. PointFileWriter appends points to a new file
+ *  without holding them in memory.
+ *
+ *  Inliers files written by AbstractEstimator::solveOutOfCore have no header:
+ *      InliersFileFormat::Bitmask - one bit per point, 64 points per uint64_t word
+ *                                   (bit j of word w: point 64*w + j)
+ *      InliersFileFormat::Indices - the indices of the inliers, ascending, as int64_t
+ */
+
+#ifndef ROBUST_MAPPED_H
+#define ROBUST_MAPPED_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <assert.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace robest
+{
+
+struct PointFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t dims;
+    uint64_t nbPoints;
+
+    static const char * expectedMagic() { return "RBSTPTS"; }
+};
+
+struct InliersFileFormat
+{
+    enum Type { Bitmask, Indices };
+};
+
+// Read only view of a point file. The points stay valid until close() or destruction.
+class MappedPointFile
+{
+  public:
+    MappedPointFile() {}
+    MappedPointFile(const MappedPointFile &) = delete;
+    MappedPointFile & operator=(const MappedPointFile &) = delete;
+    ~MappedPointFile() { close(); }
+
+    // False if the file cannot be read or is not a point file. The whole file is
+    // advised for sequential access.
+    bool open(const std::string & path)
+    {
+        close();
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(PointFileHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        void * mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            return false;
+        base = static_cast<const char *>(mapping);
+        mappingSize = st.st_size;
+        madvise(const_cast<char *>(base), mappingSize, MADV_SEQUENTIAL);
+#else
+        FILE * file = std::fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        buffer.resize(size > 0 ? (size + sizeof(double) - 1) / sizeof(double) : 0);
+        bool read = size >= (long) sizeof(PointFileHeader) && std::fread(buffer.data(), 1, size, file) == (size_t) size;
+        std::fclose(file);
+        if (!read)
+            return false;
+        base = reinterpret_cast<const char *>(buffer.data());
+        mappingSize = size;
+#endif
+        PointFileHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        size_t dataSize = (mappingSize - sizeof(header)) / sizeof(double);
+        if (std::memcmp(header.magic, PointFileHeader::expectedMagic(), 8) != 0 || header.version != 1 ||
+            header.dims == 0 || header.nbPoints > dataSize / header.dims)
+        {
+            close();
+            return false;
+        }
+        nbDims = (int) header.dims;
+        nbPoints = (long long) header.nbPoints;
+        return true;
+    }
+
+    void close()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if (base)
+            munmap(const_cast<char *>(base), mappingSize);
+#else
+        buffer.clear();
+#endif
+        base = nullptr;
+        mappingSize = 0;
+        nbDims = 0;
+        nbPoints = 0;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    int dims() const { return nbDims; }
+    long long size() const { return nbPoints; }
+
+    // dims() coordinates of point i, followed by the next points
+    const double * point(long long i) const
+    {
+        return reinterpret_cast<const double *>(base + sizeof(PointFileHeader)) + i * nbDims;
+    }
+
+    // Starts reading the points [begin, end) in the background
+    void willNeed(long long begin, long long end) const { advise(begin, end, true); }
+
+    // The points [begin, end) will not be read again soon: their pages can go
+    void release(long long begin, long long end) const { advise(begin, end, false); }
+
+  private:
+    void advise(long long begin, long long end, bool willNeed) const
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        begin = std::max(0LL, begin);
+        end = std::min(nbPoints, end);
+        if (!base || begin >= end)
+            return;
+        // madvise wants page aligned addresses: whole pages around the range
+        const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+        size_t first = (size_t)(reinterpret_cast<const char *>(point(begin)) - base) / page * page;
+        size_t last  = (size_t)(reinterpret_cast<const char *>(point(end)) - base);
+        if (!willNeed)
+        {
+            // pages shared with the points around are kept
+            first = (size_t)(reinterpret_cast<const char *>(point(begin)) - base + page - 1) / page * page;
+            last = end == nbPoints ? mappingSize : last / page * page;
+            if (first >= last)
+                return;
+        }
+        madvise(const_cast<char *>(base) + first, last - first, willNeed ? MADV_WILLNEED : MADV_DONTNEED);
+#else
+        (void) begin; (void) end; (void) willNeed;
+#endif
+    }
+
+    const char * base = nullptr;
+    size_t mappingSize = 0;
+    int nbDims = 0;
+    long long nbPoints = 0;
+#if !(defined(__unix__) || defined(__APPLE__))
+    std::vector<double> buffer;
+#endif
+};
+
+// Writes a point file point by point or by blocks; the header is completed by close()
+class PointFileWriter
+{
+  public:
+    PointFileWriter() {}
+    PointFileWriter(const PointFileWriter &) = delete;
+    PointFileWriter & operator=(const PointFileWriter &) = delete;
+    ~PointFileWriter() { close(); }
+
+    bool open(const std::string & path, int dims)
+    {
+        assert(dims > 0 && "Points need at least one coordinate");
+        close();
+        file = std::fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        nbDims = dims;
+        nbPoints = 0;
+        return writeHeader();
+    }
+
+    // Appends n points of dims() coordinates each
+    bool write(const double * points, long long n)
+    {
+        assert(file && "Point file not open");
+        if (n > 0 && std::fwrite(points, sizeof(double) * nbDims, (size_t) n, file) != (size_t) n)
+            return false;
+        nbPoints += n;
+        return true;
+    }
+
+    // False if the file could not be completed
+    bool close()
+    {
+        if (!file)
+            return true;
+        bool ok = std::fseek(file, 0, SEEK_SET) == 0 && writeHeader();
+        ok = std::fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+
+    int dims() const { return nbDims; }
+    long long size() const { return nbPoints; }
+
+  private:
+    bool writeHeader()
+    {
+        PointFileHeader header;
+        std::memcpy(header.magic, PointFileHeader::expectedMagic(), 8);
+        header.version = 1;
+        header.dims = (uint32_t) nbDims;
+        header.nbPoints = (uint64_t) nbPoints;
+        return std::fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    FILE * file = nullptr;
+    int nbDims = 0;
+    long long nbPoints = 0;
+};
+
+} // namespace robest
+
+#endif // ROBUST_MAPPED_H
@@ -0,0 +1,164 @@
+/**
+ *  @brief Compact consensus set: one bit per sample
+ *
+ *  An InlierMask stores the consensus set of a model in N/8 bytes instead of
+ *  4 bytes per inlier. Masks are filled 64 samples at a time from thresholded
+ *  residuals, counted with popcount, combined with AND / OR / ANDNOT, and
+ *  converted to index lists only when needed.
+ */
+
+#ifndef ROBUST_MASK_H
+#define ROBUST_MASK_H
+
+#include <vector>
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <assert.h>
+
+namespace robest
+{
+
+class InlierMask
+{
+  public:
+    typedef uint64_t Word;
+    enum { wordBits = 64 };
+
+    explicit InlierMask(int size = 0) { resize(size); }
+
+    // Resizes to size samples, all outliers
+    void resize(int size)
+    {
+        assert(size >= 0 && "Negative mask size");
+        nbSamples = size;
+        words.assign((size + wordBits - 1) / wordBits, 0);
+    }
+
+    void clear() { std::fill(words.begin(), words.end(), 0); }
+
+    int size() const { return nbSamples; }
+    int nbWords() const { return (int) words.size(); }
+
+    bool test(int i) const { return (words[i / wordBits] >> (i % wordBits)) & 1; }
+    void set(int i)        { words[i / wordBits] |= Word(1) << (i % wordBits); }
+    void reset(int i)      { words[i / wordBits] &= ~(Word(1) << (i % wordBits)); }
+
+    // Word w holds samples [64*w, 64*w + 64). Bits past size() must stay at zero.
+    Word word(int w) const        { return words[w]; }
+    void setWord(int w, Word bits) { words[w] = bits; }
+
+    // Mask word of n <= 64 squared residuals: bit j is set if errors2[j] < thres2.
+    // Branch free, so that the comparisons vectorize.
+    static Word thresholdWord(const double * errors2, int n, double thres2)
+    {
+        Word bits = 0;
+        for (int j = 0; j < n; ++j)
+            bits |= Word(errors2[j] < thres2) << j;
+        return bits;
+    }
+
+    // Number of inliers
+    int count() const
+    {
+        int n = 0;
+        for (Word w : words)
+            n += popcount(w);
+        return n;
+    }
+
+    // Number of samples that are inliers of both masks
+    int overlap(const InlierMask & other) const
+    {
+        assert(other.nbSamples == nbSamples && "Masks of different sizes");
+        int n = 0;
+        for (size_t w = 0; w < words.size(); ++w)
+            n += popcount(words[w] & other.words[w]);
+        return n;
+    }
+
+    InlierMask & operator&=(const InlierMask & other)
+    {
+        assert(other.nbSamples == nbSamples && "Masks of different sizes");
+        for (size_t w = 0; w < words.size(); ++w)
+            words[w] &= other.words[w];
+        return *this;
+    }
+
+    InlierMask & operator|=(const InlierMask & other)
+    {
+        assert(other.nbSamples == nbSamples && "Masks of different sizes");
+        for (size_t w = 0; w < words.size(); ++w)
+            words[w] |= other.words[w];
+        return *this;
+    }
+
+    // Removes the inliers of other
+    InlierMask & andNot(const InlierMask & other)
+    {
+        assert(other.nbSamples == nbSamples && "Masks of different sizes");
+        for (size_t w = 0; w < words.size(); ++w)
+            words[w] &= ~other.words[w];
+        return *this;
+    }
+
+    bool operator==(const InlierMask & other) const
+    {
+        return nbSamples == other.nbSamples && words == other.words;
+    }
+    bool operator!=(const InlierMask & other) const { return !(*this == other); }
+
+    // Inliers indices, in ascending order
+    void toIndices(std::vector<int> & indices) const
+    {
+        indices.clear();
+        indices.reserve(count());
+        for (size_t w = 0; w < words.size(); ++w)
+        {
+            Word bits = words[w];
+            while (bits)
+            {
+                indices.push_back((int)(w * wordBits) + lowestBit(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    void fromIndices(const std::vector<int> & indices)
+    {
+        clear();
+        for (int i : indices)
+        {
+            assert(i >= 0 && i < nbSamples && "Index out of the mask");
+            set(i);
+        }
+    }
+
+  private:
+    static int popcount(Word w)
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll(w);
+#else
+        return (int) std::bitset<wordBits>(w).count();
+#endif
+    }
+
+    static int lowestBit(Word w)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(w);
+#else
+        int n = 0;
+        while (!(w & 1)) { w >>= 1; ++n; }
+        return n;
+#endif
+    }
+
+    int nbSamples = 0;
+    std::vector<Word> words;
+};
+
+} // namespace robest
+
+#endif // ROBUST_MASK_H
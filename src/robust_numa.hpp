@@ -0,0 +1,257 @@
+/**
+ *  @brief NUMA placement of the samples and pinning of the scoring threads
+ *
+ *  On a machine with several NUMA nodes, the batched scoring splits the samples in
+ *  one contiguous partition per node (NumaLayout): the pages holding a partition
+ *  are moved to its node, the threads scoring it are pinned to the cpus of the node,
+ *  and a thread only reads the samples of its partition. The scores of the threads
+ *  are summed per partition, then across partitions.
+ *
+ *  The topology is read from /sys/devices/system/node (Linux). Elsewhere, or if it
+ *  cannot be read, the machine is a single node holding every cpu; on a single node
+ *  nothing is moved nor pinned.
+ */
+
+#ifndef ROBUST_NUMA_H
+#define ROBUST_NUMA_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <assert.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace robest
+{
+
+class NumaTopology
+{
+  public:
+    // One node per list of cpus; ids are the node numbers of the system
+    explicit NumaTopology(const std::vector<std::vector<int>> & nodeCpus = std::vector<std::vector<int>>(),
+                          const std::vector<int> & ids = std::vector<int>())
+        : nodeCpus(nodeCpus), ids(ids)
+    {
+        if (this->ids.empty())
+        {
+            for (int n = 0; n < (int) nodeCpus.size(); ++n)
+                this->ids.push_back(n);
+        }
+        assert(this->ids.size() == nodeCpus.size() && "One id per node");
+    }
+
+    // Topology of the machine, read once
+    static const NumaTopology & system()
+    {
+        static const NumaTopology topology = readSystem();
+        return topology;
+    }
+
+    // At least one node, even if the topology is unknown
+    int nbNodes() const { return std::max(1, (int) nodeCpus.size()); }
+
+    // Cpus of the node, empty if unknown
+    const std::vector<int> & cpus(int node) const
+    {
+        static const std::vector<int> none;
+        return node < (int) nodeCpus.size() ? nodeCpus[node] : none;
+    }
+
+    // Number of the node for the system
+    int id(int node) const { return node < (int) ids.size() ? ids[node] : 0; }
+
+    // Parses a cpu list as in sysfs: "0-3,8,10-11"
+    static bool parseCpuList(const std::string & list, std::vector<int> & cpus)
+    {
+        cpus.clear();
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ','))
+        {
+            range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+            if (range.empty())
+                continue;
+            int first = 0, last = 0;
+            char dash = 0;
+            std::stringstream item(range);
+            if (!(item >> first))
+                return false;
+            last = first;
+            if (item >> dash && (dash != '-' || !(item >> last)))
+                return false;
+            if (first < 0 || last < first)
+                return false;
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        return true;
+    }
+
+  private:
+    static NumaTopology readSystem()
+    {
+        std::vector<std::vector<int>> nodeCpus;
+        std::vector<int> ids;
+#if defined(__linux__)
+        // node directories can be sparse: look a bit past the last one found
+        for (int id = 0, misses = 0; misses < 64; ++id)
+        {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            std::vector<int> cpus;
+            if (!file || !std::getline(file, list) || !parseCpuList(list, cpus))
+            {
+                misses++;
+                continue;
+            }
+            misses = 0;
+            if (cpus.empty())
+                continue; // memory only node
+            nodeCpus.push_back(cpus);
+            ids.push_back(id);
+        }
+#endif
+        return NumaTopology(nodeCpus, ids);
+    }
+
+    std::vector<std::vector<int>> nodeCpus;
+    std::vector<int> ids;
+};
+
+// Samples [0, nbSamples) split in contiguous partitions, one per node used, scored by
+// a team of nbThreads threads: thread t works on partition t * P / nbThreads, so that
+// the threads of a partition are consecutive. There are min(nodes, threads)
+// partitions, partition p living on node p * nodes / P.
+class NumaLayout
+{
+  public:
+    // Affinity of a thread, saved by pinThread and given back by restoreThread
+    struct Affinity
+    {
+#if defined(__linux__)
+        cpu_set_t cpus;
+#endif
+        bool saved = false;
+    };
+
+    NumaLayout(const NumaTopology & topology, int nbSamples, int nbThreads)
+        : topology(&topology), nbSamples(nbSamples), nbThreads(std::max(1, nbThreads))
+    {
+        nbParts = std::min(topology.nbNodes(), this->nbThreads);
+    }
+
+    int nbPartitions() const { return nbParts; }
+    int getNbThreads() const { return nbThreads; }
+
+    // Samples [partitionBegin(p), partitionBegin(p + 1))
+    int partitionBegin(int p) const { return (int)((long long) nbSamples * p / nbParts); }
+
+    // Node of the topology holding partition p
+    int node(int p) const { return p * topology->nbNodes() / nbParts; }
+
+    int partitionOfThread(int t) const { return (int)((long long) t * nbParts / nbThreads); }
+
+    // Threads of partition p: [firstThread(p), firstThread(p + 1))
+    int firstThread(int p) const { return (int)(((long long) p * nbThreads + nbParts - 1) / nbParts); }
+
+    // Whether there is anything to place or pin
+    bool isMultiNode() const { return nbParts > 1; }
+
+    // Moves the pages of the array data of nbSamples samples of sampleSize bytes each
+    // to the nodes of their partitions. A page shared by two partitions goes to the
+    // node of its first sample. False if nothing was moved: single node, or pages
+    // that cannot be moved (no permission, unsupported system).
+    bool place(const void * data, size_t sampleSize) const
+    {
+#if defined(__linux__) && defined(SYS_move_pages)
+        if (!isMultiNode() || !data || nbSamples == 0)
+            return false;
+        const uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+        const uintptr_t begin = (uintptr_t) data;
+        const uintptr_t end = begin + (uintptr_t) nbSamples * sampleSize;
+
+        const int flagMove = 1 << 1; // MPOL_MF_MOVE
+        const size_t maxPages = 1024;
+        std::vector<void *> pages;
+        std::vector<int> nodes, status;
+        bool moved = false;
+        int p = 0;
+        for (uintptr_t address = begin / page * page; address < end; )
+        {
+            pages.clear();
+            nodes.clear();
+            for (; address < end && pages.size() < maxPages; address += page)
+            {
+                long long sample = address <= begin ? 0 : (long long)((address - begin) / sampleSize);
+                while (p + 1 < nbParts && partitionBegin(p + 1) <= sample)
+                    p++;
+                pages.push_back((void *) address);
+                nodes.push_back(topology->id(node(p)));
+            }
+            status.resize(pages.size());
+            long result = syscall(SYS_move_pages, 0, (unsigned long) pages.size(), pages.data(), nodes.data(), status.data(), flagMove);
+            moved = moved || result >= 0;
+            if (result < 0)
+                return moved;
+        }
+        return moved;
+#else
+        (void) data; (void) sampleSize;
+        return false;
+#endif
+    }
+
+    // Pins the calling thread, thread t of the team, to the cpus of the node of its
+    // partition and saves its previous affinity. False if not pinned.
+    bool pinThread(int t, Affinity & previous) const
+    {
+#if defined(__linux__)
+        const std::vector<int> & cpus = topology->cpus(node(partitionOfThread(t)));
+        if (!isMultiNode() || cpus.empty())
+            return false;
+        if (!previous.saved)
+            previous.saved = sched_getaffinity(0, sizeof(previous.cpus), &previous.cpus) == 0;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void) t; (void) previous;
+        return false;
+#endif
+    }
+
+    // Gives back the affinity saved by pinThread
+    static void restoreThread(Affinity & previous)
+    {
+#if defined(__linux__)
+        if (previous.saved)
+            sched_setaffinity(0, sizeof(previous.cpus), &previous.cpus);
+#endif
+        previous.saved = false;
+    }
+
+  private:
+    const NumaTopology * topology;
+    int nbSamples;
+    int nbThreads;
+    int nbParts;
+};
+
+} // namespace robest
+
+#endif // ROBUST_NUMA_H
@@ -0,0 +1,283 @@
+/**
+ *  @brief Portfolio of estimators racing on the same problem
+ *
+ *  The members of a Portfolio (estimators with their own threshold, budget and
+ *  share of the threads) solve the problem at the same time, each in a thread of
+ *  its own running its OpenMP regions. They work on ModelView's of the problem:
+ *  the data are shared and only read, each view holds the model of its member.
+ *  Problems without estimModelParams are copied instead (see
+ *  EstimationProblem::clone), each member solving a copy of its own.
+ *
+ *  The first member to reach its confidence target cancels the others, which keep
+ *  the best model found so far. All the models are then scored under the same
+ *  criterion, and the best one is put in the problem.
+ */
+
+#ifndef ROBUST_PORTFOLIO_H
+#define ROBUST_PORTFOLIO_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <assert.h>
+
+#include <omp.h>
+
+#include "robust_estim.hpp"
+
+namespace robest
+{
+
+// View of a problem with a model of its own, for estimators running at the same time
+// on the same data. The problem is only read: models are estimated by estimModelParams
+// (and estimWeightedModelParams if implemented) into the model of the view, errors are
+// computed by estimErrorsForModel, both of which the problem must implement with
+// getModelParams (see supports). Its isDegenerate must not change it, as for the
+// parallel iterations.
+class ModelView : public EstimationProblem
+{
+  public:
+    explicit ModelView(std::shared_ptr<EstimationProblem> problem)
+        : problem(problem)
+    {
+        setNbParams(problem->getNbParams());
+        setNbMinSamples(problem->getNbMinSamples());
+        problem->getModelParams(model);
+        assert(supports(*problem) && "The problem needs getModelParams, estimModelParams and estimErrorsForModel");
+    }
+
+    // Whether views of the problem can be made
+    static bool supports(const EstimationProblem & problem)
+    {
+        std::vector<double> params;
+        std::vector<int> first(problem.getNbMinSamples());
+        std::iota(first.begin(), first.end(), 0);
+        return problem.getModelParams(params) && problem.estimErrorsForModel(params, 0, 0, nullptr) &&
+               (problem.getTotalNbSamples() < (int) first.size() || problem.estimModelParams(first, params));
+    }
+
+    double estimErrorForSample(int i)
+    {
+        double error = 0.0;
+        problem->estimErrorsForModel(model, i, i + 1, &error);
+        return error;
+    }
+
+    void estimModelFromSamples(const std::vector<int> & samplesIdx)
+    {
+        problem->estimModelParams(samplesIdx, model);
+    }
+
+    // without estimWeightedModelParams, from the samples of positive weight as the
+    // default estimModelFromWeightedSamples
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+    {
+        if (problem->estimWeightedModelParams(samplesIdx, weights, model))
+            return;
+        sample.clear();
+        for (int i = 0; i < (int) samplesIdx.size(); ++i)
+        {
+            if (weights[i] > 0.0)
+                sample.push_back(samplesIdx[i]);
+        }
+        if ((int) sample.size() >= getNbMinSamples())
+            problem->estimModelParams(sample, model);
+    }
+
+    int getTotalNbSamples() const { return problem->getTotalNbSamples(); }
+
+    bool isDegenerate(const std::vector<int> & samplesIdx)
+    {
+        return problem->isDegenerate(samplesIdx);
+    }
+
+    bool getModelParams(std::vector<double> & params) const
+    {
+        params = model;
+        return true;
+    }
+
+    bool setModelParams(const std::vector<double> & params)
+    {
+        if ((int) params.size() != getNbParams())
+            return false;
+        model = params;
+        return true;
+    }
+
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+    {
+        return problem->estimErrorsForModel(params, begin, end, errors);
+    }
+
+    bool estimApproxErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors, double & errorBound) const
+    {
+        return problem->estimApproxErrorsForModel(params, begin, end, errors, errorBound);
+    }
+
+    void placeSamples(const NumaLayout & layout) { problem->placeSamples(layout); }
+    unsigned long long getDataVersion() const { return problem->getDataVersion(); }
+    std::string costKey() const { return problem->costKey(); }
+
+  private:
+    std::shared_ptr<EstimationProblem> problem;
+    std::vector<double> model;
+    std::vector<int> sample;      // samples of positive weight
+};
+
+// Estimators racing on one problem. The models are compared with the MSAC cost (sum
+// of min(error^2, thres^2) over the samples) for the threshold given to solve(),
+// whatever the estimators that found them.
+class Portfolio
+{
+  public:
+    struct Result
+    {
+        SolveStatus status;
+        std::vector<double> model;                          // empty if no model was found
+        double score = std::numeric_limits<double>::max();  // common criterion, the lower the better
+        double time = 0.0;                                  // wall time of the member, in seconds
+    };
+
+    // Adds a member solving with its own threshold thres (see the solve() of the
+    // estimator) in at most nbIter iterations (-1: as solve() computes it) on
+    // nbThreads OpenMP threads (0: an equal share of omp_get_max_threads()).
+    void add(std::shared_ptr<AbstractEstimator> estimator, double thres, int nbIter = -1, int nbThreads = 0)
+    {
+        assert(estimator && nbThreads >= 0 && "Wrong portfolio member");
+        Member member;
+        member.estimator = estimator;
+        member.thres = thres;
+        member.nbIter = nbIter;
+        member.nbThreads = nbThreads;
+        members.push_back(member);
+    }
+
+    void clear() { members.clear(); results.clear(); winner = -1; }
+
+    int size() const { return (int) members.size(); }
+
+    // Runs all the members and puts the best model in pb, which needs getModelParams,
+    // setModelParams and estimErrorsForModel, and either estimModelParams (the members
+    // share its data) or clone (each member solves a copy). The control applies to
+    // every member; with adaptive termination, it gives the confidence target. Its
+    // cancellation token stops the whole portfolio. The status is the one of the
+    // winner.
+    SolveStatus solve(std::shared_ptr<EstimationProblem> pb, double thres,
+                      const SolveControl & control = SolveControl::unbounded())
+    {
+        assert(!members.empty() && "Empty portfolio");
+        const int share = std::max(1, omp_get_max_threads() / size());
+        CancellationToken race = control.cancelToken.child();
+        const bool views = ModelView::supports(*pb);
+
+        results.assign(members.size(), Result());
+        std::vector<std::thread> threads;
+        for (int m = 0; m < size(); ++m)
+        {
+            threads.emplace_back([this, m, pb, views, race, &control, share]()
+            {
+                runMember(m, pb, views, race, control, share);
+            });
+        }
+        for (std::thread & thread : threads)
+            thread.join();
+
+        winner = -1;
+        for (int m = 0; m < size(); ++m)
+        {
+            if (results[m].model.empty())
+                continue;
+            results[m].score = commonScore(*pb, results[m].model, thres);
+            if (winner < 0 || results[m].score < results[winner].score)
+                winner = m;
+        }
+
+        SolveStatus status;
+        if (winner >= 0)
+        {
+            pb->setModelParams(results[winner].model);
+            status = results[winner].status;
+        }
+        status.cancelled = control.cancelToken.isCancelled();
+        return status;
+    }
+
+    // Member whose model was kept by the last solve(), -1 if none found a model
+    int getWinner() const { return winner; }
+
+    std::shared_ptr<AbstractEstimator> getEstimator(int m) const { return members[m].estimator; }
+    const Result & getResult(int m) const { return results[m]; }
+
+  private:
+    struct Member
+    {
+        std::shared_ptr<AbstractEstimator> estimator;
+        double thres;
+        int nbIter;
+        int nbThreads;
+    };
+
+    void runMember(int m, std::shared_ptr<EstimationProblem> pb, bool views, const CancellationToken & race,
+                   const SolveControl & control, int share)
+    {
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+        Member & member = members[m];
+        Result & result = results[m];
+
+        // the number of threads is a setting of the calling thread
+        omp_set_num_threads(member.nbThreads > 0 ? member.nbThreads : share);
+
+        std::shared_ptr<EstimationProblem> problem;
+        if (views)
+            problem = std::make_shared<ModelView>(pb);
+        else
+            problem = pb->clone();
+        assert(problem && "The problem needs estimModelParams or clone");
+
+        SolveControl memberControl = control;
+        memberControl.cancelToken = race;
+        result.status = member.estimator->solve(problem, member.thres, member.nbIter, memberControl);
+        if (member.estimator->getInliersMask().count() >= pb->getNbMinSamples())
+            problem->getModelParams(result.model);
+        if (result.status.confidenceReached)
+            race.cancel();
+
+        result.time = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    static double commonScore(const EstimationProblem & pb, const std::vector<double> & model, double thres)
+    {
+        enum { tile = 1024 };
+        const int totalNbSamples = pb.getTotalNbSamples();
+        const double thres2 = thres * thres;
+        double cost = 0.0;
+
+        #pragma omp parallel for reduction(+:cost)
+        for (int begin = 0; begin < totalNbSamples; begin += tile)
+        {
+            double errors[tile];
+            int n = std::min((int) tile, totalNbSamples - begin);
+            pb.estimErrorsForModel(model, begin, begin + n, errors);
+            for (int j = 0; j < n; ++j)
+            {
+                double error2 = errors[j] * errors[j];
+                cost += error2 < thres2 ? error2 : thres2;
+            }
+        }
+        return cost;
+    }
+
+    std::vector<Member> members;
+    std::vector<Result> results;
+    int winner = -1;
+};
+
+} // namespace robest
+
+#endif // ROBUST_PORTFOLIO_H
@@ -0,0 +1,128 @@
+/**
+ *  @brief Multi-resolution subsets of a dataset for coarse-to-fine estimation
+ *
+ *  A SamplePyramid holds nested subsets of the samples of a problem: level 0 is
+ *  the full dataset (not stored), each following level is a subset of the
+ *  previous one, the last level being the coarsest. Subsets are index lists in
+ *  ascending order, built once and reused by every solve on the same data (see
+ *  AbstractEstimator::solveHierarchical).
+ */
+
+#ifndef ROBUST_PYRAMID_H
+#define ROBUST_PYRAMID_H
+
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+#include <assert.h>
+
+namespace robest
+{
+
+class SamplePyramid
+{
+  public:
+    // Random subsets: each level keeps 1 / ratio of the samples of the previous one,
+    // down to coarsestSize samples. A random order of the samples is drawn once and
+    // every level keeps a prefix of it, so that the levels are nested.
+    void buildRandom(int nbSamples, int coarsestSize, double ratio = 8.0, unsigned seed = 0)
+    {
+        assert(nbSamples >= 0 && coarsestSize > 0 && ratio > 1.0 && "Wrong pyramid parameters");
+        clear();
+        totalNbSamples = nbSamples;
+
+        std::vector<int> order(nbSamples);
+        std::iota(order.begin(), order.end(), 0);
+        std::mt19937 generator(seed);
+        std::shuffle(order.begin(), order.end(), generator);
+
+        double size = nbSamples;
+        while (size > coarsestSize)
+        {
+            size = std::max<double>(coarsestSize, size / ratio);
+            std::vector<int> level(order.begin(), order.begin() + (int) size);
+            std::sort(level.begin(), level.end());
+            levels.push_back(level);
+        }
+    }
+
+    // Voxel grid subsets of points (x[i*stride], y[i*stride], z[i*stride]), z may be
+    // null for 2D points: each level keeps the first point of every occupied voxel
+    // of the previous level. Voxels of the first subset level have the edge voxelSize,
+    // multiplied by growth at each level, until coarsestSize points are left or the
+    // grid no longer reduces the points.
+    void buildVoxelGrid(const double * x, const double * y, const double * z, int n, int stride,
+                        double voxelSize, int coarsestSize, double growth = 2.0)
+    {
+        assert(n >= 0 && voxelSize > 0.0 && coarsestSize > 0 && growth > 1.0 && "Wrong pyramid parameters");
+        clear();
+        totalNbSamples = n;
+
+        std::vector<int> current(n);
+        std::iota(current.begin(), current.end(), 0);
+        std::unordered_map<uint64_t, int> voxels;
+
+        while ((int) current.size() > coarsestSize)
+        {
+            voxels.clear();
+            voxels.reserve(current.size());
+            std::vector<int> level;
+            for (int i : current)
+            {
+                uint64_t key = cell(x[i * stride], voxelSize) | cell(y[i * stride], voxelSize) << 21;
+                if (z)
+                    key |= cell(z[i * stride], voxelSize) << 42;
+                if (voxels.insert(std::make_pair(key, i)).second)
+                    level.push_back(i);
+            }
+            if (level.size() == current.size())
+            {
+                voxelSize *= growth;
+                continue;
+            }
+
+            levels.push_back(level);
+            current.swap(level);
+            voxelSize *= growth;
+        }
+    }
+
+    void clear()
+    {
+        totalNbSamples = 0;
+        levels.clear();
+    }
+
+    // Number of levels, full resolution included
+    int nbLevels() const { return 1 + (int) levels.size(); }
+
+    // Samples of the full dataset the pyramid was built for
+    int getTotalNbSamples() const { return totalNbSamples; }
+
+    int levelSize(int l) const { return l == 0 ? totalNbSamples : (int) levels[l - 1].size(); }
+
+    // Indices of the samples of level l >= 1, in ascending order
+    const std::vector<int> & indices(int l) const
+    {
+        assert(l >= 1 && l < nbLevels() && "Level 0 is the full dataset");
+        return levels[l - 1];
+    }
+
+  private:
+    // 21 bits per axis: voxels 2^21 apart share their key
+    static uint64_t cell(double v, double voxelSize)
+    {
+        return (uint64_t)(int64_t) std::floor(v / voxelSize) & 0x1FFFFF;
+    }
+
+    int totalNbSamples = 0;
+    std::vector<std::vector<int>> levels;
+};
+
+} // namespace robest
+
+#endif // ROBUST_PYRAMID_H
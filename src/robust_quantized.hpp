@@ -0,0 +1,162 @@
+/**
+ *  @brief Quantized storage of 3D points for bandwidth bound scoring
+ *
+ *  Points are stored by blocks of consecutive samples. Inside a block, each
+ *  coordinate is an integer (int16_t or int32_t) relative to the block origin:
+ *      p = origin + scale * q
+ *  with one scale per block, the same for the three axes. Coordinates are stored
+ *  as separate arrays (structure of arrays) so that the residual kernels decode
+ *  them on the fly in vectorized loops.
+ *
+ *  The decoded point is within errorBound(block) of the original one (euclidean
+ *  distance). Residuals that are 1-Lipschitz in the point (distance to a plane,
+ *  to a sphere...) are then known up to this bound.
+ *
+ *  A problem may keep only the quantized copy, and read the exact points from a
+ *  PointSource when it needs them: the points of the minimal samples, the residuals
+ *  re-verified near the inlier boundary and the final inliers extraction.
+ */
+
+#ifndef ROBUST_QUANTIZED_H
+#define ROBUST_QUANTIZED_H
+
+#include <vector>
+#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <assert.h>
+
+namespace robest
+{
+
+// Exact coordinates of point i, e.g. read from a MappedPointFile or from arrays held
+// by the caller. Called from several threads at a time.
+typedef std::function<void(int i, double & x, double & y, double & z)> PointSource;
+
+template<typename Int>
+class QuantizedPoints3d
+{
+  public:
+    struct Block
+    {
+        double ox, oy, oz;  // origin: center of the bounding box of the block
+        double scale;       // size of one quantization step
+        double errorBound;  // max distance between a decoded point and the original one
+    };
+
+    // Quantizes the n points (x[i*stride], y[i*stride], z[i*stride]) by blocks of
+    // blockSize points: stride is 1 for separate arrays, 3 for an array of {x, y, z}
+    void build(const double * x, const double * y, const double * z, int n, int stride = 1, int blockSize = 1024)
+    {
+        assert(n >= 0 && blockSize > 0 && "Wrong quantization parameters");
+        const double maxInt = (double) std::numeric_limits<Int>::max();
+
+        this->blockSize = blockSize;
+        nbSamples = n;
+        qx.resize(n);
+        qy.resize(n);
+        qz.resize(n);
+        blocks.resize((n + blockSize - 1) / blockSize);
+
+        for (int b = 0; b < (int) blocks.size(); ++b)
+        {
+            int begin = b * blockSize;
+            int end = std::min(begin + blockSize, n);
+
+            double lo[3] = { x[begin * stride], y[begin * stride], z[begin * stride] };
+            double hi[3] = { lo[0], lo[1], lo[2] };
+            for (int i = begin; i < end; ++i)
+            {
+                lo[0] = std::min(lo[0], x[i * stride]); hi[0] = std::max(hi[0], x[i * stride]);
+                lo[1] = std::min(lo[1], y[i * stride]); hi[1] = std::max(hi[1], y[i * stride]);
+                lo[2] = std::min(lo[2], z[i * stride]); hi[2] = std::max(hi[2], z[i * stride]);
+            }
+
+            Block & block = blocks[b];
+            block.ox = 0.5 * (lo[0] + hi[0]);
+            block.oy = 0.5 * (lo[1] + hi[1]);
+            block.oz = 0.5 * (lo[2] + hi[2]);
+            double halfExtent = 0.5 * std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+            block.scale = halfExtent > 0.0 ? halfExtent / maxInt : 1.0;
+
+            double maxError2 = 0.0;
+            for (int i = begin; i < end; ++i)
+            {
+                qx[i] = quantize(x[i * stride] - block.ox, block.scale, maxInt);
+                qy[i] = quantize(y[i * stride] - block.oy, block.scale, maxInt);
+                qz[i] = quantize(z[i * stride] - block.oz, block.scale, maxInt);
+
+                double dx = block.ox + block.scale * qx[i] - x[i * stride];
+                double dy = block.oy + block.scale * qy[i] - y[i * stride];
+                double dz = block.oz + block.scale * qz[i] - z[i * stride];
+                maxError2 = std::max(maxError2, dx * dx + dy * dy + dz * dz);
+            }
+            // measured error, with a margin for the rounding of the residual kernels
+            double magnitude = std::fabs(block.ox) + std::fabs(block.oy) + std::fabs(block.oz) + 3.0 * halfExtent;
+            block.errorBound = std::sqrt(maxError2) + 1e-12 * magnitude;
+        }
+    }
+
+    void clear()
+    {
+        nbSamples = 0;
+        qx.clear();
+        qy.clear();
+        qz.clear();
+        blocks.clear();
+    }
+
+    bool empty() const { return nbSamples == 0; }
+    int size() const { return nbSamples; }
+    int getBlockSize() const { return blockSize; }
+
+    const Block & block(int b) const { return blocks[b]; }
+    const Int * x() const { return qx.data(); }
+    const Int * y() const { return qy.data(); }
+    const Int * z() const { return qz.data(); }
+
+    // Largest error bound over the blocks holding the samples [begin, end)
+    double errorBound(int begin, int end) const
+    {
+        double bound = 0.0;
+        for (int b = begin / blockSize; b * blockSize < end; ++b)
+            bound = std::max(bound, blocks[b].errorBound);
+        return bound;
+    }
+
+    // Memory used by the quantized points, in bytes
+    size_t memorySize() const
+    {
+        return 3 * qx.size() * sizeof(Int) + blocks.size() * sizeof(Block);
+    }
+
+    // Calls kernel(block, begin, end) for each block overlapping [begin, end)
+    template<typename Kernel>
+    void forEachBlock(int begin, int end, Kernel kernel) const
+    {
+        for (int b = begin / blockSize; b * blockSize < end; ++b)
+        {
+            int first = std::max(begin, b * blockSize);
+            int last = std::min(end, (b + 1) * blockSize);
+            kernel(blocks[b], first, last);
+        }
+    }
+
+  private:
+    static Int quantize(double value, double scale, double maxInt)
+    {
+        double q = std::round(value / scale);
+        return (Int) std::max(-maxInt, std::min(maxInt, q));
+    }
+
+    int nbSamples = 0;
+    int blockSize = 1024;
+    std::vector<Int> qx, qy, qz;
+    std::vector<Block> blocks;
+};
+
+} // namespace robest
+
+#endif // ROBUST_QUANTIZED_H
@@ -0,0 +1,178 @@
+/**
+ *  @brief Minimal samples drawn from inlier probabilities learned during a solve
+ *
+ *  GuidedSampler keeps an inlier probability per sample, all starting at the same
+ *  prior. They are learned from the hypotheses scored by the estimator:
+ *   - each new best model sets them to the posterior of a mixture of inliers, whose
+ *     errors are half-normal of sigma = boundary / 2, and of outliers, uniform up to
+ *     the largest error (Guided-MLESAC), the inliers ratio being the one of the model;
+ *   - each hypothesis that fails lowers the probabilities of the samples it was
+ *     estimated from, by Bayes' rule (BaySAC). A hypothesis fails when it is supported
+ *     by less than failureRatio() times the inliers of the best one: its minimal
+ *     sample is then assumed to hold at least one outlier, so that
+ *         P(i inlier | failed) = p_i * (1 - prod_{j != i} p_j) / (1 - prod_j p_j)
+ *     for each i of the sample.
+ *  Probabilities stay within [minProbability(), 1 - minProbability()].
+ *
+ *  Minimal samples are drawn without replacement proportionally to the probabilities,
+ *  which are held in a Fenwick tree: a draw and an update take O(log N).
+ */
+
+#ifndef ROBUST_SAMPLER_H
+#define ROBUST_SAMPLER_H
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+namespace robest
+{
+
+class GuidedSampler
+{
+  public:
+    static double priorProbability() { return 0.5; }
+    static double minProbability() { return 0.01; }
+    static double failureRatio() { return 0.5; }
+
+    // n samples, all with the prior probability
+    void reset(int n)
+    {
+        probabilities.assign(n, priorProbability());
+        build();
+    }
+
+    // Posterior inlier probabilities for the errors of the best model, which has
+    // nbInliers inliers below boundary
+    void learnFromModel(const double * errors, int nbInliers, double boundary)
+    {
+        const double pi = 3.14159265358979323846;
+        const int n = size();
+        double maxError = boundary;
+        for (int i = 0; i < n; ++i)
+            maxError = std::max(maxError, std::fabs(errors[i]));
+
+        const double gamma = std::min(1.0, (double) nbInliers / std::max(1, n));
+        const double sigma = 0.5 * boundary;
+        const double inlierScale = gamma * std::sqrt(2.0 / pi) / sigma; // half-normal density at 0
+        const double outlierDensity = (1.0 - gamma) / maxError;
+        for (int i = 0; i < n; ++i)
+        {
+            double r = errors[i] / sigma;
+            double inlier = inlierScale * std::exp(-0.5 * r * r);
+            double p = inlier / (inlier + outlierDensity);
+            probabilities[i] = std::min(1.0 - minProbability(), std::max(minProbability(), p));
+        }
+        build();
+    }
+
+    int size() const { return (int) probabilities.size(); }
+    double probability(int i) const { return probabilities[i]; }
+
+    // Sum of the probabilities
+    double total() const { return prefixSum(size()); }
+
+    // Sum of the probabilities of the samples [0, n)
+    double prefixSum(int n) const
+    {
+        double sum = 0.0;
+        for (; n > 0; n -= n & -n)
+            sum += tree[n];
+        return sum;
+    }
+
+    // k distinct samples, each drawn proportionally to its probability among the
+    // samples not drawn yet
+    template<typename Generator>
+    void draw(int k, Generator & generator, std::vector<int> & idx)
+    {
+        assert(k <= size() && "Not enough samples");
+        idx.clear();
+        for (int s = 0; s < k; ++s)
+        {
+            std::uniform_real_distribution<double> uniform(0.0, total());
+            int i = find(uniform(generator));
+            if (std::find(idx.begin(), idx.end(), i) != idx.end())
+            {
+                --s; // rounding errors, the last sample was already drawn
+                continue;
+            }
+            idx.push_back(i);
+            add(i, -probabilities[i]); // not drawn twice
+        }
+        for (int i : idx)
+            add(i, probabilities[i]);
+    }
+
+    // Learns from a hypothesis estimated from sample and supported by nbInliers
+    // samples, while the best one so far has bestNbInliers
+    void update(const std::vector<int> & sample, int nbInliers, int bestNbInliers)
+    {
+        if (nbInliers >= failureRatio() * bestNbInliers)
+            return;
+
+        double all = 1.0;
+        for (int i : sample)
+            all *= probabilities[i];
+        if (all >= 1.0)
+            return;
+        for (int i : sample)
+        {
+            double others = probabilities[i] > 0.0 ? all / probabilities[i] : 0.0;
+            double p = std::max(minProbability(), probabilities[i] * (1.0 - others) / (1.0 - all));
+            add(i, p - probabilities[i]);
+            probabilities[i] = p;
+        }
+    }
+
+  private:
+    // Fenwick tree of the probabilities, in O(n)
+    void build()
+    {
+        const int n = size();
+        tree.assign(n + 1, 0.0);
+        for (int i = 1; i <= n; ++i)
+        {
+            tree[i] += probabilities[i - 1];
+            int parent = i + (i & -i);
+            if (parent <= n)
+                tree[parent] += tree[i];
+        }
+        highestBit = 1;
+        while (highestBit * 2 <= n)
+            highestBit *= 2;
+    }
+
+    void add(int i, double delta)
+    {
+        for (int node = i + 1; node < (int) tree.size(); node += node & -node)
+            tree[node] += delta;
+    }
+
+    // Sample whose probability interval holds u, by descending the tree
+    int find(double u) const
+    {
+        int node = 0;
+        for (int step = highestBit; step > 0; step /= 2)
+        {
+            int next = node + step;
+            if (next < (int) tree.size() && tree[next] <= u)
+            {
+                node = next;
+                u -= tree[next];
+            }
+        }
+        // rounding errors may push u past the last sample
+        return std::min(node, size() - 1);
+    }
+
+    std::vector<double> probabilities;
+    std::vector<double> tree;  // Fenwick tree of the probabilities, 1-based
+    int highestBit = 1;
+};
+
+} // namespace robest
+
+#endif // ROBUST_SAMPLER_H
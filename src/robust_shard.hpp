@@ -0,0 +1,327 @@
+/**
+ *  @brief Sharded scoring: hypotheses scored by worker processes holding shards of the data
+ *
+ *  The coordinator (an estimator, see AbstractEstimator::setShards) sends each batch
+ *  of hypotheses to all the shards as compact model parameters. Every worker scores
+ *  them on its part of the data (see serveShard) and replies with partial scores that
+ *  the coordinator sums: costs and inlier counts for the estimators whose cost is a
+ *  sum over the samples, error histograms (ErrorSketch) for LMedS.
+ *
+ *  Messages are vectors of doubles. The transport is pluggable: ShardTransport is
+ *  the coordinator end, ShardEndpoint the worker end. LocalProcessTransport runs the
+ *  workers as child processes of the coordinator on the same machine.
+ *
+ *  Request: [op, thres, boundary, nbModels, nbParams, params of model 0, ...]
+ *  Reply of ShardOp::Sums:   [cost, nbInliers] per model
+ *  Reply of ShardOp::Sketch: [nbInliers, ErrorSketch counts] per model
+ */
+
+#ifndef ROBUST_SHARD_H
+#define ROBUST_SHARD_H
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <assert.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+namespace robest
+{
+
+struct ShardOp
+{
+    enum { Sums = 1, Sketch = 2 };
+    enum { headerSize = 5 };
+};
+
+// Histogram of positive values (squared errors) on logarithmic bins: binsPerOctave
+// bins per power of two between 2^minExponent and 2^maxExponent. Sketches of several
+// shards are merged by adding their counts. Quantiles are interpolated in the bin, the
+// relative error is below 2^(1 / binsPerOctave) - 1 (7%) for values in the range.
+class ErrorSketch
+{
+  public:
+    enum { nbBins = 1024, minExponent = -50, maxExponent = 50 };
+
+    ErrorSketch() : counts(nbBins, 0.0) {}
+
+    void clear() { std::fill(counts.begin(), counts.end(), 0.0); }
+
+    void add(double value)
+    {
+        counts[bin(value)] += 1.0;
+    }
+
+    // Adds nbBins counts, e.g. from a shard reply
+    void merge(const double * other)
+    {
+        for (int b = 0; b < nbBins; ++b)
+            counts[b] += other[b];
+    }
+
+    const double * data() const { return counts.data(); }
+
+    double count() const
+    {
+        double n = 0.0;
+        for (double c : counts)
+            n += c;
+        return n;
+    }
+
+    // Value below which a fraction q of the values lies
+    double quantile(double q) const
+    {
+        double total = count();
+        if (total == 0.0)
+            return 0.0;
+
+        double rank = q * total;
+        double below = 0.0;
+        for (int b = 0; b < nbBins; ++b)
+        {
+            if (below + counts[b] >= rank && counts[b] > 0.0)
+            {
+                // geometric interpolation inside the bin
+                double t = (rank - below) / counts[b];
+                return std::exp2(minExponent + (b + t) / binsPerOctave());
+            }
+            below += counts[b];
+        }
+        return std::exp2((double) maxExponent);
+    }
+
+  private:
+    static double binsPerOctave() { return (double) nbBins / (maxExponent - minExponent); }
+
+    static int bin(double value)
+    {
+        if (!(value > 0.0))
+            return 0;
+        int b = (int) std::floor((std::log2(value) - minExponent) * binsPerOctave());
+        return std::max(0, std::min((int) nbBins - 1, b));
+    }
+
+    std::vector<double> counts;
+};
+
+// Coordinator end of a transport
+class ShardTransport
+{
+  public:
+    virtual ~ShardTransport() {}
+
+    virtual int nbShards() const = 0;
+
+    // Sends the request to every shard, false if a shard cannot be reached
+    virtual bool broadcast(const std::vector<double> & request) = 0;
+
+    // Waits for the reply of the shard to the last request, false if the shard is lost
+    virtual bool receive(int shard, std::vector<double> & reply) = 0;
+};
+
+// Worker end of a transport
+class ShardEndpoint
+{
+  public:
+    virtual ~ShardEndpoint() {}
+
+    // Waits for the next request, false once the coordinator has shut down
+    virtual bool receive(std::vector<double> & request) = 0;
+
+    virtual void reply(const std::vector<double> & reply) = 0;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// Workers forked from the coordinator process. Messages go through a shared memory
+// mapping (one slot for the request, one per shard for the replies) and the Unix
+// sockets connecting the coordinator to each worker only carry one byte per message
+// to wake the other end. The workers inherit the memory of the coordinator, so a
+// dataset loaded before the transport is created is shared copy-on-write.
+//
+// worker(shard, endpoint) runs in the child process, which exits when it returns.
+// It should return once endpoint.receive() is false. The coordinator should not be
+// running OpenMP parallel regions while the workers are forked.
+//
+// If the shared memory, a socket pair or a worker cannot be created, the workers
+// already started are stopped and the transport has no shard (see nbShards).
+class LocalProcessTransport : public ShardTransport
+{
+  public:
+    typedef std::function<void(int, ShardEndpoint &)> Worker;
+
+    // capacity: maximum size of a message, in doubles
+    LocalProcessTransport(int nbShards, Worker worker, size_t capacity = size_t(1) << 20)
+        : capacity(capacity)
+    {
+        assert(nbShards > 0 && capacity > 0 && "Wrong transport parameters");
+
+        mappingSize = (nbShards + 1) * slotSize() * sizeof(double);
+        void * mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED)
+            return;
+        memory = static_cast<double *>(mapping);
+
+        for (int shard = 0; shard < nbShards; ++shard)
+        {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            {
+                shutdown();
+                return;
+            }
+
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                close(fds[0]);
+                close(fds[1]);
+                shutdown();
+                return;
+            }
+            if (pid == 0)
+            {
+                // the worker keeps its own socket only, so that every worker sees the
+                // end of file when the coordinator closes its sockets
+                for (int fd : sockets)
+                    close(fd);
+                close(fds[0]);
+
+                Endpoint endpoint(fds[1], slot(0), slot(shard + 1), capacity);
+                worker(shard, endpoint);
+                close(fds[1]);
+                _exit(0);
+            }
+
+            close(fds[1]);
+            sockets.push_back(fds[0]);
+            pids.push_back(pid);
+        }
+    }
+
+    ~LocalProcessTransport()
+    {
+        shutdown();
+    }
+
+    // 0 if the workers could not be started
+    int nbShards() const { return (int) sockets.size(); }
+
+    bool broadcast(const std::vector<double> & request)
+    {
+        write(slot(0), request, capacity);
+        bool sent = true;
+        for (int fd : sockets)
+            sent = notify(fd) && sent;
+        return sent;
+    }
+
+    bool receive(int shard, std::vector<double> & reply)
+    {
+        if (!wait(sockets[shard]))
+            return false;
+        read(slot(shard + 1), reply);
+        return true;
+    }
+
+  private:
+    class Endpoint : public ShardEndpoint
+    {
+      public:
+        Endpoint(int fd, const double * request, double * reply, size_t capacity)
+            : fd(fd), request(request), replySlot(reply), capacity(capacity) {}
+
+        bool receive(std::vector<double> & message)
+        {
+            if (!wait(fd))
+                return false;
+            read(request, message);
+            return true;
+        }
+
+        void reply(const std::vector<double> & message)
+        {
+            write(replySlot, message, capacity);
+            notify(fd);
+        }
+
+      private:
+        int fd;
+        const double * request;
+        double * replySlot;
+        size_t capacity;
+    };
+
+    // Closes the sockets, the workers see the end of file and exit
+    void shutdown()
+    {
+        for (int fd : sockets)
+            close(fd);
+        for (pid_t pid : pids)
+            waitpid(pid, nullptr, 0);
+        sockets.clear();
+        pids.clear();
+        if (memory)
+            munmap(memory, mappingSize);
+        memory = nullptr;
+    }
+
+    // a slot holds the message size followed by the message
+    size_t slotSize() const { return capacity + 1; }
+    double * slot(int i) { return memory + i * slotSize(); }
+
+    static void write(double * slot, const std::vector<double> & message, size_t capacity)
+    {
+        assert(message.size() <= capacity && "Message larger than the transport capacity");
+        slot[0] = (double) message.size();
+        if (!message.empty())
+            std::memcpy(slot + 1, message.data(), message.size() * sizeof(double));
+    }
+
+    static void read(const double * slot, std::vector<double> & message)
+    {
+        message.assign(slot + 1, slot + 1 + (size_t) slot[0]);
+    }
+
+    // false if the other end is closed
+    static bool notify(int fd)
+    {
+        char token = 1;
+        ssize_t n;
+        do { n = ::send(fd, &token, 1, MSG_NOSIGNAL); } while (n < 0 && errno == EINTR);
+        return n == 1;
+    }
+
+    // false at the end of file
+    static bool wait(int fd)
+    {
+        char token;
+        ssize_t n;
+        do { n = ::recv(fd, &token, 1, 0); } while (n < 0 && errno == EINTR);
+        return n == 1;
+    }
+
+    size_t capacity;
+    size_t mappingSize = 0;
+    double * memory = nullptr;
+    std::vector<int> sockets;
+    std::vector<pid_t> pids;
+};
+
+#endif
+
+} // namespace robest
+
+#endif // ROBUST_SHARD_H
@@ -0,0 +1,286 @@
+/**
+ *  @brief Per-thread timeline of the solves, exported as Chrome trace JSON
+ *
+ *  While Tracer::global() runs, each solve gets an id and records spans (named
+ *  intervals of a thread) tagged with it:
+ *   - solve, iterations (per thread), final, inliers mask (per thread), refit;
+ *   - in each iteration: sample, model, score, then wait best (for the critical
+ *     section holding the best model) and update best;
+ *   - in batched scoring: hypotheses, score batch, tiles (per thread), update best.
+ *  solveHierarchical and solveOutOfCore record theirs under the id of their first
+ *  solve().
+ *
+ *  Each thread records into its own ring buffer without locks. When a buffer is
+ *  full, its oldest spans are overwritten. writeChromeTrace exports the spans of one
+ *  solve, or of a window of solves, in the Chrome trace event format. Both
+ *  chrome://tracing and Perfetto (ui.perfetto.dev) open it. Export only once the
+ *  traced solves have returned.
+ *
+ *  While the tracer is stopped, a span costs a test of the solve id. While it runs,
+ *  a span costs two clock reads and a buffer write. Define ROBEST_DISABLE_TRACING
+ *  to compile the spans out entirely: the Tracer is still available but records
+ *  nothing.
+ */
+
+#ifndef ROBUST_TRACE_H
+#define ROBUST_TRACE_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <fstream>
+#include <ostream>
+#include <algorithm>
+#include <cstdint>
+
+namespace robest
+{
+
+struct TraceEvent
+{
+    const char * name = nullptr;  // string literal
+    uint64_t begin = 0;           // nanoseconds, see Tracer::now()
+    uint64_t end = 0;
+    uint32_t solve = 0;
+    int thread = 0;               // index of the buffer of the thread
+};
+
+// Ring buffer of the spans of one thread: written by that thread only
+class TraceBuffer
+{
+  public:
+    TraceBuffer(size_t capacity, int thread) : events(capacity), thread(thread) {}
+
+    void push(const char * name, uint64_t begin, uint64_t end, uint32_t solve)
+    {
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        TraceEvent & event = events[h & (events.size() - 1)];
+        event.name = name;
+        event.begin = begin;
+        event.end = end;
+        event.solve = solve;
+        event.thread = thread;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Spans still in the buffer, oldest first
+    void copyTo(std::vector<TraceEvent> & out) const
+    {
+        const uint64_t h = head.load(std::memory_order_acquire);
+        const uint64_t n = std::min<uint64_t>(h, events.size());
+        for (uint64_t k = h - n; k < h; ++k)
+            out.push_back(events[k & (events.size() - 1)]);
+    }
+
+    // Not while the thread records
+    void reset(size_t capacity)
+    {
+        events.assign(capacity, TraceEvent());
+        head.store(0);
+    }
+
+    int getThread() const { return thread; }
+
+  private:
+    std::vector<TraceEvent> events;  // power of two size
+    std::atomic<uint64_t> head{0};   // spans pushed since the last reset
+    int thread;
+};
+
+class Tracer
+{
+  public:
+    static Tracer & global()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static uint64_t now()
+    {
+        return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Records the solves started from now on, keeping the last eventsPerThread spans
+    // (rounded up to a power of two) of each thread. Forgets the recorded spans if
+    // the size changes. Not while traced solves run.
+    void start(size_t eventsPerThread = 1 << 16)
+    {
+        size_t capacity = 1;
+        while (capacity < eventsPerThread)
+            capacity *= 2;
+        std::lock_guard<std::mutex> guard(mutex);
+        if (capacity != this->capacity)
+        {
+            this->capacity = capacity;
+            for (auto & buffer : buffers)
+                buffer->reset(capacity);
+        }
+        running.store(true);
+    }
+
+    // The solves running go on recording until they return
+    void stop() { running.store(false); }
+
+    bool isRunning() const { return running.load(); }
+
+    // Forgets the recorded spans. Not while traced solves run.
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        for (auto & buffer : buffers)
+            buffer->reset(capacity);
+    }
+
+    // Id of a new solve, 0 (not traced) if the tracer is stopped
+    uint32_t beginSolve()
+    {
+#ifndef ROBEST_DISABLE_TRACING
+        if (running.load(std::memory_order_relaxed))
+            return ++lastSolveId;
+#endif
+        return 0;
+    }
+
+    // Id of the last solve traced, 0 if none
+    uint32_t lastSolve() const { return lastSolveId.load(); }
+
+    // Span of the calling thread
+    void record(const char * name, uint64_t begin, uint64_t end, uint32_t solve)
+    {
+        threadBuffer().push(name, begin, end, solve);
+    }
+
+    // Spans of the solves firstSolve .. lastSolve, sorted by start
+    std::vector<TraceEvent> events(uint32_t firstSolve = 1, uint32_t lastSolve = std::numeric_limits<uint32_t>::max()) const
+    {
+        std::vector<TraceEvent> all, selected;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            for (const auto & buffer : buffers)
+                buffer->copyTo(all);
+        }
+        for (const TraceEvent & event : all)
+            if (event.solve >= firstSolve && event.solve <= lastSolve)
+                selected.push_back(event);
+        std::stable_sort(selected.begin(), selected.end(),
+                         [](const TraceEvent & a, const TraceEvent & b) { return a.begin < b.begin; });
+        return selected;
+    }
+
+    // Chrome trace event JSON of the spans of the solves firstSolve .. lastSolve:
+    // one complete event per span, in microseconds from the first one, and the
+    // names of the threads. False if the stream fails.
+    bool writeChromeTrace(std::ostream & out, uint32_t firstSolve = 1,
+                          uint32_t lastSolve = std::numeric_limits<uint32_t>::max()) const
+    {
+        const std::vector<TraceEvent> spans = events(firstSolve, lastSolve);
+        const uint64_t origin = spans.empty() ? 0 : spans.front().begin;
+        std::vector<int> threads;
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        const char * separator = "\n";
+        for (const TraceEvent & event : spans)
+        {
+            out << separator << "{\"name\":\"" << event.name << "\",\"cat\":\"robest\",\"ph\":\"X\",\"pid\":1"
+                << ",\"tid\":" << event.thread
+                << ",\"ts\":" << microseconds(event.begin - origin)
+                << ",\"dur\":" << microseconds(event.end - event.begin)
+                << ",\"args\":{\"solve\":" << event.solve << "}}";
+            separator = ",\n";
+            if (std::find(threads.begin(), threads.end(), event.thread) == threads.end())
+                threads.push_back(event.thread);
+        }
+        for (int thread : threads)
+        {
+            out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+                << ",\"args\":{\"name\":\"robest thread " << thread << "\"}}";
+        }
+        out << "\n]}\n";
+        return (bool) out;
+    }
+
+    bool writeChromeTrace(const std::string & path, uint32_t firstSolve = 1,
+                          uint32_t lastSolve = std::numeric_limits<uint32_t>::max()) const
+    {
+        std::ofstream file(path);
+        return file && writeChromeTrace(file, firstSolve, lastSolve);
+    }
+
+  private:
+    Tracer() {}
+    Tracer(const Tracer &) = delete;
+    Tracer & operator=(const Tracer &) = delete;
+
+    // Created on the first span of the thread, kept after it exits
+    TraceBuffer & threadBuffer()
+    {
+        static thread_local TraceBuffer * buffer = nullptr;
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            buffers.emplace_back(new TraceBuffer(capacity, (int) buffers.size()));
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    // fixed point, Chrome takes fractional microseconds
+    static std::string microseconds(uint64_t ns)
+    {
+        std::string digits = std::to_string(ns / 1000) + ".";
+        std::string fraction = std::to_string(ns % 1000);
+        return digits + std::string(3 - fraction.size(), '0') + fraction;
+    }
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    size_t capacity = 1 << 16;
+    std::atomic<bool> running{false};
+    std::atomic<uint32_t> lastSolveId{0};
+};
+
+// Span from its construction to its destruction, recorded if solve is not 0
+class TraceSpan
+{
+  public:
+    TraceSpan(const char * name, uint32_t solve) : name(name), solve(solve), begin(solve ? Tracer::now() : 0) {}
+    ~TraceSpan()
+    {
+        if (solve)
+            Tracer::global().record(name, begin, Tracer::now(), solve);
+    }
+
+  private:
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan & operator=(const TraceSpan &) = delete;
+
+    const char * name;
+    uint32_t solve;
+    uint64_t begin;
+};
+
+} // namespace robest
+
+// ROBEST_TRACE_SPAN: span to the end of the enclosing scope.
+// ROBEST_TRACE_MARK / ROBEST_TRACE_SINCE: span from a mark to now, for the waits
+// that end in another scope (e.g. entering a critical section).
+#ifndef ROBEST_DISABLE_TRACING
+#define ROBEST_TRACE_CONCAT_(a, b) a##b
+#define ROBEST_TRACE_CONCAT(a, b) ROBEST_TRACE_CONCAT_(a, b)
+#define ROBEST_TRACE_SPAN(name, solve) ::robest::TraceSpan ROBEST_TRACE_CONCAT(robestTraceSpan, __LINE__)(name, solve)
+#define ROBEST_TRACE_MARK(mark, solve) const uint64_t mark = (solve) ? ::robest::Tracer::now() : 0
+#define ROBEST_TRACE_SINCE(name, mark, solve) \
+    do { if (solve) ::robest::Tracer::global().record(name, mark, ::robest::Tracer::now(), solve); } while (0)
+#else
+#define ROBEST_TRACE_SPAN(name, solve)
+#define ROBEST_TRACE_MARK(mark, solve)
+#define ROBEST_TRACE_SINCE(name, mark, solve) do {} while (0)
+#endif
+
+#endif // ROBUST_TRACE_H
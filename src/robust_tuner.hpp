@@ -0,0 +1,264 @@
+/**
+ *  @brief Choice of the parallel strategy of a solve from measured costs
+ *
+ *  The iterations of a solve run in one of three ways:
+ *   - Serial: on one thread (tiny problems, where a parallel region costs more than
+ *     it saves);
+ *   - Hypotheses: the threads share the iterations, handed out in chunks (many
+ *     hypotheses over few samples);
+ *   - Data: the hypotheses are generated in batches, and each batch is scored tile
+ *     by tile by all the threads (few hypotheses over many samples).
+ *  Nested parallelism is the Data strategy: a thread scores all the hypotheses of a
+ *  batch on its tiles, so hypotheses and data are shared in a single team of threads
+ *  rather than in nested OpenMP regions.
+ *
+ *  ParallelTuner predicts the time of each strategy from the costs of a minimal
+ *  solve, of a residual, of a residual of the batched scoring and of a batch without
+ *  hypotheses, measured per problem type on the first solve of that type (keyed by
+ *  EstimationProblem::costKey, see AbstractEstimator::setAutoTuning), and from the
+ *  measured cost of a parallel region. It sizes the chunks, batches, tiles and
+ *  number of threads of the strategy it picks; a parallel strategy has to be
+ *  predicted parallelMargin() times faster than the serial one. The costs can be
+ *  saved to a profile and loaded by later runs, which then skip the measures.
+ *  Residual costs are measured on data in cache: large datasets read from memory
+ *  are somewhat slower than predicted. The residuals saved by the early abort of
+ *  the hypotheses scored one at a time are not predicted either.
+ */
+
+#ifndef ROBUST_TUNER_H
+#define ROBUST_TUNER_H
+
+#include <map>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+#include <omp.h>
+
+namespace robest
+{
+
+enum class ParallelStrategy { Serial, Hypotheses, Data };
+
+inline const char * parallelStrategyName(ParallelStrategy strategy)
+{
+    switch (strategy)
+    {
+        case ParallelStrategy::Hypotheses: return "hypotheses";
+        case ParallelStrategy::Data:       return "data";
+        default:                           return "serial";
+    }
+}
+
+// How the iterations of a solve run, see SolverStats::parallel
+struct ParallelDecision
+{
+    ParallelStrategy strategy = ParallelStrategy::Serial;
+    int nbThreads = 1;
+    int chunkSize = 1;           // iterations handed out at a time (Hypotheses)
+    int batchSize = 1;           // hypotheses scored per pass over the data (Data)
+    int tileSize  = 4096;        // samples per tile (Data)
+    bool tuned = false;          // chosen by the tuner, not set on the estimator
+    double predictedTime = 0.0;  // of the iterations in seconds, if tuned
+};
+
+// Measured costs of a problem type, in seconds
+struct ProblemCosts
+{
+    double residual = 0.0;       // one estimErrorForSample
+    double batchResidual = 0.0;  // one error of the batched scoring, 0 if not supported
+    double batchOverhead = 0.0;  // one batch of the batched scoring, without hypotheses
+    double model = 0.0;          // one minimal sample drawn, checked and solved
+};
+
+class ParallelTuner
+{
+  public:
+    static double parallelMargin() { return 1.1; }
+    static int minTileSize() { return 256; }
+    static int maxTileSize() { return 4096; }
+    static int maxBatchSize() { return 64; }
+
+    // Costs measured for the problem type, false if unknown
+    bool getCosts(const std::string & type, ProblemCosts & costs) const
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = profile.find(type);
+        if (it == profile.end())
+            return false;
+        costs = it->second;
+        return true;
+    }
+
+    void setCosts(const std::string & type, const ProblemCosts & costs)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        profile[type] = costs;
+    }
+
+    // Forgets the costs of every type: they are measured again
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        profile.clear();
+    }
+
+    // Cost of entering and leaving a parallel region on all the OpenMP threads,
+    // measured on first use unless set
+    double getRegionCost()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (regionCost < 0.0)
+            regionCost = measureRegionCost();
+        return regionCost;
+    }
+    void setRegionCost(double seconds)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        regionCost = seconds;
+    }
+
+    // Strategy for nbIter hypotheses over nbSamples samples, on at most maxThreads
+    // threads. Hypotheses is only considered if hypothesesAllowed, Data if dataAllowed
+    // and the batched residual cost is known; chunks stay below maxChunk iterations.
+    ParallelDecision decide(const ProblemCosts & costs, int nbSamples, int nbIter, int maxThreads,
+                            bool hypothesesAllowed, bool dataAllowed, int maxChunk)
+    {
+        assert(nbSamples > 0 && maxThreads > 0 && maxChunk > 0 && "Wrong tuning parameters");
+        const double region = getRegionCost();
+        const double iterations = std::max(1, nbIter);
+        const double iteration = costs.model + nbSamples * costs.residual;
+
+        ParallelDecision serial;
+        serial.tuned = true;
+        serial.chunkSize = maxChunk;
+        serial.predictedTime = iterations * iteration;
+        ParallelDecision best = serial;
+
+        if (hypothesesAllowed && maxThreads > 1 && nbIter > 1)
+        {
+            // a few chunks per thread balance the load
+            ParallelDecision hypotheses = serial;
+            hypotheses.strategy = ParallelStrategy::Hypotheses;
+            hypotheses.nbThreads = std::min(maxThreads, nbIter);
+            hypotheses.chunkSize = std::max(1, std::min(maxChunk,
+                                                        nbIter / (4 * hypotheses.nbThreads)));
+            hypotheses.predictedTime = region + iterations * iteration / hypotheses.nbThreads;
+            if (hypotheses.predictedTime * parallelMargin() < best.predictedTime)
+                best = hypotheses;
+        }
+
+        if (dataAllowed && costs.batchResidual > 0.0)
+        {
+            // a tile per thread at least; batches long enough for their overhead to
+            // cost less than a tenth of the scoring
+            ParallelDecision data = serial;
+            data.strategy = ParallelStrategy::Data;
+            const int perThread = (nbSamples + maxThreads - 1) / maxThreads;
+            data.tileSize = std::max(minTileSize(), std::min(maxTileSize(), perThread));
+            data.nbThreads = std::min(maxThreads, (nbSamples + data.tileSize - 1) / data.tileSize);
+            const double scan = nbSamples * costs.batchResidual / data.nbThreads;
+            data.batchSize = (int) std::min<double>(std::min(maxBatchSize(), std::max(1, nbIter)),
+                                                    std::ceil(10.0 * costs.batchOverhead / scan));
+            data.batchSize = std::max(1, data.batchSize);
+            const double nbBatches = std::ceil(iterations / data.batchSize);
+            data.predictedTime = nbBatches * costs.batchOverhead + iterations * (costs.model + scan);
+            double margin = best.strategy == ParallelStrategy::Serial ? parallelMargin() : 1.0;
+            if (data.predictedTime * margin < best.predictedTime)
+                best = data;
+        }
+        return best;
+    }
+
+    // Profile: one line per problem type, "residual batchResidual batchOverhead model
+    // type". False if the file cannot be written.
+    bool save(const std::string & path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        std::lock_guard<std::mutex> guard(mutex);
+        file.precision(17);
+        file << "# robest tuner profile: residual batchResidual batchOverhead model (seconds) type\n";
+        for (const auto & entry : profile)
+        {
+            const ProblemCosts & costs = entry.second;
+            file << costs.residual << " " << costs.batchResidual << " "
+                 << costs.batchOverhead << " " << costs.model << " " << entry.first << "\n";
+        }
+        return (bool) file;
+    }
+
+    // Adds the costs of a profile written by save(), replacing those of the same
+    // types. False if the file cannot be read or a line is malformed.
+    bool load(const std::string & path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+
+        std::map<std::string, ProblemCosts> loaded;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream fields(line);
+            ProblemCosts costs;
+            std::string type;
+            if (!(fields >> costs.residual >> costs.batchResidual >> costs.batchOverhead >> costs.model))
+                return false;
+            std::getline(fields >> std::ws, type);
+            if (type.empty() || costs.residual < 0.0 || costs.batchResidual < 0.0
+                || costs.batchOverhead < 0.0 || costs.model < 0.0)
+                return false;
+            loaded[type] = costs;
+        }
+
+        std::lock_guard<std::mutex> guard(mutex);
+        for (const auto & entry : loaded)
+            profile[entry.first] = entry.second;
+        return true;
+    }
+
+    // Tuner of the estimators, unless they are given another one
+    static ParallelTuner & global()
+    {
+        static ParallelTuner tuner;
+        return tuner;
+    }
+
+  private:
+    // Mean of a few empty regions, once the threads exist
+    static double measureRegionCost()
+    {
+        typedef std::chrono::steady_clock Clock;
+        const int nbRegions = 32;
+
+        #pragma omp parallel
+        {
+        }
+
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < nbRegions; ++r)
+        {
+            #pragma omp parallel
+            {
+            }
+        }
+        return std::chrono::duration<double>(Clock::now() - start).count() / nbRegions;
+    }
+
+    mutable std::mutex mutex;
+    std::map<std::string, ProblemCosts> profile;
+    double regionCost = -1.0;
+};
+
+} // namespace robest
+
+#endif // ROBUST_TUNER_H
@@ -1,4 +1,5 @@
 #include "CircleFitting.hpp"
+#include "robust_linalg.hpp"
 
 CircleFittingProblem::CircleFittingProblem(){
     setNbParams(3);
@@ -47,6 +48,72 @@ inline void CircleFittingProblem::estimModelFromSamples(const std::vector<int> &
     }
 }
 
+void CircleFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    // weighted algebraic fit (Kasa): x^2 + y^2 + D*x + E*y + F = 0,
+    // on coordinates centered at the weighted centroid for conditioning
+    double sw = 0, mx = 0, my = 0;
+    for (int i = 0; i < samplesIdx.size(); i++){
+        const Point2d & p = points[samplesIdx[i]];
+        sw += weights[i];
+        mx += weights[i] * p.x;
+        my += weights[i] * p.y;
+    }
+    if (sw <= 0) return;
+    mx /= sw;
+    my /= sw;
+
+    std::vector<double> M(9, 0.0), v(3, 0.0);
+    for (int i = 0; i < samplesIdx.size(); i++){
+        const Point2d & p = points[samplesIdx[i]];
+        const double row[3] = {p.x - mx, p.y - my, 1.0};
+        const double z = row[0] * row[0] + row[1] * row[1];
+        for (int r = 0; r < 3; r++){
+            for (int c = 0; c < 3; c++)
+                M[r * 3 + c] += weights[i] * row[r] * row[c];
+            v[r] -= weights[i] * z * row[r];
+        }
+    }
+
+    std::vector<double> u;
+    if (!robest::linalg::solve(M, v, 3, u)) return;
+
+    double ux = -0.5 * u[0], uy = -0.5 * u[1];
+    double r2 = ux * ux + uy * uy - u[2];
+    if (r2 <= 0) return;
+
+    cx = ux + mx;
+    cy = uy + my;
+    r  = std::sqrt(r2);
+}
+
+bool CircleFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params = {cx, cy, r};
+    return true;
+}
+
+bool CircleFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 3) return false;
+    cx = params[0];
+    cy = params[1];
+    r  = params[2];
+    return true;
+}
+
+bool CircleFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 3) return false;
+    const double cx = params[0], cy = params[1], r = params[2];
+    for (int i = begin; i < end; ++i)
+    {
+        const Point2d & p = points[i];
+        errors[i - begin] = std::abs(sqrt((p.x-cx)*(p.x-cx)+(p.y-cy)*(p.y-cy)) - r);
+    }
+    return true;
+}
+
 
 
 
@@ -31,11 +31,17 @@ public:
 
     double estimErrorForSample(int i);
     void   estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void   estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
 
     int getTotalNbSamples() const{
         return (int) points.size();
     }
 
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+
     void getResult(double & res_cx, double & res_cy, double & res_r) const{
         res_cx = this->cx;
         res_cy = this->cy;
@@ -57,7 +63,7 @@ public:
         double h = (K.y-P.y)/(K.x-P.x);
 
         //3. PV and PK Are colineaire if and only if f = h
-        return ( f - h < 1e-3 );
+        return ( std::fabs(f - h) < 1e-3 );
     }
 
 private:
@@ -0,0 +1,189 @@
+#include "CylinderFitting.hpp"
+#include "robust_linalg.hpp"
+
+CylinderFittingProblem::CylinderFittingProblem(){
+    setNbParams(7);
+    setNbMinSamples(2);
+}
+
+CylinderFittingProblem::~CylinderFittingProblem(){
+
+}
+
+void CylinderFittingProblem::setData(const std::vector<double> & x, const std::vector<double> & y, const std::vector<double> & z,
+                                     const std::vector<double> & nx, const std::vector<double> & ny, const std::vector<double> & nz)
+{
+    assert(x.size() == y.size() && x.size() == z.size() && x.size() == nx.size() &&
+           nx.size() == ny.size() && nx.size() == nz.size() && "Points and normals of different sizes");
+    this->x = x;
+    this->y = y;
+    this->z = z;
+    this->nx = nx;
+    this->ny = ny;
+    this->nz = nz;
+
+    for (int i = 0; i < this->nx.size(); i++){
+        double norm = sqrt(this->nx[i] * this->nx[i] + this->ny[i] * this->ny[i] + this->nz[i] * this->nz[i]);
+        if (norm == 0) norm = 1;
+        this->nx[i] /= norm;
+        this->ny[i] /= norm;
+        this->nz[i] /= norm;
+    }
+}
+
+double CylinderFittingProblem::estimErrorForSample(int i)
+{
+    const double v[3] = {x[i] - c[0], y[i] - c[1], z[i] - c[2]};
+    const double h = v[0] * a[0] + v[1] * a[1] + v[2] * a[2];
+    const double len = sqrt(std::max(0.0, v[0] * v[0] + v[1] * v[1] + v[2] * v[2] - h * h));
+    const double dot = nx[i] * v[0] + ny[i] * v[1] + nz[i] * v[2] - h * (nx[i] * a[0] + ny[i] * a[1] + nz[i] * a[2]);
+    const double deviation = 1.0 - std::fabs(dot) / std::max(len, 1e-300);
+    return std::max(std::fabs(len - r), normalWeight * deviation);
+}
+
+void CylinderFittingProblem::estimModelFromSamples(const std::vector<int> & samplesIdx)
+{
+    if (samplesIdx.size() > 2){
+        estimModelFromWeightedSamples(samplesIdx, std::vector<double>(samplesIdx.size(), 1.0));
+        return;
+    }
+    if (samplesIdx.size() < 2)
+        return;
+
+    const int i = samplesIdx[0], j = samplesIdx[1];
+    double axis[3] = {ny[i] * nz[j] - nz[i] * ny[j], nz[i] * nx[j] - nx[i] * nz[j], nx[i] * ny[j] - ny[i] * nx[j]};
+    const double norm = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (norm == 0) return;
+
+    // closest points of the lines p1 + s*n1 and p2 + t*n2, both orthogonal to the
+    // axis: they only differ along the axis
+    const double w[3] = {x[i] - x[j], y[i] - y[j], z[i] - z[j]};
+    const double B = nx[i] * nx[j] + ny[i] * ny[j] + nz[i] * nz[j];
+    const double D = nx[i] * w[0] + ny[i] * w[1] + nz[i] * w[2];
+    const double E = nx[j] * w[0] + ny[j] * w[1] + nz[j] * w[2];
+    const double denom = 1.0 - B * B;
+    if (denom <= 0) return;
+    const double s = (B * E - D) / denom;
+    const double t = (E - B * D) / denom;
+
+    for (int k = 0; k < 3; k++)
+        a[k] = axis[k] / norm;
+    c[0] = 0.5 * (x[i] + s * nx[i] + x[j] + t * nx[j]);
+    c[1] = 0.5 * (y[i] + s * ny[i] + y[j] + t * ny[j]);
+    c[2] = 0.5 * (z[i] + s * nz[i] + z[j] + t * nz[j]);
+    r = 0.5 * (std::fabs(s) + std::fabs(t));
+}
+
+bool CylinderFittingProblem::isDegenerate(const std::vector<int> & samplesIdx)
+{
+    const int i = samplesIdx[0], j = samplesIdx[1];
+    const double B = nx[i] * nx[j] + ny[i] * ny[j] + nz[i] * nz[j];
+    // sin^2 of the angle between the normals: the solve is ill-conditioned below 0.1 rad
+    return 1.0 - B * B < 1e-2;
+}
+
+void CylinderFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    // axis: the eigenvector of the smallest eigenvalue of sum w_i n_i n_i^T
+    std::vector<double> N(9, 0.0);
+    double sw = 0.0, o[3] = {0.0, 0.0, 0.0};
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        const double n[3] = {nx[i], ny[i], nz[i]};
+        for (int row = 0; row < 3; row++)
+            for (int col = 0; col < 3; col++)
+                N[row * 3 + col] += weights[k] * n[row] * n[col];
+        sw += weights[k];
+        o[0] += weights[k] * x[i];
+        o[1] += weights[k] * y[i];
+        o[2] += weights[k] * z[i];
+    }
+    if (sw <= 0) return;
+    for (int k = 0; k < 3; k++)
+        o[k] /= sw;
+
+    const std::vector<double> axis = robest::linalg::smallestEigenvector(N, 3);
+
+    // basis (e1, e2) of the plane orthogonal to the axis
+    double e1[3] = {0.0, 0.0, 0.0};
+    e1[std::fabs(axis[0]) < 0.9 ? 0 : 1] = 1.0;
+    const double proj = e1[0] * axis[0] + e1[1] * axis[1] + e1[2] * axis[2];
+    for (int k = 0; k < 3; k++)
+        e1[k] -= proj * axis[k];
+    const double n1 = sqrt(e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]);
+    for (int k = 0; k < 3; k++)
+        e1[k] /= n1;
+    const double e2[3] = {axis[1] * e1[2] - axis[2] * e1[1], axis[2] * e1[0] - axis[0] * e1[2], axis[0] * e1[1] - axis[1] * e1[0]};
+
+    // algebraic circle fit of the projected points: |q|^2 + D.q + G = 0
+    std::vector<double> M(9, 0.0), rhs(3, 0.0), sol;
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        const double p[3] = {x[i] - o[0], y[i] - o[1], z[i] - o[2]};
+        const double v[3] = {p[0] * e1[0] + p[1] * e1[1] + p[2] * e1[2], p[0] * e2[0] + p[1] * e2[1] + p[2] * e2[2], 1.0};
+        const double q = v[0] * v[0] + v[1] * v[1];
+        for (int row = 0; row < 3; row++){
+            for (int col = 0; col < 3; col++)
+                M[row * 3 + col] += weights[k] * v[row] * v[col];
+            rhs[row] -= weights[k] * q * v[row];
+        }
+    }
+    if (!robest::linalg::solve(M, rhs, 3, sol)) return;
+
+    const double u = -0.5 * sol[0], v = -0.5 * sol[1];
+    const double r2 = u * u + v * v - sol[2];
+    if (r2 <= 0) return;
+    for (int k = 0; k < 3; k++){
+        a[k] = axis[k];
+        c[k] = o[k] + u * e1[k] + v * e2[k];
+    }
+    r = sqrt(r2);
+}
+
+bool CylinderFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params = {c[0], c[1], c[2], a[0], a[1], a[2], r};
+    return true;
+}
+
+bool CylinderFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 7) return false;
+    c.assign(params.begin(), params.begin() + 3);
+    a.assign(params.begin() + 3, params.begin() + 6);
+    r = params[6];
+    return true;
+}
+
+bool CylinderFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 7) return false;
+    computeErrors(params.data(), begin, end, errors);
+    return true;
+}
+
+void CylinderFittingProblem::computeErrors(const double * params, int begin, int end, double * errors) const
+{
+    const double pcx = params[0], pcy = params[1], pcz = params[2];
+    const double ax = params[3], ay = params[4], az = params[5], pr = params[6];
+    const double w = normalWeight;
+    const double * px = x.data();
+    const double * py = y.data();
+    const double * pz = z.data();
+    const double * qx = nx.data();
+    const double * qy = ny.data();
+    const double * qz = nz.data();
+    double * out = errors - begin;
+
+    #pragma omp simd
+    for (int i = begin; i < end; ++i)
+    {
+        const double vx = px[i] - pcx, vy = py[i] - pcy, vz = pz[i] - pcz;
+        const double h = vx * ax + vy * ay + vz * az;
+        // n.(v - h*a): the normal against the radial vector
+        const double dot = qx[i] * vx + qy[i] * vy + qz[i] * vz - h * (qx[i] * ax + qy[i] * ay + qz[i] * az);
+        const double len = std::sqrt(std::max(0.0, vx * vx + vy * vy + vz * vz - h * h));
+        const double deviation = 1.0 - std::fabs(dot) / std::max(len, 1e-300);
+        out[i] = std::max(std::fabs(len - pr), w * deviation);
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ *  @brief Cylinder fitting to a set of 3D points with normals
+ *
+ *  The model is the cylinder of radius r around the axis through c with the unit
+ *  direction a. Two oriented points are a minimal sample: the normals of a cylinder
+ *  are orthogonal to its axis, so a = n1 x n2, and the axis passes through the
+ *  middle of the closest points of the lines through the points along their normals.
+ *  Larger sets (refit on the inliers) take the axis from the normals (the direction
+ *  most orthogonal to them) and fit a circle to the points projected along it.
+ *
+ *  The error of a sample combines the distance to the cylinder and the deviation of
+ *  its normal n from the radial direction u:
+ *      max(distance, normalWeight * (1 - |n.u|))
+ *  1 - |n.u| is about angle^2 / 2 for small angles. normalWeight = 0 ignores the
+ *  normals when scoring (the refit still uses them).
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "robust_estim.hpp"
+
+class CylinderFittingProblem : public robest::EstimationProblem{
+
+public:
+    CylinderFittingProblem();
+    ~CylinderFittingProblem();
+
+    // Points and their normals, normalized here
+    void setData(const std::vector<double> & x, const std::vector<double> & y, const std::vector<double> & z,
+                 const std::vector<double> & nx, const std::vector<double> & ny, const std::vector<double> & nz);
+
+    // 1 by default
+    void setNormalWeight(double weight) { normalWeight = weight; }
+
+    double estimErrorForSample(int i);
+    void estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
+
+    int getTotalNbSamples() const{
+        return (int) x.size();
+    }
+
+    // res_c: point of the axis, res_a: unit direction of the axis
+    void getResult(std::vector<double> & res_c, std::vector<double> & res_a, double & res_r) const{
+        res_c = c;
+        res_a = a;
+        res_r = r;
+    }
+
+    // Normals less than 0.1 rad apart: the axis is barely determined
+    bool isDegenerate(const std::vector<int> & samplesIdx);
+
+    // params: c (3 values), a (3 values), r
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+
+private:
+    // Data
+    std::vector<double> x, y, z;
+    std::vector<double> nx, ny, nz;
+
+    // Model
+    std::vector<double> c = {0.0, 0.0, 0.0};
+    std::vector<double> a = {0.0, 0.0, 1.0};
+    double r = 0.0;
+
+    double normalWeight = 1.0;
+
+    void computeErrors(const double * params, int begin, int end, double * errors) const;
+};
@@ -0,0 +1,243 @@
+#include "HomographyFitting.hpp"
+#include "robust_linalg.hpp"
+
+namespace {
+
+// Hartley normalization of weighted points: translation of the centroid to the
+// origin and scaling to a mean distance of sqrt(2). x' = k * (x - cx)
+struct Normalization
+{
+    double cx = 0.0, cy = 0.0, k = 1.0;
+
+    bool fit(const std::vector<double> & x, const std::vector<double> & y,
+             const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+    {
+        double sw = 0.0;
+        cx = cy = 0.0;
+        for (int j = 0; j < samplesIdx.size(); j++){
+            sw += weights[j];
+            cx += weights[j] * x[samplesIdx[j]];
+            cy += weights[j] * y[samplesIdx[j]];
+        }
+        if (sw <= 0) return false;
+        cx /= sw;
+        cy /= sw;
+
+        double meanDist = 0.0;
+        for (int j = 0; j < samplesIdx.size(); j++)
+            meanDist += weights[j] * sqrt((x[samplesIdx[j]] - cx) * (x[samplesIdx[j]] - cx) + (y[samplesIdx[j]] - cy) * (y[samplesIdx[j]] - cy));
+        meanDist /= sw;
+        if (meanDist <= 0) return false;
+        k = sqrt(2.0) / meanDist;
+        return true;
+    }
+};
+
+// H = Tdst^-1 * Hn * Tsrc, scaled so that H[8] = 1. H is unchanged if H[8] = 0
+void denormalize(const std::vector<double> & Hn, const Normalization & src, const Normalization & dst,
+                 std::vector<double> & H)
+{
+    double Hs[9], D[9];
+    for (int r = 0; r < 3; r++){
+        Hs[r * 3 + 0] = src.k * Hn[r * 3 + 0];
+        Hs[r * 3 + 1] = src.k * Hn[r * 3 + 1];
+        Hs[r * 3 + 2] = Hn[r * 3 + 2] - src.k * (src.cx * Hn[r * 3 + 0] + src.cy * Hn[r * 3 + 1]);
+    }
+    for (int c = 0; c < 3; c++){
+        D[0 + c] = Hs[0 + c] / dst.k + dst.cx * Hs[6 + c];
+        D[3 + c] = Hs[3 + c] / dst.k + dst.cy * Hs[6 + c];
+        D[6 + c] = Hs[6 + c];
+    }
+    if (D[8] == 0.0) return;
+    for (int k = 0; k < 9; k++)
+        H[k] = D[k] / D[8];
+}
+
+// Twice the signed area of the triangle (a, b, c); zero if it is flat
+double orientation(const double a[2], const double b[2], const double c[2])
+{
+    const double ux = b[0] - a[0], uy = b[1] - a[1];
+    const double vx = c[0] - a[0], vy = c[1] - a[1];
+    const double cross = ux * vy - uy * vx;
+    if (cross * cross <= 1e-12 * (ux * ux + uy * uy) * (vx * vx + vy * vy))
+        return 0.0;
+    return cross;
+}
+
+// Squared distances between H(x, y) and (u, v), one correspondence per SIMD lane
+void transferErrors2(const double * h, const double * x, const double * y, const double * u, const double * v,
+                     int n, bool accumulate, double * errors2)
+{
+    const double h0 = h[0], h1 = h[1], h2 = h[2];
+    const double h3 = h[3], h4 = h[4], h5 = h[5];
+    const double h6 = h[6], h7 = h[7], h8 = h[8];
+
+    #pragma omp simd
+    for (int i = 0; i < n; ++i)
+    {
+        const double w = h6 * x[i] + h7 * y[i] + h8;
+        const double du = (h0 * x[i] + h1 * y[i] + h2) / w - u[i];
+        const double dv = (h3 * x[i] + h4 * y[i] + h5) / w - v[i];
+        errors2[i] = (accumulate ? errors2[i] : 0.0) + du * du + dv * dv;
+    }
+}
+
+} // namespace
+
+HomographyFittingProblem::HomographyFittingProblem(){
+    setNbParams(9);
+    setNbMinSamples(4);
+}
+
+HomographyFittingProblem::~HomographyFittingProblem(){
+
+}
+
+void HomographyFittingProblem::setData(const std::vector<double> & srcX, const std::vector<double> & srcY,
+                                       const std::vector<double> & dstX, const std::vector<double> & dstY)
+{
+    assert(srcX.size() == srcY.size() && srcX.size() == dstX.size() && dstX.size() == dstY.size() &&
+           "Correspondences of different sizes");
+    this->srcX = srcX;
+    this->srcY = srcY;
+    this->dstX = dstX;
+    this->dstY = dstY;
+}
+
+double HomographyFittingProblem::estimErrorForSample(int i)
+{
+    double error = 0.0;
+    estimErrorsForModel(H, i, i + 1, &error);
+    return error;
+}
+
+void HomographyFittingProblem::estimModelFromSamples(const std::vector<int> & samplesIdx)
+{
+    if (samplesIdx.size() > 4){
+        estimModelFromWeightedSamples(samplesIdx, std::vector<double>(samplesIdx.size(), 1.0));
+        return;
+    }
+    if (samplesIdx.size() < 4)
+        return;
+
+    const std::vector<double> ones(4, 1.0);
+    Normalization src, dst;
+    if (!src.fit(srcX, srcY, samplesIdx, ones) || !dst.fit(dstX, dstY, samplesIdx, ones))
+        return;
+
+    // 8 equations of the DLT, solved with Hn[8] = 1
+    std::vector<double> A(64), b(8), h;
+    for (int k = 0; k < 4; k++){
+        const int i = samplesIdx[k];
+        const double x = src.k * (srcX[i] - src.cx), y = src.k * (srcY[i] - src.cy);
+        const double u = dst.k * (dstX[i] - dst.cx), v = dst.k * (dstY[i] - dst.cy);
+        const double r1[8] = {0.0, 0.0, 0.0, -x, -y, -1.0, v * x, v * y};
+        const double r2[8] = {x, y, 1.0, 0.0, 0.0, 0.0, -u * x, -u * y};
+        std::copy(r1, r1 + 8, A.begin() + (2 * k) * 8);
+        std::copy(r2, r2 + 8, A.begin() + (2 * k + 1) * 8);
+        b[2 * k] = -v;
+        b[2 * k + 1] = u;
+    }
+    if (!robest::linalg::solve(A, b, 8, h)){
+        // Hn[8] = 0: the centroid is mapped to infinity, take the general DLT
+        estimModelFromWeightedSamples(samplesIdx, ones);
+        return;
+    }
+    h.push_back(1.0);
+
+    denormalize(h, src, dst, H);
+}
+
+bool HomographyFittingProblem::isDegenerate(const std::vector<int> & samplesIdx)
+{
+    // triplets of the 4 points, the orientation of each one should be preserved by
+    // H, or reversed for all of them (mirror)
+    static const int triplets[4][3] = {{0, 1, 2}, {1, 2, 3}, {0, 2, 3}, {0, 1, 3}};
+
+    double p[4][2], q[4][2];
+    for (int k = 0; k < 4; k++){
+        const int i = samplesIdx[k];
+        p[k][0] = srcX[i]; p[k][1] = srcY[i];
+        q[k][0] = dstX[i]; q[k][1] = dstY[i];
+    }
+
+    int nbReversed = 0;
+    for (int k = 0; k < 4; k++){
+        const double op = orientation(p[triplets[k][0]], p[triplets[k][1]], p[triplets[k][2]]);
+        const double oq = orientation(q[triplets[k][0]], q[triplets[k][1]], q[triplets[k][2]]);
+        if (op == 0.0 || oq == 0.0)
+            return true;
+        if ((op > 0) != (oq > 0))
+            nbReversed++;
+    }
+    return nbReversed != 0 && nbReversed != 4;
+}
+
+void HomographyFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    if (samplesIdx.size() < 4)
+        return;
+
+    Normalization src, dst;
+    if (!src.fit(srcX, srcY, samplesIdx, weights) || !dst.fit(dstX, dstY, samplesIdx, weights))
+        return;
+
+    // normalized DLT: Hn is the unit vector minimizing sum w_i |A_i h|^2, the
+    // eigenvector of the smallest eigenvalue of sum w_i A_i^T A_i
+    std::vector<double> M(81, 0.0);
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        const double x = src.k * (srcX[i] - src.cx), y = src.k * (srcY[i] - src.cy);
+        const double u = dst.k * (dstX[i] - dst.cx), v = dst.k * (dstY[i] - dst.cy);
+        const double r1[9] = {0.0, 0.0, 0.0, -x, -y, -1.0, v * x, v * y, v};
+        const double r2[9] = {x, y, 1.0, 0.0, 0.0, 0.0, -u * x, -u * y, -u};
+        for (int r = 0; r < 9; r++)
+            for (int c = r; c < 9; c++)
+                M[r * 9 + c] += weights[k] * (r1[r] * r1[c] + r2[r] * r2[c]);
+    }
+    for (int r = 0; r < 9; r++)
+        for (int c = 0; c < r; c++)
+            M[r * 9 + c] = M[c * 9 + r];
+
+    const std::vector<double> h = robest::linalg::smallestEigenvector(M, 9);
+
+    denormalize(h, src, dst, H);
+}
+
+bool HomographyFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params = H;
+    return true;
+}
+
+bool HomographyFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 9) return false;
+    H = params;
+    return true;
+}
+
+bool HomographyFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 9) return false;
+
+    const int n = end - begin;
+    transferErrors2(params.data(), srcX.data() + begin, srcY.data() + begin, dstX.data() + begin, dstY.data() + begin,
+                    n, false, errors);
+
+    if (symmetricError){
+        // H^-1 up to a scale factor: the adjugate of H
+        const double * h = params.data();
+        const double G[9] = {h[4] * h[8] - h[5] * h[7], h[2] * h[7] - h[1] * h[8], h[1] * h[5] - h[2] * h[4],
+                             h[5] * h[6] - h[3] * h[8], h[0] * h[8] - h[2] * h[6], h[2] * h[3] - h[0] * h[5],
+                             h[3] * h[7] - h[4] * h[6], h[1] * h[6] - h[0] * h[7], h[0] * h[4] - h[1] * h[3]};
+        transferErrors2(G, dstX.data() + begin, dstY.data() + begin, srcX.data() + begin, srcY.data() + begin,
+                        n, true, errors);
+    }
+
+    // the transfer errors are summed squared
+    #pragma omp simd
+    for (int i = 0; i < n; ++i)
+        errors[i] = std::sqrt(errors[i]);
+    return true;
+}
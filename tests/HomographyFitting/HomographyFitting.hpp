@@ -0,0 +1,65 @@
+/**
+ *  @brief Homography between two sets of 2D points
+ *
+ *  Samples are correspondences (p_i, q_i) of image points. The model is the 3x3
+ *  matrix H (row-major, H[8] = 1) mapping p on q in homogeneous coordinates. The
+ *  error of a correspondence is the reprojection error || H(p_i) - q_i ||, or the
+ *  symmetric transfer error sqrt(|| H(p_i) - q_i ||^2 + || H^-1(q_i) - p_i ||^2).
+ *
+ *  Minimal samples of 4 correspondences and larger sets (refit on the inliers) are
+ *  both solved by the direct linear transform on Hartley normalized coordinates.
+ *  Points are stored as structure of arrays so that the batched errors are computed
+ *  by a vectorized loop.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "robust_estim.hpp"
+
+class HomographyFittingProblem : public robest::EstimationProblem{
+
+public:
+    HomographyFittingProblem();
+    ~HomographyFittingProblem();
+
+    // Correspondences (src[i], dst[i]), given as coordinate arrays
+    void setData(const std::vector<double> & srcX, const std::vector<double> & srcY,
+                 const std::vector<double> & dstX, const std::vector<double> & dstY);
+
+    // Symmetric transfer error instead of the reprojection error (false by default)
+    void setSymmetricError(bool enable) { symmetricError = enable; }
+
+    double estimErrorForSample(int i);
+    void estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
+
+    int getTotalNbSamples() const{
+        return (int) srcX.size();
+    }
+
+    // H row-major
+    void getResult(std::vector<double> & resH) const{
+        resH = H;
+    }
+
+    // Collinear triplets on either side, or a sample that H would fold (orientations
+    // of the triplets preserved for some and reversed for others)
+    bool isDegenerate(const std::vector<int> & samplesIdx);
+
+    // params: H (9 values, row-major)
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+
+private:
+    // Data
+    std::vector<double> srcX, srcY;
+    std::vector<double> dstX, dstY;
+
+    // Model
+    std::vector<double> H = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+
+    bool symmetricError = false;
+};
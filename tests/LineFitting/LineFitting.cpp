@@ -1,4 +1,5 @@
 #include "LineFitting.hpp"
+#include "robust_linalg.hpp"
 
 LineFittingProblem::LineFittingProblem()
 {
@@ -39,6 +40,63 @@ inline void LineFittingProblem::estimModelFromSamples(const std::vector<int> & s
     b = P.y -a * P.x;
 }
 
+void LineFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    // weighted total least squares: the line goes through the weighted centroid and
+    // its normal is the eigenvector of the smallest eigenvalue of the covariance
+    double sw = 0, mx = 0, my = 0;
+    for (int i = 0; i < samplesIdx.size(); i++){
+        const Point2d & p = points[samplesIdx[i]];
+        sw += weights[i];
+        mx += weights[i] * p.x;
+        my += weights[i] * p.y;
+    }
+    if (sw <= 0) return;
+    mx /= sw;
+    my /= sw;
+
+    double sxx = 0, sxy = 0, syy = 0;
+    for (int i = 0; i < samplesIdx.size(); i++){
+        const Point2d & p = points[samplesIdx[i]];
+        sxx += weights[i] * (p.x - mx) * (p.x - mx);
+        sxy += weights[i] * (p.x - mx) * (p.y - my);
+        syy += weights[i] * (p.y - my) * (p.y - my);
+    }
+
+    std::vector<double> n = robest::linalg::smallestEigenvector({sxx, sxy, sxy, syy}, 2);
+    if (std::fabs(n[1]) < 1e-12) return; // vertical line: not representable as y = a*x + b
+
+    a = -n[0] / n[1];
+    b = my - a * mx;
+}
+
+bool LineFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params = {a, b};
+    return true;
+}
+
+bool LineFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 2) return false;
+    a = params[0];
+    b = params[1];
+    return true;
+}
+
+bool LineFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 2) return false;
+    const double a = params[0], b = params[1];
+    const double invNorm = 1.0 / sqrt(a*a + 1);
+    for (int i = begin; i < end; ++i)
+    {
+        const Point2d & p = points[i];
+        errors[i - begin] = std::fabs(a*p.x - p.y + b) * invNorm;
+    }
+    return true;
+}
+
 
 
 
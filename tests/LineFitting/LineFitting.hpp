@@ -31,11 +31,17 @@ public:
 
     double estimErrorForSample(int i);
     void estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
 
     int getTotalNbSamples() const{
         return (int) points.size();
     }
 
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+
     void getResult(double & resa, double & resb){
         resa = this->a;
         resb = this->b;
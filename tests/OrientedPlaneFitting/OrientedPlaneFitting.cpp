@@ -0,0 +1,139 @@
+#include "OrientedPlaneFitting.hpp"
+#include "robust_linalg.hpp"
+
+OrientedPlaneFittingProblem::OrientedPlaneFittingProblem(){
+    setNbParams(4);
+    setNbMinSamples(1);
+}
+
+OrientedPlaneFittingProblem::~OrientedPlaneFittingProblem(){
+
+}
+
+void OrientedPlaneFittingProblem::setData(const std::vector<double> & x, const std::vector<double> & y, const std::vector<double> & z,
+                                          const std::vector<double> & nx, const std::vector<double> & ny, const std::vector<double> & nz)
+{
+    assert(x.size() == y.size() && x.size() == z.size() && x.size() == nx.size() &&
+           nx.size() == ny.size() && nx.size() == nz.size() && "Points and normals of different sizes");
+    this->x = x;
+    this->y = y;
+    this->z = z;
+    this->nx = nx;
+    this->ny = ny;
+    this->nz = nz;
+
+    for (int i = 0; i < this->nx.size(); i++){
+        double norm = sqrt(this->nx[i] * this->nx[i] + this->ny[i] * this->ny[i] + this->nz[i] * this->nz[i]);
+        if (norm == 0) norm = 1;
+        this->nx[i] /= norm;
+        this->ny[i] /= norm;
+        this->nz[i] /= norm;
+    }
+}
+
+double OrientedPlaneFittingProblem::estimErrorForSample(int i)
+{
+    const double dist = std::fabs(a * x[i] + b * y[i] + c * z[i] + d);
+    const double deviation = 1.0 - std::fabs(a * nx[i] + b * ny[i] + c * nz[i]);
+    return std::max(dist, normalWeight * deviation);
+}
+
+void OrientedPlaneFittingProblem::estimModelFromSamples(const std::vector<int> & samplesIdx)
+{
+    if (samplesIdx.size() > 1){
+        estimModelFromWeightedSamples(samplesIdx, std::vector<double>(samplesIdx.size(), 1.0));
+        return;
+    }
+    if (samplesIdx.empty())
+        return;
+
+    // the plane through the point, orthogonal to its normal
+    const int i = samplesIdx[0];
+    a = nx[i];
+    b = ny[i];
+    c = nz[i];
+    d = -(a * x[i] + b * y[i] + c * z[i]);
+}
+
+bool OrientedPlaneFittingProblem::isDegenerate(const std::vector<int> & samplesIdx)
+{
+    const int i = samplesIdx[0];
+    return nx[i] * nx[i] + ny[i] * ny[i] + nz[i] * nz[i] == 0.0;
+}
+
+void OrientedPlaneFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    // total least squares: the normal is the eigenvector of the smallest eigenvalue
+    // of the weighted covariance of the points
+    double sw = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        sw += weights[k];
+        cx += weights[k] * x[i];
+        cy += weights[k] * y[i];
+        cz += weights[k] * z[i];
+    }
+    if (sw <= 0) return;
+    cx /= sw;
+    cy /= sw;
+    cz /= sw;
+
+    std::vector<double> cov(9, 0.0);
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        const double p[3] = {x[i] - cx, y[i] - cy, z[i] - cz};
+        for (int r = 0; r < 3; r++)
+            for (int col = 0; col < 3; col++)
+                cov[r * 3 + col] += weights[k] * p[r] * p[col];
+    }
+
+    const std::vector<double> normal = robest::linalg::smallestEigenvector(cov, 3);
+    a = normal[0];
+    b = normal[1];
+    c = normal[2];
+    d = -(a * cx + b * cy + c * cz);
+}
+
+bool OrientedPlaneFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params = {a, b, c, d};
+    return true;
+}
+
+bool OrientedPlaneFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 4) return false;
+    a = params[0];
+    b = params[1];
+    c = params[2];
+    d = params[3];
+    return true;
+}
+
+bool OrientedPlaneFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 4) return false;
+    computeErrors(params.data(), begin, end, errors);
+    return true;
+}
+
+void OrientedPlaneFittingProblem::computeErrors(const double * params, int begin, int end, double * errors) const
+{
+    const double pa = params[0], pb = params[1], pc = params[2], pd = params[3];
+    const double w = normalWeight;
+    const double * px = x.data();
+    const double * py = y.data();
+    const double * pz = z.data();
+    const double * qx = nx.data();
+    const double * qy = ny.data();
+    const double * qz = nz.data();
+    double * out = errors - begin;
+
+    #pragma omp simd
+    for (int i = begin; i < end; ++i)
+    {
+        const double dist = std::fabs(pa * px[i] + pb * py[i] + pc * pz[i] + pd);
+        const double deviation = 1.0 - std::fabs(pa * qx[i] + pb * qy[i] + pc * qz[i]);
+        out[i] = std::max(dist, w * deviation);
+    }
+}
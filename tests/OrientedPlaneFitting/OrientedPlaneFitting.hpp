@@ -0,0 +1,71 @@
+/**
+ *  @brief Plane fitting to a set of 3D points with normals
+ *
+ *  The model is the plane a*x + b*y + c*z + d = 0 with (a, b, c) of unit norm. One
+ *  oriented point is a minimal sample: the plane through the point, orthogonal to
+ *  its normal. Larger sets (refit on the inliers) are fitted on the points only,
+ *  by weighted total least squares.
+ *
+ *  The error of a sample combines the distance to the plane and the deviation of
+ *  its normal n from the plane normal m:
+ *      max(distance, normalWeight * (1 - |n.m|))
+ *  1 - |n.m| is about angle^2 / 2 for small angles. normalWeight = 0 ignores the
+ *  normals when scoring.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "robust_estim.hpp"
+
+class OrientedPlaneFittingProblem : public robest::EstimationProblem{
+
+public:
+    OrientedPlaneFittingProblem();
+    ~OrientedPlaneFittingProblem();
+
+    // Points and their normals, normalized here
+    void setData(const std::vector<double> & x, const std::vector<double> & y, const std::vector<double> & z,
+                 const std::vector<double> & nx, const std::vector<double> & ny, const std::vector<double> & nz);
+
+    // 1 by default
+    void setNormalWeight(double weight) { normalWeight = weight; }
+
+    double estimErrorForSample(int i);
+    void estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
+
+    int getTotalNbSamples() const{
+        return (int) x.size();
+    }
+
+    void getResult(double & resa, double & resb, double & resc, double & resd) const{
+        resa = a;
+        resb = b;
+        resc = c;
+        resd = d;
+    }
+
+    bool isDegenerate(const std::vector<int> & samplesIdx);
+
+    // params: a, b, c, d
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+
+private:
+    // Data
+    std::vector<double> x, y, z;
+    std::vector<double> nx, ny, nz;
+
+    // Model
+    double a = 0.0;
+    double b = 0.0;
+    double c = 1.0;
+    double d = 0.0;
+
+    double normalWeight = 1.0;
+
+    void computeErrors(const double * params, int begin, int end, double * errors) const;
+};
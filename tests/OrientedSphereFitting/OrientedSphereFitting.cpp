@@ -0,0 +1,161 @@
+#include "OrientedSphereFitting.hpp"
+#include "robust_linalg.hpp"
+
+OrientedSphereFittingProblem::OrientedSphereFittingProblem(){
+    setNbParams(4);
+    setNbMinSamples(2);
+}
+
+OrientedSphereFittingProblem::~OrientedSphereFittingProblem(){
+
+}
+
+void OrientedSphereFittingProblem::setData(const std::vector<double> & x, const std::vector<double> & y, const std::vector<double> & z,
+                                           const std::vector<double> & nx, const std::vector<double> & ny, const std::vector<double> & nz)
+{
+    assert(x.size() == y.size() && x.size() == z.size() && x.size() == nx.size() &&
+           nx.size() == ny.size() && nx.size() == nz.size() && "Points and normals of different sizes");
+    this->x = x;
+    this->y = y;
+    this->z = z;
+    this->nx = nx;
+    this->ny = ny;
+    this->nz = nz;
+
+    for (int i = 0; i < this->nx.size(); i++){
+        double norm = sqrt(this->nx[i] * this->nx[i] + this->ny[i] * this->ny[i] + this->nz[i] * this->nz[i]);
+        if (norm == 0) norm = 1;
+        this->nx[i] /= norm;
+        this->ny[i] /= norm;
+        this->nz[i] /= norm;
+    }
+}
+
+double OrientedSphereFittingProblem::estimErrorForSample(int i)
+{
+    const double v[3] = {x[i] - cx, y[i] - cy, z[i] - cz};
+    const double len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    const double dot = nx[i] * v[0] + ny[i] * v[1] + nz[i] * v[2];
+    const double deviation = 1.0 - std::fabs(dot) / std::max(len, 1e-300);
+    return std::max(std::fabs(len - r), normalWeight * deviation);
+}
+
+void OrientedSphereFittingProblem::estimModelFromSamples(const std::vector<int> & samplesIdx)
+{
+    if (samplesIdx.size() > 2){
+        estimModelFromWeightedSamples(samplesIdx, std::vector<double>(samplesIdx.size(), 1.0));
+        return;
+    }
+    if (samplesIdx.size() < 2)
+        return;
+
+    // closest points of the lines p1 + s*n1 and p2 + t*n2
+    const int i = samplesIdx[0], j = samplesIdx[1];
+    const double w[3] = {x[i] - x[j], y[i] - y[j], z[i] - z[j]};
+    const double B = nx[i] * nx[j] + ny[i] * ny[j] + nz[i] * nz[j];
+    const double D = nx[i] * w[0] + ny[i] * w[1] + nz[i] * w[2];
+    const double E = nx[j] * w[0] + ny[j] * w[1] + nz[j] * w[2];
+    const double denom = 1.0 - B * B;
+    if (denom <= 0) return;
+    const double s = (B * E - D) / denom;
+    const double t = (E - B * D) / denom;
+
+    cx = 0.5 * (x[i] + s * nx[i] + x[j] + t * nx[j]);
+    cy = 0.5 * (y[i] + s * ny[i] + y[j] + t * ny[j]);
+    cz = 0.5 * (z[i] + s * nz[i] + z[j] + t * nz[j]);
+    r = 0.5 * (sqrt((x[i] - cx) * (x[i] - cx) + (y[i] - cy) * (y[i] - cy) + (z[i] - cz) * (z[i] - cz)) +
+               sqrt((x[j] - cx) * (x[j] - cx) + (y[j] - cy) * (y[j] - cy) + (z[j] - cz) * (z[j] - cz)));
+}
+
+bool OrientedSphereFittingProblem::isDegenerate(const std::vector<int> & samplesIdx)
+{
+    const int i = samplesIdx[0], j = samplesIdx[1];
+    const double B = nx[i] * nx[j] + ny[i] * ny[j] + nz[i] * nz[j];
+    // sin^2 of the angle between the normals: the solve is ill-conditioned below 0.1 rad
+    return 1.0 - B * B < 1e-2;
+}
+
+void OrientedSphereFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    // algebraic fit around the weighted centroid o: |p - o|^2 + D.(p - o) + G = 0,
+    // linear least squares in (Dx, Dy, Dz, G)
+    double sw = 0.0, ox = 0.0, oy = 0.0, oz = 0.0;
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        sw += weights[k];
+        ox += weights[k] * x[i];
+        oy += weights[k] * y[i];
+        oz += weights[k] * z[i];
+    }
+    if (sw <= 0) return;
+    ox /= sw;
+    oy /= sw;
+    oz /= sw;
+
+    std::vector<double> M(16, 0.0), rhs(4, 0.0), sol;
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        const double v[4] = {x[i] - ox, y[i] - oy, z[i] - oz, 1.0};
+        const double q = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+        for (int row = 0; row < 4; row++){
+            for (int col = 0; col < 4; col++)
+                M[row * 4 + col] += weights[k] * v[row] * v[col];
+            rhs[row] -= weights[k] * q * v[row];
+        }
+    }
+    if (!robest::linalg::solve(M, rhs, 4, sol)) return;
+
+    const double ux = -0.5 * sol[0], uy = -0.5 * sol[1], uz = -0.5 * sol[2];
+    const double r2 = ux * ux + uy * uy + uz * uz - sol[3];
+    if (r2 <= 0) return;
+    cx = ox + ux;
+    cy = oy + uy;
+    cz = oz + uz;
+    r = sqrt(r2);
+}
+
+bool OrientedSphereFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params = {cx, cy, cz, r};
+    return true;
+}
+
+bool OrientedSphereFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 4) return false;
+    cx = params[0];
+    cy = params[1];
+    cz = params[2];
+    r  = params[3];
+    return true;
+}
+
+bool OrientedSphereFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 4) return false;
+    computeErrors(params.data(), begin, end, errors);
+    return true;
+}
+
+void OrientedSphereFittingProblem::computeErrors(const double * params, int begin, int end, double * errors) const
+{
+    const double pcx = params[0], pcy = params[1], pcz = params[2], pr = params[3];
+    const double w = normalWeight;
+    const double * px = x.data();
+    const double * py = y.data();
+    const double * pz = z.data();
+    const double * qx = nx.data();
+    const double * qy = ny.data();
+    const double * qz = nz.data();
+    double * out = errors - begin;
+
+    #pragma omp simd
+    for (int i = begin; i < end; ++i)
+    {
+        const double vx = px[i] - pcx, vy = py[i] - pcy, vz = pz[i] - pcz;
+        const double dot = qx[i] * vx + qy[i] * vy + qz[i] * vz;
+        const double len = std::sqrt(vx * vx + vy * vy + vz * vz);
+        const double deviation = 1.0 - std::fabs(dot) / std::max(len, 1e-300);
+        out[i] = std::max(std::fabs(len - pr), w * deviation);
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ *  @brief Sphere fitting to a set of 3D points with normals
+ *
+ *  The model is the sphere of center (cx, cy, cz) and radius r. Two oriented points
+ *  are a minimal sample: the center is where the lines through the points along
+ *  their normals meet (the middle of their closest points). Larger sets (refit on
+ *  the inliers) are fitted on the points only, by weighted algebraic least squares.
+ *
+ *  The error of a sample combines the distance to the sphere and the deviation of
+ *  its normal n from the radial direction u:
+ *      max(distance, normalWeight * (1 - |n.u|))
+ *  1 - |n.u| is about angle^2 / 2 for small angles. normalWeight = 0 ignores the
+ *  normals when scoring.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "robust_estim.hpp"
+
+class OrientedSphereFittingProblem : public robest::EstimationProblem{
+
+public:
+    OrientedSphereFittingProblem();
+    ~OrientedSphereFittingProblem();
+
+    // Points and their normals, normalized here
+    void setData(const std::vector<double> & x, const std::vector<double> & y, const std::vector<double> & z,
+                 const std::vector<double> & nx, const std::vector<double> & ny, const std::vector<double> & nz);
+
+    // 1 by default
+    void setNormalWeight(double weight) { normalWeight = weight; }
+
+    double estimErrorForSample(int i);
+    void estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
+
+    int getTotalNbSamples() const{
+        return (int) x.size();
+    }
+
+    void getResult(double & res_cx, double & res_cy, double & res_cz, double & res_r) const{
+        res_cx = cx;
+        res_cy = cy;
+        res_cz = cz;
+        res_r  = r;
+    }
+
+    // Normals less than 0.1 rad apart: the lines through the points barely define a center
+    bool isDegenerate(const std::vector<int> & samplesIdx);
+
+    // params: cx, cy, cz, r
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+
+private:
+    // Data
+    std::vector<double> x, y, z;
+    std::vector<double> nx, ny, nz;
+
+    // Model
+    double cx = 0.0;
+    double cy = 0.0;
+    double cz = 0.0;
+    double r  = 0.0;
+
+    double normalWeight = 1.0;
+
+    void computeErrors(const double * params, int begin, int end, double * errors) const;
+};
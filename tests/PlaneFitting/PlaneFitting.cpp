@@ -1,5 +1,30 @@
 
 #include "PlaneFitting.hpp"
+#include "robust_linalg.hpp"
+
+namespace {
+
+// |n.p + d| for the decoded points: p = o + s*q, so n.p + d = (n.o + d) + (s*n).q
+template<typename Int>
+void planeErrors(const robest::QuantizedPoints3d<Int> & cloud, double a, double b, double c, double d,
+                 int begin, int end, double * errors)
+{
+    typedef typename robest::QuantizedPoints3d<Int>::Block Block;
+    const Int * qx = cloud.x();
+    const Int * qy = cloud.y();
+    const Int * qz = cloud.z();
+    double * out = errors - begin;
+
+    cloud.forEachBlock(begin, end, [&](const Block & block, int first, int last) {
+        const double base = a*block.ox + b*block.oy + c*block.oz + d;
+        const double sa = a*block.scale, sb = b*block.scale, sc = c*block.scale;
+        #pragma omp simd
+        for (int i = first; i < last; ++i)
+            out[i] = std::fabs(base + sa*qx[i] + sb*qy[i] + sc*qz[i]);
+    });
+}
+
+} // namespace
 
 PlaneFittingProblem::PlaneFittingProblem(){
     setNbParams(4);
@@ -12,44 +37,247 @@ PlaneFittingProblem::~PlaneFittingProblem(){
 
 void PlaneFittingProblem::setData(std::vector<double> & x, std::vector<double> & y,std::vector<double> & z){
 
+    source = robest::PointSource();
     points.clear();
     for (auto i = 0; i < x.size(); i++){
         points.push_back(Point3d{x[i],y[i],z[i]});
     }
+    nbSamples = (int) points.size();
+    buildQuantizedStorage();
+    dataChanged();
 }
 
 double PlaneFittingProblem::estimErrorForSample(int i)
 {
-    const Point3d & P = points[i];
+    const Point3d P = point(i);
     return std::fabs(A*P.x+B*P.y+C*P.z+D)/sqrt(A*A+B*B+C*C);
 }
 
 void PlaneFittingProblem::estimModelFromSamples(const std::vector<int> & samplesIdx){
 
-    if( !isDegenerate(samplesIdx)){
+    double plane[4];
+    if (planeFromSamples(samplesIdx, plane)){
+        A = plane[0];
+        B = plane[1];
+        C = plane[2];
+        D = plane[3];
+    }
+}
+
+bool PlaneFittingProblem::estimModelParams(const std::vector<int> & samplesIdx, std::vector<double> & params) const
+{
+    double plane[4];
+    if (planeFromSamples(samplesIdx, plane))
+        params.assign(plane, plane + 4);
+    return true;
+}
 
-        const Point3d & P = points[samplesIdx[0]];
-        const Point3d & V = points[samplesIdx[1]];
-        const Point3d & K = points[samplesIdx[2]];
+bool PlaneFittingProblem::planeFromSamples(const std::vector<int> & samplesIdx, double plane[4]) const
+{
+    if (collinear(samplesIdx))
+        return false;
+
+    const Point3d P = point(samplesIdx[0]);
+    const Point3d V = point(samplesIdx[1]);
+    const Point3d K = point(samplesIdx[2]);
+
+    plane[0] = (V.y-P.y)*(K.z-P.z) - (K.y-P.y)*(V.z-P.z);
+    plane[1] = (V.z-P.z)*(K.x-P.x) - (V.x-P.x)*(K.z-P.z);
+    plane[2] = (V.x-P.x)*(K.y-P.y) - (V.y-P.y)*(K.x-P.x);
+    plane[3] = (-1)*(plane[0]*P.x + plane[1]*P.y + plane[2]*P.z);
+    return true;
+}
 
-        A =  (V.y-P.y)*(K.z-P.z) - (K.y-P.y)*(V.z-P.z);
-        B =  (V.x-P.x)*(K.z-P.z) + (V.z-P.z)*(K.x-P.x);
-        C =  (V.x-P.x)*(K.y-P.y) - (V.y-P.y)*(K.x-P.x);
-        D =  (-1)*(A*P.x + B*P.y +C*P.z);
-    }
+bool PlaneFittingProblem::isDegenerate(const std::vector<int> & samplesIdx)
+{
+    return collinear(samplesIdx);
 }
-bool PlaneFittingProblem::isDegenerate(std::vector<int> samplesIdx)
+
+bool PlaneFittingProblem::collinear(const std::vector<int> & samplesIdx) const
 {
-    const Point3d & P = points[samplesIdx[0]];
-    const Point3d & V = points[samplesIdx[1]];
-    const Point3d & K = points[samplesIdx[2]];
+    const Point3d P = point(samplesIdx[0]);
+    const Point3d V = point(samplesIdx[1]);
+    const Point3d K = point(samplesIdx[2]);
 
     const Point3d u{V.x - P.x, V.y - P.y, V.z - P.z};
     const Point3d v{K.x - P.x, K.y - P.y, K.z - P.z};
 
-    const auto dotProduct = u.x * v.x + u.y * v.y + u.z * v.z;
+    // the three points are collinear if u and v are
+    const Point3d n{u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x};
+
+    return ( n.x * n.x + n.y * n.y + n.z * n.z < 1e-10 );
+}
+
+void PlaneFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    double plane[4];
+    if (planeFromWeightedSamples(samplesIdx, weights, plane)){
+        A = plane[0];
+        B = plane[1];
+        C = plane[2];
+        D = plane[3];
+    }
+}
+
+bool PlaneFittingProblem::estimWeightedModelParams(const std::vector<int> & samplesIdx, const std::vector<double> & weights,
+                                                   std::vector<double> & params) const
+{
+    double plane[4];
+    if (planeFromWeightedSamples(samplesIdx, weights, plane))
+        params.assign(plane, plane + 4);
+    return true;
+}
 
-    return ( dotProduct < 1e-5 );
+bool PlaneFittingProblem::planeFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights,
+                                                   double plane[4]) const
+{
+    // weighted total least squares: the plane goes through the weighted centroid and
+    // its normal is the eigenvector of the smallest eigenvalue of the covariance
+    double sw = 0, mx = 0, my = 0, mz = 0;
+    for (int i = 0; i < samplesIdx.size(); i++){
+        const Point3d P = point(samplesIdx[i]);
+        sw += weights[i];
+        mx += weights[i] * P.x;
+        my += weights[i] * P.y;
+        mz += weights[i] * P.z;
+    }
+    if (sw <= 0) return false;
+    mx /= sw;
+    my /= sw;
+    mz /= sw;
+
+    std::vector<double> cov(9, 0.0);
+    for (int i = 0; i < samplesIdx.size(); i++){
+        const Point3d P = point(samplesIdx[i]);
+        const double d[3] = {P.x - mx, P.y - my, P.z - mz};
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                cov[r * 3 + c] += weights[i] * d[r] * d[c];
+    }
+
+    std::vector<double> n = robest::linalg::smallestEigenvector(cov, 3);
+    plane[0] = n[0];
+    plane[1] = n[1];
+    plane[2] = n[2];
+    plane[3] = -(n[0] * mx + n[1] * my + n[2] * mz);
+    return true;
+}
+
+bool PlaneFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params = {A, B, C, D};
+    return true;
+}
+
+bool PlaneFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 4) return false;
+    A = params[0];
+    B = params[1];
+    C = params[2];
+    D = params[3];
+    return true;
+}
+
+bool PlaneFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 4) return false;
+    const double a = params[0], b = params[1], c = params[2], d = params[3];
+    const double invNorm = 1.0 / sqrt(a*a+b*b+c*c);
+    if (source)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            const Point3d P = point(i);
+            errors[i - begin] = std::fabs(a*P.x+b*P.y+c*P.z+d) * invNorm;
+        }
+        return true;
+    }
+    for (int i = begin; i < end; ++i)
+    {
+        const Point3d & P = points[i];
+        errors[i - begin] = std::fabs(a*P.x+b*P.y+c*P.z+d) * invNorm;
+    }
+    return true;
+}
+
+void PlaneFittingProblem::setQuantizedStorage(int bits, int blockSize, robest::PointSource source)
+{
+    assert((bits == 0 || bits == 16 || bits == 32) && "Quantization on 16 or 32 bits");
+    assert((bits != 0 || !source) && "The points are released only with a quantized copy");
+    restorePoints();
+    quantizedBits = bits;
+    quantizedBlockSize = blockSize;
+    buildQuantizedStorage();
+    if (source && nbSamples > 0)
+    {
+        Point3Dvector().swap(points);
+        this->source = source;
+    }
+    dataChanged();
+}
+
+void PlaneFittingProblem::restorePoints()
+{
+    if (!source)
+        return;
+    points.resize(nbSamples);
+    for (int i = 0; i < nbSamples; ++i)
+        points[i] = point(i);
+    source = robest::PointSource();
+}
+
+void PlaneFittingProblem::buildQuantizedStorage()
+{
+    points16.clear();
+    points32.clear();
+    if (points.empty())
+        return;
+
+    const double * x = &points[0].x;
+    const double * y = &points[0].y;
+    const double * z = &points[0].z;
+    if (quantizedBits == 16)
+        points16.build(x, y, z, (int) points.size(), 3, quantizedBlockSize);
+    else if (quantizedBits == 32)
+        points32.build(x, y, z, (int) points.size(), 3, quantizedBlockSize);
+}
+
+void PlaneFittingProblem::placeSamples(const robest::NumaLayout & layout)
+{
+    if (!points.empty())
+        layout.place(points.data(), sizeof(Point3d));
+}
+
+size_t PlaneFittingProblem::getQuantizedMemorySize() const
+{
+    return points16.memorySize() + points32.memorySize();
+}
+
+size_t PlaneFittingProblem::getMemorySize() const
+{
+    return points.capacity() * sizeof(Point3d) + getQuantizedMemorySize();
+}
+
+bool PlaneFittingProblem::estimApproxErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors, double & errorBound) const
+{
+    if (params.size() != 4 || quantizedBits == 0) return false;
+    const double norm = sqrt(params[0]*params[0] + params[1]*params[1] + params[2]*params[2]);
+    const double a = params[0] / norm, b = params[1] / norm, c = params[2] / norm, d = params[3] / norm;
+
+    // the error is 1-Lipschitz in the point, plus the rounding of d
+    if (quantizedBits == 16)
+    {
+        planeErrors(points16, a, b, c, d, begin, end, errors);
+        errorBound = points16.errorBound(begin, end);
+    }
+    else
+    {
+        planeErrors(points32, a, b, c, d, begin, end, errors);
+        errorBound = points32.errorBound(begin, end);
+    }
+    errorBound += 1e-12 * std::fabs(d);
+    return true;
 }
 
 
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "robust_estim.hpp"
+#include "robust_quantized.hpp"
 
 struct Point3d{
     double x;
@@ -30,9 +31,10 @@ public:
 
     double estimErrorForSample(int i);
     void estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
 
     int getTotalNbSamples() const{
-        return (int) points.size();
+        return nbSamples;
     }
     void getResult(double & resa, double & resb, double & resc, double &resd){
 
@@ -48,11 +50,57 @@ public:
         resc = c / norm;
         resd = d / norm;
     }
+
+    bool isDegenerate(const std::vector<int> & samplesIdx);
+
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+    bool estimModelParams(const std::vector<int> & samplesIdx, std::vector<double> & params) const;
+    bool estimWeightedModelParams(const std::vector<int> & samplesIdx, const std::vector<double> & weights,
+                                  std::vector<double> & params) const;
+
+    // Quantized copy of the points for the batched scoring: bits = 16 or 32, 0 to
+    // disable. With a source, the full precision points are released and read from
+    // the source when needed: use the batched scoring, the other paths read every
+    // point from it. setData stores full precision points again.
+    void setQuantizedStorage(int bits, int blockSize = 1024, robest::PointSource source = robest::PointSource());
+    size_t getQuantizedMemorySize() const;
+    size_t getMemorySize() const;   // points held by the problem, in bytes
+    bool estimApproxErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors, double & errorBound) const;
+
+    void placeSamples(const robest::NumaLayout & layout);
+
 private:
-    bool isDegenerate(std::vector<int> samplesIdx);
     Point3Dvector points; // Data
     double A = 0.0;
     double B = 0.0;
     double C = 0.0;
     double D = 0.0;
+
+    bool planeFromSamples(const std::vector<int> & samplesIdx, double plane[4]) const;
+    bool planeFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights, double plane[4]) const;
+    bool collinear(const std::vector<int> & samplesIdx) const;
+
+    void buildQuantizedStorage();
+    void restorePoints();
+
+    // full precision point i, from the source once the points were released
+    Point3d point(int i) const
+    {
+        if (!source)
+            return points[i];
+        Point3d p;
+        source(i, p.x, p.y, p.z);
+        return p;
+    }
+
+    int nbSamples = 0;
+    robest::PointSource source;
+
+    int quantizedBits = 0;
+    int quantizedBlockSize = 1024;
+    robest::QuantizedPoints3d<int16_t> points16;
+    robest::QuantizedPoints3d<int32_t> points32;
 };
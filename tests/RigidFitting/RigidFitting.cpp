@@ -0,0 +1,220 @@
+#include "RigidFitting.hpp"
+#include "robust_linalg.hpp"
+
+namespace {
+
+// Orthonormal frame of the triangle (a, b, c): columns e1 along ab, e3 normal to the
+// triangle, e2 = e3 x e1. False if the triangle is flat.
+bool triangleFrame(const double a[3], const double b[3], const double c[3], double F[9])
+{
+    const double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    const double v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    const double n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+
+    const double nu = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+    const double nv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+    const double nn = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+    if (nu == 0.0 || nn <= 1e-12 * nu * nv)
+        return false;
+
+    const double e1[3] = {u[0] / sqrt(nu), u[1] / sqrt(nu), u[2] / sqrt(nu)};
+    const double e3[3] = {n[0] / sqrt(nn), n[1] / sqrt(nn), n[2] / sqrt(nn)};
+    const double e2[3] = {e3[1] * e1[2] - e3[2] * e1[1], e3[2] * e1[0] - e3[0] * e1[2], e3[0] * e1[1] - e3[1] * e1[0]};
+    for (int r = 0; r < 3; r++){
+        F[r * 3 + 0] = e1[r];
+        F[r * 3 + 1] = e2[r];
+        F[r * 3 + 2] = e3[r];
+    }
+    return true;
+}
+
+} // namespace
+
+RigidFittingProblem::RigidFittingProblem(){
+    setNbParams(13);
+    setNbMinSamples(3);
+}
+
+RigidFittingProblem::~RigidFittingProblem(){
+
+}
+
+void RigidFittingProblem::setData(const std::vector<double> & srcX, const std::vector<double> & srcY, const std::vector<double> & srcZ,
+                                  const std::vector<double> & dstX, const std::vector<double> & dstY, const std::vector<double> & dstZ)
+{
+    assert(srcX.size() == srcY.size() && srcX.size() == srcZ.size() && srcX.size() == dstX.size() &&
+           dstX.size() == dstY.size() && dstX.size() == dstZ.size() && "Correspondences of different sizes");
+    this->srcX = srcX;
+    this->srcY = srcY;
+    this->srcZ = srcZ;
+    this->dstX = dstX;
+    this->dstY = dstY;
+    this->dstZ = dstZ;
+}
+
+double RigidFittingProblem::estimErrorForSample(int i)
+{
+    const double dx = s * (R[0] * srcX[i] + R[1] * srcY[i] + R[2] * srcZ[i]) + t[0] - dstX[i];
+    const double dy = s * (R[3] * srcX[i] + R[4] * srcY[i] + R[5] * srcZ[i]) + t[1] - dstY[i];
+    const double dz = s * (R[6] * srcX[i] + R[7] * srcY[i] + R[8] * srcZ[i]) + t[2] - dstZ[i];
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void RigidFittingProblem::estimModelFromSamples(const std::vector<int> & samplesIdx)
+{
+    if (samplesIdx.size() > 3){
+        estimModelFromWeightedSamples(samplesIdx, std::vector<double>(samplesIdx.size(), 1.0));
+        return;
+    }
+    if (samplesIdx.size() < 3)
+        return;
+
+    // R maps the frame of the source triangle on the frame of the target one
+    double p[3][3], q[3][3];
+    double cp[3] = {0.0, 0.0, 0.0}, cq[3] = {0.0, 0.0, 0.0};
+    for (int k = 0; k < 3; k++){
+        const int i = samplesIdx[k];
+        p[k][0] = srcX[i]; p[k][1] = srcY[i]; p[k][2] = srcZ[i];
+        q[k][0] = dstX[i]; q[k][1] = dstY[i]; q[k][2] = dstZ[i];
+        for (int c = 0; c < 3; c++){
+            cp[c] += p[k][c] / 3.0;
+            cq[c] += q[k][c] / 3.0;
+        }
+    }
+
+    double Fp[9], Fq[9];
+    if (!triangleFrame(p[0], p[1], p[2], Fp) || !triangleFrame(q[0], q[1], q[2], Fq))
+        return;
+
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            R[r * 3 + c] = Fq[r * 3 + 0] * Fp[c * 3 + 0] + Fq[r * 3 + 1] * Fp[c * 3 + 1] + Fq[r * 3 + 2] * Fp[c * 3 + 2];
+
+    s = 1.0;
+    if (estimateScale){
+        double sp = 0.0, sq = 0.0;
+        for (int k = 0; k < 3; k++)
+            for (int c = 0; c < 3; c++){
+                sp += (p[k][c] - cp[c]) * (p[k][c] - cp[c]);
+                sq += (q[k][c] - cq[c]) * (q[k][c] - cq[c]);
+            }
+        s = sqrt(sq / sp);
+    }
+
+    for (int r = 0; r < 3; r++)
+        t[r] = cq[r] - s * (R[r * 3 + 0] * cp[0] + R[r * 3 + 1] * cp[1] + R[r * 3 + 2] * cp[2]);
+}
+
+bool RigidFittingProblem::isDegenerate(const std::vector<int> & samplesIdx)
+{
+    double p[3][3], q[3][3], F[9];
+    for (int k = 0; k < 3; k++){
+        const int i = samplesIdx[k];
+        p[k][0] = srcX[i]; p[k][1] = srcY[i]; p[k][2] = srcZ[i];
+        q[k][0] = dstX[i]; q[k][1] = dstY[i]; q[k][2] = dstZ[i];
+    }
+
+    // the rotation is undetermined if the points of either side are collinear
+    return !triangleFrame(p[0], p[1], p[2], F) || !triangleFrame(q[0], q[1], q[2], F);
+}
+
+void RigidFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    // weighted least squares (Umeyama): centroids, cross-covariance, then the rotation
+    // as the unit quaternion of the largest eigenvalue of Horn's 4x4 matrix
+    double sw = 0.0, cp[3] = {0.0, 0.0, 0.0}, cq[3] = {0.0, 0.0, 0.0};
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        sw += weights[k];
+        cp[0] += weights[k] * srcX[i]; cp[1] += weights[k] * srcY[i]; cp[2] += weights[k] * srcZ[i];
+        cq[0] += weights[k] * dstX[i]; cq[1] += weights[k] * dstY[i]; cq[2] += weights[k] * dstZ[i];
+    }
+    if (sw <= 0) return;
+    for (int c = 0; c < 3; c++){
+        cp[c] /= sw;
+        cq[c] /= sw;
+    }
+
+    double S[9] = {0.0}, varP = 0.0;
+    for (int k = 0; k < samplesIdx.size(); k++){
+        const int i = samplesIdx[k];
+        const double a[3] = {srcX[i] - cp[0], srcY[i] - cp[1], srcZ[i] - cp[2]};
+        const double b[3] = {dstX[i] - cq[0], dstY[i] - cq[1], dstZ[i] - cq[2]};
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                S[r * 3 + c] += weights[k] * a[r] * b[c];
+        varP += weights[k] * (a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    }
+    if (varP <= 0) return;
+
+    const double Sxx = S[0], Sxy = S[1], Sxz = S[2];
+    const double Syx = S[3], Syy = S[4], Syz = S[5];
+    const double Szx = S[6], Szy = S[7], Szz = S[8];
+    const std::vector<double> N = {
+        Sxx + Syy + Szz, Syz - Szy,       Szx - Sxz,        Sxy - Syx,
+        Syz - Szy,       Sxx - Syy - Szz, Sxy + Syx,        Szx + Sxz,
+        Szx - Sxz,       Sxy + Syx,       -Sxx + Syy - Szz, Syz + Szy,
+        Sxy - Syx,       Szx + Sxz,       Syz + Szy,        -Sxx - Syy + Szz
+    };
+
+    std::vector<double> eigenvalues, V;
+    robest::linalg::symmetricEigen(N, 4, eigenvalues, V);
+    const double w = V[0 * 4 + 3], x = V[1 * 4 + 3], y = V[2 * 4 + 3], z = V[3 * 4 + 3];
+
+    R = {w*w + x*x - y*y - z*z, 2*(x*y - w*z),         2*(x*z + w*y),
+         2*(x*y + w*z),         w*w - x*x + y*y - z*z, 2*(y*z - w*x),
+         2*(x*z - w*y),         2*(y*z + w*x),         w*w - x*x - y*y + z*z};
+
+    // the largest eigenvalue is trace(R^T S) = sum w_i (q_i - cq).R(p_i - cp)
+    s = estimateScale ? eigenvalues[3] / varP : 1.0;
+
+    for (int r = 0; r < 3; r++)
+        t[r] = cq[r] - s * (R[r * 3 + 0] * cp[0] + R[r * 3 + 1] * cp[1] + R[r * 3 + 2] * cp[2]);
+}
+
+bool RigidFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params.assign(R.begin(), R.end());
+    params.insert(params.end(), t.begin(), t.end());
+    params.push_back(s);
+    return true;
+}
+
+bool RigidFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 13) return false;
+    R.assign(params.begin(), params.begin() + 9);
+    t.assign(params.begin() + 9, params.begin() + 12);
+    s = params[12];
+    return true;
+}
+
+bool RigidFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 13) return false;
+
+    // A = s * R, applied to the structure of arrays: one correspondence per SIMD lane
+    const double scale = params[12];
+    const double a00 = scale * params[0], a01 = scale * params[1], a02 = scale * params[2];
+    const double a10 = scale * params[3], a11 = scale * params[4], a12 = scale * params[5];
+    const double a20 = scale * params[6], a21 = scale * params[7], a22 = scale * params[8];
+    const double tx = params[9], ty = params[10], tz = params[11];
+
+    const double * px = srcX.data();
+    const double * py = srcY.data();
+    const double * pz = srcZ.data();
+    const double * qx = dstX.data();
+    const double * qy = dstY.data();
+    const double * qz = dstZ.data();
+    double * out = errors - begin;
+
+    #pragma omp simd
+    for (int i = begin; i < end; ++i)
+    {
+        const double dx = a00 * px[i] + a01 * py[i] + a02 * pz[i] + tx - qx[i];
+        const double dy = a10 * px[i] + a11 * py[i] + a12 * pz[i] + ty - qy[i];
+        const double dz = a20 * px[i] + a21 * py[i] + a22 * pz[i] + tz - qz[i];
+        out[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+    return true;
+}
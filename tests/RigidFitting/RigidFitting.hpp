@@ -0,0 +1,66 @@
+/**
+ *  @brief Rigid (or similarity) transform between two sets of 3D points
+ *
+ *  Samples are correspondences (p_i, q_i). The model maps the source points on the
+ *  target ones: q = s * R * p + t, with R a rotation and s = 1 unless the scale is
+ *  estimated. The error of a correspondence is the distance || s*R*p_i + t - q_i ||.
+ *
+ *  Minimal samples of 3 correspondences are solved in closed form from the frames
+ *  they span; larger sets (refit on the inliers) by the least squares solution of
+ *  Umeyama / Horn. Points are stored as structure of arrays so that the batched
+ *  errors are computed by a vectorized loop.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "robust_estim.hpp"
+
+class RigidFittingProblem : public robest::EstimationProblem{
+
+public:
+    RigidFittingProblem();
+    ~RigidFittingProblem();
+
+    // Correspondences (src[i], dst[i]), given as coordinate arrays
+    void setData(const std::vector<double> & srcX, const std::vector<double> & srcY, const std::vector<double> & srcZ,
+                 const std::vector<double> & dstX, const std::vector<double> & dstY, const std::vector<double> & dstZ);
+
+    // Similarity transform: the scale s is estimated too (false by default)
+    void setEstimateScale(bool enable) { estimateScale = enable; }
+
+    double estimErrorForSample(int i);
+    void estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
+
+    int getTotalNbSamples() const{
+        return (int) srcX.size();
+    }
+
+    // R row-major
+    void getResult(std::vector<double> & resR, std::vector<double> & rest, double & ress) const{
+        resR = R;
+        rest = t;
+        ress = s;
+    }
+
+    bool isDegenerate(const std::vector<int> & samplesIdx);
+
+    // params: R (9 values, row-major), t (3 values), s
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+
+private:
+    // Data
+    std::vector<double> srcX, srcY, srcZ;
+    std::vector<double> dstX, dstY, dstZ;
+
+    // Model
+    std::vector<double> R = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+    std::vector<double> t = {0.0, 0.0, 0.0};
+    double s = 1.0;
+
+    bool estimateScale = false;
+};
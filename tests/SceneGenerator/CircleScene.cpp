@@ -0,0 +1,18 @@
+#include "SceneGenerator.hpp"
+
+#include "CircleFitting/CircleFitting.hpp"
+
+namespace scene {
+
+std::shared_ptr<robest::EstimationProblem> makeCircleProblem(const Scene & scene)
+{
+    // setData copies the coordinates, it does not modify them
+    std::vector<double> & x = const_cast<std::vector<double> &>(scene.x);
+    std::vector<double> & y = const_cast<std::vector<double> &>(scene.y);
+
+    auto problem = std::make_shared<CircleFittingProblem>();
+    problem->setData(x, y);
+    return problem;
+}
+
+} // namespace scene
@@ -0,0 +1,18 @@
+#include "SceneGenerator.hpp"
+
+#include "LineFitting/LineFitting.hpp"
+
+namespace scene {
+
+std::shared_ptr<robest::EstimationProblem> makeLineProblem(const Scene & scene)
+{
+    // setData copies the coordinates, it does not modify them
+    std::vector<double> & x = const_cast<std::vector<double> &>(scene.x);
+    std::vector<double> & y = const_cast<std::vector<double> &>(scene.y);
+
+    auto problem = std::make_shared<LineFittingProblem>();
+    problem->setData(x, y);
+    return problem;
+}
+
+} // namespace scene
@@ -0,0 +1,36 @@
+/**
+ *  @brief Problem of the reference line of the unit tests
+ *
+ *  The points are the ones of scene::referenceLine, the line y = 0.5*x + 2 that
+ *  LineFittingProblem::getResult gives as a = 0.5 and b = 2.
+ */
+
+#ifndef REFERENCE_LINE_H
+#define REFERENCE_LINE_H
+
+#include <memory>
+
+#include "LineFitting/LineFitting.hpp"
+#include "SceneGenerator.hpp"
+
+namespace scene {
+
+// Problem holding the points of a line scene
+inline std::shared_ptr<LineFittingProblem> makeLineFitting(const Scene & line)
+{
+    std::vector<double> x = line.x, y = line.y;
+    auto lineFitting = std::make_shared<LineFittingProblem>();
+    lineFitting->setData(x, y);
+    return lineFitting;
+}
+
+// Problem holding referenceLine(nbPoints, noiseSigma, outliersRatio, outliersShift)
+inline std::shared_ptr<LineFittingProblem> makeReferenceLine(int nbPoints, double noiseSigma = 0.0, double outliersRatio = 0.3,
+                                                             double outliersShift = 0.0)
+{
+    return makeLineFitting(referenceLine(nbPoints, noiseSigma, outliersRatio, outliersShift));
+}
+
+} // namespace scene
+
+#endif // REFERENCE_LINE_H
@@ -0,0 +1,58 @@
+/**
+ *  @brief Problem of the reference plane of the unit tests and checks of its results
+ *
+ *  The points are the ones of scene::referencePlane. A result is the reference plane
+ *  when a/c, b/c and d/c of PlaneFittingProblem::getResult match -0.1, 0.2 and -1 up
+ *  to the tolerance, the offset d/c up to its own tolerance.
+ */
+
+#ifndef REFERENCE_PLANE_H
+#define REFERENCE_PLANE_H
+
+#include <cmath>
+#include <memory>
+
+#include "gtest/gtest.h"
+
+#include "PlaneFitting/PlaneFitting.hpp"
+#include "SceneGenerator.hpp"
+
+namespace scene {
+
+// Problem holding the points of a plane scene
+inline std::shared_ptr<PlaneFittingProblem> makePlaneFitting(const Scene & plane)
+{
+    std::vector<double> x = plane.x, y = plane.y, z = plane.z;
+    auto planeFitting = std::make_shared<PlaneFittingProblem>();
+    planeFitting->setData(x, y, z);
+    return planeFitting;
+}
+
+// Problem holding referencePlane(nbPoints, noiseSigma, outliersRatio, outliersShift)
+inline std::shared_ptr<PlaneFittingProblem> makeReferencePlane(int nbPoints, double noiseSigma = 0.0, double outliersRatio = 0.3,
+                                                               double outliersShift = 30.0)
+{
+    return makePlaneFitting(referencePlane(nbPoints, noiseSigma, outliersRatio, outliersShift));
+}
+
+inline bool isReferencePlane(std::shared_ptr<PlaneFittingProblem> planeFitting, double tolerance = 1.0e-6,
+                             double offsetTolerance = 1.0e-6)
+{
+    double a, b, c, d;
+    planeFitting->getResult(a, b, c, d);
+    return std::fabs(a / c + 0.1) < tolerance && std::fabs(b / c - 0.2) < tolerance && std::fabs(d / c + 1.0) < offsetTolerance;
+}
+
+inline void expectReferencePlane(std::shared_ptr<PlaneFittingProblem> planeFitting, double tolerance = 1.0e-6,
+                                 double offsetTolerance = 1.0e-6)
+{
+    double a, b, c, d;
+    planeFitting->getResult(a, b, c, d);
+    EXPECT_NEAR(-0.1, a / c, tolerance);
+    EXPECT_NEAR( 0.2, b / c, tolerance);
+    EXPECT_NEAR(-1.0, d / c, offsetTolerance);
+}
+
+} // namespace scene
+
+#endif // REFERENCE_PLANE_H
@@ -0,0 +1,380 @@
+#include "SceneGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace scene {
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+const double outliersBox = 20.0;   // outliers in [-20, 20]^dim
+const double extent = 10.0;        // parameters of lines and planes in [-10, 10]
+const int nbSpots = 3;             // clusters per structure
+
+typedef std::mt19937 Generator;
+
+struct Vec3
+{
+    double x = 0.0, y = 0.0, z = 0.0;
+};
+
+Vec3 vec3(double x, double y, double z)
+{
+    Vec3 v;
+    v.x = x; v.y = y; v.z = z;
+    return v;
+}
+
+Vec3 cross(const Vec3 & u, const Vec3 & v)
+{
+    return vec3(u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x);
+}
+
+Vec3 normalized(const Vec3 & v)
+{
+    double norm = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    return vec3(v.x / norm, v.y / norm, v.z / norm);
+}
+
+double uniform(Generator & generator, double lo, double hi)
+{
+    return std::uniform_real_distribution<double>(lo, hi)(generator);
+}
+
+double gaussian(Generator & generator, double sigma)
+{
+    return std::normal_distribution<double>(0.0, sigma)(generator);
+}
+
+Vec3 randomDirection(Generator & generator)
+{
+    return normalized(vec3(gaussian(generator, 1.0), gaussian(generator, 1.0), gaussian(generator, 1.0)));
+}
+
+// Where an inlier lies on its structure
+enum class Placement : int { Uniform, Clustered, Degenerate };
+
+// A structure and the frame its points are drawn in. The position of a point on the
+// structure is given by its parameters: x for a line, an angle for a circle, (s, t)
+// in the plane for a plane, a unit direction for a sphere.
+struct Structure
+{
+    std::vector<double> model;
+    Vec3 center, u, v, w;       // planes and spheres: w is the normal of the plane, of
+                                // the degenerate circle of the sphere
+    Vec3 spots[nbSpots];        // parameters of the clusters
+    Vec3 degenerate;            // parameters of the degenerate subset (lines, circles)
+};
+
+Vec3 uniformParams(SceneKind kind, Generator & generator)
+{
+    switch (kind)
+    {
+        case SceneKind::Lines:   return vec3(uniform(generator, -extent, extent), 0.0, 0.0);
+        case SceneKind::Circles: return vec3(uniform(generator, 0.0, 2.0 * pi), 0.0, 0.0);
+        case SceneKind::Planes:  return vec3(uniform(generator, -extent, extent), uniform(generator, -extent, extent), 0.0);
+        default:                 return randomDirection(generator);
+    }
+}
+
+Structure makeStructure(SceneKind kind, Generator & generator)
+{
+    Structure structure;
+    switch (kind)
+    {
+        case SceneKind::Lines:
+            structure.model = {uniform(generator, -1.0, 1.0), uniform(generator, -5.0, 5.0)};
+            break;
+        case SceneKind::Circles:
+            structure.model = {uniform(generator, -extent, extent), uniform(generator, -extent, extent), uniform(generator, 2.0, 8.0)};
+            break;
+        case SceneKind::Planes:
+        case SceneKind::Spheres:
+        {
+            const double half = kind == SceneKind::Planes ? 0.5 * extent : extent;
+            structure.center = vec3(uniform(generator, -half, half), uniform(generator, -half, half), uniform(generator, -half, half));
+            structure.w = randomDirection(generator);
+            Vec3 other = std::fabs(structure.w.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0);
+            structure.u = normalized(cross(structure.w, other));
+            structure.v = cross(structure.w, structure.u);
+            const Vec3 & n = structure.w, & c = structure.center;
+            if (kind == SceneKind::Planes)
+                structure.model = {n.x, n.y, n.z, -(n.x * c.x + n.y * c.y + n.z * c.z)};
+            else
+                structure.model = {c.x, c.y, c.z, uniform(generator, 2.0, 8.0)};
+            break;
+        }
+    }
+    for (int k = 0; k < nbSpots; ++k)
+        structure.spots[k] = uniformParams(kind, generator);
+    structure.degenerate = uniformParams(kind, generator);
+    return structure;
+}
+
+Vec3 drawParams(SceneKind kind, const Structure & structure, Placement placement, Generator & generator)
+{
+    if (placement == Placement::Uniform)
+        return uniformParams(kind, generator);
+
+    if (placement == Placement::Clustered)
+    {
+        const Vec3 & spot = structure.spots[std::uniform_int_distribution<int>(0, nbSpots - 1)(generator)];
+        switch (kind)
+        {
+            case SceneKind::Lines:   return vec3(spot.x + gaussian(generator, 0.2), 0.0, 0.0);
+            case SceneKind::Circles: return vec3(spot.x + gaussian(generator, 0.05), 0.0, 0.0);
+            case SceneKind::Planes:  return vec3(spot.x + gaussian(generator, 0.2), spot.y + gaussian(generator, 0.2), 0.0);
+            default:                 return normalized(vec3(spot.x + gaussian(generator, 0.05), spot.y + gaussian(generator, 0.05), spot.z + gaussian(generator, 0.05)));
+        }
+    }
+
+    switch (kind)
+    {
+        case SceneKind::Lines:   return structure.degenerate;
+        case SceneKind::Circles: return vec3(structure.degenerate.x + uniform(generator, 0.0, 0.01), 0.0, 0.0);
+        case SceneKind::Planes:  return vec3(uniform(generator, -extent, extent), 0.0, 0.0);
+        default:
+        {
+            double angle = uniform(generator, 0.0, 2.0 * pi);
+            const Vec3 & u = structure.u, & v = structure.v;
+            return vec3(std::cos(angle) * u.x + std::sin(angle) * v.x,
+                        std::cos(angle) * u.y + std::sin(angle) * v.y,
+                        std::cos(angle) * u.z + std::sin(angle) * v.z);
+        }
+    }
+}
+
+Vec3 pointAt(SceneKind kind, const Structure & structure, const Vec3 & params)
+{
+    const std::vector<double> & m = structure.model;
+    const Vec3 & c = structure.center, & u = structure.u, & v = structure.v;
+    switch (kind)
+    {
+        case SceneKind::Lines:   return vec3(params.x, m[0] * params.x + m[1], 0.0);
+        case SceneKind::Circles: return vec3(m[0] + m[2] * std::cos(params.x), m[1] + m[2] * std::sin(params.x), 0.0);
+        case SceneKind::Planes:  return vec3(c.x + params.x * u.x + params.y * v.x,
+                                             c.y + params.x * u.y + params.y * v.y,
+                                             c.z + params.x * u.z + params.y * v.z);
+        default:                 return vec3(c.x + m[3] * params.x, c.y + m[3] * params.y, c.z + m[3] * params.z);
+    }
+}
+
+} // namespace
+
+const char * sceneKindName(SceneKind kind)
+{
+    switch (kind)
+    {
+        case SceneKind::Lines:   return "lines";
+        case SceneKind::Circles: return "circles";
+        case SceneKind::Planes:  return "planes";
+        default:                 return "spheres";
+    }
+}
+
+bool parseSceneKind(const std::string & name, SceneKind & kind)
+{
+    const SceneKind kinds[] = {SceneKind::Lines, SceneKind::Circles, SceneKind::Planes, SceneKind::Spheres};
+    for (SceneKind candidate : kinds)
+    {
+        if (name == sceneKindName(candidate))
+        {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+int Scene::count(int structure) const
+{
+    return (int) std::count(labels.begin(), labels.end(), structure);
+}
+
+Scene generateScene(SceneKind kind, const SceneOptions & options)
+{
+    assert(options.nbPoints > 0 && options.nbStructures > 0 && "Wrong scene options");
+    assert(options.outliersRatio >= 0.0 && options.outliersRatio < 1.0 && "Wrong outliers ratio");
+    assert(options.clustering + options.degeneracy <= 1.0 && "Wrong inliers placement");
+
+    Generator generator(options.seed);
+    Scene scene;
+    scene.kind = kind;
+
+    std::vector<Structure> structures;
+    for (int s = 0; s < options.nbStructures; ++s)
+    {
+        structures.push_back(makeStructure(kind, generator));
+        scene.models.push_back(structures.back().model);
+    }
+
+    // structure and placement of every point, before they are shuffled. Structure s
+    // gets 1 / (s + 1) of the inliers, up to a normalization; 0 gets the remainder.
+    const int nbInliers = options.nbPoints - (int) std::lround(options.nbPoints * options.outliersRatio);
+    double weights = 0.0;
+    for (int s = 0; s < options.nbStructures; ++s)
+        weights += 1.0 / (s + 1);
+    std::vector<int> counts(options.nbStructures);
+    int nbAssigned = 0;
+    for (int s = 1; s < options.nbStructures; ++s)
+    {
+        counts[s] = (int) (nbInliers / (s + 1) / weights);
+        nbAssigned += counts[s];
+    }
+    counts[0] = nbInliers - nbAssigned;
+
+    std::vector<std::pair<int, Placement>> tags;
+    tags.reserve(options.nbPoints);
+    for (int s = 0; s < options.nbStructures; ++s)
+    {
+        const int nbDegenerate = (int) std::lround(counts[s] * options.degeneracy);
+        const int nbClustered = std::min(counts[s] - nbDegenerate, (int) std::lround(counts[s] * options.clustering));
+        for (int i = 0; i < counts[s]; ++i)
+            tags.emplace_back(s, i < nbDegenerate ? Placement::Degenerate : i < nbDegenerate + nbClustered ? Placement::Clustered : Placement::Uniform);
+    }
+    while ((int) tags.size() < options.nbPoints)
+        tags.emplace_back(-1, Placement::Uniform);
+    std::shuffle(tags.begin(), tags.end(), generator);
+
+    const bool is3d = kind == SceneKind::Planes || kind == SceneKind::Spheres;
+    scene.x.resize(options.nbPoints);
+    scene.y.resize(options.nbPoints);
+    scene.z.resize(is3d ? options.nbPoints : 0);
+    scene.labels.resize(options.nbPoints);
+    for (int i = 0; i < options.nbPoints; ++i)
+    {
+        const int s = tags[i].first;
+        Vec3 p;
+        if (s < 0)
+            p = vec3(uniform(generator, -outliersBox, outliersBox), uniform(generator, -outliersBox, outliersBox), uniform(generator, -outliersBox, outliersBox));
+        else
+        {
+            p = pointAt(kind, structures[s], drawParams(kind, structures[s], tags[i].second, generator));
+            p.x += gaussian(generator, options.noiseSigma);
+            p.y += gaussian(generator, options.noiseSigma);
+            p.z += gaussian(generator, options.noiseSigma);
+        }
+        scene.x[i] = p.x;
+        scene.y[i] = p.y;
+        if (is3d)
+            scene.z[i] = p.z;
+        scene.labels[i] = s;
+    }
+    return scene;
+}
+
+Scene referencePlane(int nbPoints, double noiseSigma, double outliersRatio, double outliersShift, unsigned seed)
+{
+    assert(nbPoints > 0 && outliersRatio >= 0.0 && outliersRatio < 1.0 && "Wrong reference plane");
+
+    Generator generator(seed);
+    Scene scene;
+    scene.kind = SceneKind::Planes;
+    const double norm = std::sqrt(0.1 * 0.1 + 0.2 * 0.2 + 1.0);
+    scene.models.push_back({0.1 / norm, -0.2 / norm, -1.0 / norm, 1.0 / norm});
+
+    const int nbOutliers = (int) std::lround(nbPoints * outliersRatio);
+    scene.x.resize(nbPoints);
+    scene.y.resize(nbPoints);
+    scene.z.resize(nbPoints);
+    scene.labels.resize(nbPoints);
+    for (int i = 0; i < nbPoints; ++i)
+    {
+        const double x = uniform(generator, -extent, extent);
+        const double y = uniform(generator, -extent, extent);
+        scene.x[i] = x;
+        scene.y[i] = y;
+        if (i < nbOutliers)
+        {
+            scene.z[i] = uniform(generator, -extent, extent) + outliersShift;
+            scene.labels[i] = -1;
+        }
+        else
+        {
+            scene.z[i] = 0.1 * x - 0.2 * y + 1.0 + (noiseSigma > 0.0 ? gaussian(generator, noiseSigma) : 0.0);
+            scene.labels[i] = 0;
+        }
+    }
+    return scene;
+}
+
+Scene referenceLine(int nbPoints, double noiseSigma, double outliersRatio, double outliersShift, unsigned seed)
+{
+    assert(nbPoints > 0 && outliersRatio >= 0.0 && outliersRatio < 1.0 && "Wrong reference line");
+
+    Generator generator(seed);
+    Scene scene;
+    scene.kind = SceneKind::Lines;
+    scene.models.push_back({0.5, 2.0});
+
+    const int nbOutliers = (int) std::lround(nbPoints * outliersRatio);
+    scene.x.resize(nbPoints);
+    scene.y.resize(nbPoints);
+    scene.labels.resize(nbPoints);
+    for (int i = 0; i < nbPoints; ++i)
+    {
+        const double x = uniform(generator, 0.0, 100.0);
+        scene.x[i] = x;
+        if (i < nbOutliers)
+        {
+            scene.y[i] = uniform(generator, 0.0, 100.0) + outliersShift;
+            scene.labels[i] = -1;
+        }
+        else
+        {
+            scene.y[i] = 0.5 * x + 2.0 + (noiseSigma > 0.0 ? gaussian(generator, noiseSigma) : 0.0);
+            scene.labels[i] = 0;
+        }
+    }
+    return scene;
+}
+
+int nbMinSamples(SceneKind kind)
+{
+    switch (kind)
+    {
+        case SceneKind::Lines:   return 2;
+        case SceneKind::Circles: return 3;
+        case SceneKind::Planes:  return 3;
+        default:                 return 4;
+    }
+}
+
+double modelError(SceneKind kind, const std::vector<double> & estimated, const std::vector<double> & truth)
+{
+    if (estimated.size() != truth.size())
+        return std::numeric_limits<double>::infinity();
+
+    std::vector<double> model = estimated;
+    if (kind == SceneKind::Planes)
+    {
+        double norm = std::sqrt(model[0] * model[0] + model[1] * model[1] + model[2] * model[2]);
+        if (norm == 0.0)
+            return std::numeric_limits<double>::infinity();
+        if (model[0] * truth[0] + model[1] * truth[1] + model[2] * truth[2] < 0.0)
+            norm = -norm;
+        for (double & param : model)
+            param /= norm;
+    }
+
+    double error = 0.0;
+    for (size_t k = 0; k < model.size(); ++k)
+        error += std::fabs(model[k] - truth[k]);
+    return error;
+}
+
+std::shared_ptr<robest::EstimationProblem> makeProblem(const Scene & scene)
+{
+    switch (scene.kind)
+    {
+        case SceneKind::Lines:   return makeLineProblem(scene);
+        case SceneKind::Circles: return makeCircleProblem(scene);
+        case SceneKind::Planes:  return makePlaneProblem(scene);
+        default:                 return makeSphereProblem(scene);
+    }
+}
+
+} // namespace scene
@@ -0,0 +1,99 @@
+/**
+ *  @brief Synthetic scenes of lines, circles, planes and spheres with ground truth
+ *
+ *  A scene holds nbPoints points: outliers, uniform in the box [-20, 20]^dim, and
+ *  the inliers of nbStructures structures of the same kind, with Gaussian noise of
+ *  noiseSigma on every coordinate. Structure s holds a share of the inliers
+ *  proportional to 1 / (s + 1): structure 0 is the dominant one, the one a solve is
+ *  expected to find. The points are shuffled, labels[i] gives the structure of point
+ *  i (-1 for an outlier).
+ *
+ *  Within a structure, the inliers are spread uniformly, except:
+ *   - a clustering share of them, gathered around three random spots;
+ *   - a degeneracy share of them, on a subset from which minimal samples give no
+ *     model or an ill-conditioned one: one point for a line, an arc of 0.01 rad for
+ *     a circle, a line for a plane, a circle for a sphere.
+ *
+ *  Ground truth models are given in the parameters of getModelParams of the
+ *  matching problem (tests/<Kind>Fitting): {a, b} for y = a*x + b, {cx, cy, r},
+ *  {A, B, C, D} for A*x + B*y + C*z + D = 0 with a unit normal, {cx, cy, cz, r}.
+ */
+
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "robust_estim.hpp"
+
+namespace scene {
+
+enum class SceneKind { Lines, Circles, Planes, Spheres };
+
+const char * sceneKindName(SceneKind kind);
+
+// false if name is none of "lines", "circles", "planes", "spheres"
+bool parseSceneKind(const std::string & name, SceneKind & kind);
+
+struct SceneOptions
+{
+    int nbPoints = 10000;
+    int nbStructures = 1;
+    double noiseSigma = 0.01;
+    double outliersRatio = 0.3;
+    double clustering = 0.0;  // share of the inliers of a structure in clusters
+    double degeneracy = 0.0;  // share of the inliers of a structure on a degenerate subset
+    unsigned seed = 42;
+};
+
+struct Scene
+{
+    SceneKind kind = SceneKind::Lines;
+    std::vector<double> x, y, z;                // z is empty for lines and circles
+    std::vector<int> labels;                    // structure of each point, -1 for outliers
+    std::vector<std::vector<double>> models;    // ground truth of each structure
+
+    int size() const { return (int) x.size(); }
+    int dimension() const { return z.empty() ? 2 : 3; }
+
+    // Points of the structure, -1 for the outliers
+    int count(int structure) const;
+};
+
+Scene generateScene(SceneKind kind, const SceneOptions & options);
+
+// The plane z = 0.1*x - 0.2*y + 1 of the unit tests, x and y uniform in [-10, 10], with
+// Gaussian noise of noiseSigma on z. The first outliersRatio of the points are the
+// outliers, not shuffled: z uniform in [-10, 10] + outliersShift, a shift of 30 keeping
+// them away from the plane. See ReferencePlane.hpp for its problem and checks.
+Scene referencePlane(int nbPoints, double noiseSigma = 0.0, double outliersRatio = 0.3,
+                     double outliersShift = 30.0, unsigned seed = 42);
+
+// The line y = 0.5*x + 2 of the unit tests, x uniform in [0, 100], with Gaussian noise
+// of noiseSigma on y. The first outliersRatio of the points are the outliers, not
+// shuffled: y uniform in [0, 100] + outliersShift. See ReferenceLine.hpp for its problem.
+Scene referenceLine(int nbPoints, double noiseSigma = 0.0, double outliersRatio = 0.3,
+                    double outliersShift = 0.0, unsigned seed = 42);
+
+// Minimal sample size of the problems of the kind
+int nbMinSamples(SceneKind kind);
+
+// Sum of the absolute differences between the parameters of two models, planes
+// being normalized first (unit normal, same orientation)
+double modelError(SceneKind kind, const std::vector<double> & estimated, const std::vector<double> & truth);
+
+// Problem of the kind holding the points of the scene
+std::shared_ptr<robest::EstimationProblem> makeProblem(const Scene & scene);
+
+// One per kind, each next to its problem header: the headers of the problems cannot
+// be included together
+std::shared_ptr<robest::EstimationProblem> makeLineProblem(const Scene & scene);
+std::shared_ptr<robest::EstimationProblem> makeCircleProblem(const Scene & scene);
+std::shared_ptr<robest::EstimationProblem> makePlaneProblem(const Scene & scene);
+std::shared_ptr<robest::EstimationProblem> makeSphereProblem(const Scene & scene);
+
+} // namespace scene
+
+#endif // SCENE_GENERATOR_H
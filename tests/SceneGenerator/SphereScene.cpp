@@ -0,0 +1,19 @@
+#include "SceneGenerator.hpp"
+
+#include "SphereFitting/SphereFitting.hpp"
+
+namespace scene {
+
+std::shared_ptr<robest::EstimationProblem> makeSphereProblem(const Scene & scene)
+{
+    // setData copies the coordinates, it does not modify them
+    std::vector<double> & x = const_cast<std::vector<double> &>(scene.x);
+    std::vector<double> & y = const_cast<std::vector<double> &>(scene.y);
+    std::vector<double> & z = const_cast<std::vector<double> &>(scene.z);
+
+    auto problem = std::make_shared<SphereFittingProblem>();
+    problem->setData(x, y, z);
+    return problem;
+}
+
+} // namespace scene
@@ -1,4 +1,34 @@
 #include "SphereFitting.hpp"
+#include "robust_linalg.hpp"
+
+namespace {
+
+// |‖p - c‖ - r| for the decoded points: p - c = (o - c) + s*q
+template<typename Int>
+void sphereErrors(const robest::QuantizedPoints3d<Int> & cloud, double cx, double cy, double cz, double r,
+                  int begin, int end, double * errors)
+{
+    typedef typename robest::QuantizedPoints3d<Int>::Block Block;
+    const Int * qx = cloud.x();
+    const Int * qy = cloud.y();
+    const Int * qz = cloud.z();
+    double * out = errors - begin;
+
+    cloud.forEachBlock(begin, end, [&](const Block & block, int first, int last) {
+        const double dx0 = block.ox - cx, dy0 = block.oy - cy, dz0 = block.oz - cz;
+        const double s = block.scale;
+        #pragma omp simd
+        for (int i = first; i < last; ++i)
+        {
+            double dx = dx0 + s*qx[i];
+            double dy = dy0 + s*qy[i];
+            double dz = dz0 + s*qz[i];
+            out[i] = std::fabs(std::sqrt(dx*dx + dy*dy + dz*dz) - r);
+        }
+    });
+}
+
+} // namespace
 
 SphereFittingProblem::SphereFittingProblem(){
     setNbParams(4);
@@ -11,29 +41,32 @@ SphereFittingProblem::~SphereFittingProblem(){
 
 void SphereFittingProblem::setData(std::vector<double> & x, std::vector<double> & y, std::vector<double> & z)
 {
+    source = robest::PointSource();
     points.clear();
     for (int i = 0; i < x.size(); i++){
-        Point3d point;
-        point.x=x[i];
-        point.y=y[i];
-        point.z=z[i];
-        points.push_back(point);
+        Point3d p;
+        p.x=x[i];
+        p.y=y[i];
+        p.z=z[i];
+        points.push_back(p);
     }
+    nbSamples = (int) points.size();
+    buildQuantizedStorage();
 }
 
 inline double SphereFittingProblem::estimErrorForSample(int i)
 {
-    const Point3d & p = this->points[i];
+    const Point3d p = point(i);
     return std::fabs(std::sqrt(std::pow((p.x - this->cx),2)+ std::pow((p.y - this->cy),2) + std::pow((this->cz - p.z),2)) - this->r);
 }
 
 inline void SphereFittingProblem::estimModelFromSamples(const std::vector<int> & samplesIdx)
 {
-    const Point3Dvector & P = this->points;
+    const Point3d p1 = point(samplesIdx[0]), p2 = point(samplesIdx[1]), p3 = point(samplesIdx[2]), p4 = point(samplesIdx[3]);
 
-    const auto & x1 = P[samplesIdx[0]].x, x2 = P[samplesIdx[1]].x, x3 = P[samplesIdx[2]].x, x4 = P[samplesIdx[3]].x;
-    const auto & y1 = P[samplesIdx[0]].y, y2 = P[samplesIdx[1]].y, y3 = P[samplesIdx[2]].y, y4 = P[samplesIdx[3]].y;
-    const auto & z1 = P[samplesIdx[0]].z, z2 = P[samplesIdx[1]].z, z3 = P[samplesIdx[2]].z, z4 = P[samplesIdx[3]].z;
+    const auto & x1 = p1.x, x2 = p2.x, x3 = p3.x, x4 = p4.x;
+    const auto & y1 = p1.y, y2 = p2.y, y3 = p3.y, y4 = p4.y;
+    const auto & z1 = p1.z, z2 = p2.z, z3 = p3.z, z4 = p4.z;
 
     double D = this->determinantFromDataPoints(samplesIdx);
 
@@ -72,11 +105,11 @@ inline void SphereFittingProblem::estimModelFromSamples(const std::vector<int> &
 
 inline double SphereFittingProblem::determinantFromDataPoints(const std::vector<int> & samplesIdx)
 {
-    const Point3Dvector & P = this->points;
+    const Point3d p1 = point(samplesIdx[0]), p2 = point(samplesIdx[1]), p3 = point(samplesIdx[2]), p4 = point(samplesIdx[3]);
 
-    const auto & x1 = P[samplesIdx[0]].x, x2 = P[samplesIdx[1]].x, x3 = P[samplesIdx[2]].x, x4 = P[samplesIdx[3]].x;
-    const auto & y1 = P[samplesIdx[0]].y, y2 = P[samplesIdx[1]].y, y3 = P[samplesIdx[2]].y, y4 = P[samplesIdx[3]].y;
-    const auto & z1 = P[samplesIdx[0]].z, z2 = P[samplesIdx[1]].z, z3 = P[samplesIdx[2]].z, z4 = P[samplesIdx[3]].z;
+    const auto & x1 = p1.x, x2 = p2.x, x3 = p3.x, x4 = p4.x;
+    const auto & y1 = p1.y, y2 = p2.y, y3 = p3.y, y4 = p4.y;
+    const auto & z1 = p1.z, z2 = p2.z, z3 = p3.z, z4 = p4.z;
 
     return  8.0*(x1*(y2*(z3 - z4) + y3*(z4 - z2) + y4*(z2 - z3))\
                + x2*(y1*(z4 - z3) + y3*(z1 - z4) + y4*(z3 - z1))\
@@ -87,4 +120,154 @@ inline double SphereFittingProblem::determinantFromDataPoints(const std::vector<
 bool SphereFittingProblem::isDegenerate(const std::vector<int> & samplesIdx)
 {
     return (std::fabs(this->determinantFromDataPoints(samplesIdx)) < 1e-3);
-}
\ No newline at end of file
+}
+
+void SphereFittingProblem::estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights)
+{
+    // weighted algebraic fit: x^2 + y^2 + z^2 + D*x + E*y + F*z + G = 0,
+    // on coordinates centered at the weighted centroid for conditioning
+    double sw = 0, mx = 0, my = 0, mz = 0;
+    for (int i = 0; i < samplesIdx.size(); i++){
+        const Point3d p = point(samplesIdx[i]);
+        sw += weights[i];
+        mx += weights[i] * p.x;
+        my += weights[i] * p.y;
+        mz += weights[i] * p.z;
+    }
+    if (sw <= 0) return;
+    mx /= sw;
+    my /= sw;
+    mz /= sw;
+
+    std::vector<double> M(16, 0.0), v(4, 0.0);
+    for (int i = 0; i < samplesIdx.size(); i++){
+        const Point3d p = point(samplesIdx[i]);
+        const double row[4] = {p.x - mx, p.y - my, p.z - mz, 1.0};
+        const double f = row[0] * row[0] + row[1] * row[1] + row[2] * row[2];
+        for (int r = 0; r < 4; r++){
+            for (int c = 0; c < 4; c++)
+                M[r * 4 + c] += weights[i] * row[r] * row[c];
+            v[r] -= weights[i] * f * row[r];
+        }
+    }
+
+    std::vector<double> u;
+    if (!robest::linalg::solve(M, v, 4, u)) return;
+
+    double ux = -0.5 * u[0], uy = -0.5 * u[1], uz = -0.5 * u[2];
+    double r2 = ux * ux + uy * uy + uz * uz - u[3];
+    if (r2 <= 0) return;
+
+    this->cx = ux + mx;
+    this->cy = uy + my;
+    this->cz = uz + mz;
+    this->r  = std::sqrt(r2);
+}
+
+bool SphereFittingProblem::getModelParams(std::vector<double> & params) const
+{
+    params = {cx, cy, cz, r};
+    return true;
+}
+
+bool SphereFittingProblem::setModelParams(const std::vector<double> & params)
+{
+    if (params.size() != 4) return false;
+    cx = params[0];
+    cy = params[1];
+    cz = params[2];
+    r  = params[3];
+    return true;
+}
+
+bool SphereFittingProblem::estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const
+{
+    if (params.size() != 4) return false;
+    const double cx = params[0], cy = params[1], cz = params[2], r = params[3];
+    if (source)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            const Point3d p = point(i);
+            errors[i - begin] = std::fabs(std::sqrt((p.x-cx)*(p.x-cx) + (p.y-cy)*(p.y-cy) + (p.z-cz)*(p.z-cz)) - r);
+        }
+        return true;
+    }
+    for (int i = begin; i < end; ++i)
+    {
+        const Point3d & p = points[i];
+        errors[i - begin] = std::fabs(std::sqrt((p.x-cx)*(p.x-cx) + (p.y-cy)*(p.y-cy) + (p.z-cz)*(p.z-cz)) - r);
+    }
+    return true;
+}
+
+void SphereFittingProblem::setQuantizedStorage(int bits, int blockSize, robest::PointSource source)
+{
+    assert((bits == 0 || bits == 16 || bits == 32) && "Quantization on 16 or 32 bits");
+    assert((bits != 0 || !source) && "The points are released only with a quantized copy");
+    restorePoints();
+    quantizedBits = bits;
+    quantizedBlockSize = blockSize;
+    buildQuantizedStorage();
+    if (source && nbSamples > 0)
+    {
+        Point3Dvector().swap(points);
+        this->source = source;
+    }
+}
+
+void SphereFittingProblem::restorePoints()
+{
+    if (!source)
+        return;
+    points.resize(nbSamples);
+    for (int i = 0; i < nbSamples; ++i)
+        points[i] = point(i);
+    source = robest::PointSource();
+}
+
+void SphereFittingProblem::buildQuantizedStorage()
+{
+    points16.clear();
+    points32.clear();
+    if (points.empty())
+        return;
+
+    const double * x = &points[0].x;
+    const double * y = &points[0].y;
+    const double * z = &points[0].z;
+    if (quantizedBits == 16)
+        points16.build(x, y, z, (int) points.size(), 3, quantizedBlockSize);
+    else if (quantizedBits == 32)
+        points32.build(x, y, z, (int) points.size(), 3, quantizedBlockSize);
+}
+
+size_t SphereFittingProblem::getQuantizedMemorySize() const
+{
+    return points16.memorySize() + points32.memorySize();
+}
+
+size_t SphereFittingProblem::getMemorySize() const
+{
+    return points.capacity() * sizeof(Point3d) + getQuantizedMemorySize();
+}
+
+bool SphereFittingProblem::estimApproxErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors, double & errorBound) const
+{
+    if (params.size() != 4 || quantizedBits == 0) return false;
+    const double cx = params[0], cy = params[1], cz = params[2], r = params[3];
+
+    // the error is 1-Lipschitz in the point, plus the rounding of the center and radius
+    if (quantizedBits == 16)
+    {
+        sphereErrors(points16, cx, cy, cz, r, begin, end, errors);
+        errorBound = points16.errorBound(begin, end);
+    }
+    else
+    {
+        sphereErrors(points32, cx, cy, cz, r, begin, end, errors);
+        errorBound = points32.errorBound(begin, end);
+    }
+    errorBound += 1e-12 * (std::fabs(cx) + std::fabs(cy) + std::fabs(cz) + std::fabs(r));
+    return true;
+}
@@ -13,6 +13,7 @@
 #include <iostream>
 
 #include "robust_estim.hpp"
+#include "robust_quantized.hpp"
 
 struct Point3d{
     double x;
@@ -32,9 +33,10 @@ public:
 
     double estimErrorForSample(int i);
     void   estimModelFromSamples(const std::vector<int> & samplesIdx);
+    void   estimModelFromWeightedSamples(const std::vector<int> & samplesIdx, const std::vector<double> & weights);
 
     int getTotalNbSamples() const{
-        return (int) points.size();
+        return nbSamples;
     }
 
     void getResult(double & res_cx, double & res_cy, double & res_cz, double & res_r) const{
@@ -46,6 +48,20 @@ public:
 
     bool isDegenerate(const std::vector<int> & samplesIdx);
 
+    bool getModelParams(std::vector<double> & params) const;
+    bool setModelParams(const std::vector<double> & params);
+    bool estimErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors) const;
+    std::shared_ptr<robest::EstimationProblem> clone() const { return copyOf(*this); }
+
+    // Quantized copy of the points for the batched scoring: bits = 16 or 32, 0 to
+    // disable. With a source, the full precision points are released and read from
+    // the source when needed: use the batched scoring, the other paths read every
+    // point from it. setData stores full precision points again.
+    void setQuantizedStorage(int bits, int blockSize = 1024, robest::PointSource source = robest::PointSource());
+    size_t getQuantizedMemorySize() const;
+    size_t getMemorySize() const;   // points held by the problem, in bytes
+    bool estimApproxErrorsForModel(const std::vector<double> & params, int begin, int end, double * errors, double & errorBound) const;
+
 private:
     double determinantFromDataPoints(const std::vector<int> & samplesIdx);
 
@@ -54,4 +70,25 @@ private:
     double cy = 0;
     double cz = 0;
     double r  = 0;
+
+    void buildQuantizedStorage();
+    void restorePoints();
+
+    // full precision point i, from the source once the points were released
+    Point3d point(int i) const
+    {
+        if (!source)
+            return points[i];
+        Point3d p;
+        source(i, p.x, p.y, p.z);
+        return p;
+    }
+
+    int nbSamples = 0;
+    robest::PointSource source;
+
+    int quantizedBits = 0;
+    int quantizedBlockSize = 1024;
+    robest::QuantizedPoints3d<int16_t> points16;
+    robest::QuantizedPoints3d<int32_t> points32;
 };
\ No newline at end of file
@@ -0,0 +1,353 @@
+/**
+ *  @brief End-to-end throughput and accuracy harness of the estimators
+ *
+ *  Generates a scene of each requested kind (see SceneGenerator), solves it several
+ *  times with each requested estimator and reports per (scene, estimator):
+ *      p50_ms, p90_ms, p99_ms - latency percentiles of the solves
+ *      Mres_s                 - residuals evaluated per second (from SolverStats)
+ *      err                    - median error of the model against structure 0
+ *      success                - share of the solves whose error is below --max-error
+ *      recall, precision      - mean, of the inliers against the points of structure 0
+ *
+ *  The solves run the iterations needed to reach --confidence for the share of
+ *  structure 0 in the scene. Thresholds given on the command line are checked for
+ *  every row: the exit status is 1 if one of them fails, so that the harness can
+ *  fail a CTest regression run. A zero threshold is not checked. The throughput
+ *  floor can be given per estimator, e.g. --min-throughput msac=5,magsac=2.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include "robust_estim.hpp"
+#include "SceneGenerator/SceneGenerator.hpp"
+
+namespace {
+
+struct Options
+{
+    std::vector<std::string> scenes = {"lines", "circles", "planes", "spheres"};
+    std::vector<std::string> estimators = {"ransac", "msac", "lmeds", "magsac", "sweep"};
+    scene::SceneOptions scene;
+    double threshold = 0.0;       // 3 * noise if 0
+    double confidence = 0.99;
+    int nbSolves = 10;
+    int nbThreads = 0;            // OpenMP default if 0
+    int maxIterations = 10000;
+    std::string csvPath;
+
+    double maxError = 0.05;
+    double minSuccess = 0.0;
+    double minRecall = 0.0;
+    double minPrecision = 0.0;
+    double minThroughput = 0.0;   // millions of residuals per second
+    std::map<std::string, double> minThroughputOf;  // per estimator, instead of minThroughput
+    double maxP99 = 0.0;          // milliseconds
+};
+
+struct Row
+{
+    std::string scene, estimator;
+    int nbIterations = 0;
+    double p50 = 0.0, p90 = 0.0, p99 = 0.0;
+    double throughput = 0.0;
+    double error = 0.0, success = 0.0, recall = 0.0, precision = 0.0;
+    std::vector<std::string> failures;
+};
+
+void usage()
+{
+    std::printf(
+        "Usage: robest_e2e [options]\n"
+        "  scenes and solves:\n"
+        "    --scenes LIST          lines,circles,planes,spheres (default all)\n"
+        "    --estimators LIST      ransac,msac,lmeds,magsac,sweep (default all)\n"
+        "    --points N             points per scene (10000)\n"
+        "    --structures K         structures per scene, 0 is the dominant one (1)\n"
+        "    --outliers R           outliers ratio (0.3)\n"
+        "    --noise S              noise sigma (0.01)\n"
+        "    --clustering C         share of the inliers in clusters (0)\n"
+        "    --degeneracy D         share of the inliers on a degenerate subset (0)\n"
+        "    --seed S               seed of the scenes (42)\n"
+        "    --threshold T          threshold of the solves (3 * noise)\n"
+        "    --confidence P         confidence the iterations are computed for (0.99)\n"
+        "    --solves N             solves per scene and estimator (10)\n"
+        "    --threads N            OpenMP threads (default)\n"
+        "    --max-iterations N     cap of the iterations per solve (10000)\n"
+        "    --csv PATH             also writes the rows to a CSV file\n"
+        "  regression thresholds, 0 to disable:\n"
+        "    --max-error E          error of a successful solve (0.05)\n"
+        "    --min-success F        share of successful solves (0)\n"
+        "    --min-recall R         mean recall of structure 0 (0)\n"
+        "    --min-precision P      mean precision of structure 0 (0)\n"
+        "    --min-throughput M     millions of residuals per second (0), or\n"
+        "                           per estimator: NAME=M,... (others unchecked)\n"
+        "    --max-p99 MS           99th percentile of the latency (0)\n");
+}
+
+std::vector<std::string> split(const std::string & list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+// M for every estimator, or NAME=M,... for each named one
+bool parseThroughputs(const std::string & value, Options & options)
+{
+    if (value.find('=') == std::string::npos)
+    {
+        options.minThroughput = std::atof(value.c_str());
+        return true;
+    }
+    for (const std::string & item : split(value))
+    {
+        const size_t equal = item.find('=');
+        if (equal == std::string::npos || equal == 0)
+            return false;
+        options.minThroughputOf[item.substr(0, equal)] = std::atof(item.c_str() + equal + 1);
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char ** argv, Options & options)
+{
+    for (int a = 1; a < argc; ++a)
+    {
+        const std::string name = argv[a];
+        if (name == "--help" || name == "-h" || a + 1 >= argc)
+            return false;
+        const char * value = argv[++a];
+
+        if      (name == "--scenes")         options.scenes = split(value);
+        else if (name == "--estimators")     options.estimators = split(value);
+        else if (name == "--points")         options.scene.nbPoints = std::atoi(value);
+        else if (name == "--structures")     options.scene.nbStructures = std::atoi(value);
+        else if (name == "--outliers")       options.scene.outliersRatio = std::atof(value);
+        else if (name == "--noise")          options.scene.noiseSigma = std::atof(value);
+        else if (name == "--clustering")     options.scene.clustering = std::atof(value);
+        else if (name == "--degeneracy")     options.scene.degeneracy = std::atof(value);
+        else if (name == "--seed")           options.scene.seed = (unsigned) std::atol(value);
+        else if (name == "--threshold")      options.threshold = std::atof(value);
+        else if (name == "--confidence")     options.confidence = std::atof(value);
+        else if (name == "--solves")         options.nbSolves = std::atoi(value);
+        else if (name == "--threads")        options.nbThreads = std::atoi(value);
+        else if (name == "--max-iterations") options.maxIterations = std::atoi(value);
+        else if (name == "--csv")            options.csvPath = value;
+        else if (name == "--max-error")      options.maxError = std::atof(value);
+        else if (name == "--min-success")    options.minSuccess = std::atof(value);
+        else if (name == "--min-recall")     options.minRecall = std::atof(value);
+        else if (name == "--min-precision")  options.minPrecision = std::atof(value);
+        else if (name == "--min-throughput")
+        {
+            if (!parseThroughputs(value, options))
+                return false;
+        }
+        else if (name == "--max-p99")        options.maxP99 = std::atof(value);
+        else
+        {
+            std::fprintf(stderr, "Unknown option %s\n", name.c_str());
+            return false;
+        }
+    }
+
+    const scene::SceneOptions & s = options.scene;
+    return s.nbPoints > 0 && s.nbStructures > 0 && s.outliersRatio >= 0.0 && s.outliersRatio < 1.0
+        && s.clustering >= 0.0 && s.degeneracy >= 0.0 && s.clustering + s.degeneracy <= 1.0
+        && options.confidence > 0.0 && options.confidence < 1.0 && options.nbSolves > 0 && options.maxIterations > 0;
+}
+
+std::unique_ptr<robest::AbstractEstimator> makeEstimator(const std::string & name)
+{
+    std::unique_ptr<robest::AbstractEstimator> estimator;
+    if      (name == "ransac") estimator.reset(new robest::RANSAC());
+    else if (name == "msac")   estimator.reset(new robest::MSAC());
+    else if (name == "lmeds")  estimator.reset(new robest::LMedS());
+    else if (name == "magsac") estimator.reset(new robest::MAGSAC());
+    else if (name == "sweep")  estimator.reset(new robest::ThresholdSweep());
+    return estimator;
+}
+
+// Nearest rank percentile of sorted values
+double percentile(const std::vector<double> & sorted, double p)
+{
+    size_t rank = (size_t) std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+Row run(const scene::Scene & scene, std::shared_ptr<robest::EstimationProblem> problem,
+        const std::string & estimatorName, const Options & options)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Row row;
+    row.scene = scene::sceneKindName(scene.kind);
+    row.estimator = estimatorName;
+
+    const int nbTruth = scene.count(0);
+    const float inliersRatio = (float) nbTruth / scene.size();
+    const double threshold = options.threshold > 0.0 ? options.threshold : 3.0 * options.scene.noiseSigma;
+
+    std::vector<double> latencies, errors;
+    long long nbResiduals = 0;
+    double totalTime = 0.0;
+    for (int solve = 0; solve < options.nbSolves; ++solve)
+    {
+        std::unique_ptr<robest::AbstractEstimator> solver = makeEstimator(estimatorName);
+        row.nbIterations = std::min(options.maxIterations,
+                                    solver->calculateIterationsNb(scene::nbMinSamples(scene.kind), (float) options.confidence, inliersRatio));
+
+        Clock::time_point start = Clock::now();
+        solver->solve(problem, threshold, row.nbIterations);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        latencies.push_back(1e3 * seconds);
+        totalTime += seconds;
+        nbResiduals += solver->getStats().nbResiduals;
+
+        std::vector<double> model;
+        problem->getModelParams(model);
+        double error = scene::modelError(scene.kind, model, scene.models[0]);
+        errors.push_back(error);
+        row.success += error < options.maxError;
+
+        const std::vector<int> & inliers = solver->getInliersIndices();
+        int nbTrue = 0;
+        for (int i : inliers)
+            nbTrue += scene.labels[i] == 0;
+        row.recall += nbTruth > 0 ? (double) nbTrue / nbTruth : 1.0;
+        row.precision += inliers.empty() ? 0.0 : (double) nbTrue / inliers.size();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(errors.begin(), errors.end());
+    row.p50 = percentile(latencies, 50.0);
+    row.p90 = percentile(latencies, 90.0);
+    row.p99 = percentile(latencies, 99.0);
+    row.throughput = totalTime > 0.0 ? 1e-6 * nbResiduals / totalTime : 0.0;
+    row.error = percentile(errors, 50.0);
+    row.success /= options.nbSolves;
+    row.recall /= options.nbSolves;
+    row.precision /= options.nbSolves;
+
+    char failure[128];
+    if (options.minSuccess > 0.0 && row.success < options.minSuccess)
+    {
+        std::snprintf(failure, sizeof(failure), "success %.2f < %.2f", row.success, options.minSuccess);
+        row.failures.push_back(failure);
+    }
+    if (options.minRecall > 0.0 && row.recall < options.minRecall)
+    {
+        std::snprintf(failure, sizeof(failure), "recall %.3f < %.3f", row.recall, options.minRecall);
+        row.failures.push_back(failure);
+    }
+    if (options.minPrecision > 0.0 && row.precision < options.minPrecision)
+    {
+        std::snprintf(failure, sizeof(failure), "precision %.3f < %.3f", row.precision, options.minPrecision);
+        row.failures.push_back(failure);
+    }
+    double minThroughput = options.minThroughput;
+    if (!options.minThroughputOf.empty())
+    {
+        auto floor = options.minThroughputOf.find(estimatorName);
+        minThroughput = floor != options.minThroughputOf.end() ? floor->second : 0.0;
+    }
+    if (minThroughput > 0.0 && row.throughput < minThroughput)
+    {
+        std::snprintf(failure, sizeof(failure), "throughput %.1f < %.1f Mres/s", row.throughput, minThroughput);
+        row.failures.push_back(failure);
+    }
+    if (options.maxP99 > 0.0 && row.p99 > options.maxP99)
+    {
+        std::snprintf(failure, sizeof(failure), "p99 %.2f > %.2f ms", row.p99, options.maxP99);
+        row.failures.push_back(failure);
+    }
+    return row;
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        usage();
+        return 2;
+    }
+    for (const std::string & name : options.estimators)
+    {
+        if (!makeEstimator(name))
+        {
+            std::fprintf(stderr, "Unknown estimator %s\n", name.c_str());
+            return 2;
+        }
+    }
+    if (options.nbThreads > 0)
+        omp_set_num_threads(options.nbThreads);
+
+    std::printf("%d points, %d structures, %.0f%% outliers, noise %g, clustering %g, degeneracy %g, %d threads\n",
+                options.scene.nbPoints, options.scene.nbStructures, 100.0 * options.scene.outliersRatio,
+                options.scene.noiseSigma, options.scene.clustering, options.scene.degeneracy, omp_get_max_threads());
+    std::printf("%-8s %-7s %6s %9s %9s %9s %8s %9s %8s %7s %9s  %s\n",
+                "scene", "estim", "iters", "p50_ms", "p90_ms", "p99_ms", "Mres_s", "err", "success", "recall", "precision", "status");
+
+    std::vector<Row> rows;
+    bool passed = true;
+    for (const std::string & sceneName : options.scenes)
+    {
+        scene::SceneKind kind;
+        if (!scene::parseSceneKind(sceneName, kind))
+        {
+            std::fprintf(stderr, "Unknown scene %s\n", sceneName.c_str());
+            return 2;
+        }
+        scene::Scene scene = scene::generateScene(kind, options.scene);
+        std::shared_ptr<robest::EstimationProblem> problem = scene::makeProblem(scene);
+
+        for (const std::string & estimatorName : options.estimators)
+        {
+            Row row = run(scene, problem, estimatorName, options);
+            std::printf("%-8s %-7s %6d %9.3f %9.3f %9.3f %8.1f %9.2e %8.2f %7.3f %9.3f  %s\n",
+                        row.scene.c_str(), row.estimator.c_str(), row.nbIterations, row.p50, row.p90, row.p99,
+                        row.throughput, row.error, row.success, row.recall, row.precision, row.failures.empty() ? "ok" : "FAIL");
+            for (const std::string & failure : row.failures)
+                std::printf("    %s\n", failure.c_str());
+            passed = passed && row.failures.empty();
+            rows.push_back(row);
+        }
+    }
+
+    if (!options.csvPath.empty())
+    {
+        std::ofstream csv(options.csvPath);
+        csv << "scene,estimator,points,iterations,p50_ms,p90_ms,p99_ms,Mres_s,err,success,recall,precision,passed\n";
+        for (const Row & row : rows)
+            csv << row.scene << "," << row.estimator << "," << options.scene.nbPoints << "," << row.nbIterations << ","
+                << row.p50 << "," << row.p90 << "," << row.p99 << "," << row.throughput << "," << row.error << ","
+                << row.success << "," << row.recall << "," << row.precision << "," << row.failures.empty() << "\n";
+        if (!csv)
+        {
+            std::fprintf(stderr, "Cannot write %s\n", options.csvPath.c_str());
+            return 2;
+        }
+    }
+
+    std::printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
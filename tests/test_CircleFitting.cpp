@@ -163,3 +163,43 @@ TEST(CircleFitting, isDegenerate)
     circleFitting->setData(x3,y3);
     ASSERT_TRUE(!circleFitting->isDegenerate({0,1,2}));
 }
+
+TEST(CircleFitting, weightedFit)
+{
+    // points on the circle C(2,-1), r = 3, the last one is an outlier with zero weight
+    std::vector<double> x, y;
+    for (int i = 0; i < 8; i++){
+        x.push_back(2.0 + 3.0 * cos(0.7 * i));
+        y.push_back(-1.0 + 3.0 * sin(0.7 * i));
+    }
+    x.push_back(10);
+    y.push_back(10);
+
+    auto circleFitting = std::make_shared<CircleFittingProblem>();
+    circleFitting->setData(x,y);
+    circleFitting->estimModelFromWeightedSamples({0,1,2,3,4,5,6,7,8}, {1,1,0.5,1,2,1,0.1,1,0});
+
+    double res_cx,res_cy,res_r;
+    circleFitting->getResult(res_cx,res_cy,res_r);
+
+    ASSERT_NEAR( 2.0, res_cx, 1.0e-11);
+    ASSERT_NEAR(-1.0, res_cy, 1.0e-11);
+    ASSERT_NEAR( 3.0,  res_r, 1.0e-11);
+}
+
+TEST(CircleFitting, errorsForModel)
+{
+    std::vector<double> x, y;
+    generateCircleData(1.0, -2.0, 5.0, 0.3, 1.0, x, y);
+
+    auto circleFitting = std::make_shared<CircleFittingProblem>();
+    circleFitting->setData(x, y);
+
+    std::vector<double> errors(10);
+    ASSERT_TRUE(circleFitting->estimErrorsForModel({1.5, -2.0, 4.0}, 5, 15, errors.data()));
+    EXPECT_FALSE(circleFitting->estimErrorsForModel({1.5, -2.0}, 0, 1, errors.data()));
+
+    circleFitting->setModelParams({1.5, -2.0, 4.0});
+    for (int i = 0; i < 10; ++i)
+        EXPECT_NEAR(circleFitting->estimErrorForSample(5 + i), errors[i], 1.0e-12);
+}
@@ -0,0 +1,183 @@
+#include "gtest/gtest.h"
+
+#include <random>
+
+#include "CylinderFitting/CylinderFitting.hpp"
+
+namespace {
+
+// axis through c0 along a0 = (2, -1, 2) / 3, radius r0
+const double c0[3] = {1.0, 0.0, 2.0};
+const double a0[3] = {2.0 / 3.0, -1.0 / 3.0, 2.0 / 3.0};
+const double r0 = 2.0;
+
+// nbPts oriented points, the first nbOutliers random, the next nbWrongNormals on
+// the cylinder with random normals
+void generatePoints(int nbPts, int nbOutliers, int nbWrongNormals, double noise,
+                    std::vector<double> & x, std::vector<double> & y, std::vector<double> & z,
+                    std::vector<double> & nx, std::vector<double> & ny, std::vector<double> & nz)
+{
+    std::default_random_engine generator(9);
+    std::uniform_real_distribution<double> uniform(-5.0, 5.0), angle(0.0, 2.0 * M_PI);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+
+    // e1, e2: orthonormal basis of the plane orthogonal to the axis
+    const double e1[3] = {1.0 / std::sqrt(2.0), 0.0, -1.0 / std::sqrt(2.0)};
+    const double e2[3] = {a0[1] * e1[2] - a0[2] * e1[1], a0[2] * e1[0] - a0[0] * e1[2], a0[0] * e1[1] - a0[1] * e1[0]};
+
+    for (int i = 0; i < nbPts; i++){
+        const double h = uniform(generator), theta = angle(generator);
+        const double rad = r0 + noise * gaussian(generator);
+        double p[3], n[3];
+        for (int k = 0; k < 3; k++){
+            n[k] = std::cos(theta) * e1[k] + std::sin(theta) * e2[k];
+            p[k] = c0[k] + h * a0[k] + rad * n[k];
+        }
+        if (i < nbOutliers)
+            for (int k = 0; k < 3; k++)
+                p[k] = uniform(generator);
+        if (i < nbOutliers + nbWrongNormals)
+            for (int k = 0; k < 3; k++)
+                n[k] = gaussian(generator);
+        else
+            for (int k = 0; k < 3; k++)
+                n[k] += noise * gaussian(generator);
+
+        x.push_back(p[0]); y.push_back(p[1]); z.push_back(p[2]);
+        nx.push_back(n[0]); ny.push_back(n[1]); nz.push_back(n[2]);
+    }
+}
+
+// same axis direction (up to the sign), c0 on the axis, same radius
+void expectCylinder(std::shared_ptr<CylinderFittingProblem> cylinderFitting, double tol)
+{
+    std::vector<double> c, a;
+    double r;
+    cylinderFitting->getResult(c, a, r);
+
+    const double sign = a[0] * a0[0] + a[1] * a0[1] + a[2] * a0[2] > 0 ? 1.0 : -1.0;
+    for (int k = 0; k < 3; k++)
+        EXPECT_NEAR(a0[k], sign * a[k], tol);
+
+    const double v[3] = {c0[0] - c[0], c0[1] - c[1], c0[2] - c[2]};
+    const double h = v[0] * a[0] + v[1] * a[1] + v[2] * a[2];
+    for (int k = 0; k < 3; k++)
+        EXPECT_NEAR(0.0, v[k] - h * a[k], tol);
+    EXPECT_NEAR(r0, r, tol);
+}
+
+} // namespace
+
+TEST(CylinderFitting, idealCase)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(100, 0, 0, 0.0, x, y, z, nx, ny, nz);
+
+    auto cylinderFitting = std::make_shared<CylinderFittingProblem>();
+    cylinderFitting->setData(x, y, z, nx, ny, nz);
+
+    robest::MSAC solver;
+    solver.solve(cylinderFitting, 0.01, 5);
+
+    expectCylinder(cylinderFitting, 1.0e-9);
+    EXPECT_EQ(100u, solver.getInliersIndices().size());
+}
+
+TEST(CylinderFitting, outliers)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(1000, 700, 0, 0.0001, x, y, z, nx, ny, nz);
+
+    auto cylinderFitting = std::make_shared<CylinderFittingProblem>();
+    cylinderFitting->setData(x, y, z, nx, ny, nz);
+
+    robest::RANSAC ransac;
+    ransac.solve(cylinderFitting, 0.01, 100);
+    expectCylinder(cylinderFitting, 5.0e-2);
+
+    // no refit: the accuracy of the best minimal sample. MSAC compares the
+    // squared errors to the threshold
+    robest::MSAC msac;
+    msac.solve(cylinderFitting, 1.0e-4, 100);
+    expectCylinder(cylinderFitting, 5.0e-2);
+}
+
+TEST(CylinderFitting, normalDeviation)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(1000, 300, 200, 0.0, x, y, z, nx, ny, nz);
+
+    auto cylinderFitting = std::make_shared<CylinderFittingProblem>();
+    cylinderFitting->setData(x, y, z, nx, ny, nz);
+
+    // a few random points may lie on the cylinder with a radial normal
+    robest::RANSAC solver;
+    solver.solve(cylinderFitting, 0.01, 200);
+    expectCylinder(cylinderFitting, 5.0e-2);
+    EXPECT_GE(solver.getInliersIndices().size(), 500u);
+    EXPECT_LE(solver.getInliersIndices().size(), 505u);
+
+    cylinderFitting->setNormalWeight(0.0);
+    for (int i = 300; i < 500; i++)
+        EXPECT_LT(cylinderFitting->estimErrorForSample(i), 0.01);
+}
+
+TEST(CylinderFitting, isDegenerate)
+{
+    std::vector<double> x = {0.0, 1.0, 2.0}, y = {0.0, 0.0, 0.0}, z = {0.0, 0.0, 1.0};
+    std::vector<double> nx = {0.0, 0.0, 1.0}, ny = {0.0, 0.0, 0.0}, nz = {1.0, -1.0, 0.0};
+
+    auto cylinderFitting = std::make_shared<CylinderFittingProblem>();
+    cylinderFitting->setData(x, y, z, nx, ny, nz);
+    EXPECT_TRUE(cylinderFitting->isDegenerate({0, 1}));
+    EXPECT_FALSE(cylinderFitting->isDegenerate({0, 2}));
+}
+
+TEST(CylinderFitting, weightedFit)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(50, 0, 0, 0.0, x, y, z, nx, ny, nz);
+    x.push_back(20.0); y.push_back(0.0); z.push_back(0.0);
+    nx.push_back(0.0); ny.push_back(1.0); nz.push_back(0.0);
+
+    std::vector<int> idx;
+    std::vector<double> weights;
+    for (int i = 0; i < x.size(); i++){
+        idx.push_back(i);
+        weights.push_back(i == 50 ? 0.0 : 1.0 + i % 3);
+    }
+
+    auto cylinderFitting = std::make_shared<CylinderFittingProblem>();
+    cylinderFitting->setData(x, y, z, nx, ny, nz);
+    cylinderFitting->estimModelFromWeightedSamples(idx, weights);
+    expectCylinder(cylinderFitting, 1.0e-9);
+}
+
+TEST(CylinderFitting, errorsForModel)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(40, 10, 10, 0.01, x, y, z, nx, ny, nz);
+
+    auto cylinderFitting = std::make_shared<CylinderFittingProblem>();
+    cylinderFitting->setData(x, y, z, nx, ny, nz);
+    cylinderFitting->setNormalWeight(0.5);
+
+    // axis z through (1, 1, 0)
+    const std::vector<double> params = {1.0, 1.0, 0.0, 0.0, 0.0, 1.0, 1.5};
+    std::vector<double> errors(30);
+    ASSERT_TRUE(cylinderFitting->estimErrorsForModel(params, 5, 35, errors.data()));
+    EXPECT_FALSE(cylinderFitting->estimErrorsForModel({1.0, 2.0}, 0, 1, errors.data()));
+
+    ASSERT_TRUE(cylinderFitting->setModelParams(params));
+    std::vector<double> current;
+    ASSERT_TRUE(cylinderFitting->getModelParams(current));
+    EXPECT_EQ(params, current);
+    for (int i = 0; i < 30; ++i){
+        const int k = 5 + i;
+        const double len = std::hypot(x[k] - 1.0, y[k] - 1.0);
+        const double nn = std::sqrt(nx[k] * nx[k] + ny[k] * ny[k] + nz[k] * nz[k]);
+        const double deviation = 1.0 - std::fabs(nx[k] * (x[k] - 1.0) + ny[k] * (y[k] - 1.0)) / (nn * len);
+        EXPECT_NEAR(std::max(std::fabs(len - 1.5), 0.5 * deviation), errors[i], 1.0e-12);
+        EXPECT_NEAR(cylinderFitting->estimErrorForSample(k), errors[i], 1.0e-12);
+    }
+}
@@ -0,0 +1,213 @@
+#include "gtest/gtest.h"
+
+#include <numeric>
+#include <random>
+
+#include "HomographyFitting/HomographyFitting.hpp"
+
+namespace {
+
+// perspective view of a 640x480 image
+const std::vector<double> Htrue = {0.9, 0.05, 30.0,
+                                   -0.1, 1.1, 10.0,
+                                   1.0e-4, -2.0e-4, 1.0};
+
+void project(const std::vector<double> & H, double x, double y, double & u, double & v)
+{
+    const double w = H[6] * x + H[7] * y + H[8];
+    u = (H[0] * x + H[1] * y + H[2]) / w;
+    v = (H[3] * x + H[4] * y + H[5]) / w;
+}
+
+// nbPts correspondences q = H(p) (+ noise), the first nbOutliers target points being random
+void generateCorrespondences(int nbPts, int nbOutliers, double noise,
+                             std::vector<double> & px, std::vector<double> & py,
+                             std::vector<double> & qx, std::vector<double> & qy)
+{
+    std::default_random_engine generator(11);
+    std::uniform_real_distribution<double> ux(0.0, 640.0), uy(0.0, 480.0);
+    std::normal_distribution<double> gaussian(0.0, noise > 0 ? noise : 1.0);
+
+    for (int i = 0; i < nbPts; i++){
+        const double x = ux(generator), y = uy(generator);
+        double u, v;
+        project(Htrue, x, y, u, v);
+        if (i < nbOutliers){
+            u = ux(generator);
+            v = uy(generator);
+        }
+        else if (noise > 0){
+            u += gaussian(generator);
+            v += gaussian(generator);
+        }
+        px.push_back(x);
+        py.push_back(y);
+        qx.push_back(u);
+        qy.push_back(v);
+    }
+}
+
+// the image corners are mapped where the true homography maps them
+void expectHomography(std::shared_ptr<HomographyFittingProblem> homographyFitting, double tol)
+{
+    std::vector<double> resH;
+    homographyFitting->getResult(resH);
+    EXPECT_DOUBLE_EQ(1.0, resH[8]);
+
+    const double corners[4][2] = {{0.0, 0.0}, {640.0, 0.0}, {640.0, 480.0}, {0.0, 480.0}};
+    for (int k = 0; k < 4; k++){
+        double u, v, resu, resv;
+        project(Htrue, corners[k][0], corners[k][1], u, v);
+        project(resH, corners[k][0], corners[k][1], resu, resv);
+        EXPECT_NEAR(u, resu, tol);
+        EXPECT_NEAR(v, resv, tol);
+    }
+}
+
+} // namespace
+
+TEST(HomographyFitting, idealCase)
+{
+    std::vector<double> px, py, qx, qy;
+    generateCorrespondences(100, 0, 0.0, px, py, qx, qy);
+
+    auto homographyFitting = std::make_shared<HomographyFittingProblem>();
+    homographyFitting->setData(px, py, qx, qy);
+
+    robest::MSAC solver;
+    solver.solve(homographyFitting, 0.5, 20);
+
+    expectHomography(homographyFitting, 1.0e-6);
+    EXPECT_EQ(100u, solver.getInliersIndices().size());
+}
+
+TEST(HomographyFitting, minimalSample)
+{
+    std::vector<double> px, py, qx, qy;
+    generateCorrespondences(4, 0, 0.0, px, py, qx, qy);
+
+    auto homographyFitting = std::make_shared<HomographyFittingProblem>();
+    homographyFitting->setData(px, py, qx, qy);
+    ASSERT_FALSE(homographyFitting->isDegenerate({0, 1, 2, 3}));
+    homographyFitting->estimModelFromSamples({0, 1, 2, 3});
+
+    expectHomography(homographyFitting, 1.0e-6);
+    for (int i = 0; i < 4; i++)
+        EXPECT_NEAR(0.0, homographyFitting->estimErrorForSample(i), 1.0e-8);
+}
+
+TEST(HomographyFitting, outliers)
+{
+    std::vector<double> px, py, qx, qy;
+    generateCorrespondences(1000, 400, 0.5, px, py, qx, qy);
+
+    auto homographyFitting = std::make_shared<HomographyFittingProblem>();
+    homographyFitting->setData(px, py, qx, qy);
+
+    // the refit on the inliers averages the noise out
+    robest::RANSAC ransac;
+    ransac.solve(homographyFitting, 2.0, 300);
+    expectHomography(homographyFitting, 1.5);
+
+    robest::MSAC msac;
+    msac.solve(homographyFitting, 4.0, 300);
+    expectHomography(homographyFitting, 5.0);
+    EXPECT_NEAR(0.6, msac.getInliersFraction(), 0.02);
+
+    robest::LMedS lmeds;
+    lmeds.solve(homographyFitting, 2.0, 300);
+    expectHomography(homographyFitting, 1.5);
+}
+
+TEST(HomographyFitting, symmetricError)
+{
+    std::vector<double> px, py, qx, qy;
+    generateCorrespondences(200, 50, 0.0, px, py, qx, qy);
+
+    auto homographyFitting = std::make_shared<HomographyFittingProblem>();
+    homographyFitting->setData(px, py, qx, qy);
+    homographyFitting->setSymmetricError(true);
+
+    robest::RANSAC solver;
+    solver.solve(homographyFitting, 0.5, 100);
+    expectHomography(homographyFitting, 1.0e-6);
+    EXPECT_EQ(150u, solver.getInliersIndices().size());
+
+    // the symmetric error adds the error of the inverse mapping
+    const std::vector<double> shift = {1.0, 0.0, 5.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+    homographyFitting->setModelParams(shift);
+    std::vector<double> errors(1);
+    homographyFitting->estimErrorsForModel(shift, 60, 61, errors.data());
+    double u, v;
+    project(Htrue, px[60], py[60], u, v);
+    const double forward = std::hypot(px[60] + 5.0 - u, py[60] - v);
+    const double backward = std::hypot(u - 5.0 - px[60], v - py[60]);
+    EXPECT_NEAR(std::hypot(forward, backward), errors[0], 1.0e-9);
+    EXPECT_NEAR(errors[0], homographyFitting->estimErrorForSample(60), 1.0e-12);
+}
+
+TEST(HomographyFitting, isDegenerate)
+{
+    // the unit square mapped on: a larger square, the same square with two corners
+    // swapped (a fold), its mirror image, then four points on a line
+    std::vector<double> px = {0.0, 1.0, 1.0, 0.0,  0.0, 1.0, 1.0, 0.0,  0.0, 1.0, 1.0, 0.0,  0.0, 1.0, 2.0, 3.0};
+    std::vector<double> py = {0.0, 0.0, 1.0, 1.0,  0.0, 0.0, 1.0, 1.0,  0.0, 0.0, 1.0, 1.0,  0.0, 1.0, 2.0, 3.0};
+    std::vector<double> qx = {0.0, 2.0, 2.0, 0.0,  0.0, 2.0, 0.0, 2.0,  0.0, -1.0, -1.0, 0.0,  5.0, 6.0, 7.0, 8.0};
+    std::vector<double> qy = {0.0, 0.0, 2.0, 2.0,  0.0, 0.0, 2.0, 2.0,  0.0, 0.0, 1.0, 1.0,  1.0, 3.0, 2.0, 4.0};
+
+    auto homographyFitting = std::make_shared<HomographyFittingProblem>();
+    homographyFitting->setData(px, py, qx, qy);
+
+    EXPECT_FALSE(homographyFitting->isDegenerate({0, 1, 2, 3}));
+    EXPECT_TRUE(homographyFitting->isDegenerate({4, 5, 6, 7}));     // fold
+    EXPECT_FALSE(homographyFitting->isDegenerate({8, 9, 10, 11}));  // mirror: all orientations reversed
+    EXPECT_TRUE(homographyFitting->isDegenerate({12, 13, 14, 0}));  // collinear source points
+    EXPECT_TRUE(homographyFitting->isDegenerate({0, 1, 1, 3}));     // repeated correspondence
+}
+
+TEST(HomographyFitting, weightedFit)
+{
+    std::vector<double> px, py, qx, qy;
+    generateCorrespondences(50, 0, 0.0, px, py, qx, qy);
+
+    // one outlier with zero weight
+    px.push_back(10.0); py.push_back(10.0);
+    qx.push_back(500.0); qy.push_back(20.0);
+
+    std::vector<int> idx(px.size());
+    std::iota(idx.begin(), idx.end(), 0);
+    std::vector<double> weights(px.size(), 1.0);
+    weights.back() = 0.0;
+    weights[5] = 0.2;
+
+    auto homographyFitting = std::make_shared<HomographyFittingProblem>();
+    homographyFitting->setData(px, py, qx, qy);
+    homographyFitting->estimModelFromWeightedSamples(idx, weights);
+    expectHomography(homographyFitting, 1.0e-6);
+}
+
+TEST(HomographyFitting, errorsForModel)
+{
+    std::vector<double> px, py, qx, qy;
+    generateCorrespondences(40, 10, 0.5, px, py, qx, qy);
+
+    auto homographyFitting = std::make_shared<HomographyFittingProblem>();
+    homographyFitting->setData(px, py, qx, qy);
+
+    const std::vector<double> params = {1.1, 0.1, -20.0, 0.0, 0.9, 15.0, 2.0e-4, 1.0e-4, 1.0};
+
+    std::vector<double> errors(30);
+    ASSERT_TRUE(homographyFitting->estimErrorsForModel(params, 5, 35, errors.data()));
+    EXPECT_FALSE(homographyFitting->estimErrorsForModel({1.0, 2.0}, 0, 1, errors.data()));
+
+    ASSERT_TRUE(homographyFitting->setModelParams(params));
+    std::vector<double> current;
+    ASSERT_TRUE(homographyFitting->getModelParams(current));
+    EXPECT_EQ(params, current);
+    for (int i = 0; i < 30; ++i){
+        double u, v;
+        project(params, px[5 + i], py[5 + i], u, v);
+        EXPECT_NEAR(std::hypot(u - qx[5 + i], v - qy[5 + i]), errors[i], 1.0e-9);
+        EXPECT_NEAR(homographyFitting->estimErrorForSample(5 + i), errors[i], 1.0e-12);
+    }
+}
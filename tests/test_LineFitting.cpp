@@ -208,3 +208,38 @@ TEST(LineFitting, noiseCaseMSAC)
     ASSERT_NEAR(k, res_k, 1.0e-11);
     ASSERT_NEAR(b, res_b, 1.0e-11);
 }
+
+TEST(LineFitting, weightedFit)
+{
+    // points on y = 0.7*x - 1.5, the last two are outliers with zero weight
+    std::vector<double> x = {0, 1, 2, 3, 4, 5, 2, 7};
+    std::vector<double> y = {-1.5, -0.8, -0.1, 0.6, 1.3, 2.0, 10, -4};
+
+    auto lineFitting = std::make_shared<LineFittingProblem>();
+    lineFitting->setData(x, y);
+    lineFitting->estimModelFromWeightedSamples({0, 1, 2, 3, 4, 5, 6, 7}, {1, 0.5, 2, 1, 0.3, 1, 0, 0});
+
+    double res_k, res_b;
+    lineFitting->getResult(res_k, res_b);
+
+    ASSERT_NEAR( 0.7, res_k, 1.0e-11);
+    ASSERT_NEAR(-1.5, res_b, 1.0e-11);
+}
+
+TEST(LineFitting, errorsForModel)
+{
+    std::vector<double> x, y;
+    generateLineData(0.5, 2.0, 0.3, 1.0, x, y);
+
+    auto lineFitting = std::make_shared<LineFittingProblem>();
+    lineFitting->setData(x, y);
+
+    // same errors as estimErrorForSample, on a sub-range, without setting the model
+    std::vector<double> errors(10);
+    ASSERT_TRUE(lineFitting->estimErrorsForModel({0.4, 2.5}, 5, 15, errors.data()));
+    EXPECT_FALSE(lineFitting->estimErrorsForModel({0.4}, 0, 1, errors.data()));
+
+    lineFitting->setModelParams({0.4, 2.5});
+    for (int i = 0; i < 10; ++i)
+        EXPECT_NEAR(lineFitting->estimErrorForSample(5 + i), errors[i], 1.0e-12);
+}
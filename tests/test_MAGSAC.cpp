@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+
+#include "SceneGenerator/ReferenceLine.hpp"
+#include "SceneGenerator/ReferencePlane.hpp"
+
+TEST(MAGSAC, incompleteGamma)
+{
+    // P(1,x) = 1 - exp(-x), Q(1/2,x) = erfc(sqrt(x))
+    for (double x : {0.01, 0.5, 1.0, 2.0, 5.0, 20.0})
+    {
+        EXPECT_NEAR(1.0 - std::exp(-x), robest::detail::regularizedLowerGamma(1.0, x), 1.0e-12);
+        EXPECT_NEAR(std::erfc(std::sqrt(x)), robest::detail::regularizedUpperGamma(0.5, x), 1.0e-12);
+    }
+}
+
+TEST(MAGSAC, sigmaConsensusTable)
+{
+    robest::SigmaConsensusTable table(2, 0.99);
+
+    // sqrt of the 99% quantile of chi-squared with 2 dof
+    EXPECT_NEAR(3.035, std::sqrt(table.cutoff2()), 1.0e-3);
+
+    EXPECT_NEAR(0.0, table.loss(0.0), 1.0e-12);
+    EXPECT_NEAR(1.0, table.weight(0.0), 1.0e-12);
+    EXPECT_EQ(1.0, table.loss(table.cutoff2()));
+    EXPECT_EQ(0.0, table.weight(table.cutoff2()));
+
+    double previousLoss = 0.0, previousWeight = 1.0;
+    for (double t = 0.01; t < table.cutoff2(); t += 0.01)
+    {
+        EXPECT_GE(table.loss(t), previousLoss);
+        EXPECT_LE(table.weight(t), previousWeight);
+        previousLoss = table.loss(t);
+        previousWeight = table.weight(t);
+    }
+}
+
+TEST(MAGSAC, noisyLineWithOutliers)
+{
+    // y = 0.5*x + 2, 40% of outliers
+    auto lineFitting = scene::makeReferenceLine(500, 0.05, 0.4);
+
+    // sigmaMax is a loose upper bound of the noise, no threshold tuning
+    robest::MAGSAC solver;
+    solver.solve(lineFitting, 1.0, 500);
+
+    double res_k, res_b;
+    lineFitting->getResult(res_k, res_b);
+    EXPECT_NEAR(0.5, res_k, 1.0e-3);
+    EXPECT_NEAR(2.0, res_b, 3.0e-2);
+    EXPECT_NEAR(0.6, solver.getInliersFraction(), 0.05);
+    EXPECT_LT(solver.getScore(), 500.0);
+}
+
+TEST(MAGSAC, polishingImprovesPlane)
+{
+    auto planeFitting = scene::makeReferencePlane(300, 0.02, 0.3, 0.0);
+
+    robest::MAGSAC withoutPolishing(2, 0);
+    withoutPolishing.solve(planeFitting, 0.2, 300);
+    double unpolishedScore = withoutPolishing.getScore();
+
+    robest::MAGSAC solver;
+    solver.solve(planeFitting, 0.2, 300);
+    EXPECT_LE(solver.getScore(), unpolishedScore);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 2.0e-2);
+}
@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+
+#include <random>
+
+#include "OrientedPlaneFitting/OrientedPlaneFitting.hpp"
+
+namespace {
+
+// plane a*x + b*y + c*z + d = 0, (a, b, c) of unit norm
+const double norm = std::sqrt(0.2 * 0.2 + 0.1 * 0.1 + 1.0);
+const double a = -0.2 / norm, b = 0.1 / norm, c = 1.0 / norm, d = -1.0 / norm;
+
+// nbPts oriented points, the first nbOutliers random, the next nbWrongNormals on
+// the plane with random normals
+void generatePoints(int nbPts, int nbOutliers, int nbWrongNormals, double noise,
+                    std::vector<double> & x, std::vector<double> & y, std::vector<double> & z,
+                    std::vector<double> & nx, std::vector<double> & ny, std::vector<double> & nz)
+{
+    std::default_random_engine generator(3);
+    std::uniform_real_distribution<double> uniform(-10.0, 10.0);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+
+    for (int i = 0; i < nbPts; i++){
+        const double px = uniform(generator), py = uniform(generator);
+        double pz = (-a * px - b * py - d) / c;
+        double n[3] = {a, b, c};
+        if (i < nbOutliers)
+            pz = uniform(generator);
+        else
+            pz += noise * gaussian(generator);
+        if (i < nbOutliers + nbWrongNormals){
+            n[0] = gaussian(generator);
+            n[1] = gaussian(generator);
+            n[2] = 0.5 * gaussian(generator);
+        }
+        else{
+            // flipped normals are as good as the others
+            const double sign = i % 2 ? -1.0 : 1.0;
+            for (int k = 0; k < 3; k++)
+                n[k] = sign * (n[k] + noise * gaussian(generator));
+        }
+        x.push_back(px); y.push_back(py); z.push_back(pz);
+        nx.push_back(n[0]); ny.push_back(n[1]); nz.push_back(n[2]);
+    }
+}
+
+void expectPlane(std::shared_ptr<OrientedPlaneFittingProblem> planeFitting, double tol)
+{
+    double res_a, res_b, res_c, res_d;
+    planeFitting->getResult(res_a, res_b, res_c, res_d);
+    const double sign = res_c > 0 ? 1.0 : -1.0;
+    EXPECT_NEAR(a, sign * res_a, tol);
+    EXPECT_NEAR(b, sign * res_b, tol);
+    EXPECT_NEAR(c, sign * res_c, tol);
+    EXPECT_NEAR(d, sign * res_d, tol);
+}
+
+} // namespace
+
+TEST(OrientedPlaneFitting, idealCase)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(100, 0, 0, 0.0, x, y, z, nx, ny, nz);
+
+    auto planeFitting = std::make_shared<OrientedPlaneFittingProblem>();
+    planeFitting->setData(x, y, z, nx, ny, nz);
+
+    robest::MSAC solver;
+    solver.solve(planeFitting, 0.01, 5);
+
+    expectPlane(planeFitting, 1.0e-9);
+    EXPECT_EQ(100u, solver.getInliersIndices().size());
+}
+
+TEST(OrientedPlaneFitting, outliers)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(1000, 700, 0, 0.001, x, y, z, nx, ny, nz);
+
+    auto planeFitting = std::make_shared<OrientedPlaneFittingProblem>();
+    planeFitting->setData(x, y, z, nx, ny, nz);
+
+    // one point per sample: 13 iterations for 99% confidence at 70% outliers
+    robest::RANSAC ransac;
+    EXPECT_EQ(13, ransac.calculateIterationsNb(1, 0.99f, 0.3f));
+    ransac.solve(planeFitting, 0.01, 30);
+    expectPlane(planeFitting, 5.0e-2);
+
+    // no refit: the accuracy of the best minimal sample. MSAC compares the
+    // squared errors to the threshold
+    robest::MSAC msac;
+    msac.solve(planeFitting, 1.0e-4, 30);
+    expectPlane(planeFitting, 5.0e-2);
+}
+
+TEST(OrientedPlaneFitting, normalDeviation)
+{
+    // 200 points on the plane have wrong normals
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(1000, 300, 200, 0.0, x, y, z, nx, ny, nz);
+
+    auto planeFitting = std::make_shared<OrientedPlaneFittingProblem>();
+    planeFitting->setData(x, y, z, nx, ny, nz);
+
+    robest::RANSAC solver;
+    solver.solve(planeFitting, 0.01, 100);
+    expectPlane(planeFitting, 1.0e-9);
+    EXPECT_EQ(500u, solver.getInliersIndices().size());
+
+    // the distance alone
+    planeFitting->setNormalWeight(0.0);
+    for (int i = 300; i < 500; i++)
+        EXPECT_NEAR(0.0, planeFitting->estimErrorForSample(i), 1.0e-9);
+}
+
+TEST(OrientedPlaneFitting, weightedFit)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(50, 0, 0, 0.0, x, y, z, nx, ny, nz);
+    x.push_back(0.0); y.push_back(0.0); z.push_back(50.0);
+    nx.push_back(1.0); ny.push_back(0.0); nz.push_back(0.0);
+
+    std::vector<int> idx;
+    std::vector<double> weights;
+    for (int i = 0; i < x.size(); i++){
+        idx.push_back(i);
+        weights.push_back(i == 50 ? 0.0 : 1.0 + i % 3);
+    }
+
+    auto planeFitting = std::make_shared<OrientedPlaneFittingProblem>();
+    planeFitting->setData(x, y, z, nx, ny, nz);
+    planeFitting->estimModelFromWeightedSamples(idx, weights);
+    expectPlane(planeFitting, 1.0e-9);
+}
+
+TEST(OrientedPlaneFitting, errorsForModel)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(40, 10, 10, 0.01, x, y, z, nx, ny, nz);
+
+    auto planeFitting = std::make_shared<OrientedPlaneFittingProblem>();
+    planeFitting->setData(x, y, z, nx, ny, nz);
+    planeFitting->setNormalWeight(0.5);
+
+    const std::vector<double> params = {0.0, 0.6, 0.8, -1.0};
+    std::vector<double> errors(30);
+    ASSERT_TRUE(planeFitting->estimErrorsForModel(params, 5, 35, errors.data()));
+    EXPECT_FALSE(planeFitting->estimErrorsForModel({1.0, 2.0}, 0, 1, errors.data()));
+
+    ASSERT_TRUE(planeFitting->setModelParams(params));
+    std::vector<double> current;
+    ASSERT_TRUE(planeFitting->getModelParams(current));
+    EXPECT_EQ(params, current);
+    for (int i = 0; i < 30; ++i){
+        const int k = 5 + i;
+        const double nn = std::sqrt(nx[k] * nx[k] + ny[k] * ny[k] + nz[k] * nz[k]);
+        const double dist = std::fabs(0.6 * y[k] + 0.8 * z[k] - 1.0);
+        const double deviation = 1.0 - std::fabs(0.6 * ny[k] + 0.8 * nz[k]) / nn;
+        EXPECT_NEAR(std::max(dist, 0.5 * deviation), errors[i], 1.0e-12);
+        EXPECT_NEAR(planeFitting->estimErrorForSample(k), errors[i], 1.0e-12);
+    }
+}
@@ -0,0 +1,171 @@
+#include "gtest/gtest.h"
+
+#include <random>
+
+#include "OrientedSphereFitting/OrientedSphereFitting.hpp"
+
+namespace {
+
+const double cx = 1.0, cy = -2.0, cz = 0.5, r = 3.0;
+
+// nbPts oriented points, the first nbOutliers random, the next nbWrongNormals on
+// the sphere with random normals
+void generatePoints(int nbPts, int nbOutliers, int nbWrongNormals, double noise,
+                    std::vector<double> & x, std::vector<double> & y, std::vector<double> & z,
+                    std::vector<double> & nx, std::vector<double> & ny, std::vector<double> & nz)
+{
+    std::default_random_engine generator(5);
+    std::uniform_real_distribution<double> uniform(-5.0, 5.0);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+
+    for (int i = 0; i < nbPts; i++){
+        double u[3] = {gaussian(generator), gaussian(generator), gaussian(generator)};
+        const double nu = std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+        for (int k = 0; k < 3; k++)
+            u[k] /= nu;
+
+        const double rad = r + noise * gaussian(generator);
+        double p[3] = {cx + rad * u[0], cy + rad * u[1], cz + rad * u[2]};
+        double n[3] = {u[0], u[1], u[2]};
+        if (i < nbOutliers)
+            for (int k = 0; k < 3; k++)
+                p[k] = uniform(generator);
+        if (i < nbOutliers + nbWrongNormals)
+            for (int k = 0; k < 3; k++)
+                n[k] = gaussian(generator);
+        else
+            for (int k = 0; k < 3; k++)
+                n[k] += noise * gaussian(generator);
+
+        x.push_back(p[0]); y.push_back(p[1]); z.push_back(p[2]);
+        nx.push_back(n[0]); ny.push_back(n[1]); nz.push_back(n[2]);
+    }
+}
+
+void expectSphere(std::shared_ptr<OrientedSphereFittingProblem> sphereFitting, double tol)
+{
+    double res_cx, res_cy, res_cz, res_r;
+    sphereFitting->getResult(res_cx, res_cy, res_cz, res_r);
+    EXPECT_NEAR(cx, res_cx, tol);
+    EXPECT_NEAR(cy, res_cy, tol);
+    EXPECT_NEAR(cz, res_cz, tol);
+    EXPECT_NEAR(r, res_r, tol);
+}
+
+} // namespace
+
+TEST(OrientedSphereFitting, idealCase)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(100, 0, 0, 0.0, x, y, z, nx, ny, nz);
+
+    auto sphereFitting = std::make_shared<OrientedSphereFittingProblem>();
+    sphereFitting->setData(x, y, z, nx, ny, nz);
+
+    robest::MSAC solver;
+    solver.solve(sphereFitting, 0.01, 5);
+
+    expectSphere(sphereFitting, 1.0e-9);
+    EXPECT_EQ(100u, solver.getInliersIndices().size());
+}
+
+TEST(OrientedSphereFitting, outliers)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(1000, 700, 0, 0.001, x, y, z, nx, ny, nz);
+
+    auto sphereFitting = std::make_shared<OrientedSphereFittingProblem>();
+    sphereFitting->setData(x, y, z, nx, ny, nz);
+
+    // two points per sample instead of four: 49 iterations for 99% confidence at
+    // 70% outliers, against 567
+    robest::RANSAC ransac;
+    EXPECT_EQ(49, ransac.calculateIterationsNb(2, 0.99f, 0.3f));
+    EXPECT_EQ(567, ransac.calculateIterationsNb(4, 0.99f, 0.3f));
+    ransac.solve(sphereFitting, 0.01, 100);
+    expectSphere(sphereFitting, 5.0e-2);
+
+    // no refit: the accuracy of the best minimal sample. MSAC compares the
+    // squared errors to the threshold
+    robest::MSAC msac;
+    msac.solve(sphereFitting, 1.0e-4, 100);
+    expectSphere(sphereFitting, 5.0e-2);
+}
+
+TEST(OrientedSphereFitting, normalDeviation)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(1000, 300, 200, 0.0, x, y, z, nx, ny, nz);
+
+    auto sphereFitting = std::make_shared<OrientedSphereFittingProblem>();
+    sphereFitting->setData(x, y, z, nx, ny, nz);
+
+    robest::RANSAC solver;
+    solver.solve(sphereFitting, 0.01, 200);
+    expectSphere(sphereFitting, 1.0e-9);
+    EXPECT_EQ(500u, solver.getInliersIndices().size());
+
+    sphereFitting->setNormalWeight(0.0);
+    for (int i = 300; i < 500; i++)
+        EXPECT_NEAR(0.0, sphereFitting->estimErrorForSample(i), 1.0e-9);
+}
+
+TEST(OrientedSphereFitting, isDegenerate)
+{
+    std::vector<double> x = {0.0, 1.0, 2.0}, y = {0.0, 0.0, 0.0}, z = {0.0, 0.0, 1.0};
+    std::vector<double> nx = {0.0, 0.0, 1.0}, ny = {0.0, 0.0, 0.0}, nz = {1.0, -1.0, 0.0};
+
+    auto sphereFitting = std::make_shared<OrientedSphereFittingProblem>();
+    sphereFitting->setData(x, y, z, nx, ny, nz);
+    EXPECT_TRUE(sphereFitting->isDegenerate({0, 1}));
+    EXPECT_FALSE(sphereFitting->isDegenerate({0, 2}));
+}
+
+TEST(OrientedSphereFitting, weightedFit)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(50, 0, 0, 0.0, x, y, z, nx, ny, nz);
+    x.push_back(20.0); y.push_back(0.0); z.push_back(0.0);
+    nx.push_back(1.0); ny.push_back(0.0); nz.push_back(0.0);
+
+    std::vector<int> idx;
+    std::vector<double> weights;
+    for (int i = 0; i < x.size(); i++){
+        idx.push_back(i);
+        weights.push_back(i == 50 ? 0.0 : 1.0 + i % 3);
+    }
+
+    auto sphereFitting = std::make_shared<OrientedSphereFittingProblem>();
+    sphereFitting->setData(x, y, z, nx, ny, nz);
+    sphereFitting->estimModelFromWeightedSamples(idx, weights);
+    expectSphere(sphereFitting, 1.0e-9);
+}
+
+TEST(OrientedSphereFitting, errorsForModel)
+{
+    std::vector<double> x, y, z, nx, ny, nz;
+    generatePoints(40, 10, 10, 0.01, x, y, z, nx, ny, nz);
+
+    auto sphereFitting = std::make_shared<OrientedSphereFittingProblem>();
+    sphereFitting->setData(x, y, z, nx, ny, nz);
+    sphereFitting->setNormalWeight(0.5);
+
+    const std::vector<double> params = {0.5, -1.5, 0.0, 2.5};
+    std::vector<double> errors(30);
+    ASSERT_TRUE(sphereFitting->estimErrorsForModel(params, 5, 35, errors.data()));
+    EXPECT_FALSE(sphereFitting->estimErrorsForModel({1.0, 2.0}, 0, 1, errors.data()));
+
+    ASSERT_TRUE(sphereFitting->setModelParams(params));
+    std::vector<double> current;
+    ASSERT_TRUE(sphereFitting->getModelParams(current));
+    EXPECT_EQ(params, current);
+    for (int i = 0; i < 30; ++i){
+        const int k = 5 + i;
+        const double v[3] = {x[k] - 0.5, y[k] + 1.5, z[k]};
+        const double len = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        const double nn = std::sqrt(nx[k] * nx[k] + ny[k] * ny[k] + nz[k] * nz[k]);
+        const double deviation = 1.0 - std::fabs(nx[k] * v[0] + ny[k] * v[1] + nz[k] * v[2]) / (nn * len);
+        EXPECT_NEAR(std::max(std::fabs(len - 2.5), 0.5 * deviation), errors[i], 1.0e-12);
+        EXPECT_NEAR(sphereFitting->estimErrorForSample(k), errors[i], 1.0e-12);
+    }
+}
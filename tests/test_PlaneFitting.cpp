@@ -2,6 +2,7 @@
 
 #include "gtest/gtest.h"
 
+#include <numeric>
 #include <random>
 
 #include "PlaneFitting/PlaneFitting.hpp"
@@ -128,3 +129,56 @@ TEST(PlaneFitting, idealCase3)
     EXPECT_NEAR( c, fabs(res_c), 1.0e-6);
     EXPECT_NEAR( d, fabs(res_d), 1.0e-6);
 }
+
+TEST(PlaneFitting, weightedFit)
+{
+    double a =  0.372997;
+    double b = -0.136612;
+    double c =  0.265316;
+    double d = -0.878531;
+
+    std::vector<double> x, y, z;
+    generateData({a,b,c,d},x,y,z);
+
+    // one outlier with zero weight
+    x.push_back(3);
+    y.push_back(4);
+    z.push_back(50);
+
+    std::vector<int> idx(x.size());
+    std::iota(idx.begin(), idx.end(), 0);
+    std::vector<double> weights(x.size(), 1.0);
+    weights.back() = 0.0;
+    weights[5] = 0.2;
+
+    auto planeFitting = std::make_shared<PlaneFittingProblem>();
+    planeFitting->setData(x,y,z);
+    planeFitting->estimModelFromWeightedSamples(idx, weights);
+    double res_a,res_b,res_c, res_d;
+    planeFitting->getResult(res_a,res_b,res_c,res_d);
+
+    double norm = sqrt(a*a+b*b+c*c+d*d);
+    double sign = res_a * a > 0 ? 1.0 : -1.0;
+
+    EXPECT_NEAR( a / norm, sign * res_a, 1.0e-9);
+    EXPECT_NEAR( b / norm, sign * res_b, 1.0e-9);
+    EXPECT_NEAR( c / norm, sign * res_c, 1.0e-9);
+    EXPECT_NEAR( d / norm, sign * res_d, 1.0e-9);
+}
+
+TEST(PlaneFitting, errorsForModel)
+{
+    std::vector<double> x, y, z;
+    generateData({0.372997, -0.136612, 0.265316, -0.878531}, x, y, z);
+
+    auto planeFitting = std::make_shared<PlaneFittingProblem>();
+    planeFitting->setData(x,y,z);
+
+    std::vector<double> errors(10);
+    ASSERT_TRUE(planeFitting->estimErrorsForModel({1.0, 2.0, -3.0, 0.5}, 5, 15, errors.data()));
+    EXPECT_FALSE(planeFitting->estimErrorsForModel({1.0, 2.0, -3.0}, 0, 1, errors.data()));
+
+    planeFitting->setModelParams({1.0, 2.0, -3.0, 0.5});
+    for (int i = 0; i < 10; ++i)
+        EXPECT_NEAR(planeFitting->estimErrorForSample(5 + i), errors[i], 1.0e-12);
+}
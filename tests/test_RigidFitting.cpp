@@ -0,0 +1,221 @@
+#include "gtest/gtest.h"
+
+#include <numeric>
+#include <random>
+
+#include "RigidFitting/RigidFitting.hpp"
+
+namespace {
+
+// Rotation of angle theta around the unit axis (ux, uy, uz), row-major
+std::vector<double> rotation(double ux, double uy, double uz, double theta)
+{
+    const double n = sqrt(ux * ux + uy * uy + uz * uz);
+    ux /= n; uy /= n; uz /= n;
+    const double c = cos(theta), s = sin(theta), C = 1 - c;
+    return {c + ux*ux*C,      ux*uy*C - uz*s, ux*uz*C + uy*s,
+            uy*ux*C + uz*s,   c + uy*uy*C,    uy*uz*C - ux*s,
+            uz*ux*C - uy*s,   uz*uy*C + ux*s, c + uz*uz*C};
+}
+
+// nbPts correspondences q = scale * R * p + t (+ noise), the first nbOutliers
+// target points being random
+void generateCorrespondences(
+    const std::vector<double> & R, const std::vector<double> & t, double scale,
+    int nbPts, int nbOutliers, double noise,
+    std::vector<double> & px, std::vector<double> & py, std::vector<double> & pz,
+    std::vector<double> & qx, std::vector<double> & qy, std::vector<double> & qz)
+{
+    std::default_random_engine generator(7);
+    std::uniform_real_distribution<double> uniform(-5.0, 5.0);
+    std::normal_distribution<double> gaussian(0.0, noise > 0 ? noise : 1.0);
+
+    for (int i = 0; i < nbPts; i++){
+        const double p[3] = {uniform(generator), uniform(generator), uniform(generator)};
+        px.push_back(p[0]);
+        py.push_back(p[1]);
+        pz.push_back(p[2]);
+
+        double q[3];
+        for (int r = 0; r < 3; r++){
+            q[r] = scale * (R[r * 3] * p[0] + R[r * 3 + 1] * p[1] + R[r * 3 + 2] * p[2]) + t[r];
+            if (i < nbOutliers)
+                q[r] = uniform(generator) * 3.0;
+            else if (noise > 0)
+                q[r] += gaussian(generator);
+        }
+        qx.push_back(q[0]);
+        qy.push_back(q[1]);
+        qz.push_back(q[2]);
+    }
+}
+
+void expectTransform(std::shared_ptr<RigidFittingProblem> rigidFitting,
+                     const std::vector<double> & R, const std::vector<double> & t, double scale, double tol)
+{
+    std::vector<double> resR, rest;
+    double ress;
+    rigidFitting->getResult(resR, rest, ress);
+    for (int k = 0; k < 9; k++)
+        EXPECT_NEAR(R[k], resR[k], tol);
+    for (int k = 0; k < 3; k++)
+        EXPECT_NEAR(t[k], rest[k], 10 * tol);
+    EXPECT_NEAR(scale, ress, tol);
+}
+
+} // namespace
+
+TEST(RigidFitting, idealCase)
+{
+    const std::vector<double> R = rotation(1.0, 2.0, -0.5, 0.7);
+    const std::vector<double> t = {0.3, -2.0, 5.0};
+
+    std::vector<double> px, py, pz, qx, qy, qz;
+    generateCorrespondences(R, t, 1.0, 100, 0, 0.0, px, py, pz, qx, qy, qz);
+
+    auto rigidFitting = std::make_shared<RigidFittingProblem>();
+    rigidFitting->setData(px, py, pz, qx, qy, qz);
+
+    robest::MSAC solver;
+    solver.solve(rigidFitting, 0.01, 20);
+
+    expectTransform(rigidFitting, R, t, 1.0, 1.0e-9);
+    EXPECT_EQ(100u, solver.getInliersIndices().size());
+}
+
+TEST(RigidFitting, minimalSample)
+{
+    const std::vector<double> R = rotation(0.0, 0.0, 1.0, 3.0);
+    const std::vector<double> t = {1.0, 2.0, 3.0};
+
+    std::vector<double> px, py, pz, qx, qy, qz;
+    generateCorrespondences(R, t, 2.5, 3, 0, 0.0, px, py, pz, qx, qy, qz);
+
+    auto rigidFitting = std::make_shared<RigidFittingProblem>();
+    rigidFitting->setData(px, py, pz, qx, qy, qz);
+    rigidFitting->setEstimateScale(true);
+    rigidFitting->estimModelFromSamples({0, 1, 2});
+
+    expectTransform(rigidFitting, R, t, 2.5, 1.0e-9);
+    for (int i = 0; i < 3; i++)
+        EXPECT_NEAR(0.0, rigidFitting->estimErrorForSample(i), 1.0e-9);
+}
+
+TEST(RigidFitting, outliers)
+{
+    const std::vector<double> R = rotation(-0.3, 1.0, 0.2, -1.2);
+    const std::vector<double> t = {-4.0, 0.5, 1.5};
+
+    std::vector<double> px, py, pz, qx, qy, qz;
+    generateCorrespondences(R, t, 1.0, 1000, 400, 0.001, px, py, pz, qx, qy, qz);
+
+    auto rigidFitting = std::make_shared<RigidFittingProblem>();
+    rigidFitting->setData(px, py, pz, qx, qy, qz);
+
+    // the refit on the inliers averages the noise out
+    robest::RANSAC ransac;
+    ransac.solve(rigidFitting, 0.005, 200);
+    expectTransform(rigidFitting, R, t, 1.0, 1.0e-3);
+
+    robest::MSAC msac;
+    msac.solve(rigidFitting, 0.005, 200);
+    expectTransform(rigidFitting, R, t, 1.0, 1.0e-2);
+    EXPECT_NEAR(0.6, msac.getInliersFraction(), 0.01);
+
+    robest::LMedS lmeds;
+    lmeds.solve(rigidFitting, 0.005, 200);
+    expectTransform(rigidFitting, R, t, 1.0, 1.0e-3);
+}
+
+TEST(RigidFitting, similarity)
+{
+    const std::vector<double> R = rotation(0.5, 0.5, 0.5, 2.0);
+    const std::vector<double> t = {10.0, 0.0, -1.0};
+
+    std::vector<double> px, py, pz, qx, qy, qz;
+    generateCorrespondences(R, t, 0.4, 500, 100, 0.0, px, py, pz, qx, qy, qz);
+
+    auto rigidFitting = std::make_shared<RigidFittingProblem>();
+    rigidFitting->setData(px, py, pz, qx, qy, qz);
+    rigidFitting->setEstimateScale(true);
+
+    robest::RANSAC solver;
+    solver.solve(rigidFitting, 0.01, 100);
+    expectTransform(rigidFitting, R, t, 0.4, 1.0e-9);
+    EXPECT_EQ(400u, solver.getInliersIndices().size());
+}
+
+TEST(RigidFitting, isDegenerate)
+{
+    // the first three source points are collinear, the last three target points too
+    std::vector<double> px = {0.0, 1.0, 2.0, 0.0, 1.0};
+    std::vector<double> py = {0.0, 1.0, 2.0, 1.0, 0.0};
+    std::vector<double> pz = {0.0, 1.0, 2.0, 0.0, 3.0};
+    std::vector<double> qx = {0.0, 1.0, 0.0, 1.0, 2.0};
+    std::vector<double> qy = {1.0, 0.0, 0.0, 1.0, 2.0};
+    std::vector<double> qz = {0.0, 0.0, 0.0, 1.0, 2.0};
+
+    auto rigidFitting = std::make_shared<RigidFittingProblem>();
+    rigidFitting->setData(px, py, pz, qx, qy, qz);
+
+    EXPECT_TRUE(rigidFitting->isDegenerate({0, 1, 2}));
+    EXPECT_TRUE(rigidFitting->isDegenerate({1, 3, 3}));
+    EXPECT_TRUE(rigidFitting->isDegenerate({2, 3, 4}));
+    EXPECT_FALSE(rigidFitting->isDegenerate({0, 1, 3}));
+}
+
+TEST(RigidFitting, weightedFit)
+{
+    const std::vector<double> R = rotation(1.0, -1.0, 0.0, 0.3);
+    const std::vector<double> t = {0.0, 1.0, 0.0};
+
+    std::vector<double> px, py, pz, qx, qy, qz;
+    generateCorrespondences(R, t, 1.0, 50, 0, 0.0, px, py, pz, qx, qy, qz);
+
+    // one outlier with zero weight
+    px.push_back(1.0); py.push_back(1.0); pz.push_back(1.0);
+    qx.push_back(9.0); qy.push_back(9.0); qz.push_back(9.0);
+
+    std::vector<int> idx(px.size());
+    std::iota(idx.begin(), idx.end(), 0);
+    std::vector<double> weights(px.size(), 1.0);
+    weights.back() = 0.0;
+    weights[5] = 0.2;
+
+    auto rigidFitting = std::make_shared<RigidFittingProblem>();
+    rigidFitting->setData(px, py, pz, qx, qy, qz);
+    rigidFitting->estimModelFromWeightedSamples(idx, weights);
+    expectTransform(rigidFitting, R, t, 1.0, 1.0e-9);
+
+    // a reflection is never returned: the rotation is proper
+    std::vector<double> resR, rest;
+    double ress;
+    rigidFitting->getResult(resR, rest, ress);
+    const double det = resR[0] * (resR[4] * resR[8] - resR[5] * resR[7])
+                     - resR[1] * (resR[3] * resR[8] - resR[5] * resR[6])
+                     + resR[2] * (resR[3] * resR[7] - resR[4] * resR[6]);
+    EXPECT_NEAR(1.0, det, 1.0e-12);
+}
+
+TEST(RigidFitting, errorsForModel)
+{
+    std::vector<double> px, py, pz, qx, qy, qz;
+    generateCorrespondences(rotation(1.0, 0.0, 0.0, 0.5), {1.0, 2.0, 3.0}, 1.0, 40, 10, 0.01, px, py, pz, qx, qy, qz);
+
+    auto rigidFitting = std::make_shared<RigidFittingProblem>();
+    rigidFitting->setData(px, py, pz, qx, qy, qz);
+
+    std::vector<double> params = rotation(0.0, 1.0, 0.0, 0.2);
+    params.insert(params.end(), {0.5, -0.5, 1.0, 1.3});
+
+    std::vector<double> errors(30);
+    ASSERT_TRUE(rigidFitting->estimErrorsForModel(params, 5, 35, errors.data()));
+    EXPECT_FALSE(rigidFitting->estimErrorsForModel({1.0, 2.0}, 0, 1, errors.data()));
+
+    ASSERT_TRUE(rigidFitting->setModelParams(params));
+    std::vector<double> current;
+    ASSERT_TRUE(rigidFitting->getModelParams(current));
+    EXPECT_EQ(params, current);
+    for (int i = 0; i < 30; ++i)
+        EXPECT_NEAR(rigidFitting->estimErrorForSample(5 + i), errors[i], 1.0e-12);
+}
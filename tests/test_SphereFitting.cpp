@@ -222,3 +222,67 @@ TEST(SphereFitting, isDegenerate)
     ASSERT_TRUE(!sphereFitting->isDegenerate({0,1,2,3}));
 
 }
+
+TEST(SphereFitting, weightedFit)
+{
+    auto sphereFitting = std::make_shared<SphereFittingProblem>();
+
+    // sphere C(8,6,-11), r = 4 and one outlier with zero weight
+    std::vector<double> x = {   8,   12,     4,     8,     8,     8,  30};
+    std::vector<double> y = {  10,    6,     6,     2,     6,     6,   0};
+    std::vector<double> z = { -11,  -11,   -11,   -11,   -15,    -7,   4};
+
+    sphereFitting->setData(x,y,z);
+    sphereFitting->estimModelFromWeightedSamples({0,1,2,3,4,5,6}, {1,2,1,0.5,1,1,0});
+
+    double res_cx,res_cy, res_cz,res_r;
+    sphereFitting->getResult(res_cx, res_cy, res_cz, res_r);
+
+    ASSERT_NEAR(  8.0, res_cx, 1.0e-11);
+    ASSERT_NEAR(  6.0, res_cy, 1.0e-11);
+    ASSERT_NEAR(-11.0, res_cz, 1.0e-11);
+    ASSERT_NEAR(  4.0,  res_r, 1.0e-11);
+}
+
+TEST(SphereFitting, errorsForModel)
+{
+    std::vector<double> x, y, z;
+    generateSphereData(1.0, 2.0, -1.0, 5.0, 0.3, 1.0, x, y, z);
+
+    auto sphereFitting = std::make_shared<SphereFittingProblem>();
+    sphereFitting->setData(x, y, z);
+
+    std::vector<double> errors(10);
+    ASSERT_TRUE(sphereFitting->estimErrorsForModel({1.5, 2.0, -1.0, 4.0}, 5, 15, errors.data()));
+    EXPECT_FALSE(sphereFitting->estimErrorsForModel({1.5, 2.0, -1.0}, 0, 1, errors.data()));
+
+    sphereFitting->setModelParams({1.5, 2.0, -1.0, 4.0});
+    for (int i = 0; i < 10; ++i)
+        EXPECT_NEAR(sphereFitting->estimErrorForSample(5 + i), errors[i], 1.0e-12);
+}
+
+TEST(SphereFitting, quantizedErrors)
+{
+    std::vector<double> x, y, z;
+    generateSphereData(1.0, 2.0, -1.0, 5.0, 0.3, 1.0, x, y, z);
+    const int n = (int) x.size();
+
+    auto sphereFitting = std::make_shared<SphereFittingProblem>();
+    sphereFitting->setData(x, y, z);
+
+    const std::vector<double> model = {1.5, 2.0, -1.0, 4.0};
+    std::vector<double> exact(n), approx(n);
+    double errorBound = 0.0;
+    ASSERT_TRUE(sphereFitting->estimErrorsForModel(model, 0, n, exact.data()));
+    EXPECT_FALSE(sphereFitting->estimApproxErrorsForModel(model, 0, n, approx.data(), errorBound));
+
+    for (int bits : {16, 32})
+    {
+        sphereFitting->setQuantizedStorage(bits, 7);
+        ASSERT_TRUE(sphereFitting->estimApproxErrorsForModel(model, 3, n, approx.data(), errorBound));
+        EXPECT_LT(errorBound, 1.0e-3);
+        for (int i = 3; i < n; ++i)
+            EXPECT_LE(std::fabs(approx[i - 3] - exact[i]), errorBound);
+    }
+    EXPECT_FALSE(sphereFitting->estimApproxErrorsForModel({1.5, 2.0, -1.0}, 0, 1, approx.data(), errorBound));
+}
@@ -0,0 +1,164 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include <omp.h>
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+} // namespace
+
+TEST(SolveAsync, sameAsSolve)
+{
+    auto planeFitting = scene::makeReferencePlane(2000);
+    robest::MSAC solver;
+    robest::SolveHandle handle = solver.solveAsync(planeFitting, 0.01, 100);
+    ASSERT_TRUE(handle.valid());
+
+    robest::SolveStatus status = handle.get();
+    EXPECT_TRUE(handle.isReady());
+    EXPECT_EQ(100, status.nbIterations);
+    EXPECT_FALSE(status.cancelled);
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(1400u, solver.getInliersIndices().size());
+}
+
+// Reports while iterating and at the end, in order
+TEST(SolveAsync, progress)
+{
+    auto planeFitting = scene::makeReferencePlane(2000);
+    std::vector<robest::SolveProgress> reports;
+
+    robest::SolveControl control;
+    control.adaptiveTermination = false;
+    control.chunkSize = 10;
+    control.progressInterval = 0.0;
+    control.progress = [&reports](const robest::SolveProgress & progress) { reports.push_back(progress); };
+
+    robest::RANSAC solver;
+    robest::SolveStatus status = solver.solveAsync(planeFitting, 0.01, 200, control).get();
+
+    ASSERT_GE(reports.size(), 2u);
+    for (size_t r = 1; r < reports.size(); ++r)
+    {
+        EXPECT_GE(reports[r].nbIterations, reports[r - 1].nbIterations);
+        EXPECT_LE(reports[r].bestCost, reports[r - 1].bestCost);
+        EXPECT_GE(reports[r].confidence, reports[r - 1].confidence);
+    }
+    EXPECT_EQ(status.nbIterations, reports.back().nbIterations);
+    EXPECT_GT(reports.back().inliersFraction, 0.5);
+    EXPECT_GT(reports.back().confidence, 0.99);
+    EXPECT_LE(reports.back().confidence, 1.0);
+
+    // the interval limits the number of reports: only the last one is left
+    reports.clear();
+    control.progressInterval = 3600.0;
+    solver.solve(planeFitting, 0.01, 200, control);
+    ASSERT_EQ(1u, reports.size());
+    EXPECT_EQ(200, reports[0].nbIterations);
+}
+
+// Samples drawn among the prior inliers do not raise the reported confidence
+TEST(SolveAsync, progressWithPrior)
+{
+    auto planeFitting = scene::makeReferencePlane(2000);
+    std::vector<robest::SolveProgress> reports;
+
+    robest::SolveControl control;
+    control.adaptiveTermination = false;
+    control.chunkSize = 5;
+    control.progressInterval = 0.0;
+    control.progress = [&reports](const robest::SolveProgress & progress) { reports.push_back(progress); };
+
+    robest::MSAC solver;
+    solver.setPriorModels({{0.1, -0.2, -1.0, 1.0}});
+    solver.setPriorSamplingBias(0.9);
+    robest::SolveStatus status = solver.solveAsync(planeFitting, 0.01, 20, control).get();
+
+    // one uniform sample in ten, all inliers with probability 0.7^3
+    ASSERT_FALSE(reports.empty());
+    for (const robest::SolveProgress & progress : reports)
+    {
+        EXPECT_NEAR(0.7, progress.inliersFraction, 1.0e-12);
+        EXPECT_NEAR(1.0 - std::pow(1.0 - 0.1 * 0.343, progress.nbIterations), progress.confidence, 1.0e-9);
+    }
+    EXPECT_LT(reports.back().confidence, 0.6);
+    EXPECT_FALSE(status.confidenceReached);
+}
+
+// The token of the control stops the solve, here from the progress callback
+TEST(SolveAsync, cancelledByControl)
+{
+    auto planeFitting = scene::makeReferencePlane(2000);
+    robest::SolveControl control;
+    control.adaptiveTermination = false;
+    control.progressInterval = 0.0;
+    robest::CancellationToken token = control.cancelToken;
+    control.progress = [token](const robest::SolveProgress & progress)
+    {
+        if (progress.nbIterations >= 50)
+            token.cancel();
+    };
+
+    robest::MSAC solver;
+    solver.setBatchSize(8);
+    robest::SolveStatus status = solver.solveAsync(planeFitting, 0.01, 50000, control).get();
+    EXPECT_TRUE(status.cancelled);
+    EXPECT_LT(status.nbIterations, 50000);
+    scene::expectReferencePlane(planeFitting);
+}
+
+// A solve queued behind another one is cancelled before it starts; the handles
+// do not cancel each other
+TEST(SolveAsync, cancelledByHandle)
+{
+    robest::Executor executor(1);
+    auto first = scene::makeReferencePlane(2000), second = scene::makeReferencePlane(2000);
+    robest::SolveControl control;
+    control.adaptiveTermination = false;
+
+    robest::RANSAC firstSolver, secondSolver;
+    robest::SolveHandle running = firstSolver.solveAsync(first, 0.01, 50000, control, executor);
+    robest::SolveHandle queued = secondSolver.solveAsync(second, 0.01, 50000, control, executor);
+    queued.cancel();
+    running.cancel();
+
+    robest::SolveStatus status = queued.get();
+    EXPECT_TRUE(status.cancelled);
+    EXPECT_EQ(0, status.nbIterations);
+    EXPECT_TRUE(running.get().cancelled);
+    EXPECT_FALSE(control.cancelToken.isCancelled());
+}
+
+// Solves sharing a pool of workers, each with its share of the OpenMP threads
+TEST(SolveAsync, sharedExecutor)
+{
+    robest::Executor executor(2, 1);
+    EXPECT_EQ(2, executor.getNbWorkers());
+    EXPECT_EQ(1, executor.getThreadsPerWorker());
+
+    const int nbSolves = 4;
+    std::vector<std::shared_ptr<PlaneFittingProblem>> problems;
+    std::vector<std::unique_ptr<robest::MSAC>> solvers;
+    std::vector<robest::SolveHandle> handles;
+    std::vector<int> nbThreads(nbSolves, 0);
+    for (int s = 0; s < nbSolves; ++s)
+    {
+        problems.push_back(scene::makeReferencePlane(2000));
+        solvers.emplace_back(new robest::MSAC());
+
+        robest::SolveControl control;
+        control.progress = [&nbThreads, s](const robest::SolveProgress &) { nbThreads[s] = omp_get_max_threads(); };
+        handles.push_back(solvers[s]->solveAsync(problems[s], 0.01, 100, control, executor));
+    }
+
+    for (int s = 0; s < nbSolves; ++s)
+    {
+        EXPECT_TRUE(handles[s].get().confidenceReached);
+        scene::expectReferencePlane(problems[s]);
+        EXPECT_EQ(1, nbThreads[s]);
+    }
+    EXPECT_EQ(0, executor.getNbPending());
+}
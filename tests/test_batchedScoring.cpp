@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+// MSAC counting the hypotheses scored one at a time
+class CountingMSAC : public robest::MSAC
+{
+  public:
+    int nbSingleScores = 0;
+
+  protected:
+    double scoreCurrentModel(double thres, int & nbInliers)
+    {
+        nbSingleScores++;
+        return robest::MSAC::scoreCurrentModel(thres, nbInliers);
+    }
+};
+
+} // namespace
+
+TEST(BatchedScoring, ransac)
+{
+    auto planeFitting = scene::makeReferencePlane(1000);
+
+    // tiles do not divide the data
+    robest::RANSAC solver;
+    solver.setBatchSize(8, 96);
+    solver.solve(planeFitting, 0.01, 40);
+
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(700u, solver.getInliersIndices().size());
+    EXPECT_EQ(40, solver.getStats().nbIterations);
+    EXPECT_EQ(40 - solver.getStats().nbDegenerate, solver.getStats().nbHypotheses);
+}
+
+TEST(BatchedScoring, msac)
+{
+    auto planeFitting = scene::makeReferencePlane(1000);
+
+    CountingMSAC solver;
+    solver.setBatchSize(16, 64);
+    solver.solve(planeFitting, 0.01, 50);
+
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(700u, solver.getInliersIndices().size());
+    EXPECT_EQ(50, solver.getStats().nbIterations);
+    EXPECT_EQ(0, solver.nbSingleScores);
+}
+
+TEST(BatchedScoring, magsac)
+{
+    auto planeFitting = scene::makeReferencePlane(1000);
+
+    robest::MAGSAC solver;
+    solver.setBatchSize(16);
+    solver.solve(planeFitting, 0.01, 50);
+
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(700u, solver.getInliersIndices().size());
+}
+
+TEST(BatchedScoring, sameScoreAsOneAtATime)
+{
+    auto planeFitting = scene::makeReferencePlane(1000);
+
+    // both find the exact plane: same consensus set as the one-at-a-time path
+    robest::MSAC serial, batched;
+    batched.setBatchSize(4, 100);
+    serial.solve(planeFitting, 0.01, 30);
+    batched.solve(planeFitting, 0.01, 30);
+
+    EXPECT_EQ(serial.getInliersMask(), batched.getInliersMask());
+    EXPECT_DOUBLE_EQ(serial.getInliersFraction(), batched.getInliersFraction());
+}
+
+TEST(BatchedScoring, fallbackWithoutTileScoring)
+{
+    auto planeFitting = scene::makeReferencePlane(1000);
+
+    // LMedS cost is not a sum over the samples: hypotheses are scored one at a time
+    robest::LMedS solver;
+    solver.setBatchSize(16);
+    solver.solve(planeFitting, 0.01, 50);
+
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(700u, solver.getInliersIndices().size());
+}
+
+TEST(BatchedScoring, solveControl)
+{
+    auto planeFitting = scene::makeReferencePlane(1000);
+
+    robest::MSAC solver;
+    solver.setBatchSize(16);
+
+    robest::SolveControl control;
+    control.cancelToken.cancel();
+    robest::SolveStatus status = solver.solve(planeFitting, 0.01, 100, control);
+    EXPECT_TRUE(status.cancelled);
+    EXPECT_EQ(0, status.nbIterations);
+
+    // adaptive termination cuts the batches: 70% of inliers needs ~11 iterations
+    robest::SolveControl adaptive;
+    status = solver.solve(planeFitting, 0.01, 10000, adaptive);
+    EXPECT_TRUE(status.confidenceReached);
+    EXPECT_LT(status.nbIterations, 100);
+    scene::expectReferencePlane(planeFitting);
+}
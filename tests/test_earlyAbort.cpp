@@ -0,0 +1,64 @@
+#include "gtest/gtest.h"
+
+#include <omp.h>
+
+#include "SceneGenerator/ReferenceLine.hpp"
+
+namespace {
+
+// All the C(300, 2) = 44850 minimal samples are enumerated, in the same order with
+// and without early abort, on one thread so that ties are broken the same way: the
+// retained model must be the same.
+template<typename Estimator>
+void checkSameResult(double thres)
+{
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+
+    auto problem = scene::makeReferenceLine(300, 0.01, 0.2);
+    double a[2], b[2];
+    std::vector<int> inliers[2];
+    robest::SolverStats stats[2];
+    for (int run = 0; run < 2; ++run)
+    {
+        Estimator solver;
+        solver.setUniqueSamples(true);
+        solver.setEarlyAbort(run == 0);
+        solver.solve(problem, thres, 45000);
+        problem->getResult(a[run], b[run]);
+        inliers[run] = solver.getInliersIndices();
+        stats[run] = solver.getStats();
+    }
+    omp_set_num_threads(previousNbThreads);
+
+    EXPECT_EQ(a[1], a[0]);
+    EXPECT_EQ(b[1], b[0]);
+    EXPECT_EQ(inliers[1], inliers[0]);
+    EXPECT_NEAR(0.5, a[0], 0.01);
+    EXPECT_NEAR(2.0, b[0], 0.3);
+
+#ifndef ROBEST_DISABLE_STATS
+    EXPECT_EQ(stats[1].nbHypotheses, stats[0].nbHypotheses);
+    EXPECT_EQ(stats[1].lastImprovementIter, stats[0].lastImprovementIter);
+    EXPECT_EQ(0, stats[1].nbAborted);
+    EXPECT_GT(stats[0].nbAborted, stats[0].nbHypotheses / 2);
+    EXPECT_LT(stats[0].nbResiduals, stats[1].nbResiduals);
+#endif
+}
+
+} // namespace
+
+TEST(EarlyAbort, RANSAC)
+{
+    checkSameResult<robest::RANSAC>(0.05 * 0.05);
+}
+
+TEST(EarlyAbort, MSAC)
+{
+    checkSameResult<robest::MSAC>(0.05);
+}
+
+TEST(EarlyAbort, LMedS)
+{
+    checkSameResult<robest::LMedS>(0.05);
+}
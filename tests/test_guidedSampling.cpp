@@ -0,0 +1,212 @@
+#include "gtest/gtest.h"
+
+#include <limits>
+#include <random>
+
+#include <omp.h>
+
+#include "robust_sampler.hpp"
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+// z = 0.1*x - 0.2*y + 1 without noise. Outliers are the first points, on five other
+// planes holding less points each than the true one.
+std::shared_ptr<PlaneFittingProblem> makeStructuredPlane(int nbPts, double outliersRatio)
+{
+    std::default_random_engine generator(61);
+    std::uniform_real_distribution<double> uniform(-10.0, 10.0);
+
+    std::vector<double> x(nbPts), y(nbPts), z(nbPts);
+    const int nbOutliers = (int)(nbPts * outliersRatio);
+    for (int i = 0; i < nbPts; i++)
+    {
+        x[i] = uniform(generator);
+        y[i] = uniform(generator);
+        if (i < nbOutliers)
+        {
+            int plane = i % 5;
+            z[i] = 0.3 * (plane - 2) * x[i] + 0.5 * y[i] + 4.0 * plane - 8.0;
+        }
+        else
+            z[i] = 0.1 * x[i] - 0.2 * y[i] + 1.0;
+    }
+
+    auto planeFitting = std::make_shared<PlaneFittingProblem>();
+    planeFitting->setData(x, y, z);
+    return planeFitting;
+}
+
+// MSAC whose scorings stop at the first check once a best model is found, as if they
+// lost the race against its cost: their inliers are counted on the first residuals
+class AbortingMSAC : public robest::MSAC
+{
+  protected:
+    double scoreCurrentModel(double thres, int & nbInliers)
+    {
+        double cost = robest::MSAC::scoreCurrentModel(thres, nbInliers);
+        if (nbScorings++ == 0)
+            return cost;
+        scoringAborted(abortCheckInterval);
+        nbInliers = std::min(nbInliers, (int) abortCheckInterval);
+        return std::numeric_limits<double>::max();
+    }
+
+  private:
+    int nbScorings = 0;
+};
+
+} // namespace
+
+// Failed hypotheses lower the probabilities of their samples, the most for the
+// samples in several of them
+TEST(GuidedSampling, learnsFromFailures)
+{
+    robest::GuidedSampler sampler;
+    sampler.reset(10);
+    EXPECT_DOUBLE_EQ(5.0, sampler.total());
+
+    sampler.update({0, 1, 2}, 0, 100);
+    const double once = sampler.probability(0);
+    EXPECT_LT(once, robest::GuidedSampler::priorProbability());
+    EXPECT_NEAR(0.5 * 0.75 / 0.875, once, 1e-12);
+
+    sampler.update({2, 3, 4}, 0, 100);
+    EXPECT_LT(sampler.probability(2), once);
+    EXPECT_DOUBLE_EQ(sampler.probability(0), sampler.probability(1));
+    EXPECT_DOUBLE_EQ(sampler.probability(3), sampler.probability(4));
+
+    // a supported hypothesis teaches nothing
+    sampler.update({5, 6, 7}, 60, 100);
+    EXPECT_DOUBLE_EQ(robest::GuidedSampler::priorProbability(), sampler.probability(6));
+
+    double sum = 0.0;
+    for (int i = 0; i < 10; ++i)
+        sum += sampler.probability(i);
+    EXPECT_NEAR(sum, sampler.total(), 1e-12);
+    EXPECT_NEAR(sampler.probability(0) + sampler.probability(1) + sampler.probability(2), sampler.prefixSum(3), 1e-12);
+}
+
+TEST(GuidedSampling, drawsProportionally)
+{
+    // samples 0 .. 4 far from the model, 5 .. 9 on it
+    robest::GuidedSampler sampler;
+    sampler.reset(10);
+    std::vector<double> errors = {5.0, 5.0, 5.0, 5.0, 5.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    sampler.learnFromModel(errors.data(), 5, 0.1);
+    const double low = robest::GuidedSampler::minProbability(), high = sampler.probability(5);
+    EXPECT_DOUBLE_EQ(low, sampler.probability(0));
+    EXPECT_GT(high, 0.95);
+    EXPECT_NEAR(5 * low + 5 * high, sampler.total(), 1e-12);
+
+    std::mt19937 generator(7);
+    std::vector<int> counts(10, 0), idx;
+    const int nbDraws = 20000;
+    for (int k = 0; k < nbDraws; ++k)
+    {
+        sampler.draw(3, generator, idx);
+        ASSERT_EQ(3u, idx.size());
+        EXPECT_NE(idx[0], idx[1]);
+        EXPECT_NE(idx[0], idx[2]);
+        EXPECT_NE(idx[1], idx[2]);
+        for (int i : idx)
+            counts[i]++;
+    }
+    int nbLow = 0;
+    for (int i = 0; i < 5; ++i)
+        nbLow += counts[i];
+    EXPECT_LT(nbLow, 3 * nbDraws / 50);
+    for (int i = 5; i < 10; ++i)
+        EXPECT_NEAR(3 * nbDraws / 5, counts[i], 3 * nbDraws / 20);
+
+    // the draws leave the probabilities as they were
+    EXPECT_NEAR(5 * low + 5 * high, sampler.total(), 1e-9);
+}
+
+TEST(GuidedSampling, learnsFromModel)
+{
+    robest::GuidedSampler sampler;
+    sampler.reset(4);
+    std::vector<double> errors = {0.0, 0.02, 0.5, 10.0};
+    sampler.learnFromModel(errors.data(), 2, 0.1);
+
+    EXPECT_GT(sampler.probability(0), 0.9);
+    EXPECT_GT(sampler.probability(1), 0.5);
+    EXPECT_DOUBLE_EQ(robest::GuidedSampler::minProbability(), sampler.probability(2));
+    EXPECT_DOUBLE_EQ(robest::GuidedSampler::minProbability(), sampler.probability(3));
+    EXPECT_NEAR(sampler.probability(0) + sampler.probability(1) + 2 * 0.01, sampler.total(), 1e-12);
+}
+
+TEST(GuidedSampling, findsStructuredPlane)
+{
+    auto planeFitting = makeStructuredPlane(2000, 0.6);
+    robest::MSAC solver;
+    solver.setGuidedSampling(0.5);
+    robest::SolveStatus status = solver.solve(planeFitting, 0.01, 5000, robest::SolveControl());
+
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(800u, solver.getInliersIndices().size());
+    EXPECT_TRUE(status.confidenceReached);
+}
+
+// A scoring that stopped early is no failure: the samples of its model keep the
+// probabilities learned from the best one
+TEST(GuidedSampling, abortedScoringsDoNotFail)
+{
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+
+    auto planeFitting = scene::makeReferencePlane(2000, 0.0, 0.0);
+    AbortingMSAC solver;
+    solver.setGuidedSampling(0.5);
+    solver.solve(planeFitting, 0.01, 200);
+    omp_set_num_threads(previousNbThreads);
+
+    ASSERT_EQ(200, solver.getStats().nbIterations);
+    const double learned = solver.getInlierProbability(0);
+    EXPECT_GT(learned, 0.9);
+    for (int i = 1; i < planeFitting->getTotalNbSamples(); ++i)
+        ASSERT_EQ(learned, solver.getInlierProbability(i)) << "sample " << i;
+}
+
+// With a budget that is often too small for uniform samples (about 65% of success),
+// the guided ones find the plane more often (about 80%). On one thread, so that each
+// iteration learns from all the previous ones. The rng is not seeded: over 500 runs,
+// the mean difference (about 70) is 3.5 standard deviations above the margin.
+TEST(GuidedSampling, moreSuccessesOnBudget)
+{
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+
+    auto planeFitting = scene::makeReferencePlane(2000, 0.0, 0.7, 0.0);
+    int nbSuccesses[2] = {0, 0};
+    for (int run = 0; run < 500; ++run)
+    {
+        for (int guided = 0; guided < 2; ++guided)
+        {
+            robest::MSAC solver;
+            solver.setGuidedSampling(guided ? 0.5 : 0.0);
+            solver.solve(planeFitting, 0.01, 40);
+            nbSuccesses[guided] += scene::isReferencePlane(planeFitting);
+        }
+    }
+    omp_set_num_threads(previousNbThreads);
+    EXPECT_GT(nbSuccesses[1], nbSuccesses[0] + 20);
+}
+
+// Only the uniform samples count for the adaptive termination
+TEST(GuidedSampling, conservativeTermination)
+{
+    auto planeFitting = makeStructuredPlane(2000, 0.7);
+    robest::SolveControl control;
+    robest::MSAC uniform, guided;
+    guided.setGuidedSampling(0.5);
+    robest::SolveStatus uniformStatus = uniform.solve(planeFitting, 0.01, 5000, control);
+    robest::SolveStatus guidedStatus = guided.solve(planeFitting, 0.01, 5000, control);
+
+    ASSERT_TRUE(uniformStatus.confidenceReached && guidedStatus.confidenceReached);
+    scene::expectReferencePlane(planeFitting);
+    int required = uniform.calculateIterationsNb(3, control.confidence, 0.3f);
+    EXPECT_GE(uniformStatus.nbIterations, required - 1);
+    EXPECT_GE(guidedStatus.nbIterations, 2 * required - 3);
+}
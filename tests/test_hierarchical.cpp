@@ -0,0 +1,169 @@
+#include "gtest/gtest.h"
+
+#include <set>
+#include <tuple>
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+bool isSubset(const std::vector<int> & subset, const std::vector<int> & set)
+{
+    return std::includes(set.begin(), set.end(), subset.begin(), subset.end());
+}
+
+} // namespace
+
+TEST(SamplePyramid, random)
+{
+    robest::SamplePyramid pyramid;
+    pyramid.buildRandom(100000, 1000, 10.0);
+
+    ASSERT_EQ(3, pyramid.nbLevels());
+    EXPECT_EQ(100000, pyramid.getTotalNbSamples());
+    EXPECT_EQ(100000, pyramid.levelSize(0));
+    EXPECT_EQ(10000, pyramid.levelSize(1));
+    EXPECT_EQ(1000, pyramid.levelSize(2));
+
+    EXPECT_TRUE(std::is_sorted(pyramid.indices(1).begin(), pyramid.indices(1).end()));
+    EXPECT_TRUE(isSubset(pyramid.indices(2), pyramid.indices(1)));
+    EXPECT_LT(pyramid.indices(1).back(), 100000);
+
+    // nothing to subsample
+    pyramid.buildRandom(500, 1000);
+    EXPECT_EQ(1, pyramid.nbLevels());
+}
+
+TEST(SamplePyramid, voxelGrid)
+{
+    const scene::Scene plane = scene::referencePlane(20000, 0.001, 0.4, 0.0);
+    const std::vector<double> & x = plane.x, & y = plane.y, & z = plane.z;
+
+    robest::SamplePyramid pyramid;
+    pyramid.buildVoxelGrid(x.data(), y.data(), z.data(), 20000, 1, 0.5, 500);
+
+    ASSERT_GE(pyramid.nbLevels(), 3);
+    EXPECT_LE(pyramid.levelSize(pyramid.nbLevels() - 1), 500);
+    for (int l = 1; l < pyramid.nbLevels(); ++l)
+    {
+        EXPECT_LT(pyramid.levelSize(l), pyramid.levelSize(l - 1));
+        EXPECT_TRUE(std::is_sorted(pyramid.indices(l).begin(), pyramid.indices(l).end()));
+        if (l > 1)
+        {
+            EXPECT_TRUE(isSubset(pyramid.indices(l), pyramid.indices(l - 1)));
+        }
+    }
+
+    // one point per voxel of edge 0.5 on the first level
+    std::set<std::tuple<int, int, int>> voxels;
+    for (int i : pyramid.indices(1))
+        voxels.insert(std::make_tuple((int) std::floor(x[i] / 0.5), (int) std::floor(y[i] / 0.5), (int) std::floor(z[i] / 0.5)));
+    EXPECT_EQ((size_t) pyramid.levelSize(1), voxels.size());
+
+    // 2D points, interleaved
+    std::vector<double> xy;
+    for (int i = 0; i < 20000; ++i)
+    {
+        xy.push_back(x[i]);
+        xy.push_back(y[i]);
+    }
+    pyramid.buildVoxelGrid(&xy[0], &xy[1], nullptr, 20000, 2, 1.0, 100);
+    EXPECT_EQ(400, pyramid.levelSize(1)); // 20 x 20 cells
+}
+
+TEST(SubsetProblem, mapsSamples)
+{
+    auto planeFitting = scene::makeReferencePlane(1000, 0.001, 0.4, 0.0);
+    std::vector<int> indices = {3, 500, 700, 701, 999};
+    robest::SubsetProblem subset(planeFitting, indices);
+
+    EXPECT_EQ(5, subset.getTotalNbSamples());
+    EXPECT_EQ(planeFitting->getNbMinSamples(), subset.getNbMinSamples());
+
+    subset.estimModelFromSamples({1, 2, 4});
+    std::vector<double> params;
+    ASSERT_TRUE(subset.getModelParams(params));
+
+    std::vector<double> errors(5);
+    ASSERT_TRUE(subset.estimErrorsForModel(params, 0, 5, errors.data()));
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_DOUBLE_EQ(planeFitting->estimErrorForSample(indices[i]), subset.estimErrorForSample(i));
+        EXPECT_NEAR(subset.estimErrorForSample(i), errors[i], 1.0e-12);
+    }
+    EXPECT_EQ(std::vector<int>({500, 999}), subset.toProblemIdx({1, 4}));
+}
+
+TEST(Hierarchical, ransac)
+{
+    auto planeFitting = scene::makeReferencePlane(200000, 0.001, 0.4, 0.0);
+    robest::SamplePyramid pyramid;
+    pyramid.buildRandom(200000, 2000, 10.0);
+
+    robest::RANSAC solver;
+    robest::SolveStatus status = solver.solveHierarchical(planeFitting, pyramid, 0.01 * 0.01, 100);
+    EXPECT_EQ(100, status.nbIterations);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+
+    // inliers at full resolution
+    EXPECT_EQ(200000, solver.getInliersMask().size());
+
+    // 100 hypotheses on 2000 points, 9 on 20000, 5 on 200000, then the final phase
+    const robest::SolverStats & stats = solver.getStats();
+    EXPECT_EQ(100 + 9 + 5, stats.nbHypotheses);
+    EXPECT_LT(stats.nbResiduals, 100LL * 200000 / 10);
+}
+
+TEST(Hierarchical, reusedPyramid)
+{
+    auto planeFitting = scene::makeReferencePlane(50000, 0.001, 0.4, 0.0);
+    robest::SamplePyramid pyramid;
+    pyramid.buildRandom(50000, 1000);
+
+    robest::MSAC msac;
+    msac.setNbCarriedHypotheses(4);
+    for (int run = 0; run < 3; ++run)
+    {
+        msac.solveHierarchical(planeFitting, pyramid, 0.01, 200);
+        scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+        EXPECT_NEAR(0.6, msac.getInliersFraction(), 0.01);
+    }
+
+    robest::MAGSAC magsac;
+    magsac.solveHierarchical(planeFitting, pyramid, 0.01, 200);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+
+    robest::LMedS lmeds;
+    lmeds.solveHierarchical(planeFitting, pyramid, 0.01, 200);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+}
+
+TEST(Hierarchical, singleLevel)
+{
+    auto planeFitting = scene::makeReferencePlane(1000, 0.001, 0.4, 0.0);
+    robest::SamplePyramid pyramid;
+    pyramid.buildRandom(1000, 5000);
+
+    robest::MSAC solver;
+    solver.solveHierarchical(planeFitting, pyramid, 0.003, 100);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+    EXPECT_EQ(100, solver.getStats().nbHypotheses);
+}
+
+TEST(Hierarchical, priorsAndCancel)
+{
+    auto planeFitting = scene::makeReferencePlane(20000, 0.001, 0.4, 0.0);
+    robest::SamplePyramid pyramid;
+    pyramid.buildRandom(20000, 500);
+
+    // an exact prior wins on the coarse level and is carried to the full dataset
+    robest::MSAC solver;
+    solver.setPriorModels({{0.1, -0.2, -1.0, 1.0}});
+    robest::SolveControl control;
+    control.cancelToken.cancel();
+    robest::SolveStatus status = solver.solveHierarchical(planeFitting, pyramid, 0.01, 100, control);
+    EXPECT_TRUE(status.cancelled);
+    EXPECT_EQ(0, status.nbIterations);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+    EXPECT_NEAR(0.6, solver.getInliersFraction(), 0.01);
+}
@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include <random>
+
+#include "LineFitting/LineFitting.hpp"
+
+TEST(InlierMask, setTestAndCount)
+{
+    robest::InlierMask mask(130);
+    EXPECT_EQ(130, mask.size());
+    EXPECT_EQ(3, mask.nbWords());
+    EXPECT_EQ(0, mask.count());
+
+    for (int i : {0, 63, 64, 129})
+        mask.set(i);
+    EXPECT_TRUE(mask.test(63));
+    EXPECT_TRUE(mask.test(64));
+    EXPECT_FALSE(mask.test(65));
+    EXPECT_EQ(4, mask.count());
+
+    mask.reset(63);
+    EXPECT_FALSE(mask.test(63));
+    EXPECT_EQ(3, mask.count());
+}
+
+TEST(InlierMask, indicesRoundTrip)
+{
+    std::vector<int> indices = {1, 5, 64, 65, 100, 199};
+    robest::InlierMask mask(200);
+    mask.fromIndices(indices);
+
+    std::vector<int> converted;
+    mask.toIndices(converted);
+    EXPECT_EQ(indices, converted);
+}
+
+TEST(InlierMask, thresholdWord)
+{
+    double errors2[5] = {0.5, 2.0, 0.0, 1.0, 0.99};
+    EXPECT_EQ(robest::InlierMask::Word(0x15), robest::InlierMask::thresholdWord(errors2, 5, 1.0));
+    EXPECT_EQ(robest::InlierMask::Word(0), robest::InlierMask::thresholdWord(errors2, 0, 1.0));
+}
+
+TEST(InlierMask, setOperations)
+{
+    robest::InlierMask a(100), b(100);
+    for (int i = 0; i < 60; ++i)
+        a.set(i);
+    for (int i = 40; i < 100; ++i)
+        b.set(i);
+
+    EXPECT_EQ(20, a.overlap(b));
+
+    robest::InlierMask intersection = a;
+    intersection &= b;
+    EXPECT_EQ(20, intersection.count());
+    EXPECT_TRUE(intersection.test(40) && !intersection.test(39));
+
+    robest::InlierMask onlyA = a;
+    onlyA.andNot(b);
+    EXPECT_EQ(40, onlyA.count());
+    EXPECT_EQ(0, onlyA.overlap(b));
+
+    robest::InlierMask both = a;
+    both |= b;
+    EXPECT_EQ(100, both.count());
+    EXPECT_NE(both, a);
+}
+
+TEST(InlierMask, estimatorInliers)
+{
+    std::default_random_engine generator(5);
+    std::uniform_real_distribution<double> uniform(0.0, 100.0);
+
+    // y = 2*x - 1, the first 150 points are outliers
+    std::vector<double> x(1000), y(1000);
+    for (int i = 0; i < 1000; i++)
+    {
+        x[i] = uniform(generator);
+        y[i] = (i < 150) ? uniform(generator) + 300.0 : 2.0 * x[i] - 1.0;
+    }
+
+    auto lineFitting = std::make_shared<LineFittingProblem>();
+    lineFitting->setData(x, y);
+
+    robest::MSAC solver;
+    solver.solve(lineFitting, 0.1, 100);
+
+    const robest::InlierMask & mask = solver.getInliersMask();
+    EXPECT_EQ(850, mask.count());
+
+    // the indices are a view on the estimator, in ascending order
+    const std::vector<int> & indices = solver.getInliersIndices();
+    EXPECT_EQ(&indices, &solver.getInliersIndices());
+    ASSERT_EQ(850u, indices.size());
+    for (int i = 0; i < 850; ++i)
+        EXPECT_EQ(150 + i, indices[i]);
+
+    // filled by solve(): const callers may read them from several threads
+    int nbWrong = 0;
+    #pragma omp parallel for num_threads(4) reduction(+:nbWrong)
+    for (int t = 0; t < 4; ++t)
+        nbWrong += solver.getInliersIndices().size() != 850u;
+    EXPECT_EQ(0, nbWrong);
+}
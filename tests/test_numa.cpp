@@ -0,0 +1,179 @@
+#include "gtest/gtest.h"
+
+
+#include <omp.h>
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+// Two nodes sharing cpu 0: the partitions and pinning are exercised on any machine,
+// the pages cannot be moved to a node that does not exist
+robest::NumaTopology fakeTwoNodes()
+{
+    return robest::NumaTopology(std::vector<std::vector<int>>{{0}, {0}});
+}
+
+// Counts the placements of its samples
+class CountingPlane : public PlaneFittingProblem
+{
+  public:
+    int nbPlacements = 0;
+
+    void placeSamples(const robest::NumaLayout & layout)
+    {
+        nbPlacements++;
+        PlaneFittingProblem::placeSamples(layout);
+    }
+};
+
+} // namespace
+
+TEST(Numa, parseCpuList)
+{
+    std::vector<int> cpus;
+    EXPECT_TRUE(robest::NumaTopology::parseCpuList("0-3,8,10-11\n", cpus));
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), cpus);
+    EXPECT_TRUE(robest::NumaTopology::parseCpuList("", cpus));
+    EXPECT_TRUE(cpus.empty());
+
+    EXPECT_FALSE(robest::NumaTopology::parseCpuList("3-1", cpus));
+    EXPECT_FALSE(robest::NumaTopology::parseCpuList("0-", cpus));
+    EXPECT_FALSE(robest::NumaTopology::parseCpuList("a", cpus));
+    EXPECT_FALSE(robest::NumaTopology::parseCpuList("1:2", cpus));
+}
+
+TEST(Numa, topology)
+{
+    robest::NumaTopology unknown;
+    EXPECT_EQ(1, unknown.nbNodes());
+    EXPECT_TRUE(unknown.cpus(0).empty());
+
+    robest::NumaTopology topology({{0, 1}, {2, 3}}, {0, 2});
+    EXPECT_EQ(2, topology.nbNodes());
+    EXPECT_EQ(std::vector<int>({2, 3}), topology.cpus(1));
+    EXPECT_EQ(2, topology.id(1));
+
+    // whatever the machine, there is a node
+    EXPECT_GE(robest::NumaTopology::system().nbNodes(), 1);
+}
+
+TEST(Numa, layout)
+{
+    robest::NumaTopology topology({{0}, {1}, {2}, {3}});
+
+    // 4 nodes, 6 threads: 4 partitions
+    robest::NumaLayout layout(topology, 1000, 6);
+    ASSERT_EQ(4, layout.nbPartitions());
+    EXPECT_TRUE(layout.isMultiNode());
+    EXPECT_EQ(0, layout.partitionBegin(0));
+    EXPECT_EQ(500, layout.partitionBegin(2));
+    EXPECT_EQ(1000, layout.partitionBegin(4));
+    for (int p = 0; p < 4; ++p)
+    {
+        EXPECT_EQ(p, layout.node(p));
+        for (int t = layout.firstThread(p); t < layout.firstThread(p + 1); ++t)
+            EXPECT_EQ(p, layout.partitionOfThread(t));
+    }
+    EXPECT_EQ(6, layout.firstThread(4));
+
+    // fewer threads than nodes: one partition per thread, spread over the nodes
+    robest::NumaLayout small(topology, 1000, 2);
+    EXPECT_EQ(2, small.nbPartitions());
+    EXPECT_EQ(0, small.node(0));
+    EXPECT_EQ(2, small.node(1));
+
+    // one thread: nothing to do
+    robest::NumaLayout single(topology, 1000, 1);
+    EXPECT_FALSE(single.isMultiNode());
+    EXPECT_FALSE(single.place(nullptr, 8));
+}
+
+// Same consensus set with the scores summed per partition as with the usual batched
+// scoring, and the threads get their affinity back
+TEST(Numa, sameResultAsBatched)
+{
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(2);
+
+    auto planeFitting = scene::makeReferencePlane(5000);
+#if defined(__linux__)
+    cpu_set_t before, after;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(before), &before));
+#endif
+
+    robest::MSAC batched, numa;
+    batched.setBatchSize(8, 256);
+    numa.setBatchSize(8, 256);
+    numa.setNumaAware(true, fakeTwoNodes());
+
+    batched.solve(planeFitting, 0.01, 40);
+    scene::expectReferencePlane(planeFitting);
+    numa.solve(planeFitting, 0.01, 40);
+    scene::expectReferencePlane(planeFitting);
+    omp_set_num_threads(previousNbThreads);
+
+    EXPECT_EQ(batched.getInliersMask(), numa.getInliersMask());
+    EXPECT_EQ(3500u, numa.getInliersIndices().size());
+#if defined(__linux__)
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(after), &after));
+    EXPECT_TRUE(CPU_EQUAL(&before, &after));
+#endif
+}
+
+TEST(Numa, ransacOnSingleNode)
+{
+    auto planeFitting = scene::makeReferencePlane(2000);
+
+    // a single node is the usual batched scoring
+    robest::RANSAC solver;
+    solver.setBatchSize(8, 128);
+    solver.setNumaAware(true, robest::NumaTopology(std::vector<std::vector<int>>{{0}}));
+    solver.solve(planeFitting, 0.01, 40);
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(1400u, solver.getInliersIndices().size());
+
+    // the topology of the machine
+    solver.setNumaAware(true);
+    solver.solve(planeFitting, 0.01, 40);
+    scene::expectReferencePlane(planeFitting);
+}
+
+// The samples are placed once per data, new data of the same size included
+TEST(Numa, placedAgainAfterSetData)
+{
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(2);
+
+    std::vector<double> x(1000), y(1000), z(1000);
+    for (int i = 0; i < 1000; i++)
+    {
+        x[i] = i % 37;
+        y[i] = i % 41;
+        z[i] = 0.1 * x[i] - 0.2 * y[i] + 1.0;
+    }
+    auto planeFitting = std::make_shared<CountingPlane>();
+    planeFitting->setData(x, y, z);
+
+    robest::MSAC solver;
+    solver.setBatchSize(8, 128);
+    solver.setNumaAware(true, fakeTwoNodes());
+    solver.solve(planeFitting, 0.01, 16);
+    solver.solve(planeFitting, 0.01, 16);
+    EXPECT_EQ(1, planeFitting->nbPlacements);
+
+    const unsigned long long version = planeFitting->getDataVersion();
+    planeFitting->setData(x, y, z);
+    EXPECT_NE(version, planeFitting->getDataVersion());
+    solver.solve(planeFitting, 0.01, 16);
+    EXPECT_EQ(2, planeFitting->nbPlacements);
+
+    // another problem has another version
+    auto other = std::make_shared<CountingPlane>();
+    other->setData(x, y, z);
+    EXPECT_NE(planeFitting->getDataVersion(), other->getDataVersion());
+    solver.solve(other, 0.01, 16);
+    EXPECT_EQ(1, other->nbPlacements);
+
+    omp_set_num_threads(previousNbThreads);
+}
@@ -0,0 +1,235 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <random>
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+const int nbPts = 20000;
+
+// Point file of z = 0.1*x - 0.2*y + 1 without noise, 3 points out of 10 being
+// outliers 30 above the plane. Written in blocks, as a scan too large for memory.
+std::string writePlaneFile(const std::string & name)
+{
+    std::default_random_engine generator(43);
+    std::uniform_real_distribution<double> uniform(-10.0, 10.0);
+
+    std::string path = testing::TempDir() + name;
+    robest::PointFileWriter writer;
+    EXPECT_TRUE(writer.open(path, 3));
+
+    std::vector<double> block;
+    for (int i = 0; i < nbPts; i++)
+    {
+        double x = uniform(generator);
+        double y = uniform(generator);
+        double z = (i % 10 < 3) ? uniform(generator) + 30.0 : 0.1 * x - 0.2 * y + 1.0;
+        block.insert(block.end(), {x, y, z});
+        if (block.size() == 3 * 1000)
+        {
+            EXPECT_TRUE(writer.write(block.data(), 1000));
+            block.clear();
+        }
+    }
+    EXPECT_TRUE(writer.close());
+    return path;
+}
+
+bool isInlier(int i) { return i % 10 >= 3; }
+
+// Splits the coordinates of the loaded points
+robest::AbstractEstimator::PointsLoader planeLoader(std::shared_ptr<PlaneFittingProblem> problem)
+{
+    return [problem](const double * points, int n)
+    {
+        std::vector<double> x(n), y(n), z(n);
+        for (int i = 0; i < n; ++i)
+        {
+            x[i] = points[3 * i];
+            y[i] = points[3 * i + 1];
+            z[i] = points[3 * i + 2];
+        }
+        problem->setData(x, y, z);
+    };
+}
+
+std::vector<char> readFile(const std::string & path)
+{
+    std::vector<char> content;
+    FILE * file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return content;
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        content.insert(content.end(), buffer, buffer + n);
+    std::fclose(file);
+    return content;
+}
+
+} // namespace
+
+TEST(OutOfCore, mappedPointFile)
+{
+    std::string path = writePlaneFile("robest_mapped.pts");
+
+    robest::MappedPointFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_EQ(3, file.dims());
+    EXPECT_EQ(nbPts, file.size());
+    EXPECT_NEAR(0.1 * file.point(5)[0] - 0.2 * file.point(5)[1] + 1.0, file.point(5)[2], 1e-12);
+    EXPECT_GT(file.point(1)[2], 20.0);
+
+    // the pages come back when released points are read again
+    file.willNeed(0, nbPts);
+    file.release(0, nbPts);
+    EXPECT_NEAR(0.1 * file.point(5)[0] - 0.2 * file.point(5)[1] + 1.0, file.point(5)[2], 1e-12);
+    file.close();
+    EXPECT_FALSE(file.isOpen());
+
+    // not a point file
+    std::string other = testing::TempDir() + "robest_not_points.pts";
+    FILE * out = std::fopen(other.c_str(), "wb");
+    ASSERT_TRUE(out != nullptr);
+    std::fputs("some text that is long enough for a header", out);
+    std::fclose(out);
+    EXPECT_FALSE(file.open(other));
+    EXPECT_FALSE(file.open(testing::TempDir() + "robest_missing.pts"));
+
+    std::remove(path.c_str());
+    std::remove(other.c_str());
+}
+
+TEST(OutOfCore, bitmaskInliers)
+{
+    std::string path = writePlaneFile("robest_bitmask.pts");
+    robest::MappedPointFile file;
+    ASSERT_TRUE(file.open(path));
+
+    // chunks that are not a multiple of 64, nor divide the file
+    robest::OutOfCoreOptions options;
+    options.reservoirSize = 2000;
+    options.chunkSize = 3000;
+    options.inliersPath = testing::TempDir() + "robest_inliers.mask";
+
+    auto planeFitting = std::make_shared<PlaneFittingProblem>();
+    robest::MSAC solver;
+    solver.solveOutOfCore(planeFitting, file, planeLoader(planeFitting), 0.01, 100, options);
+
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(2000, planeFitting->getTotalNbSamples());
+    EXPECT_NEAR(0.7, solver.getInliersFraction(), 1e-12);
+
+    std::vector<char> mask = readFile(options.inliersPath);
+    ASSERT_EQ(size_t((nbPts + 63) / 64 * 8), mask.size());
+    int nbMismatches = 0;
+    for (int i = 0; i < nbPts; i++)
+    {
+        uint64_t word;
+        std::memcpy(&word, mask.data() + i / 64 * 8, 8);
+        nbMismatches += bool((word >> (i % 64)) & 1) != isInlier(i);
+    }
+    EXPECT_EQ(0, nbMismatches);
+
+    std::remove(path.c_str());
+    std::remove(options.inliersPath.c_str());
+}
+
+TEST(OutOfCore, indexInliers)
+{
+    std::string path = writePlaneFile("robest_indices.pts");
+    robest::MappedPointFile file;
+    ASSERT_TRUE(file.open(path));
+
+    robest::OutOfCoreOptions options;
+    options.reservoirSize = 1000;
+    options.chunkSize = 4096;
+    options.inliersPath = testing::TempDir() + "robest_inliers.idx";
+    options.inliersFormat = robest::InliersFileFormat::Indices;
+
+    auto planeFitting = std::make_shared<PlaneFittingProblem>();
+    robest::RANSAC solver;
+    solver.solveOutOfCore(planeFitting, file, planeLoader(planeFitting), 0.01 * 0.01, 100, options);
+
+    scene::expectReferencePlane(planeFitting);
+
+    std::vector<char> content = readFile(options.inliersPath);
+    std::vector<int64_t> indices(content.size() / sizeof(int64_t));
+    if (!indices.empty())
+        std::memcpy(indices.data(), content.data(), indices.size() * sizeof(int64_t));
+
+    std::vector<int64_t> expected;
+    for (int i = 0; i < nbPts; i++)
+    {
+        if (isInlier(i))
+            expected.push_back(i);
+    }
+    EXPECT_EQ(expected, indices);
+
+#ifndef ROBEST_DISABLE_STATS
+    // every hypothesis is scored on the whole file, as well as the final model
+    EXPECT_GE(solver.getStats().nbResiduals, 2LL * nbPts);
+#endif
+
+    std::remove(path.c_str());
+    std::remove(options.inliersPath.c_str());
+}
+
+// The inliers are still counted when their file cannot be written
+TEST(OutOfCore, inliersFileError)
+{
+    std::string path = writePlaneFile("robest_ioerror.pts");
+    robest::MappedPointFile file;
+    ASSERT_TRUE(file.open(path));
+
+    robest::OutOfCoreOptions options;
+    options.reservoirSize = 1000;
+    options.chunkSize = 4096;
+    options.inliersPath = testing::TempDir() + "robest_missing_dir/inliers.mask";
+
+    auto planeFitting = std::make_shared<PlaneFittingProblem>();
+    robest::RANSAC solver;
+    robest::SolveStatus status = solver.solveOutOfCore(planeFitting, file, planeLoader(planeFitting), 0.01 * 0.01, 100, options);
+    EXPECT_TRUE(status.ioError);
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_NEAR(0.7, solver.getInliersFraction(), 1.0e-9);
+
+    // full device: the writes fail once the buffer is flushed
+    if (FILE * full = std::fopen("/dev/full", "wb"))
+    {
+        std::fclose(full);
+        options.inliersPath = "/dev/full";
+        status = solver.solveOutOfCore(planeFitting, file, planeLoader(planeFitting), 0.01 * 0.01, 100, options);
+        EXPECT_TRUE(status.ioError);
+        EXPECT_NEAR(0.7, solver.getInliersFraction(), 1.0e-9);
+    }
+
+    options.inliersPath.clear();
+    status = solver.solveOutOfCore(planeFitting, file, planeLoader(planeFitting), 0.01 * 0.01, 100, options);
+    EXPECT_FALSE(status.ioError);
+
+    std::remove(path.c_str());
+}
+
+// The reservoir holds the whole file when it is small enough
+TEST(OutOfCore, smallFile)
+{
+    std::string path = writePlaneFile("robest_small.pts");
+    robest::MappedPointFile file;
+    ASSERT_TRUE(file.open(path));
+
+    robest::OutOfCoreOptions options;
+    options.reservoirSize = 2 * nbPts;
+
+    auto planeFitting = std::make_shared<PlaneFittingProblem>();
+    robest::MSAC solver;
+    solver.solveOutOfCore(planeFitting, file, planeLoader(planeFitting), 0.01, 50, options);
+
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(nbPts, planeFitting->getTotalNbSamples());
+    EXPECT_EQ(size_t(nbPts * 7 / 10), solver.getInliersIndices().size());
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,158 @@
+#include "gtest/gtest.h"
+
+#include "robust_portfolio.hpp"
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+robest::Portfolio makePortfolio()
+{
+    robest::Portfolio portfolio;
+    portfolio.add(std::make_shared<robest::RANSAC>(), 0.01 * 0.01, 2000);
+    portfolio.add(std::make_shared<robest::MSAC>(), 0.01, 2000);
+    portfolio.add(std::make_shared<robest::LMedS>(), 0.01, 2000);
+    return portfolio;
+}
+
+} // namespace
+
+TEST(Portfolio, modelViews)
+{
+    auto planeFitting = scene::makeReferencePlane(100, 0.001, 0.0, 0.0);
+    std::vector<double> problemModel;
+    planeFitting->getModelParams(problemModel);
+    robest::ModelView first(planeFitting), second(planeFitting);
+
+    // each view keeps the model estimated from its samples
+    first.estimModelFromSamples({0, 1, 2});
+    second.estimModelFromSamples({3, 4, 5});
+    std::vector<double> firstModel, secondModel;
+    first.getModelParams(firstModel);
+    second.getModelParams(secondModel);
+    EXPECT_NE(firstModel, secondModel);
+
+    std::vector<double> errors(100);
+    planeFitting->estimErrorsForModel(firstModel, 0, 100, errors.data());
+    for (int i = 0; i < 100; i++)
+        EXPECT_DOUBLE_EQ(errors[i], first.estimErrorForSample(i));
+
+    // weighted refit on the samples of the first model
+    second.estimModelFromWeightedSamples({0, 1, 2, 3}, {1.0, 1.0, 1.0, 0.0});
+    for (int i = 0; i < 3; i++)
+        EXPECT_NEAR(0.0, second.estimErrorForSample(i), 1e-9);
+
+    // the model of the problem is left as is
+    std::vector<double> model;
+    planeFitting->getModelParams(model);
+    EXPECT_EQ(problemModel, model);
+
+    EXPECT_EQ(planeFitting->getTotalNbSamples(), first.getTotalNbSamples());
+    EXPECT_FALSE(first.setModelParams({1.0}));
+}
+
+// A copy holds the same data, with a model and a data version of its own
+TEST(Portfolio, clonedProblem)
+{
+    auto planeFitting = scene::makeReferencePlane(100);
+    std::shared_ptr<robest::EstimationProblem> copy = planeFitting->clone();
+    ASSERT_TRUE(copy != nullptr);
+    EXPECT_EQ(planeFitting->getTotalNbSamples(), copy->getTotalNbSamples());
+    EXPECT_NE(planeFitting->getDataVersion(), copy->getDataVersion());
+
+    std::vector<double> model, copyModel;
+    planeFitting->getModelParams(model);
+    ASSERT_TRUE(copy->setModelParams({0.0, 0.0, 1.0, -1.0}));
+    copy->getModelParams(copyModel);
+    EXPECT_NE(model, copyModel);
+    std::vector<double> unchanged;
+    planeFitting->getModelParams(unchanged);
+    EXPECT_EQ(model, unchanged);
+
+    std::vector<double> errors(100), copyErrors(100);
+    planeFitting->estimErrorsForModel(copyModel, 0, 100, errors.data());
+    copy->estimErrorsForModel(copyModel, 0, 100, copyErrors.data());
+    EXPECT_EQ(errors, copyErrors);
+}
+
+// Without estimModelParams, each member solves a copy of the problem
+TEST(Portfolio, copiesOfTheProblem)
+{
+    scene::SceneOptions options;
+    options.nbPoints = 2000;
+    options.noiseSigma = 0.001;
+    options.outliersRatio = 0.3;
+    const scene::Scene lines = scene::generateScene(scene::SceneKind::Lines, options);
+    std::shared_ptr<robest::EstimationProblem> lineFitting = scene::makeProblem(lines);
+    ASSERT_FALSE(robest::ModelView::supports(*lineFitting));
+
+    robest::Portfolio portfolio = makePortfolio();
+    portfolio.solve(lineFitting, 0.01);
+    ASSERT_GE(portfolio.getWinner(), 0);
+
+    std::vector<double> model;
+    lineFitting->getModelParams(model);
+    EXPECT_LT(scene::modelError(scene::SceneKind::Lines, model, lines.models[0]), 1.0e-2);
+    for (int m = 0; m < portfolio.size(); ++m)
+        EXPECT_FALSE(portfolio.getResult(m).model.empty());
+}
+
+TEST(Portfolio, fewOutliers)
+{
+    auto planeFitting = scene::makeReferencePlane(2000, 0.001, 0.3, 0.0);
+    robest::Portfolio portfolio = makePortfolio();
+    robest::SolveStatus status = portfolio.solve(planeFitting, 0.01);
+
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+    ASSERT_GE(portfolio.getWinner(), 0);
+    EXPECT_TRUE(status.confidenceReached);
+    EXPECT_FALSE(status.cancelled);
+
+    // the winner has the lowest common score
+    const robest::Portfolio::Result & best = portfolio.getResult(portfolio.getWinner());
+    for (int m = 0; m < portfolio.size(); ++m)
+        EXPECT_LE(best.score, portfolio.getResult(m).score);
+}
+
+// LMedS breaks down above 50% of outliers, the portfolio does not
+TEST(Portfolio, manyOutliers)
+{
+    auto planeFitting = scene::makeReferencePlane(2000, 0.001, 0.7, 0.0);
+    robest::Portfolio portfolio = makePortfolio();
+    portfolio.solve(planeFitting, 0.01);
+
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+    EXPECT_NE(2, portfolio.getWinner());
+}
+
+// A member without a chance to reach its confidence target in a reasonable time
+// (threshold far below the noise) is cancelled by the first confident one, with
+// the adaptive termination
+TEST(Portfolio, slowMembersAreCancelled)
+{
+    auto planeFitting = scene::makeReferencePlane(2000, 0.001, 0.3, 0.0);
+    robest::Portfolio portfolio;
+    portfolio.add(std::make_shared<robest::MSAC>(), 1e-7, 50000);
+    portfolio.add(std::make_shared<robest::RANSAC>(), 0.01 * 0.01, 50000);
+    portfolio.solve(planeFitting, 0.01, robest::SolveControl());
+
+    ASSERT_GE(portfolio.getWinner(), 0);
+    EXPECT_TRUE(portfolio.getResult(1).status.confidenceReached);
+    EXPECT_TRUE(portfolio.getResult(0).status.cancelled);
+    EXPECT_LT(portfolio.getResult(0).status.nbIterations, 50000);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+}
+
+TEST(Portfolio, cancelled)
+{
+    auto planeFitting = scene::makeReferencePlane(2000, 0.001, 0.3, 0.0);
+    robest::Portfolio portfolio = makePortfolio();
+
+    robest::SolveControl control;
+    control.cancelToken.cancel();
+    robest::SolveStatus status = portfolio.solve(planeFitting, 0.01, control);
+
+    EXPECT_TRUE(status.cancelled);
+    EXPECT_EQ(-1, portfolio.getWinner());
+    for (int m = 0; m < portfolio.size(); ++m)
+        EXPECT_EQ(0, portfolio.getResult(m).status.nbIterations);
+}
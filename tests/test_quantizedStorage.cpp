@@ -0,0 +1,194 @@
+#include "gtest/gtest.h"
+
+#include <random>
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+// Points of the scene, which outlives the source
+robest::PointSource sourceFrom(const scene::Scene & plane)
+{
+    return [&plane](int i, double & x, double & y, double & z) {
+        x = plane.x[i];
+        y = plane.y[i];
+        z = plane.z[i];
+    };
+}
+
+} // namespace
+
+TEST(QuantizedPoints3d, decodeWithinBound)
+{
+    std::default_random_engine generator(5);
+    std::uniform_real_distribution<double> uniform(-100.0, 100.0);
+
+    const int n = 1000;
+    std::vector<double> xyz(3 * n);
+    for (double & v : xyz)
+        v = uniform(generator);
+
+    robest::QuantizedPoints3d<int16_t> cloud;
+    cloud.build(&xyz[0], &xyz[1], &xyz[2], n, 3, 128);
+    ASSERT_EQ(n, cloud.size());
+
+    for (int i = 0; i < n; ++i)
+    {
+        const robest::QuantizedPoints3d<int16_t>::Block & block = cloud.block(i / 128);
+        double dx = block.ox + block.scale * cloud.x()[i] - xyz[3 * i];
+        double dy = block.oy + block.scale * cloud.y()[i] - xyz[3 * i + 1];
+        double dz = block.oz + block.scale * cloud.z()[i] - xyz[3 * i + 2];
+        EXPECT_LE(std::sqrt(dx * dx + dy * dy + dz * dz), block.errorBound);
+    }
+    // 200 / 2^16 per step on each axis
+    EXPECT_LT(cloud.errorBound(0, n), 3.0e-3);
+}
+
+TEST(QuantizedStorage, approxErrorsWithinBound)
+{
+    auto planeFitting = scene::makeReferencePlane(5000, 0.01, 0.3, 0.0);
+    const std::vector<double> model = {0.12, -0.19, -1.0, 0.9};
+
+    std::vector<double> exact(5000), approx(5000);
+    double errorBound = 0.0;
+    ASSERT_TRUE(planeFitting->estimErrorsForModel(model, 0, 5000, exact.data()));
+    EXPECT_FALSE(planeFitting->estimApproxErrorsForModel(model, 0, 5000, approx.data(), errorBound));
+
+    for (int bits : {16, 32})
+    {
+        planeFitting->setQuantizedStorage(bits, 1000);
+        // unaligned range over several blocks
+        ASSERT_TRUE(planeFitting->estimApproxErrorsForModel(model, 700, 3300, approx.data(), errorBound));
+        EXPECT_GT(errorBound, 0.0);
+        for (int i = 700; i < 3300; ++i)
+            EXPECT_LE(std::fabs(approx[i - 700] - exact[i]), errorBound);
+    }
+    EXPECT_LT(errorBound, 1.0e-6);
+}
+
+TEST(QuantizedStorage, memorySize)
+{
+    auto planeFitting = scene::makeReferencePlane(10000, 0.01, 0.3, 0.0);
+    EXPECT_EQ(0u, planeFitting->getQuantizedMemorySize());
+
+    const size_t fullSize = 10000 * 3 * sizeof(double);
+    planeFitting->setQuantizedStorage(16);
+    EXPECT_LT(planeFitting->getQuantizedMemorySize(), fullSize / 4 + fullSize / 50);
+    planeFitting->setQuantizedStorage(32);
+    EXPECT_LT(planeFitting->getQuantizedMemorySize(), fullSize / 2 + fullSize / 50);
+
+    // new data is quantized again
+    planeFitting = scene::makeReferencePlane(10000, 0.01, 0.3, 0.0);
+    planeFitting->setQuantizedStorage(16);
+    std::vector<double> x(100, 1.0), y(100, 2.0), z(100, 3.0);
+    planeFitting->setData(x, y, z);
+    EXPECT_LT(planeFitting->getQuantizedMemorySize(), 100 * 3 * sizeof(int16_t) + 100);
+
+    planeFitting->setQuantizedStorage(0);
+    EXPECT_EQ(0u, planeFitting->getQuantizedMemorySize());
+}
+
+TEST(QuantizedStorage, sameConsensusAsFullPrecision)
+{
+    // noisy inliers: many errors close to the threshold. The 34220 minimal samples
+    // are enumerated, so both solves score the same hypotheses in the same order.
+    auto planeFitting = scene::makeReferencePlane(60, 0.02, 0.3, 0.0);
+    const double thres = 0.02;
+
+    robest::RANSAC exact, quantized;
+    for (robest::RANSAC * solver : {&exact, &quantized})
+    {
+        solver->setUniqueSamples(true);
+        solver->setBatchSize(8, 20);
+    }
+
+    exact.solve(planeFitting, thres * thres, 40000);
+    std::vector<double> exactParams;
+    planeFitting->getModelParams(exactParams);
+    EXPECT_EQ(0, exact.getStats().nbReverified);
+
+    planeFitting->setQuantizedStorage(16, 16);
+    quantized.solve(planeFitting, thres * thres, 40000);
+    std::vector<double> params;
+    planeFitting->getModelParams(params);
+
+    EXPECT_GT(quantized.getStats().nbReverified, 0);
+    EXPECT_LT(quantized.getStats().nbReverified, quantized.getStats().nbResiduals / 10);
+    EXPECT_EQ(exact.getInliersMask(), quantized.getInliersMask());
+    for (int k = 0; k < 4; ++k)
+        EXPECT_DOUBLE_EQ(exactParams[k], params[k]);
+}
+
+TEST(QuantizedStorage, releasedPoints)
+{
+    const scene::Scene plane = scene::referencePlane(10000, 0.01, 0.3, 0.0);
+    auto planeFitting = scene::makePlaneFitting(plane);
+    const size_t fullSize = planeFitting->getMemorySize();
+    EXPECT_GE(fullSize, 10000 * 3 * sizeof(double));
+
+    planeFitting->setQuantizedStorage(16, 1024, sourceFrom(plane));
+    EXPECT_EQ(planeFitting->getQuantizedMemorySize(), planeFitting->getMemorySize());
+    EXPECT_LT(3 * planeFitting->getMemorySize(), fullSize);
+    EXPECT_EQ(10000, planeFitting->getTotalNbSamples());
+
+    // the exact errors are read from the source
+    const std::vector<double> model = {0.12, -0.19, -1.0, 0.9};
+    std::vector<double> errors(10000);
+    ASSERT_TRUE(planeFitting->estimErrorsForModel(model, 0, 10000, errors.data()));
+    const double invNorm = 1.0 / std::sqrt(0.12 * 0.12 + 0.19 * 0.19 + 1.0);
+    for (int i = 0; i < 10000; i += 997)
+        EXPECT_DOUBLE_EQ(std::fabs(0.12 * plane.x[i] - 0.19 * plane.y[i] - plane.z[i] + 0.9) * invNorm, errors[i]);
+
+    // reconfiguring stores the full precision points again
+    planeFitting->setQuantizedStorage(0);
+    EXPECT_GE(planeFitting->getMemorySize(), 10000 * 3 * sizeof(double));
+    std::vector<double> restored(10000);
+    ASSERT_TRUE(planeFitting->estimErrorsForModel(model, 0, 10000, restored.data()));
+    EXPECT_EQ(errors, restored);
+}
+
+TEST(QuantizedStorage, sameConsensusFromSource)
+{
+    const scene::Scene plane = scene::referencePlane(60, 0.02, 0.3, 0.0);
+    auto planeFitting = scene::makePlaneFitting(plane);
+    const double thres = 0.02;
+
+    robest::RANSAC exact, quantized;
+    for (robest::RANSAC * solver : {&exact, &quantized})
+    {
+        solver->setUniqueSamples(true);
+        solver->setBatchSize(8, 20);
+    }
+
+    exact.solve(planeFitting, thres * thres, 40000);
+    std::vector<double> exactParams;
+    planeFitting->getModelParams(exactParams);
+
+    planeFitting->setQuantizedStorage(16, 16, sourceFrom(plane));
+    quantized.solve(planeFitting, thres * thres, 40000);
+    std::vector<double> params;
+    planeFitting->getModelParams(params);
+
+    EXPECT_GT(quantized.getStats().nbReverified, 0);
+    EXPECT_EQ(exact.getInliersMask(), quantized.getInliersMask());
+    for (int k = 0; k < 4; ++k)
+        EXPECT_DOUBLE_EQ(exactParams[k], params[k]);
+}
+
+TEST(QuantizedStorage, batchedMSAC)
+{
+    auto planeFitting = scene::makeReferencePlane(20000, 0.01, 0.3, 0.0);
+    planeFitting->setQuantizedStorage(16, 512);
+
+    robest::MSAC solver;
+    solver.setBatchSize(8, 1000);
+    solver.solve(planeFitting, 0.03, 40);
+    EXPECT_GT(solver.getStats().nbReverified, 0);
+
+    // best minimal sample, without refit on the noisy inliers
+    double a, b, c, d;
+    planeFitting->getResult(a, b, c, d);
+    EXPECT_NEAR(-0.1, a / c, 1.0e-2);
+    EXPECT_NEAR( 0.2, b / c, 1.0e-2);
+    EXPECT_NEAR(-1.0, d / c, 5.0e-2);
+}
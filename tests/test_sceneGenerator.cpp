@@ -0,0 +1,172 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <limits>
+
+#include "SceneGenerator/SceneGenerator.hpp"
+
+namespace {
+
+const scene::SceneKind allKinds[] = {scene::SceneKind::Lines, scene::SceneKind::Circles, scene::SceneKind::Planes, scene::SceneKind::Spheres};
+
+} // namespace
+
+TEST(SceneGenerator, structureShares)
+{
+    scene::SceneOptions options;
+    options.nbPoints = 10000;
+    options.nbStructures = 3;
+    options.outliersRatio = 0.3;
+    scene::Scene planes = scene::generateScene(scene::SceneKind::Planes, options);
+
+    ASSERT_EQ(10000, planes.size());
+    EXPECT_EQ(3, planes.dimension());
+    EXPECT_EQ(10000u, planes.z.size());
+    EXPECT_EQ(10000u, planes.labels.size());
+    ASSERT_EQ(3u, planes.models.size());
+    EXPECT_EQ(3000, planes.count(-1));
+
+    // 1, 1/2, 1/3 of the inliers, up to a normalization
+    EXPECT_EQ(7000, planes.count(0) + planes.count(1) + planes.count(2));
+    EXPECT_NEAR(7000 * 6 / 11, planes.count(0), 2);
+    EXPECT_EQ(7000 * 3 / 11, planes.count(1));
+    EXPECT_EQ(7000 * 2 / 11, planes.count(2));
+
+    scene::Scene lines = scene::generateScene(scene::SceneKind::Lines, options);
+    EXPECT_EQ(2, lines.dimension());
+    EXPECT_TRUE(lines.z.empty());
+    EXPECT_EQ(2u, lines.models[0].size());
+}
+
+TEST(SceneGenerator, reproducible)
+{
+    scene::SceneOptions options;
+    options.nbPoints = 500;
+    scene::Scene first = scene::generateScene(scene::SceneKind::Spheres, options);
+    scene::Scene second = scene::generateScene(scene::SceneKind::Spheres, options);
+    EXPECT_EQ(first.x, second.x);
+    EXPECT_EQ(first.z, second.z);
+    EXPECT_EQ(first.labels, second.labels);
+
+    options.seed = 43;
+    scene::Scene other = scene::generateScene(scene::SceneKind::Spheres, options);
+    EXPECT_NE(first.x, other.x);
+}
+
+// The first points are the outliers, the others lie on z = 0.1*x - 0.2*y + 1
+TEST(SceneGenerator, referencePlane)
+{
+    scene::Scene plane = scene::referencePlane(1000);
+    ASSERT_EQ(1000, plane.size());
+    EXPECT_EQ(300, plane.count(-1));
+    EXPECT_EQ(700, plane.count(0));
+    ASSERT_EQ(1u, plane.models.size());
+    const std::vector<double> & model = plane.models[0];
+    EXPECT_NEAR(1.0, model[0] * model[0] + model[1] * model[1] + model[2] * model[2], 1.0e-12);
+
+    for (int i = 0; i < plane.size(); ++i)
+    {
+        const double distance = model[0] * plane.x[i] + model[1] * plane.y[i] + model[2] * plane.z[i] + model[3];
+        if (i < 300)
+        {
+            EXPECT_EQ(-1, plane.labels[i]);
+            EXPECT_GT(std::fabs(distance), 1.0);
+        }
+        else
+            EXPECT_NEAR(0.0, distance, 1.0e-12);
+    }
+}
+
+// The inliers lie on their structure within the noise, scored by the problems
+TEST(SceneGenerator, groundTruth)
+{
+    scene::SceneOptions options;
+    options.nbPoints = 5000;
+    options.nbStructures = 2;
+    options.noiseSigma = 0.01;
+    options.clustering = 0.3;
+    options.degeneracy = 0.1;
+
+    for (scene::SceneKind kind : allKinds)
+    {
+        scene::Scene scene = scene::generateScene(kind, options);
+        std::shared_ptr<robest::EstimationProblem> problem = scene::makeProblem(scene);
+        ASSERT_EQ(scene.size(), problem->getTotalNbSamples());
+
+        for (int s = 0; s < 2; ++s)
+        {
+            ASSERT_TRUE(problem->setModelParams(scene.models[s]));
+            double maxError = 0.0;
+            for (int i = 0; i < scene.size(); ++i)
+                if (scene.labels[i] == s)
+                    maxError = std::max(maxError, problem->estimErrorForSample(i));
+            EXPECT_LT(maxError, 10 * options.noiseSigma) << scene::sceneKindName(kind) << " structure " << s;
+
+            std::vector<double> model;
+            ASSERT_TRUE(problem->getModelParams(model));
+            EXPECT_NEAR(0.0, scene::modelError(kind, model, scene.models[s]), 1e-12);
+        }
+    }
+}
+
+// Without noise, any minimal sample of the degenerate subset of a plane is collinear
+TEST(SceneGenerator, degenerateSubset)
+{
+    scene::SceneOptions options;
+    options.nbPoints = 1000;
+    options.noiseSigma = 0.0;
+    options.outliersRatio = 0.0;
+    options.degeneracy = 1.0;
+    scene::Scene scene = scene::generateScene(scene::SceneKind::Planes, options);
+    std::shared_ptr<robest::EstimationProblem> problem = scene::makeProblem(scene);
+
+    for (int i = 0; i + 2 < 300; i += 3)
+        EXPECT_TRUE(problem->isDegenerate({i, i + 1, i + 2}));
+
+    options.degeneracy = 0.0;
+    scene = scene::generateScene(scene::SceneKind::Planes, options);
+    problem = scene::makeProblem(scene);
+    EXPECT_FALSE(problem->isDegenerate({0, 1, 2}));
+}
+
+TEST(SceneGenerator, modelError)
+{
+    const std::vector<double> plane = {0.0, 0.6, 0.8, -2.0};
+    EXPECT_NEAR(0.0, scene::modelError(scene::SceneKind::Planes, {0.0, -1.2, -1.6, 4.0}, plane), 1e-12);
+    EXPECT_NEAR(0.5, scene::modelError(scene::SceneKind::Planes, {0.0, 0.6, 0.8, -1.5}, plane), 1e-12);
+    EXPECT_NEAR(0.3, scene::modelError(scene::SceneKind::Circles, {1.0, 2.1, 2.8}, {1.0, 2.0, 3.0}), 1e-12);
+    EXPECT_EQ(std::numeric_limits<double>::infinity(), scene::modelError(scene::SceneKind::Lines, {}, {0.5, 2.0}));
+
+    EXPECT_EQ(2, scene::nbMinSamples(scene::SceneKind::Lines));
+    EXPECT_EQ(4, scene::nbMinSamples(scene::SceneKind::Spheres));
+
+    scene::SceneKind kind;
+    EXPECT_TRUE(scene::parseSceneKind("spheres", kind));
+    EXPECT_EQ(scene::SceneKind::Spheres, kind);
+    EXPECT_FALSE(scene::parseSceneKind("cubes", kind));
+}
+
+// The dominant structure is the one found among several, clusters and degenerate
+// subsets included
+TEST(SceneGenerator, dominantStructureFound)
+{
+    scene::SceneOptions options;
+    options.nbPoints = 5000;
+    options.nbStructures = 4;
+    options.clustering = 0.2;
+    options.degeneracy = 0.05;
+    scene::Scene scene = scene::generateScene(scene::SceneKind::Planes, options);
+    std::shared_ptr<robest::EstimationProblem> problem = scene::makeProblem(scene);
+
+    robest::MSAC solver;
+    solver.solve(problem, 3 * options.noiseSigma, 500);
+
+    std::vector<double> model;
+    ASSERT_TRUE(problem->getModelParams(model));
+    EXPECT_LT(scene::modelError(scene.kind, model, scene.models[0]), 0.05);
+    int nbTrue = 0;
+    for (int i : solver.getInliersIndices())
+        nbTrue += scene.labels[i] == 0;
+    EXPECT_GT(nbTrue, 0.9 * scene.count(0));
+    EXPECT_GT(nbTrue, 0.9 * solver.getInliersIndices().size());
+}
@@ -0,0 +1,192 @@
+#include "gtest/gtest.h"
+
+#include <random>
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+// Shard s of nbShards holds the samples [begin, end) of the problem
+void shardRange(int shard, int nbShards, int nbSamples, int & begin, int & end)
+{
+    begin = (int)((long long) nbSamples * shard / nbShards);
+    end = (int)((long long) nbSamples * (shard + 1) / nbShards);
+}
+
+// Workers forked from the test process: they share the problem and the estimator
+template<typename Estimator>
+std::shared_ptr<robest::LocalProcessTransport> makeShards(int nbShards, std::shared_ptr<PlaneFittingProblem> problem,
+                                                          const Estimator & estimator)
+{
+    const Estimator * scorer = &estimator;
+    return std::make_shared<robest::LocalProcessTransport>(nbShards, [=](int shard, robest::ShardEndpoint & endpoint) {
+        int begin, end;
+        shardRange(shard, nbShards, problem->getTotalNbSamples(), begin, end);
+        robest::serveShard(endpoint, *problem, begin, end, *scorer, 1000);
+    });
+}
+
+// Workers exiting at once, as after a crash
+std::shared_ptr<robest::LocalProcessTransport> makeLostShards(int nbShards)
+{
+    return std::make_shared<robest::LocalProcessTransport>(nbShards, [](int, robest::ShardEndpoint &) {});
+}
+
+} // namespace
+
+TEST(ErrorSketch, quantiles)
+{
+    std::default_random_engine generator(3);
+    std::exponential_distribution<double> exponential(10.0);
+
+    std::vector<double> values(10001);
+    robest::ErrorSketch first, second;
+    for (int i = 0; i < (int) values.size(); ++i)
+    {
+        values[i] = exponential(generator);
+        (i % 2 ? first : second).add(values[i]);
+    }
+    first.merge(second.data());
+    EXPECT_DOUBLE_EQ(10001.0, first.count());
+
+    std::sort(values.begin(), values.end());
+    for (double q : {0.1, 0.5, 0.9})
+    {
+        double exact = values[(int)(q * 10000)];
+        EXPECT_NEAR(exact, first.quantile(q), 0.07 * exact);
+    }
+
+    // zeros and values out of the range are counted in the first and the last bins
+    robest::ErrorSketch extremes;
+    extremes.add(0.0);
+    extremes.add(1.0e300);
+    EXPECT_EQ(0.0, robest::ErrorSketch().quantile(0.5));
+    EXPECT_LT(extremes.quantile(0.25), 1.0e-14);
+    EXPECT_GT(extremes.quantile(1.0), 1.0e14);
+}
+
+TEST(LocalProcessTransport, roundTrip)
+{
+    // every worker replies with the request times its shard number plus one
+    robest::LocalProcessTransport transport(3, [](int shard, robest::ShardEndpoint & endpoint) {
+        std::vector<double> message;
+        while (endpoint.receive(message))
+        {
+            for (double & v : message)
+                v *= shard + 1;
+            endpoint.reply(message);
+        }
+    }, 64);
+    ASSERT_EQ(3, transport.nbShards());
+
+    std::vector<double> reply;
+    for (int round = 0; round < 5; ++round)
+    {
+        std::vector<double> request(round + 1, 2.0);
+        EXPECT_TRUE(transport.broadcast(request));
+        for (int shard = 2; shard >= 0; --shard)
+        {
+            ASSERT_TRUE(transport.receive(shard, reply));
+            EXPECT_EQ(std::vector<double>(round + 1, 2.0 * (shard + 1)), reply);
+        }
+    }
+
+    EXPECT_TRUE(transport.broadcast(std::vector<double>()));
+    ASSERT_TRUE(transport.receive(0, reply));
+    EXPECT_TRUE(reply.empty());
+}
+
+TEST(LocalProcessTransport, workerExited)
+{
+    auto transport = makeLostShards(2);
+    ASSERT_EQ(2, transport->nbShards());
+
+    std::vector<double> reply;
+    transport->broadcast(std::vector<double>(3, 1.0));
+    EXPECT_FALSE(transport->receive(0, reply));
+    EXPECT_FALSE(transport->receive(1, reply));
+}
+
+TEST(ShardedScoring, sameResultAsLocal)
+{
+    // 34220 enumerated minimal samples: both solves score the same hypotheses in the
+    // same order, integer inlier counts do not depend on the order of the sums
+    auto planeFitting = scene::makeReferencePlane(60, 0.01, 0.3, 0.0);
+
+    robest::RANSAC local, sharded;
+    for (robest::RANSAC * solver : {&local, &sharded})
+    {
+        solver->setUniqueSamples(true);
+        solver->setBatchSize(64);
+    }
+    sharded.setShards(makeShards(3, planeFitting, sharded));
+
+    local.solve(planeFitting, 0.02 * 0.02, 40000);
+    std::vector<double> localParams;
+    planeFitting->getModelParams(localParams);
+
+    sharded.solve(planeFitting, 0.02 * 0.02, 40000);
+    std::vector<double> params;
+    planeFitting->getModelParams(params);
+
+    EXPECT_EQ(local.getInliersMask(), sharded.getInliersMask());
+    for (int k = 0; k < 4; ++k)
+        EXPECT_DOUBLE_EQ(localParams[k], params[k]);
+}
+
+TEST(ShardedScoring, msac)
+{
+    auto planeFitting = scene::makeReferencePlane(20000, 0.001, 0.3, 0.0);
+
+    robest::MSAC solver;
+    solver.setBatchSize(16);
+    solver.setShards(makeShards(4, planeFitting, solver));
+    solver.solve(planeFitting, 0.01, 64);
+
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+    EXPECT_EQ(64, solver.getStats().nbIterations);
+
+    // shards released: scored locally again
+    solver.setShards(nullptr);
+    solver.solve(planeFitting, 0.01, 64);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+}
+
+TEST(ShardedScoring, lmedsSketch)
+{
+    auto planeFitting = scene::makeReferencePlane(20000, 0.001, 0.3, 0.0);
+
+    robest::LMedS solver;
+    solver.setShards(makeShards(2, planeFitting, solver));
+    solver.solve(planeFitting, 0.01, 64);
+
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+    EXPECT_NEAR(0.7, solver.getInliersFraction(), 0.01);
+}
+
+TEST(ShardedScoring, lostShardsScoredLocally)
+{
+    auto planeFitting = scene::makeReferencePlane(20000, 0.001, 0.3, 0.0);
+
+    robest::MSAC solver;
+    solver.setBatchSize(16);
+    solver.setShards(makeLostShards(2));
+    robest::SolveStatus status = solver.solve(planeFitting, 0.01, 64, robest::SolveControl::unbounded());
+
+    EXPECT_TRUE(status.shardsLost);
+    EXPECT_EQ(64, status.nbIterations);
+    scene::expectReferencePlane(planeFitting, 1.0e-2, 5.0e-2);
+}
+
+TEST(ShardedScoring, lostShardsStopSketches)
+{
+    // LMedS is not scored by tile, this process cannot take over
+    auto planeFitting = scene::makeReferencePlane(2000, 0.001, 0.3, 0.0);
+
+    robest::LMedS solver;
+    solver.setShards(makeLostShards(2));
+    robest::SolveStatus status = solver.solve(planeFitting, 0.01, 64, robest::SolveControl::unbounded());
+
+    EXPECT_TRUE(status.shardsLost);
+    EXPECT_EQ(0, status.nbIterations);
+}
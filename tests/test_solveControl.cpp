@@ -0,0 +1,96 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "SceneGenerator/ReferenceLine.hpp"
+
+TEST(SolveControl, deadline)
+{
+    auto lineFitting = scene::makeReferenceLine(100000, 0.0, 0.5);
+
+    const double timeout = 0.05;
+    robest::SolveControl control = robest::SolveControl::timeout(timeout);
+    control.adaptiveTermination = false;
+
+    auto start = std::chrono::steady_clock::now();
+    robest::MSAC solver;
+    robest::SolveStatus status = solver.solve(lineFitting, 0.1, 50000, control);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_TRUE(status.deadlineReached);
+    EXPECT_LT(status.nbIterations, 50000);
+    EXPECT_GT(status.nbIterations, 0);
+    // stopped near the deadline, far before the 50000 iterations (a generous bound,
+    // the test machine may be loaded)
+    EXPECT_LT(elapsed, 20 * timeout);
+
+    // best model found so far
+    double res_k, res_b;
+    lineFitting->getResult(res_k, res_b);
+    EXPECT_NEAR(0.5, res_k, 1.0e-6);
+    EXPECT_NEAR(2.0, res_b, 1.0e-4);
+}
+
+TEST(SolveControl, cancelledBeforeStart)
+{
+    auto lineFitting = scene::makeReferenceLine(100, 0.0, 0.2);
+
+    robest::SolveControl control;
+    control.cancelToken.cancel();
+
+    robest::RANSAC solver;
+    robest::SolveStatus status = solver.solve(lineFitting, 0.1, 1000, control);
+
+    EXPECT_TRUE(status.cancelled);
+    EXPECT_FALSE(status.confidenceReached);
+    EXPECT_EQ(0, status.nbIterations);
+    EXPECT_TRUE(solver.getInliersIndices().empty());
+}
+
+TEST(SolveControl, cancelledFromAnotherThread)
+{
+    auto lineFitting = scene::makeReferenceLine(20000, 0.0, 0.5);
+
+    // the first progress report waits for the cancellation: the solve is then
+    // cancelled from the other thread while it runs, whatever the machine load
+    std::atomic<bool> started{false}, cancelled{false};
+    robest::SolveControl control;
+    control.adaptiveTermination = false;
+    control.progressInterval = 0.0;
+    control.progress = [&started, &cancelled](const robest::SolveProgress &) {
+        started.store(true);
+        while (!cancelled.load())
+            std::this_thread::yield();
+    };
+
+    std::thread canceller([control, &started, &cancelled]() {
+        while (!started.load())
+            std::this_thread::yield();
+        control.cancelToken.cancel();
+        cancelled.store(true);
+    });
+
+    robest::LMedS solver;
+    robest::SolveStatus status = solver.solve(lineFitting, 0.1, 50000, control);
+    canceller.join();
+
+    EXPECT_TRUE(status.cancelled);
+    EXPECT_LT(status.nbIterations, 50000);
+    EXPECT_GT(solver.getInliersFraction(), 0.4);
+}
+
+TEST(SolveControl, adaptiveTermination)
+{
+    auto lineFitting = scene::makeReferenceLine(1000, 0.0, 0.1);
+
+    robest::RANSAC solver;
+    robest::SolveStatus status = solver.solve(lineFitting, 0.1, 50000, robest::SolveControl());
+
+    EXPECT_TRUE(status.confidenceReached);
+    EXPECT_FALSE(status.deadlineReached);
+    EXPECT_FALSE(status.cancelled);
+    // 99% confidence with 90% of inliers needs a handful of iterations
+    EXPECT_LT(status.nbIterations, 100);
+}
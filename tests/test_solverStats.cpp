@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+
+#include <numeric>
+
+#include "SceneGenerator/ReferenceLine.hpp"
+#include "SphereFitting/SphereFitting.hpp"
+
+template<typename Estimator>
+static void checkStatsConsistency()
+{
+    auto lineFitting = scene::makeReferenceLine(11);
+    const int nbIter = 200;
+    const long long nbPts = lineFitting->getTotalNbSamples();
+
+    Estimator solver;
+    solver.solve(lineFitting, 0.1, nbIter);
+
+    const robest::SolverStats & stats = solver.getStats();
+#ifndef ROBEST_DISABLE_STATS
+    EXPECT_EQ(nbIter, stats.nbIterations);
+    EXPECT_EQ(stats.nbIterations, stats.nbHypotheses + stats.nbDegenerate);
+    // every hypothesis is scored against all points, plus one inliers extraction pass
+    EXPECT_EQ(stats.nbHypotheses * nbPts + nbPts, stats.nbResiduals);
+    EXPECT_GE(stats.lastImprovementIter, 0);
+    EXPECT_LT(stats.lastImprovementIter, nbIter);
+
+    long long perThread = std::accumulate(stats.hypothesesPerThread.begin(), stats.hypothesesPerThread.end(), 0LL);
+    EXPECT_EQ(stats.nbHypotheses, perThread);
+
+    EXPECT_GE(stats.samplingTime, 0.0);
+    EXPECT_GE(stats.modelTime, 0.0);
+    EXPECT_GE(stats.scoringTime, 0.0);
+    EXPECT_GE(stats.totalTime, stats.finalTime);
+#else
+    EXPECT_EQ(0, stats.nbIterations);
+#endif
+}
+
+TEST(SolverStats, RANSAC)
+{
+    checkStatsConsistency<robest::RANSAC>();
+}
+
+TEST(SolverStats, MSAC)
+{
+    checkStatsConsistency<robest::MSAC>();
+}
+
+TEST(SolverStats, LMedS)
+{
+    checkStatsConsistency<robest::LMedS>();
+}
+
+TEST(SolverStats, resetBetweenSolves)
+{
+    auto lineFitting = scene::makeReferenceLine(11);
+
+    robest::RANSAC solver;
+    solver.solve(lineFitting, 0.1, 300);
+    solver.solve(lineFitting, 0.1, 100);
+
+#ifndef ROBEST_DISABLE_STATS
+    EXPECT_EQ(100, solver.getStats().nbIterations);
+#endif
+}
+
+TEST(SolverStats, degenerateSamplesAreNotScored)
+{
+    // the first four points are coplanar: one sample out of five is degenerate
+    std::vector<double> x = {0,  1,  0, -1,  0};
+    std::vector<double> y = {1,  0, -1,  0,  0};
+    std::vector<double> z = {0,  0,  0,  0,  1};
+
+    auto sphereFitting = std::make_shared<SphereFittingProblem>();
+    sphereFitting->setData(x, y, z);
+
+    robest::MSAC solver;
+    solver.solve(sphereFitting, 0.1, 200);
+
+#ifndef ROBEST_DISABLE_STATS
+    const robest::SolverStats & stats = solver.getStats();
+    EXPECT_GT(stats.nbDegenerate, 0);
+    EXPECT_EQ(stats.nbIterations, stats.nbHypotheses + stats.nbDegenerate);
+#endif
+}
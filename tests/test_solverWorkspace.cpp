@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <set>
+
+#include <omp.h>
+
+#include "SceneGenerator/ReferenceLine.hpp"
+
+// Global allocations are counted while countAllocations is set. The operators are
+// replaced for the whole program: this file is an executable of its own
+// (workspace_tests), so that the other tests are not affected.
+// The replacement operators pair malloc and free, whatever GCC assumes.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+std::atomic<bool> countAllocations(false);
+std::atomic<long long> nbAllocations(0);
+}
+
+void * operator new(std::size_t size)
+{
+    if (countAllocations.load())
+        nbAllocations++;
+    void * p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void * operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+// Allocations of one solve once the estimator has been warmed up
+template<typename Estimator>
+long long allocationsAfterWarmUp(Estimator & solver, std::shared_ptr<LineFittingProblem> problem)
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        solver.solve(problem, 0.1, 50);
+        solver.getInliersIndices();
+    }
+
+    nbAllocations = 0;
+    countAllocations = true;
+    solver.solve(problem, 0.1, 50);
+    solver.getInliersIndices();
+    countAllocations = false;
+    return nbAllocations.load();
+}
+
+} // namespace
+
+TEST(SolverWorkspace, noAllocationAfterWarmUp)
+{
+    auto problem = scene::makeReferenceLine(2000, 0.0, 0.2, 200.0);
+
+    robest::RANSAC ransac;
+    EXPECT_EQ(0, allocationsAfterWarmUp(ransac, problem));
+    EXPECT_EQ(1600u, ransac.getInliersIndices().size());
+
+    robest::MSAC msac;
+    EXPECT_EQ(0, allocationsAfterWarmUp(msac, problem));
+    EXPECT_EQ(1600u, msac.getInliersIndices().size());
+
+    robest::LMedS lmeds;
+    EXPECT_EQ(0, allocationsAfterWarmUp(lmeds, problem));
+    EXPECT_EQ(1600u, lmeds.getInliersIndices().size());
+
+    robest::ThresholdSweep sweep(0.01, 1.0, 10);
+    EXPECT_EQ(0, allocationsAfterWarmUp(sweep, problem));
+}
+
+TEST(SolverWorkspace, sharedBetweenEstimators)
+{
+    auto problem = scene::makeReferenceLine(2000, 0.0, 0.2, 200.0);
+    auto workspace = std::make_shared<robest::SolverWorkspace>();
+
+    robest::RANSAC ransac;
+    robest::MSAC msac;
+    ransac.setWorkspace(workspace);
+    msac.setWorkspace(workspace);
+    EXPECT_EQ(workspace, msac.getWorkspace());
+
+    allocationsAfterWarmUp(ransac, problem);
+    EXPECT_EQ(0, allocationsAfterWarmUp(msac, problem));
+    EXPECT_EQ(0, allocationsAfterWarmUp(ransac, problem));
+}
+
+TEST(SolverWorkspace, growsOnlyWithTheProblem)
+{
+    auto small = scene::makeReferenceLine(500, 0.0, 0.2, 200.0);
+    auto large = scene::makeReferenceLine(4000, 0.0, 0.2, 200.0);
+
+    robest::MSAC solver;
+    allocationsAfterWarmUp(solver, large);
+
+    // a smaller problem fits in the buffers of the larger one, without warm-up
+    nbAllocations = 0;
+    countAllocations = true;
+    solver.solve(small, 0.1, 50);
+    solver.getInliersIndices();
+    countAllocations = false;
+    EXPECT_EQ(0, nbAllocations.load());
+    EXPECT_EQ(400u, solver.getInliersIndices().size());
+}
+
+// Out of solve(), each thread draws from a shuffle state of its own
+TEST(SolverWorkspace, randomSampleIdxFromThreads)
+{
+    auto problem = scene::makeReferenceLine(2000, 0.0, 0.2, 200.0);
+    robest::RANSAC solver;
+    solver.solve(problem, 0.1, 10);
+
+    int nbWrong = 0;
+    #pragma omp parallel for num_threads(4) reduction(+:nbWrong)
+    for (int i = 0; i < 4000; ++i)
+    {
+        std::vector<int> sample = solver.randomSampleIdx();
+        std::set<int> distinct(sample.begin(), sample.end());
+        nbWrong += distinct.size() != 2 || *distinct.begin() < 0 || *distinct.rbegin() >= 2000;
+    }
+    EXPECT_EQ(0, nbWrong);
+}
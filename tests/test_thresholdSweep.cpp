@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+
+#include <numeric>
+
+#include "SceneGenerator/ReferenceLine.hpp"
+
+TEST(ThresholdSweep, logSpacedThresholds)
+{
+    robest::ThresholdSweep sweep(0.01, 10.0, 4);
+    const std::vector<robest::ThresholdScore> & scores = sweep.getSweep();
+
+    ASSERT_EQ(4u, scores.size());
+    EXPECT_NEAR(0.01, scores[0].thres, 1.0e-12);
+    EXPECT_NEAR(0.1,  scores[1].thres, 1.0e-12);
+    EXPECT_NEAR(1.0,  scores[2].thres, 1.0e-12);
+    EXPECT_NEAR(10.0, scores[3].thres, 1.0e-12);
+}
+
+TEST(ThresholdSweep, matchesPerThresholdScoring)
+{
+    auto lineFitting = scene::makeReferenceLine(400, 0.05);
+
+    robest::ThresholdSweep sweep(0.01, 5.0, 20);
+    sweep.solve(lineFitting, 0.2, 200);
+
+    for (const robest::ThresholdScore & score : sweep.getSweep())
+    {
+        ASSERT_EQ(2u, score.model.size());
+        ASSERT_EQ(21u, score.histogram.size());
+        EXPECT_EQ(400, std::accumulate(score.histogram.begin(), score.histogram.end(), 0LL));
+
+        // rescoring the recorded model at this threshold gives the same count and cost
+        lineFitting->setModelParams(score.model);
+        int nbInliers = 0;
+        double cost = 0.0;
+        for (int j = 0; j < lineFitting->getTotalNbSamples(); ++j)
+        {
+            double error = lineFitting->estimErrorForSample(j);
+            bool inlier = error * error < score.thres * score.thres;
+            nbInliers += inlier;
+            cost += inlier ? error * error : score.thres * score.thres;
+        }
+        EXPECT_EQ(nbInliers, score.nbInliers);
+        EXPECT_NEAR(cost, score.cost, 1.0e-9 * cost);
+    }
+}
+
+TEST(ThresholdSweep, inliersGrowWithThreshold)
+{
+    auto lineFitting = scene::makeReferenceLine(400, 0.05);
+
+    robest::ThresholdSweep sweep(0.01, 5.0, 20, robest::ThresholdSweep::MaximizeInliers);
+    sweep.solve(lineFitting, 0.2, 200);
+
+    // the best count of a threshold is also an inlier count for the next one
+    const std::vector<robest::ThresholdScore> & scores = sweep.getSweep();
+    for (size_t k = 1; k < scores.size(); ++k)
+        EXPECT_GE(scores[k].nbInliers, scores[k - 1].nbInliers);
+
+    // thresholds above the noise level catch the 280 inliers, few outliers come along
+    EXPECT_GE(scores.back().nbInliers, 280);
+    EXPECT_LT(scores.front().nbInliers, 280);
+}
+
+TEST(ThresholdSweep, keepsModelOfSolveThreshold)
+{
+    auto lineFitting = scene::makeReferenceLine(400, 0.05);
+
+    robest::ThresholdSweep sweep;
+    sweep.solve(lineFitting, 0.2, 200);
+
+    double res_k, res_b;
+    lineFitting->getResult(res_k, res_b);
+    EXPECT_NEAR(0.5, res_k, 1.0e-2);
+    EXPECT_NEAR(2.0, res_b, 0.5);
+    EXPECT_NEAR(0.7, sweep.getInliersFraction(), 0.05);
+}
@@ -0,0 +1,183 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include <omp.h>
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+int countSpans(const std::vector<robest::TraceEvent> & events, const std::string & name)
+{
+    return (int) std::count_if(events.begin(), events.end(),
+                               [&name](const robest::TraceEvent & event) { return name == event.name; });
+}
+
+int countOccurrences(const std::string & text, const std::string & pattern)
+{
+    int count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+        count++;
+    return count;
+}
+
+} // namespace
+
+TEST(Tracing, stoppedRecordsNothing)
+{
+    robest::Tracer & tracer = robest::Tracer::global();
+    tracer.stop();
+    tracer.clear();
+
+    robest::RANSAC solver;
+    solver.solve(scene::makeReferencePlane(500), 0.01, 50);
+    EXPECT_EQ(0u, solver.getTraceId());
+    EXPECT_TRUE(tracer.events().empty());
+}
+
+#ifndef ROBEST_DISABLE_TRACING
+
+// Every step of every iteration, within the solve, on each thread of the team
+TEST(Tracing, spansOfASolve)
+{
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(2);
+    robest::Tracer & tracer = robest::Tracer::global();
+    tracer.clear();
+    tracer.start();
+
+    auto planeFitting = scene::makeReferencePlane(500);
+    robest::RANSAC solver;
+    solver.solve(planeFitting, 0.01, 100);
+    tracer.stop();
+    omp_set_num_threads(previousNbThreads);
+    scene::expectReferencePlane(planeFitting);
+
+    const uint32_t id = solver.getTraceId();
+    ASSERT_NE(0u, id);
+    EXPECT_EQ(id, tracer.lastSolve());
+    const std::vector<robest::TraceEvent> events = tracer.events(id, id);
+
+    const robest::SolverStats & stats = solver.getStats();
+    const int nbModels = (int) (stats.nbIterations - stats.nbDegenerate);
+    ASSERT_EQ(1, countSpans(events, "solve"));
+    EXPECT_EQ(100, countSpans(events, "sample"));
+    EXPECT_EQ(nbModels, countSpans(events, "model"));
+    EXPECT_EQ(nbModels, countSpans(events, "score"));
+    EXPECT_EQ(nbModels, countSpans(events, "wait best"));
+    EXPECT_EQ(nbModels, countSpans(events, "update best"));
+    EXPECT_EQ(1, countSpans(events, "final"));
+    EXPECT_EQ(1, countSpans(events, "refit"));
+    EXPECT_EQ(2, countSpans(events, "iterations"));
+    EXPECT_EQ(2, countSpans(events, "inliers mask"));
+
+    // sorted by start, the solve first and enclosing the others
+    const robest::TraceEvent & solve = events.front();
+    EXPECT_STREQ("solve", solve.name);
+    std::set<int> threads;
+    for (const robest::TraceEvent & event : events)
+    {
+        EXPECT_LE(solve.begin, event.begin);
+        EXPECT_LE(event.begin, event.end);
+        EXPECT_LE(event.end, solve.end);
+        EXPECT_EQ(id, event.solve);
+        threads.insert(event.thread);
+    }
+    EXPECT_EQ(2u, threads.size());
+}
+
+// Batched scoring: hypotheses of a batch, then its tiles on the threads
+TEST(Tracing, batchedSpans)
+{
+    robest::Tracer & tracer = robest::Tracer::global();
+    tracer.clear();
+    tracer.start();
+
+    robest::MSAC solver;
+    solver.setBatchSize(8, 256);
+    solver.solve(scene::makeReferencePlane(2000), 0.01, 40);
+    tracer.stop();
+
+    const uint32_t id = solver.getTraceId();
+    const std::vector<robest::TraceEvent> events = tracer.events(id, id);
+    EXPECT_EQ(5, countSpans(events, "hypotheses"));
+    EXPECT_EQ(5, countSpans(events, "score batch"));
+    EXPECT_EQ(5, countSpans(events, "update best"));
+    EXPECT_EQ(5 * omp_get_max_threads(), countSpans(events, "tiles"));
+    EXPECT_EQ(0, countSpans(events, "score"));
+    EXPECT_EQ(1, countSpans(events, "iterations"));
+}
+
+// A window of solves, or one of them, as Chrome trace JSON
+TEST(Tracing, chromeTraceExport)
+{
+    robest::Tracer & tracer = robest::Tracer::global();
+    tracer.clear();
+    tracer.start();
+
+    auto planeFitting = scene::makeReferencePlane(500);
+    robest::MSAC msac;
+    robest::LMedS lmeds;
+    msac.solve(planeFitting, 0.01, 20);
+    lmeds.solve(planeFitting, 0.01, 20);
+    tracer.stop();
+
+    const uint32_t first = msac.getTraceId(), last = lmeds.getTraceId();
+    ASSERT_EQ(first + 1, last);
+
+    std::ostringstream window;
+    ASSERT_TRUE(tracer.writeChromeTrace(window, first, last));
+    const std::string json = window.str();
+    EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    EXPECT_EQ(json.size() - 3, json.rfind("]}\n"));
+    EXPECT_EQ((int) tracer.events(first, last).size(), countOccurrences(json, "\"ph\":\"X\""));
+    EXPECT_EQ(2, countOccurrences(json, "\"name\":\"solve\""));
+    EXPECT_GE(countOccurrences(json, "\"ph\":\"M\""), 1);
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"thread_name\""));
+    EXPECT_NE(std::string::npos, json.find("\"ts\":0.000,"));
+
+    std::ostringstream single;
+    ASSERT_TRUE(tracer.writeChromeTrace(single, last, last));
+    EXPECT_EQ(1, countOccurrences(single.str(), "\"name\":\"solve\""));
+    EXPECT_EQ(0, countOccurrences(single.str(), "\"solve\":" + std::to_string(first) + "}"));
+    EXPECT_EQ((int) tracer.events(last, last).size(), countOccurrences(single.str(), "\"ph\":\"X\""));
+}
+
+// Full buffers keep the last spans of each thread
+TEST(Tracing, ringBuffer)
+{
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    robest::Tracer & tracer = robest::Tracer::global();
+    tracer.clear();
+    tracer.start(10);
+
+    robest::RANSAC solver;
+    solver.solve(scene::makeReferencePlane(500), 0.01, 100);
+    tracer.stop();
+    tracer.start();
+    tracer.stop();
+
+    // the buffer was emptied when its size changed back
+    EXPECT_TRUE(tracer.events().empty());
+
+    tracer.start(10);
+    solver.solve(scene::makeReferencePlane(500), 0.01, 100);
+    tracer.stop();
+    const std::vector<robest::TraceEvent> events = tracer.events(solver.getTraceId(), solver.getTraceId());
+    EXPECT_EQ(16u, events.size());
+    EXPECT_EQ(1, countSpans(events, "solve"));
+    EXPECT_EQ(1, countSpans(events, "final"));
+    EXPECT_EQ(1, countSpans(events, "iterations"));
+    EXPECT_LT(countSpans(events, "sample"), 16);  // the first ones were overwritten
+
+    tracer.start();
+    tracer.stop();
+    omp_set_num_threads(previousNbThreads);
+}
+
+#endif // ROBEST_DISABLE_TRACING
@@ -0,0 +1,231 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+
+#include <omp.h>
+
+#include "SceneGenerator/ReferencePlane.hpp"
+
+namespace {
+
+// 200 ns per model, 5 ns per residual, 2 ns per batched residual, 5 us per batch
+robest::ProblemCosts planeCosts()
+{
+    robest::ProblemCosts costs;
+    costs.model = 200e-9;
+    costs.residual = 5e-9;
+    costs.batchResidual = 2e-9;
+    costs.batchOverhead = 5e-6;
+    return costs;
+}
+
+} // namespace
+
+// 5 us per parallel region, 8 threads
+TEST(Tuner, decide)
+{
+    robest::ParallelTuner tuner;
+    tuner.setRegionCost(5e-6);
+    const robest::ProblemCosts costs = planeCosts();
+
+    // a few iterations over a few samples: not worth a parallel region
+    robest::ParallelDecision tiny = tuner.decide(costs, 20, 10, 8, true, true, 16);
+    EXPECT_EQ(robest::ParallelStrategy::Serial, tiny.strategy);
+    EXPECT_EQ(1, tiny.nbThreads);
+    EXPECT_TRUE(tiny.tuned);
+    EXPECT_NEAR(10 * (200e-9 + 20 * 5e-9), tiny.predictedTime, 1e-12);
+
+    // many iterations over few samples: the threads share the iterations
+    robest::ParallelDecision many = tuner.decide(costs, 200, 5000, 8, true, true, 16);
+    EXPECT_EQ(robest::ParallelStrategy::Hypotheses, many.strategy);
+    EXPECT_EQ(8, many.nbThreads);
+    EXPECT_EQ(16, many.chunkSize);
+    EXPECT_EQ(robest::ParallelStrategy::Hypotheses, tuner.decide(costs, 200, 5000, 8, true, true, 1000).strategy);
+    EXPECT_EQ(156, tuner.decide(costs, 200, 5000, 8, true, true, 1000).chunkSize);
+
+    // few iterations over many samples: the threads share the data
+    robest::ParallelDecision large = tuner.decide(costs, 10000000, 20, 8, true, true, 16);
+    EXPECT_EQ(robest::ParallelStrategy::Data, large.strategy);
+    EXPECT_EQ(8, large.nbThreads);
+    EXPECT_EQ(4096, large.tileSize);
+    EXPECT_EQ(1, large.batchSize);
+
+    // smaller data: larger batches amortize their overhead, smaller tiles feed the threads
+    robest::ParallelDecision medium = tuner.decide(costs, 8000, 20, 8, false, true, 16);
+    EXPECT_EQ(robest::ParallelStrategy::Data, medium.strategy);
+    EXPECT_EQ(1000, medium.tileSize);
+    EXPECT_EQ(8, medium.nbThreads);
+    EXPECT_EQ(20, medium.batchSize);
+
+    // unsupported strategies are not considered
+    EXPECT_NE(robest::ParallelStrategy::Hypotheses, tuner.decide(costs, 200, 5000, 8, false, true, 16).strategy);
+    EXPECT_EQ(robest::ParallelStrategy::Hypotheses, tuner.decide(costs, 10000000, 20, 8, true, false, 16).strategy);
+    robest::ProblemCosts unbatched = costs;
+    unbatched.batchResidual = 0.0;
+    EXPECT_EQ(robest::ParallelStrategy::Serial, tuner.decide(unbatched, 10000000, 20, 8, false, true, 16).strategy);
+
+    // one thread: batches may still be cheaper, the iterations are never shared
+    EXPECT_NE(robest::ParallelStrategy::Hypotheses, tuner.decide(costs, 200, 5000, 1, true, true, 16).strategy);
+}
+
+TEST(Tuner, profile)
+{
+    const std::string path = "robest_tuner_profile.txt";
+    robest::ParallelTuner tuner;
+    tuner.setCosts("class PlaneFittingProblem", planeCosts());
+    robest::ProblemCosts other;
+    other.residual = 1e-8;
+    other.model = 3e-6;
+    tuner.setCosts("18HomographyProblem", other);
+    ASSERT_TRUE(tuner.save(path));
+
+    robest::ParallelTuner loaded;
+    ASSERT_TRUE(loaded.load(path));
+    robest::ProblemCosts costs;
+    ASSERT_TRUE(loaded.getCosts("class PlaneFittingProblem", costs));
+    EXPECT_DOUBLE_EQ(200e-9, costs.model);
+    EXPECT_DOUBLE_EQ(5e-9, costs.residual);
+    EXPECT_DOUBLE_EQ(2e-9, costs.batchResidual);
+    EXPECT_DOUBLE_EQ(5e-6, costs.batchOverhead);
+    ASSERT_TRUE(loaded.getCosts("18HomographyProblem", costs));
+    EXPECT_DOUBLE_EQ(0.0, costs.batchResidual);
+    EXPECT_FALSE(loaded.getCosts("PlaneFittingProblem", costs));
+
+    // malformed profiles are rejected as a whole
+    {
+        std::ofstream file(path);
+        file << "1e-9 1e-9 1e-6 1e-7 GoodProblem\n1e-9 oops\n";
+    }
+    robest::ParallelTuner malformed;
+    EXPECT_FALSE(malformed.load(path));
+    EXPECT_FALSE(malformed.getCosts("GoodProblem", costs));
+    EXPECT_FALSE(malformed.load("no_such_profile.txt"));
+    std::remove(path.c_str());
+}
+
+// The first solve of a type measures its costs, every solve records its strategy
+TEST(Tuner, autoTunedSolve)
+{
+    auto planeFitting = scene::makeReferencePlane(2000);
+    robest::ParallelTuner tuner;
+    robest::MSAC solver;
+    solver.setAutoTuning(true, tuner);
+
+    const int previousNbThreads = omp_get_max_threads();
+    solver.solve(planeFitting, 0.01, 100);
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(1400u, solver.getInliersIndices().size());
+    EXPECT_EQ(previousNbThreads, omp_get_max_threads());
+
+    robest::ProblemCosts costs;
+    ASSERT_TRUE(tuner.getCosts(planeFitting->costKey(), costs));
+    EXPECT_GT(costs.model, 0.0);
+    EXPECT_GT(costs.residual, 0.0);
+    EXPECT_GT(costs.batchResidual, 0.0);
+    EXPECT_GT(costs.batchOverhead, 0.0);
+
+    const robest::ParallelDecision & decision = solver.getStats().parallel;
+    EXPECT_TRUE(decision.tuned);
+    EXPECT_NE(robest::ParallelStrategy::Hypotheses, decision.strategy); // MSAC does not share its iterations
+    EXPECT_GT(decision.predictedTime, 0.0);
+
+    // costly regions and batches: serial, on one thread
+    costs.batchOverhead = 1.0;
+    tuner.setCosts(planeFitting->costKey(), costs);
+    tuner.setRegionCost(1.0);
+    solver.solve(planeFitting, 0.01, 100);
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(robest::ParallelStrategy::Serial, solver.getStats().parallel.strategy);
+    EXPECT_EQ(1, solver.getStats().parallel.nbThreads);
+    EXPECT_EQ(previousNbThreads, omp_get_max_threads());
+
+    // costly residuals, cheap batched ones: batches
+    costs.residual = 1e-6;
+    costs.batchResidual = 1e-9;
+    costs.batchOverhead = 1e-6;
+    tuner.setCosts(planeFitting->costKey(), costs);
+    tuner.setRegionCost(1e-6);
+    solver.solve(planeFitting, 0.01, 100);
+    scene::expectReferencePlane(planeFitting);
+    EXPECT_EQ(1400u, solver.getInliersIndices().size());
+    EXPECT_EQ(robest::ParallelStrategy::Data, solver.getStats().parallel.strategy);
+    EXPECT_EQ(100, solver.getStats().nbIterations);
+}
+
+// Views of a problem share the costs of the problem, the measurement keeps its model
+TEST(Tuner, costKeyOfViews)
+{
+    auto planeFitting = scene::makeReferencePlane(2000);
+    std::vector<int> indices(1000);
+    std::iota(indices.begin(), indices.end(), 1000);
+    auto subset = std::make_shared<robest::SubsetProblem>(planeFitting, indices);
+    EXPECT_EQ(planeFitting->costKey(), subset->costKey());
+
+    const std::vector<double> model = {0.0, 0.0, 1.0, 5.0};
+    ASSERT_TRUE(planeFitting->setModelParams(model));
+
+    // cancelled: the costs are measured, no hypothesis is tried
+    robest::ParallelTuner tuner;
+    robest::MSAC solver;
+    solver.setAutoTuning(true, tuner);
+    robest::SolveControl control;
+    control.cancelToken.cancel();
+    EXPECT_EQ(0, solver.solve(subset, 0.01, 100, control).nbIterations);
+    robest::ProblemCosts costs;
+    EXPECT_TRUE(tuner.getCosts(planeFitting->costKey(), costs));
+    EXPECT_FALSE(tuner.getCosts(typeid(*subset).name(), costs));
+
+    std::vector<double> params;
+    ASSERT_TRUE(planeFitting->getModelParams(params));
+    EXPECT_EQ(model, params);
+}
+
+TEST(Tuner, sharedIterations)
+{
+    const int previousNbThreads = omp_get_max_threads();
+    omp_set_num_threads(4);
+
+    // many iterations over few samples
+    auto planeFitting = scene::makeReferencePlane(200);
+    robest::ParallelTuner tuner;
+    tuner.setRegionCost(1e-6);
+    tuner.setCosts(planeFitting->costKey(), planeCosts());
+
+    robest::RANSAC solver;
+    solver.setAutoTuning(true, tuner);
+    solver.solve(planeFitting, 0.01, 2000);
+    const robest::ParallelDecision & decision = solver.getStats().parallel;
+    EXPECT_EQ(robest::ParallelStrategy::Hypotheses, decision.strategy);
+    EXPECT_EQ(4, decision.nbThreads);
+    EXPECT_EQ(2000, solver.getStats().nbIterations);
+    EXPECT_EQ(4, omp_get_max_threads());
+    omp_set_num_threads(previousNbThreads);
+}
+
+// Without the tuner, the strategy set on the estimator is recorded
+TEST(Tuner, untunedDecision)
+{
+    auto planeFitting = scene::makeReferencePlane(2000);
+
+    robest::MSAC serial;
+    serial.solve(planeFitting, 0.01, 50);
+    EXPECT_EQ(robest::ParallelStrategy::Serial, serial.getStats().parallel.strategy);
+    EXPECT_FALSE(serial.getStats().parallel.tuned);
+
+    robest::MSAC batched;
+    batched.setBatchSize(8, 512);
+    batched.solve(planeFitting, 0.01, 50);
+    const robest::ParallelDecision & decision = batched.getStats().parallel;
+    EXPECT_EQ(robest::ParallelStrategy::Data, decision.strategy);
+    EXPECT_EQ(8, decision.batchSize);
+    EXPECT_EQ(512, decision.tileSize);
+    EXPECT_EQ(omp_get_max_threads(), decision.nbThreads);
+
+    robest::RANSAC shared;
+    shared.solve(planeFitting, 0.01, 50);
+    EXPECT_EQ(robest::ParallelStrategy::Hypotheses, shared.getStats().parallel.strategy);
+    EXPECT_EQ(64, shared.getStats().parallel.chunkSize);
+    EXPECT_STREQ("hypotheses", robest::parallelStrategyName(shared.getStats().parallel.strategy));
+}
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "LineFitting/LineFitting.hpp"
+
+namespace {
+
+// Line problem recording the minimal samples the model is estimated from
+class RecordingLineProblem : public LineFittingProblem
+{
+  public:
+    std::vector<std::vector<int>> samples;
+
+    void estimModelFromSamples(const std::vector<int> & samplesIdx)
+    {
+        if ((int)samplesIdx.size() == getNbMinSamples())
+        {
+            std::vector<int> sorted(samplesIdx);
+            std::sort(sorted.begin(), sorted.end());
+            samples.push_back(sorted);
+        }
+        LineFittingProblem::estimModelFromSamples(samplesIdx);
+    }
+
+    size_t nbDistinctSamples() const
+    {
+        return std::set<std::vector<int>>(samples.begin(), samples.end()).size();
+    }
+};
+
+// nbPts random points, the 3 first ones are on y = 2x + 1
+std::shared_ptr<RecordingLineProblem> makeProblem(int nbPts)
+{
+    std::default_random_engine generator(29);
+    std::uniform_real_distribution<double> uniform(0.0, 10.0);
+
+    std::vector<double> x(nbPts), y(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        x[i] = uniform(generator);
+        y[i] = (i < 3) ? 2.0 * x[i] + 1.0 : uniform(generator) * 3.0;
+    }
+
+    auto problem = std::make_shared<RecordingLineProblem>();
+    problem->setData(x, y);
+    return problem;
+}
+
+} // namespace
+
+TEST(UniqueSampling, enumeratesAllSubsets)
+{
+    auto problem = makeProblem(12);
+
+    // C(12,2) = 66 subsets, less than the budget
+    robest::MSAC solver;
+    solver.setUniqueSamples(true);
+    robest::SolveStatus status = solver.solve(problem, 0.01, 1000, robest::SolveControl::unbounded());
+
+    EXPECT_EQ(66, status.nbIterations);
+    EXPECT_TRUE(status.confidenceReached);
+    // plus the final estimation from the best sample
+    ASSERT_EQ(67u, problem->samples.size());
+    EXPECT_EQ(66u, problem->nbDistinctSamples());
+
+    // lexicographic order
+    EXPECT_EQ(std::vector<int>({0, 1}), problem->samples.front());
+    EXPECT_EQ(std::vector<int>({10, 11}), problem->samples[65]);
+}
+
+TEST(UniqueSampling, exhaustiveSearchIsOptimal)
+{
+    // only 3 points out of 25 support the line: found for sure by the enumeration
+    auto problem = makeProblem(25);
+
+    robest::RANSAC solver;
+    solver.setUniqueSamples(true);
+    solver.solve(problem, 0.0001, 1000);
+
+    double k, b;
+    problem->getResult(k, b);
+    EXPECT_NEAR(2.0, k, 1.0e-9);
+    EXPECT_NEAR(1.0, b, 1.0e-9);
+    EXPECT_EQ(std::vector<int>({0, 1, 2}), solver.getInliersIndices());
+}
+
+TEST(UniqueSampling, enumerationWithBatches)
+{
+    auto problem = makeProblem(12);
+
+    robest::MSAC solver;
+    solver.setUniqueSamples(true);
+    solver.setBatchSize(8, 4);
+    robest::SolveStatus status = solver.solve(problem, 0.01, 1000, robest::SolveControl::unbounded());
+
+    EXPECT_EQ(66, status.nbIterations);
+    EXPECT_EQ(66u, problem->nbDistinctSamples());
+}
+
+TEST(UniqueSampling, noDuplicateRandomSamples)
+{
+    auto problem = makeProblem(30);
+
+    // C(30,2) = 435 subsets, more than the budget: random draws without duplicates
+    // (without the check, 100 draws almost surely repeat a sample)
+    robest::MSAC solver;
+    solver.setUniqueSamples(true);
+    robest::SolveStatus status = solver.solve(problem, 0.01, 100, robest::SolveControl::unbounded());
+
+    EXPECT_EQ(100, status.nbIterations);
+    ASSERT_EQ(101u, problem->samples.size());
+    EXPECT_EQ(100u, problem->nbDistinctSamples());
+}
+
+TEST(UniqueSampling, disabledByDefault)
+{
+    auto problem = makeProblem(12);
+
+    // 1000 random draws among 66 subsets repeat some of them
+    robest::MSAC solver;
+    robest::SolveStatus status = solver.solve(problem, 0.01, 1000, robest::SolveControl::unbounded());
+
+    EXPECT_EQ(1000, status.nbIterations);
+    EXPECT_LT(problem->nbDistinctSamples(), problem->samples.size());
+}
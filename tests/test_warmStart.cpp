@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+
+#include <random>
+
+#include "LineFitting/LineFitting.hpp"
+#include "SphereFitting/SphereFitting.hpp"
+
+// y = k*x + b with a given ratio of uniform outliers
+static void generateTrackedLine(double k, double b, int nbPts, double outliersRatio, unsigned seed,
+                                std::vector<double> & x, std::vector<double> & y)
+{
+    std::default_random_engine generator(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 100.0);
+
+    x.resize(nbPts);
+    y.resize(nbPts);
+    for (int i = 0; i < nbPts; i++)
+    {
+        x[i] = uniform(generator);
+        y[i] = (i < (int)(nbPts * outliersRatio)) ? uniform(generator) : k * x[i] + b;
+    }
+}
+
+TEST(WarmStart, priorModelFromPreviousFrame)
+{
+    std::vector<double> x, y;
+    generateTrackedLine(0.5, 2.0, 1000, 0.6, 1, x, y);
+
+    auto lineFitting = std::make_shared<LineFittingProblem>();
+    lineFitting->setData(x, y);
+
+    robest::RANSAC solver;
+    robest::SolveStatus first = solver.solve(lineFitting, 0.1, 50000, robest::SolveControl());
+    std::vector<double> previousModel;
+    ASSERT_TRUE(lineFitting->getModelParams(previousModel));
+
+    // next frame: the line has barely moved
+    generateTrackedLine(0.5, 2.05, 1000, 0.6, 2, x, y);
+    lineFitting->setData(x, y);
+
+    // the prior model is the best one from the start, samples drawn among its
+    // inliers are not counted by the adaptive termination
+    solver.setPriorModels({previousModel});
+    solver.setPriorSamplingBias(0.5);
+    robest::SolveStatus next = solver.solve(lineFitting, 0.1, 50000, robest::SolveControl());
+
+    EXPECT_TRUE(next.confidenceReached);
+#ifndef ROBEST_DISABLE_STATS
+    EXPECT_EQ(-1, solver.getStats().lastImprovementIter);
+#endif
+    EXPECT_GE(next.nbIterations, first.nbIterations);
+
+    double res_k, res_b;
+    lineFitting->getResult(res_k, res_b);
+    EXPECT_NEAR(0.5, res_k, 1.0e-6);
+    EXPECT_NEAR(2.05, res_b, 1.0e-4);
+}
+
+TEST(WarmStart, exactPriorIsRetained)
+{
+    std::vector<double> x, y;
+    generateTrackedLine(1.0, 0.0, 200, 0.5, 3, x, y);
+
+    auto lineFitting = std::make_shared<LineFittingProblem>();
+    lineFitting->setData(x, y);
+
+    // sampled models cannot have more inliers than the true one
+    robest::RANSAC solver;
+    solver.setPriorModels({{1.0, 0.0}});
+    solver.solve(lineFitting, 0.1, 20);
+
+#ifndef ROBEST_DISABLE_STATS
+    EXPECT_EQ(-1, solver.getStats().lastImprovementIter);
+#endif
+    EXPECT_NEAR(0.5, solver.getInliersFraction(), 1.0e-11);
+}
+
+TEST(WarmStart, priorInliersAndBiasedSampling)
+{
+    std::vector<double> x = {8,   12,   4,   8,   8,   8,  30, -20,  7, 15};
+    std::vector<double> y = {10,   6,   6,   2,   6,   6,   0,  11,  3, -9};
+    std::vector<double> z = {-11, -11, -11, -11, -15,  -7,  4,   2, 25,  8};
+
+    auto sphereFitting = std::make_shared<SphereFittingProblem>();
+    sphereFitting->setData(x, y, z);
+
+    robest::MSAC solver;
+    solver.setPriorInliers({{0, 1, 2, 3, 4, 5}});
+    solver.setPriorSamplingBias(0.9);
+    robest::SolveStatus status = solver.solve(sphereFitting, 0.1, 1000, robest::SolveControl());
+
+    EXPECT_TRUE(status.confidenceReached);
+
+    double res_cx, res_cy, res_cz, res_r;
+    sphereFitting->getResult(res_cx, res_cy, res_cz, res_r);
+    EXPECT_NEAR(  8.0, res_cx, 1.0e-9);
+    EXPECT_NEAR(  6.0, res_cy, 1.0e-9);
+    EXPECT_NEAR(-11.0, res_cz, 1.0e-9);
+    EXPECT_NEAR(  4.0, res_r,  1.0e-9);
+    EXPECT_EQ(6u, solver.getInliersIndices().size());
+}
+
+TEST(WarmStart, invalidPriorsAreIgnored)
+{
+    std::vector<double> x, y;
+    generateTrackedLine(1.0, 0.0, 50, 0.2, 4, x, y);
+
+    auto lineFitting = std::make_shared<LineFittingProblem>();
+    lineFitting->setData(x, y);
+
+    robest::MSAC solver;
+    solver.setPriorModels({{1.0, 0.0, 3.0}});     // wrong number of parameters
+    solver.setPriorInliers({{0}, {10, 1000}});    // too small, out of range
+    solver.solve(lineFitting, 0.1, 500);
+
+    double res_k, res_b;
+    lineFitting->getResult(res_k, res_b);
+    EXPECT_NEAR(1.0, res_k, 1.0e-9);
+    EXPECT_NEAR(0.0, res_b, 1.0e-9);
+}
+
+// A prior on a distractor structure: its samples must not count towards the
+// confidence, the solve goes on until the uniform samples find the dominant line
+TEST(WarmStart, wrongPriorDoesNotStopTheSolve)
+{
+    // 50% on y = 0.5*x + 2, 20% on y = -x + 80, 30% of outliers
+    std::vector<double> x, y;
+    generateTrackedLine(0.5, 2.0, 1000, 0.5, 5, x, y);
+    std::vector<int> distractor;
+    for (int i = 0; i < 200; i++)
+    {
+        y[i] = -x[i] + 80.0;
+        distractor.push_back(i);
+    }
+
+    auto lineFitting = std::make_shared<LineFittingProblem>();
+    lineFitting->setData(x, y);
+
+    robest::RANSAC solver;
+    solver.setPriorInliers({distractor});
+    solver.setPriorSamplingBias(0.9);
+    robest::SolveStatus status = solver.solve(lineFitting, 0.1, 50000, robest::SolveControl());
+
+    // one uniform sample in ten, all inliers of the line with probability 0.25
+    EXPECT_TRUE(status.confidenceReached);
+    EXPECT_GE(status.nbIterations, solver.calculateIterationsNb(2, 0.99f, 0.5f) * 5);
+
+    double res_k, res_b;
+    lineFitting->getResult(res_k, res_b);
+    EXPECT_NEAR(0.5, res_k, 1.0e-2);   // refit on the inliers, outliers near the line included
+    EXPECT_NEAR(2.0, res_b, 1.0e-1);
+}